@@ -128,6 +128,18 @@ if(OPTION_USE_POLL)
    CHECK_FUNCTION_EXISTS(poll USE_POLL)
 endif(OPTION_USE_POLL)
 
+option(OPTION_USE_EPOLL "use epoll, timerfd and eventfd if available" ON)
+mark_as_advanced(OPTION_USE_EPOLL)
+
+if(OPTION_USE_EPOLL)
+   CHECK_FUNCTION_EXISTS(epoll_create1 HAVE_EPOLL_CREATE1)
+   CHECK_FUNCTION_EXISTS(timerfd_create HAVE_TIMERFD_CREATE)
+   CHECK_FUNCTION_EXISTS(eventfd HAVE_EVENTFD)
+   if(HAVE_EPOLL_CREATE1 AND HAVE_TIMERFD_CREATE AND HAVE_EVENTFD)
+      set(USE_EPOLL 1)
+   endif(HAVE_EPOLL_CREATE1 AND HAVE_TIMERFD_CREATE AND HAVE_EVENTFD)
+endif(OPTION_USE_EPOLL)
+
 #######################################################################
 option(OPTION_BUILD_SHARED_LIBS
     "Build shared libraries(in addition to static libraries)"
@@ -23,6 +23,7 @@
 #include <FL/fl_show_input.H>
 #include <FL/Fl_File_Chooser.H>
 #include "alignment_panel.h"
+#include "undo.h"
 #include "../src/flstring.h"
 #include <stdio.h>
 #include <stdlib.h>
@@ -195,6 +196,9 @@ void Fl_Function_Type::open() {
       else if (w == f_panel_ok) break;
       else if (!w) Fl::wait();
     }
+    // save the type once, before the first try to change it:
+    undo_checkpoint(this);
+    undo_suspend();
     const char*c = f_name_input->value();
     while (isspace(*c)) c++;
     message = c_check(c); if (message) continue;
@@ -238,6 +242,7 @@ void Fl_Function_Type::open() {
     break;
   }
 BREAK2:
+  undo_resume();
   function_panel->hide();
 }
 
@@ -466,6 +471,8 @@ void Fl_Code_Type::open() {
       else if (w == code_panel_ok) break;
       else if (!w) Fl::wait();
     }
+    undo_checkpoint(this);
+    undo_suspend();
     char*c = code_input->buffer()->text();
     message = c_check(c); if (message) continue;
     name(c);
@@ -473,6 +480,7 @@ void Fl_Code_Type::open() {
     break;
   }
 BREAK2:
+  undo_resume();
   code_panel->hide();
 }
 
@@ -555,6 +563,8 @@ void Fl_CodeBlock_Type::open() {
       else if (w == codeblock_panel_ok) break;
       else if (!w) Fl::wait();
     }
+    undo_checkpoint(this);
+    undo_suspend();
     const char*c = code_before_input->value();
     message = c_check(c); if (message) continue;
     name(c);
@@ -564,6 +574,7 @@ void Fl_CodeBlock_Type::open() {
     break;
   }
 BREAK2:
+  undo_resume();
   codeblock_panel->hide();
 }
 
@@ -659,6 +670,8 @@ void Fl_Decl_Type::open() {
       else if (w == decl_panel_ok) break;
       else if (!w) Fl::wait();
     }
+    undo_checkpoint(this);
+    undo_suspend();
     const char*c = decl_input->value();
     while (isspace(*c)) c++;
     message = c_check(c&&c[0]=='#' ? c+1 : c);
@@ -691,6 +704,7 @@ void Fl_Decl_Type::open() {
     break;
   }
 BREAK2:
+  undo_resume();
   decl_panel->hide();
 }
 
@@ -827,6 +841,8 @@ void Fl_Data_Type::open() {
       }
       else if (!w) Fl::wait();
     }
+    undo_checkpoint(this);
+    undo_suspend();
     // store the variable name:
     const char*c = data_input->value();
     char *s = strdup(c), *p = s, *q, *n;
@@ -889,6 +905,7 @@ void Fl_Data_Type::open() {
     break;
   }
 BREAK2:
+  undo_resume();
   data_panel->hide();
 }
 
@@ -1018,6 +1035,8 @@ void Fl_DeclBlock_Type::open() {
       else if (w == declblock_panel_ok) break;
       else if (!w) Fl::wait();
     }
+    undo_checkpoint(this);
+    undo_suspend();
     const char*c = decl_before_input->value();
     while (isspace(*c)) c++;
     message = c_check(c&&c[0]=='#' ? c+1 : c);
@@ -1036,6 +1055,7 @@ void Fl_DeclBlock_Type::open() {
     break;
   }
 BREAK2:
+  undo_resume();
   declblock_panel->hide();
 }
 
@@ -1206,6 +1226,8 @@ void Fl_Comment_Type::open() {
       }
       else if (!w) Fl::wait();
     }
+    undo_checkpoint(this);
+    undo_suspend();
     char*c = comment_input->buffer()->text();
     name(c);
     free(c);
@@ -1222,6 +1244,7 @@ void Fl_Comment_Type::open() {
     break;
   }
 BREAK2:
+  undo_resume();
   title_buf[0] = 0;
   comment_panel->hide();
 }
@@ -1397,6 +1420,8 @@ void Fl_Class_Type::open() {
       else if (w == c_panel_ok) break;
       else if (!w) Fl::wait();
     }
+    undo_checkpoint(this);
+    undo_suspend();
     const char*c = c_name_input->value();
     char *s = strdup(c);
     size_t len = strlen(s);
@@ -1439,6 +1464,7 @@ void Fl_Class_Type::open() {
     break;
   }
 BREAK2:
+  undo_resume();
   class_panel->hide();
 }
 
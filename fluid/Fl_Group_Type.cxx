@@ -25,6 +25,7 @@
 #include <FL/Fl_Table.H>
 #include <FL/fl_message.H>
 #include "Fl_Widget_Type.h"
+#include "undo.h"
 #include "../src/flstring.h"
 
 // Override group's resize behavior to do nothing to children:
@@ -68,6 +69,8 @@ void group_cb(Fl_Widget *, void *) {
     return;
   }
   Fl_Widget_Type* q = (Fl_Widget_Type*)qq;
+  undo_checkpoint_selected(UNDO_PARENTS);
+  undo_suspend();
   force_parent = 1;
   Fl_Group_Type *n = (Fl_Group_Type*)(Fl_Group_type.make());
   n->move_before(q);
@@ -80,6 +83,7 @@ void group_cb(Fl_Widget *, void *) {
     t = nxt;
   }
   fix_group_size(n);
+  undo_resume();
 }
 
 void ungroup_cb(Fl_Widget *, void *) {
@@ -98,12 +102,15 @@ void ungroup_cb(Fl_Widget *, void *) {
       return;
     }
   }
+  undo_checkpoint(q->parent);
+  undo_suspend();
   for (n = q->next; n && n->level > q->level;) {
     Fl_Type *nxt = n->remove();
     n->insert(q);
     n = nxt;
   }
   delete q;
+  undo_resume();
 }
 
 ////////////////////////////////////////////////////////////////
@@ -296,6 +303,8 @@ void Fl_Table_Type::add_child(Fl_Type* cc, Fl_Type* before) {
 
 void Fl_Group_Type::remove_child(Fl_Type* cc) {
   Fl_Widget_Type* c = (Fl_Widget_Type*)cc;
+  // don't keep resizing a widget that is moved to another group:
+  if (((Fl_Group*)o)->resizable() == c->o) ((Fl_Group*)o)->resizable(0);
   ((Fl_Group*)o)->remove(c->o);
   o->redraw();
 }
@@ -309,6 +318,7 @@ void Fl_Tabs_Type::remove_child(Fl_Type* cc) {
 
 void Fl_Table_Type::remove_child(Fl_Type* cc) {
   Fl_Widget_Type* c = (Fl_Widget_Type*)cc;
+  if (((Fl_Table*)o)->resizable() == c->o) ((Fl_Table*)o)->resizable(0);
   ((Fl_Table*)o)->remove(*(c->o));
   o->redraw();
 }
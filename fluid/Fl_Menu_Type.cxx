@@ -25,6 +25,7 @@
 #include <FL/Fl.H>
 #include "Fl_Widget_Type.h"
 #include "alignment_panel.h"
+#include "undo.h"
 #include <FL/fl_message.H>
 #include <FL/Fl_Menu_.H>
 #include <FL/Fl_Button.H>
@@ -630,6 +631,7 @@ void shortcut_in_cb(Shortcut_Button* i, void* v) {
     i->redraw();
   } else {
     int mod = 0;
+    undo_checkpoint_selected();
     for (Fl_Type *o = Fl_Type::first; o; o = o->next)
       if (o->selected && o->is_button()) {
 	Fl_Button* b = (Fl_Button*)(((Fl_Widget_Type*)o)->o);
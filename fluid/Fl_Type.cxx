@@ -580,7 +580,11 @@ void Fl_Type::add(Fl_Type *p) {
   Fl_Type *q;
   int newlevel;
   if (p) {
-    for (q = p->next; q && q->level > p->level; q = q->next) {/*empty*/}
+    // when reading a file, p is usually the parent of the last type and
+    // its children end at the end of the list:
+    for (q = last; q && q != p; q = q->parent) {/*empty*/}
+    if (q) q = 0;
+    else for (q = p->next; q && q->level > p->level; q = q->next) {/*empty*/}
     newlevel = p->level+1;
   } else {
     q = 0;
@@ -830,6 +834,12 @@ static void delete_children(Fl_Type *p) {
   }
 }
 
+// delete a type and all its children:
+void delete_type(Fl_Type *t) {
+  delete_children(t);
+  delete t;
+}
+
 void delete_all(int selected_only) {
   for (Fl_Type *f = Fl_Type::first; f;) {
     if (f->selected || !selected_only) {
@@ -879,6 +889,7 @@ void earlier_cb(Fl_Widget*,void*) {
       Fl_Type* g;
       for (g = f->prev; g && g->level > f->level; g = g->prev) {/*empty*/}
       if (g && g->level == f->level && !g->selected) {
+        if (!mod) undo_checkpoint_selected(UNDO_PARENTS);
         f->move_before(g);
         mod = 1;
       }
@@ -897,6 +908,7 @@ void later_cb(Fl_Widget*,void*) {
       Fl_Type* g;
       for (g = f->next; g && g->level > f->level; g = g->next) {/*empty*/}
       if (g && g->level == f->level && !g->selected) {
+        if (!mod) undo_checkpoint_selected(UNDO_PARENTS);
         g->move_before(f);
         mod = 1;
       }
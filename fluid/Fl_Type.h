@@ -841,6 +841,7 @@ Fl_Widget *make_widget_browser(int X,int Y,int W,int H);
 void redraw_widget_browser(Fl_Type*);
 extern int modflag;
 void delete_all(int selected_only=0);
+void delete_type(Fl_Type *t);
 void selection_changed(Fl_Type* new_current);
 void reveal_in_browser(Fl_Type*);
 int has_toplevel_function(const char *rtype, const char *sig);
@@ -855,6 +856,8 @@ int has_toplevel_function(const char *rtype, const char *sig);
 void write_word(const char *);
 void write_string(const char *,...) __fl_attr((__format__ (__printf__, 1, 2)));
 int write_file(const char *, int selected_only = 0);
+char *write_file_to_memory(int *size);
+char *write_types_to_memory(Fl_Type *t, int n, int *size);
 int write_code(const char *cfile, const char *hfile);
 int write_strings(const char *sfile);
 
@@ -877,6 +880,8 @@ extern int indentation;
 extern const char* indent();
 
 int read_file(const char *, int merge);
+int read_file_from_memory(const char *data, int size, int merge);
+int read_types_from_memory(Fl_Type *p, const char *data, int size);
 const char *read_word(int wantbrace = 0);
 void read_error(const char *format, ...);
 
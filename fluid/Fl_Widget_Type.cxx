@@ -22,6 +22,7 @@
 #include <FL/Fl_Input.H>
 #include "Fl_Widget_Type.h"
 #include "alignment_panel.h"
+#include "undo.h"
 #include <FL/fl_message.H>
 #include <FL/Fl_Slider.H>
 #include <FL/Fl_Spinner.H>
@@ -210,7 +211,12 @@ Fl_Widget_Type::Fl_Widget_Type() {
 Fl_Widget_Type::~Fl_Widget_Type() {
   if (o) {
     o->hide();
-    if (o->parent()) ((Fl_Group*)o->parent())->remove(*o);
+    if (o->parent()) {
+      Fl_Group *p = (Fl_Group*)o->parent();
+      // don't leave the group resizing a deleted widget:
+      if (p->resizable() == o) p->resizable(0);
+      p->remove(*o);
+    }
     delete o;
   }
   if (subclass_) free((void*)subclass_);
@@ -320,7 +326,10 @@ void name_cb(Fl_Input* o, void *v) {
     the_panel->label(buf);
   } else {
     if (numselected == 1) {
+      undo_checkpoint(current_widget);
+      undo_suspend();
       current_widget->name(o->value());
+      undo_resume();
       // I don't update window title, as it probably is being closed
       // and wm2 (a window manager) barfs if you retitle and then
       // hide a window:
@@ -335,6 +344,7 @@ void name_public_member_cb(Fl_Choice* i, void* v) {
     if (current_widget->is_in_class()) i->show(); else i->hide();
   } else {
     int mod = 0;
+    undo_checkpoint_selected();
     for (Fl_Type *o = Fl_Type::first; o; o = o->next) {
       if (o->selected && o->is_widget()) {
         Fl_Widget_Type *w = ((Fl_Widget_Type*)o);
@@ -360,6 +370,7 @@ void name_public_cb(Fl_Choice* i, void* v) {
     if (current_widget->is_in_class()) i->hide(); else i->show();
   } else {
     int mod = 0;
+    undo_checkpoint_selected();
     for (Fl_Type *o = Fl_Type::first; o; o = o->next) {
       if (o->selected && o->is_widget()) {
 	((Fl_Widget_Type*)o)->public_ = i->value();
@@ -386,12 +397,15 @@ void label_cb(Fl_Input* i, void *v) {
     strcpy(oldlabel,i->value());
   } else {
     int mod = 0;
+    undo_checkpoint_selected();
+    undo_suspend();
     for (Fl_Type *o = Fl_Type::first; o; o = o->next) {
       if (o->selected && o->is_widget()) {
         o->label(i->value());
 	mod = 1;
       }
     }
+    undo_resume();
     if (mod) set_modflag(1);
   }
 }
@@ -407,12 +421,15 @@ void image_cb(Fl_Input* i, void *v) {
     } else i->deactivate();
   } else {
     int mod = 0;
+    undo_checkpoint_selected();
+    undo_suspend();
     for (Fl_Type *o = Fl_Type::first; o; o = o->next) {
       if (o->selected && o->is_widget()) {
         ((Fl_Widget_Type*)o)->image_name(i->value());
 	mod = 1;
       }
     }
+    undo_resume();
     if (mod) set_modflag(1);
   }
 }
@@ -427,12 +444,15 @@ void image_browse_cb(Fl_Button* b, void *v) {
     int mod = 0;
     if (ui_find_image(image_input->value())) {
       image_input->value(ui_find_image_name);
+      undo_checkpoint_selected();
+      undo_suspend();
       for (Fl_Type *o = Fl_Type::first; o; o = o->next) {
 	if (o->selected && o->is_widget()) {
 	  ((Fl_Widget_Type*)o)->image_name(ui_find_image_name);
 	  mod = 1;
 	}
       }
+      undo_resume();
       if (mod) set_modflag(1);
     }
   }
@@ -449,12 +469,15 @@ void inactive_cb(Fl_Input* i, void *v) {
     } else i->deactivate();
   } else {
     int mod = 0;
+    undo_checkpoint_selected();
+    undo_suspend();
     for (Fl_Type *o = Fl_Type::first; o; o = o->next) {
       if (o->selected && o->is_widget()) {
         ((Fl_Widget_Type*)o)->inactive_name(i->value());
 	mod = 1;
       }
     }
+    undo_resume();
     if (mod) set_modflag(1);
   }
 }
@@ -469,12 +492,15 @@ void inactive_browse_cb(Fl_Button* b, void *v) {
     int mod = 0;
     if (ui_find_image(inactive_input->value())) {
       inactive_input->value(ui_find_image_name);
+      undo_checkpoint_selected();
+      undo_suspend();
       for (Fl_Type *o = Fl_Type::first; o; o = o->next) {
 	if (o->selected && o->is_widget()) {
 	  ((Fl_Widget_Type*)o)->inactive_name(ui_find_image_name);
 	  mod = 1;
 	}
       }
+      undo_resume();
       if (mod) set_modflag(1);
     }
   }
@@ -488,12 +514,15 @@ void tooltip_cb(Fl_Input* i, void *v) {
     } else i->deactivate();
   } else {
     int mod = 0;
+    undo_checkpoint_selected();
+    undo_suspend();
     for (Fl_Type *o = Fl_Type::first; o; o = o->next) {
       if (o->selected && o->is_widget()) {
         ((Fl_Widget_Type*)o)->tooltip(i->value());
 	mod = 1;
       }
     }
+    undo_resume();
     if (mod) set_modflag(1);
   }
 }
@@ -509,6 +538,7 @@ void x_cb(Fl_Value_Input *i, void *v) {
     } else x_input->deactivate();
   } else {
     int mod = 0;
+    undo_checkpoint_selected();
     for (Fl_Type *o = Fl_Type::first; o; o = o->next) {
       if (o->selected && o->is_widget()) {
         Fl_Widget *w = ((Fl_Widget_Type *)o)->o;
@@ -534,6 +564,7 @@ void y_cb(Fl_Value_Input *i, void *v) {
     } else y_input->deactivate();
   } else {
     int mod = 0;
+    undo_checkpoint_selected();
     for (Fl_Type *o = Fl_Type::first; o; o = o->next) {
       if (o->selected && o->is_widget()) {
         Fl_Widget *w = ((Fl_Widget_Type *)o)->o;
@@ -559,6 +590,7 @@ void w_cb(Fl_Value_Input *i, void *v) {
     } else w_input->deactivate();
   } else {
     int mod = 0;
+    undo_checkpoint_selected();
     for (Fl_Type *o = Fl_Type::first; o; o = o->next) {
       if (o->selected && o->is_widget()) {
         Fl_Widget *w = ((Fl_Widget_Type *)o)->o;
@@ -584,6 +616,7 @@ void h_cb(Fl_Value_Input *i, void *v) {
     } else h_input->deactivate();
   } else {
     int mod = 0;
+    undo_checkpoint_selected();
     for (Fl_Type *o = Fl_Type::first; o; o = o->next) {
       if (o->selected && o->is_widget()) {
         Fl_Widget *w = ((Fl_Widget_Type *)o)->o;
@@ -610,6 +643,7 @@ void wc_relative_cb(Fl_Light_Button *i, void *v) {
     }
   } else {
     int mod = 0;
+    undo_checkpoint_selected();
     for (Fl_Type *o = Fl_Type::first; o; o = o->next) {
       if (o->selected && !strcmp(current_widget->type_name(), "widget_class")) {
         Fl_Widget_Class_Type *t = (Fl_Widget_Class_Type *)o;
@@ -741,6 +775,7 @@ void box_cb(Fl_Choice* i, void *v) {
     int n = int(boxmenu[m].argument());
     if (!n) return; // should not happen
     if (n == ZERO_ENTRY) n = 0;
+    undo_checkpoint_selected();
     for (Fl_Type *o = Fl_Type::first; o; o = o->next) {
       if (o->selected && o->is_widget()) {
 	Fl_Widget_Type* q = (Fl_Widget_Type*)o;
@@ -775,6 +810,7 @@ void down_box_cb(Fl_Choice* i, void *v) {
     int n = int(boxmenu[m].argument());
     if (!n) return; // should not happen
     if (n == ZERO_ENTRY) n = 0;
+    undo_checkpoint_selected();
     for (Fl_Type *o = Fl_Type::first; o; o = o->next) {
       if (o->selected) {
 	if (o->is_button() && !o->is_menu_item()) {
@@ -827,6 +863,7 @@ void when_cb(Fl_Choice* i, void *v) {
     int n = int(whenmenu[m].argument());
     if (!n) return; // should not happen
     if (n == ZERO_ENTRY) n = 0;
+    undo_checkpoint_selected();
     for (Fl_Type *o = Fl_Type::first; o; o = o->next) {
       if (o->selected && o->is_widget()) {
 	Fl_Widget_Type* q = (Fl_Widget_Type*)o;
@@ -845,6 +882,7 @@ void when_button_cb(Fl_Light_Button* i, void *v) {
   } else {
     int mod = 0;
     int n = i->value() ? FL_WHEN_NOT_CHANGED : 0;
+    undo_checkpoint_selected();
     for (Fl_Type *o = Fl_Type::first; o; o = o->next) {
       if (o->selected && o->is_widget()) {
 	Fl_Widget_Type* q = (Fl_Widget_Type*)o;
@@ -889,6 +927,8 @@ void resizable_cb(Fl_Light_Button* i,void* v) {
     i->activate();
     i->value(current_widget->resizable());
   } else {
+    // the resizable widget is saved with the parent's children:
+    undo_checkpoint(current_widget->is_window() ? current_widget : current_widget->parent);
     current_widget->resizable(i->value());
     set_modflag(1);
   }
@@ -902,6 +942,10 @@ void hotspot_cb(Fl_Light_Button* i,void* v) {
     i->activate();
     i->value(current_widget->hotspot());
   } else {
+    // setting the hotspot clears it in the rest of the window:
+    Fl_Type *w = current_widget;
+    while (w->parent && w->parent->is_widget() && !w->is_window()) w = w->parent;
+    undo_checkpoint(w);
     current_widget->hotspot(i->value());
     if (current_widget->is_menu_item()) {current_widget->redraw(); return;}
     if (i->value()) {
@@ -925,6 +969,8 @@ void visible_cb(Fl_Light_Button* i, void* v) {
   } else {
     int mod = 0;
     int n = i->value();
+    // showing a tab or wizard page hides its siblings:
+    undo_checkpoint_selected(n ? UNDO_PARENTS : UNDO_CHANGE);
     for (Fl_Type *o = Fl_Type::first; o; o = o->next) {
       if (o->selected && o->is_widget()) {
 	Fl_Widget_Type* q = (Fl_Widget_Type*)o;
@@ -952,6 +998,7 @@ void active_cb(Fl_Light_Button* i, void* v) {
   } else {
     int mod = 0;
     int n = i->value();
+    undo_checkpoint_selected();
     for (Fl_Type *o = Fl_Type::first; o; o = o->next) {
       if (o->selected && o->is_widget()) {
 	Fl_Widget_Type* q = (Fl_Widget_Type*)o;
@@ -993,6 +1040,7 @@ void labelfont_cb(Fl_Choice* i, void *v) {
   } else {
     int mod = 0;
     int n = i->value();
+    undo_checkpoint_selected();
     for (Fl_Type *o = Fl_Type::first; o; o = o->next) {
       if (o->selected && o->is_widget()) {
 	Fl_Widget_Type* q = (Fl_Widget_Type*)o;
@@ -1013,6 +1061,7 @@ void labelsize_cb(Fl_Value_Input* i, void *v) {
     int mod = 0;
     n = int(i->value());
     if (n <= 0) n = Fl_Widget_Type::default_size;
+    undo_checkpoint_selected();
     for (Fl_Type *o = Fl_Type::first; o; o = o->next) {
       if (o->selected && o->is_widget()) {
 	Fl_Widget_Type* q = (Fl_Widget_Type*)o;
@@ -1048,6 +1097,7 @@ void labeltype_cb(Fl_Choice* i, void *v) {
     int m = i->value();
     int n = int(labeltypemenu[m].argument());
     if (n<0) return; // should not happen
+    undo_checkpoint_selected();
     for (Fl_Type *o = Fl_Type::first; o; o = o->next) {
       if (o->selected && o->is_widget()) {
 	Fl_Widget_Type* p = (Fl_Widget_Type*)o;
@@ -1071,6 +1121,7 @@ void color_cb(Fl_Button* i, void *v) {
     Fl_Color d = fl_show_colormap(c);
     if (d == c) return;
     c = d;
+    undo_checkpoint_selected();
     for (Fl_Type *o = Fl_Type::first; o; o = o->next) {
       if (o->selected && o->is_widget()) {
 	Fl_Widget_Type* q = (Fl_Widget_Type*)o;
@@ -1095,6 +1146,7 @@ void color2_cb(Fl_Button* i, void *v) {
     Fl_Color d = fl_show_colormap(c);
     if (d == c) return;
     c = d;
+    undo_checkpoint_selected();
     for (Fl_Type *o = Fl_Type::first; o; o = o->next) {
       if (o->selected && o->is_widget()) {
 	Fl_Widget_Type* q = (Fl_Widget_Type*)o;
@@ -1114,6 +1166,7 @@ void labelcolor_cb(Fl_Button* i, void *v) {
     Fl_Color d = fl_show_colormap(c);
     if (d == c) return;
     c = d;
+    undo_checkpoint_selected();
     for (Fl_Type *o = Fl_Type::first; o; o = o->next) {
       if (o->selected && o->is_widget()) {
 	Fl_Widget_Type* q = (Fl_Widget_Type*)o;
@@ -1158,6 +1211,7 @@ void align_cb(Fl_Button* i, void *v) {
     i->value(current_widget->o->align() & b);
   } else {
     int mod = 0;
+    undo_checkpoint_selected();
     for (Fl_Type *o = Fl_Type::first; o; o = o->next) {
       if (o->selected && o->is_widget()) {
 	Fl_Widget_Type* q = (Fl_Widget_Type*)o;
@@ -1202,6 +1256,7 @@ void align_position_cb(Fl_Choice *i, void *v) {
     const Fl_Menu_Item *mi = i->menu() + i->value();
     Fl_Align b = Fl_Align(fl_uintptr_t(mi->user_data()));
     int mod = 0;
+    undo_checkpoint_selected();
     for (Fl_Type *o = Fl_Type::first; o; o = o->next) {
       if (o->selected && o->is_widget()) {
 	Fl_Widget_Type* q = (Fl_Widget_Type*)o;
@@ -1231,6 +1286,7 @@ void align_text_image_cb(Fl_Choice *i, void *v) {
     const Fl_Menu_Item *mi = i->menu() + i->value();
     Fl_Align b = Fl_Align(fl_uintptr_t(mi->user_data()));
     int mod = 0;
+    undo_checkpoint_selected();
     for (Fl_Type *o = Fl_Type::first; o; o = o->next) {
       if (o->selected && o->is_widget()) {
 	Fl_Widget_Type* q = (Fl_Widget_Type*)o;
@@ -1262,12 +1318,15 @@ void callback_cb(CodeEditor* i, void *v) {
       if (i->window()) i->window()->make_current();
       haderror = 1;
     }
+    undo_checkpoint_selected();
+    undo_suspend();
     for (Fl_Type *o = Fl_Type::first; o; o = o->next) {
       if (o->selected) {
         o->callback(c);
         mod = 1;
       }
     }
+    undo_resume();
     if (mod) set_modflag(1);
     free(c);
   }
@@ -1286,12 +1345,15 @@ void comment_cb(Fl_Text_Editor* i, void *v) {
       if (i->window()) i->window()->make_current();
       haderror = 1;
     }
+    undo_checkpoint_selected();
+    undo_suspend();
     for (Fl_Type *o = Fl_Type::first; o; o = o->next) {
       if (o->selected) {
         o->comment(c);
         mod = 1;
       }
     }
+    undo_resume();
     if (mod) set_modflag(1);
     free(c);
   }
@@ -1305,12 +1367,15 @@ void user_data_cb(Fl_Input *i, void *v) {
     const char *c = i->value();
     const char *d = c_check(c);
     if (d) {fl_message("Error in user_data: %s",d); haderror = 1; return;}
+    undo_checkpoint_selected();
+    undo_suspend();
     for (Fl_Type *o = Fl_Type::first; o; o = o->next) {
       if (o->selected) {
         o->user_data(c);
 	mod = 1;
       }
     }
+    undo_resume();
     if (mod) set_modflag(1);
   }
 }
@@ -1332,12 +1397,15 @@ void user_data_type_cb(Fl_Input *i, void *v) {
 	d = "must be pointer or long";
     }
     if (d) {fl_message("Error in type: %s",d); haderror = 1; return;}
+    undo_checkpoint_selected();
+    undo_suspend();
     for (Fl_Type *o = Fl_Type::first; o; o = o->next) {
       if (o->selected) {
         o->user_data_type(c);
 	mod = 1;
       }
     }
+    undo_resume();
     if (mod) set_modflag(1);
   }
 }
@@ -1353,6 +1421,8 @@ void v_input_cb(Fl_Input* i, void* v) {
     const char *c = i->value();
     const char *d = c_check(c&&c[0]=='#' ? c+1 : c);
     if (d) {fl_message("Error in %s: %s",i->label(),d); haderror = 1; return;}
+    undo_checkpoint_selected();
+    undo_suspend();
     for (Fl_Type *o = Fl_Type::first; o; o = o->next) {
       if (o->selected && o->is_widget()) {
 	Fl_Widget_Type *t = (Fl_Widget_Type*)o;
@@ -1360,6 +1430,7 @@ void v_input_cb(Fl_Input* i, void* v) {
 	mod = 1;
       }
     }
+    undo_resume();
     if (mod) set_modflag(1);
   }
 }
@@ -1371,6 +1442,8 @@ void subclass_cb(Fl_Input* i, void* v) {
   } else {
     int mod = 0;
     const char *c = i->value();
+    undo_checkpoint_selected();
+    undo_suspend();
     for (Fl_Type *o = Fl_Type::first; o; o = o->next) {
       if (o->selected && o->is_widget()) {
 	Fl_Widget_Type *t = (Fl_Widget_Type*)o;
@@ -1378,6 +1451,7 @@ void subclass_cb(Fl_Input* i, void* v) {
 	mod = 1;
       }
     }
+    undo_resume();
     if (mod) set_modflag(1);
   }
 }
@@ -1399,6 +1473,7 @@ void textfont_cb(Fl_Choice* i, void* v) {
   } else {
     int mod = 0;
     n = (Fl_Font)i->value();
+    undo_checkpoint_selected();
     for (Fl_Type *o = Fl_Type::first; o; o = o->next) {
       if (o->selected && o->is_widget()) {
 	Fl_Widget_Type* q = (Fl_Widget_Type*)o;
@@ -1420,6 +1495,7 @@ void textsize_cb(Fl_Value_Input* i, void* v) {
     int mod = 0;
     s = int(i->value());
     if (s <= 0) s = Fl_Widget_Type::default_size;
+    undo_checkpoint_selected();
     for (Fl_Type *o = Fl_Type::first; o; o = o->next) {
       if (o->selected && o->is_widget()) {
 	Fl_Widget_Type* q = (Fl_Widget_Type*)o;
@@ -1444,6 +1520,7 @@ void textcolor_cb(Fl_Button* i, void* v) {
     Fl_Color d = fl_show_colormap(c);
     if (d == c) return;
     c = d;
+    undo_checkpoint_selected();
     for (Fl_Type *o = Fl_Type::first; o; o = o->next) {
       if (o->selected && o->is_widget()) {
 	Fl_Widget_Type* q = (Fl_Widget_Type*)o;
@@ -1467,6 +1544,7 @@ void min_w_cb(Fl_Value_Input* i, void* v) {
   } else {
     int mod = 0;
     int n = (int)i->value();
+    undo_checkpoint_selected();
     for (Fl_Type *o = Fl_Type::first; o; o = o->next) {
       if (o->selected && o->is_window()) {
         ((Fl_Window_Type*)current_widget)->sr_min_w = n;
@@ -1484,6 +1562,7 @@ void min_h_cb(Fl_Value_Input* i, void* v) {
   } else {
     int mod = 0;
     int n = (int)i->value();
+    undo_checkpoint_selected();
     for (Fl_Type *o = Fl_Type::first; o; o = o->next) {
       if (o->selected && o->is_window()) {
         ((Fl_Window_Type*)current_widget)->sr_min_h = n;
@@ -1501,6 +1580,7 @@ void max_w_cb(Fl_Value_Input* i, void* v) {
   } else {
     int mod = 0;
     int n = (int)i->value();
+    undo_checkpoint_selected();
     for (Fl_Type *o = Fl_Type::first; o; o = o->next) {
       if (o->selected && o->is_window()) {
         ((Fl_Window_Type*)current_widget)->sr_max_w = n;
@@ -1518,6 +1598,7 @@ void max_h_cb(Fl_Value_Input* i, void* v) {
   } else {
     int mod = 0;
     int n = (int)i->value();
+    undo_checkpoint_selected();
     for (Fl_Type *o = Fl_Type::first; o; o = o->next) {
       if (o->selected && o->is_window()) {
         ((Fl_Window_Type*)current_widget)->sr_max_h = n;
@@ -1532,6 +1613,7 @@ void set_min_size_cb(Fl_Button*, void* v) {
   if (v == LOAD) {
   } else {
     int mod = 0;
+    undo_checkpoint_selected();
     for (Fl_Type *o = Fl_Type::first; o; o = o->next) {
       if (o->selected && o->is_window()) {
         Fl_Window_Type *win = (Fl_Window_Type*)current_widget;
@@ -1549,6 +1631,7 @@ void set_max_size_cb(Fl_Button*, void* v) {
   if (v == LOAD) {
   } else {
     int mod = 0;
+    undo_checkpoint_selected();
     for (Fl_Type *o = Fl_Type::first; o; o = o->next) {
       if (o->selected && o->is_window()) {
         Fl_Window_Type *win = (Fl_Window_Type*)current_widget;
@@ -1574,6 +1657,7 @@ void slider_size_cb(Fl_Value_Input* i, void* v) {
   } else {
     int mod = 0;
     double n = i->value();
+    undo_checkpoint_selected();
     for (Fl_Type *o = Fl_Type::first; o; o = o->next) {
       if (o->selected && o->is_widget()) {
 	Fl_Widget_Type* q = (Fl_Widget_Type*)o;
@@ -1603,6 +1687,7 @@ void min_cb(Fl_Value_Input* i, void* v) {
   } else {
     int mod = 0;
     double n = i->value();
+    undo_checkpoint_selected();
     for (Fl_Type *o = Fl_Type::first; o; o = o->next) {
       if (o->selected && o->is_widget()) {
 	Fl_Widget_Type* q = (Fl_Widget_Type*)o;
@@ -1636,6 +1721,7 @@ void max_cb(Fl_Value_Input* i, void* v) {
   } else {
     int mod = 0;
     double n = i->value();
+    undo_checkpoint_selected();
     for (Fl_Type *o = Fl_Type::first; o; o = o->next) {
       if (o->selected && o->is_widget()) {
 	Fl_Widget_Type* q = (Fl_Widget_Type*)o;
@@ -1669,6 +1755,7 @@ void step_cb(Fl_Value_Input* i, void* v) {
   } else {
     int mod = 0;
     double n = i->value();
+    undo_checkpoint_selected();
     for (Fl_Type *o = Fl_Type::first; o; o = o->next) {
       if (o->selected && o->is_widget()) {
         Fl_Widget_Type* q = (Fl_Widget_Type*)o;
@@ -1703,6 +1790,7 @@ void value_cb(Fl_Value_Input* i, void* v) {
   } else {
     int mod = 0;
     double n = i->value();
+    undo_checkpoint_selected();
     for (Fl_Type *o = Fl_Type::first; o; o = o->next) {
       if (o->selected && o->is_widget()) {
 	Fl_Widget_Type* q = (Fl_Widget_Type*)o;
@@ -1750,6 +1838,7 @@ void subtype_cb(Fl_Choice* i, void* v) {
     int mod = 0;
     int n = int(i->mvalue()->argument());
     Fl_Menu_Item* m = current_widget->subtypes();
+    undo_checkpoint_selected();
     for (Fl_Type *o = Fl_Type::first; o; o = o->next) {
       if (o->selected && o->is_widget()) {
         Fl_Widget_Type* q = (Fl_Widget_Type*)o;
@@ -1800,7 +1889,12 @@ void ok_cb(Fl_Return_Button* o, void* v) {
 void revert_cb(Fl_Button*, void*) {
   // We have to revert all dynamically changing fields:
   // but for now only the first label works...
-  if (numselected == 1) current_widget->label(oldlabel);
+  if (numselected == 1) {
+    undo_checkpoint(current_widget);
+    undo_suspend();
+    current_widget->label(oldlabel);
+    undo_resume();
+  }
   propagate_load(the_panel, LOAD);
 }
 
@@ -391,6 +391,7 @@ void Fl_Window_Type::add_child(Fl_Type* cc, Fl_Type* before) {
 
 void Fl_Window_Type::remove_child(Fl_Type* cc) {
   Fl_Widget_Type* c = (Fl_Widget_Type*)cc;
+  if (((Fl_Window*)o)->resizable() == c->o) ((Fl_Window*)o)->resizable(0);
   ((Fl_Window*)o)->remove(c->o);
   o->redraw();
 }
@@ -440,6 +441,7 @@ void modal_cb(Fl_Light_Button* i, void* v) {
     i->show();
     i->value(((Fl_Window_Type *)current_widget)->modal);
   } else {
+    undo_checkpoint(current_widget);
     ((Fl_Window_Type *)current_widget)->modal = i->value();
     set_modflag(1);
   }
@@ -451,6 +453,7 @@ void non_modal_cb(Fl_Light_Button* i, void* v) {
     i->show();
     i->value(((Fl_Window_Type *)current_widget)->non_modal);
   } else {
+    undo_checkpoint(current_widget);
     ((Fl_Window_Type *)current_widget)->non_modal = i->value();
     set_modflag(1);
   }
@@ -462,6 +465,7 @@ void border_cb(Fl_Light_Button* i, void* v) {
     i->show();
     i->value(((Fl_Window*)(current_widget->o))->border());
   } else {
+    undo_checkpoint(current_widget);
     ((Fl_Window*)(current_widget->o))->border(i->value());
     set_modflag(1);
   }
@@ -479,6 +483,8 @@ void xclass_cb(Fl_Input* i, void* v) {
     i->value(((Fl_Widget_Type *)current_widget)->xclass);
   } else {
     int mod = 0;
+    undo_checkpoint_selected();
+    undo_suspend();
     for (Fl_Type *o = Fl_Type::first; o; o = o->next) {
       if (o->selected && o->is_widget()) {
         mod = 1;
@@ -489,6 +495,7 @@ void xclass_cb(Fl_Input* i, void* v) {
 	else if (w->is_menu_item()) w->redraw();
       }
     }
+    undo_resume();
     if (mod) set_modflag(1);
   }
 }
@@ -1139,7 +1146,8 @@ extern Fl_Menu_Item New_Menu[];
 // move the selected children according to current dx,dy,drag state:
 void Fl_Window_Type::moveallchildren()
 {
-  undo_checkpoint();
+  // groups grow with their children, so save the whole window:
+  undo_checkpoint(this);
   Fl_Type *i;
   for (i=next; i && i->level>level;) {
     if (i->selected && i->is_widget() && !i->is_menu_item()) {
@@ -55,7 +55,7 @@ void align_widget_cb(Fl_Widget*, long how)
 	  if (!changed) {
 	    changed = 1;
 	    set_modflag(1);
-	    undo_checkpoint();
+	    undo_checkpoint_selected();
 	  }
 
 	  Fl_Widget *w = ((Fl_Widget_Type *)o)->o;
@@ -92,7 +92,7 @@ void align_widget_cb(Fl_Widget*, long how)
 	  if (!changed) {
 	    changed = 1;
 	    set_modflag(1);
-	    undo_checkpoint();
+	    undo_checkpoint_selected();
 	  }
 
 	  Fl_Widget *w = ((Fl_Widget_Type *)o)->o;
@@ -126,7 +126,7 @@ void align_widget_cb(Fl_Widget*, long how)
 	  if (!changed) {
 	    changed = 1;
 	    set_modflag(1);
-	    undo_checkpoint();
+	    undo_checkpoint_selected();
 	  }
 
 	  Fl_Widget *w = ((Fl_Widget_Type *)o)->o;
@@ -159,7 +159,7 @@ void align_widget_cb(Fl_Widget*, long how)
 	  if (!changed) {
 	    changed = 1;
 	    set_modflag(1);
-	    undo_checkpoint();
+	    undo_checkpoint_selected();
 	  }
 
 	  Fl_Widget *w = ((Fl_Widget_Type *)o)->o;
@@ -196,7 +196,7 @@ void align_widget_cb(Fl_Widget*, long how)
 	  if (!changed) {
 	    changed = 1;
 	    set_modflag(1);
-	    undo_checkpoint();
+	    undo_checkpoint_selected();
 	  }
 
 	  Fl_Widget *w = ((Fl_Widget_Type *)o)->o;
@@ -230,7 +230,7 @@ void align_widget_cb(Fl_Widget*, long how)
 	  if (!changed) {
 	    changed = 1;
 	    set_modflag(1);
-	    undo_checkpoint();
+	    undo_checkpoint_selected();
 	  }
 
 	  Fl_Widget *w = ((Fl_Widget_Type *)o)->o;
@@ -271,7 +271,7 @@ void align_widget_cb(Fl_Widget*, long how)
 	  if (!changed) {
 	    changed = 1;
 	    set_modflag(1);
-	    undo_checkpoint();
+	    undo_checkpoint_selected();
 	  }
 
 	  Fl_Widget *w = ((Fl_Widget_Type *)o)->o;
@@ -314,7 +314,7 @@ void align_widget_cb(Fl_Widget*, long how)
 	  if (!changed) {
 	    changed = 1;
 	    set_modflag(1);
-	    undo_checkpoint();
+	    undo_checkpoint_selected();
 	  }
 
 	  Fl_Widget *w = ((Fl_Widget_Type *)o)->o;
@@ -351,7 +351,7 @@ void align_widget_cb(Fl_Widget*, long how)
 	  if (!changed) {
 	    changed = 1;
 	    set_modflag(1);
-	    undo_checkpoint();
+	    undo_checkpoint_selected();
 	  }
 
 	  Fl_Widget *w = ((Fl_Widget_Type *)o)->o;
@@ -384,7 +384,7 @@ void align_widget_cb(Fl_Widget*, long how)
 	  if (!changed) {
 	    changed = 1;
 	    set_modflag(1);
-	    undo_checkpoint();
+	    undo_checkpoint_selected();
 	  }
 
 	  Fl_Widget *w = ((Fl_Widget_Type *)o)->o;
@@ -419,7 +419,7 @@ void align_widget_cb(Fl_Widget*, long how)
 	  if (!changed) {
 	    changed = 1;
 	    set_modflag(1);
-	    undo_checkpoint();
+	    undo_checkpoint_selected();
 	  }
 
 	  Fl_Widget *w = ((Fl_Widget_Type *)o)->o;
@@ -443,7 +443,7 @@ void align_widget_cb(Fl_Widget*, long how)
 	if (!changed) {
 	  changed = 1;
 	  set_modflag(1);
-	  undo_checkpoint();
+	  undo_checkpoint_selected();
 	}
 
 	Fl_Widget *w = ((Fl_Widget_Type *)o)->o;
@@ -472,7 +472,7 @@ void align_widget_cb(Fl_Widget*, long how)
 	if (!changed) {
 	  changed = 1;
 	  set_modflag(1);
-	  undo_checkpoint();
+	  undo_checkpoint_selected();
 	}
 
 	Fl_Widget *w = ((Fl_Widget_Type *)o)->o;
@@ -508,7 +508,7 @@ void widget_size_cb(Fl_Widget *, long size) {
       if (!changed) {
 	changed = 1;
 	set_modflag(1);
-	undo_checkpoint();
+	undo_checkpoint_selected();
       }
 
       Fl_Widget *w = ((Fl_Widget_Type *)o)->o;
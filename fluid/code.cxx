@@ -25,8 +25,88 @@
 #include "Fl_Type.h"
 #include "alignment_panel.h"
 
-static FILE *code_file;
-static FILE *header_file;
+#ifndef va_copy
+#  define va_copy(a, b) ((a) = (b))
+#endif
+
+// Generated code is collected in memory and written when it is complete.
+// Files whose contents did not change are not written again, so their
+// time stamps stay the same and nothing that depends on them is rebuilt:
+
+struct code_buffer {
+  char *text;
+  int size, alloc;
+};
+
+static code_buffer code_text, header_text;
+static code_buffer *code_file;
+static code_buffer *header_file;
+
+static void buffer_reserve(code_buffer *b, int n) {
+  if (b->size + n > b->alloc) {
+    b->alloc = 2*b->alloc + n + 4096;
+    b->text = (char*)realloc(b->text, b->alloc);
+  }
+}
+
+static void buffer_putc(code_buffer *b, int c) {
+  buffer_reserve(b, 1);
+  b->text[b->size++] = c;
+}
+
+static void buffer_puts(code_buffer *b, const char *s) {
+  int n = (int)strlen(s);
+  buffer_reserve(b, n);
+  memcpy(b->text + b->size, s, n);
+  b->size += n;
+}
+
+static void buffer_vprintf(code_buffer *b, const char *format, va_list args) {
+  va_list copy;
+  va_copy(copy, args);
+  buffer_reserve(b, 1);
+  int n = vsnprintf(b->text + b->size, b->alloc - b->size, format, args);
+  if (n >= b->alloc - b->size) { // did not fit, format again
+    buffer_reserve(b, n + 1);
+    vsnprintf(b->text + b->size, b->alloc - b->size, format, copy);
+  }
+  va_end(copy);
+  if (n > 0) b->size += n;
+}
+
+static void buffer_printf(code_buffer *b, const char *format, ...) {
+  va_list args;
+  va_start(args, format);
+  buffer_vprintf(b, format, args);
+  va_end(args);
+}
+
+// write a buffer to a file unless the file already contains exactly this
+// text; a null filename writes to stdout. Returns 0 and sets errno on error:
+static int buffer_write(code_buffer *b, const char *filename, const char *mode) {
+  if (!filename) {
+    fwrite(b->text, 1, b->size, stdout);
+    return 1;
+  }
+  FILE *f = fl_fopen(filename, "rb");
+  if (f) {
+    int same = 1, n = 0;
+    char buf[8192];
+    for (;;) {
+      int r = (int)fread(buf, 1, sizeof(buf), f);
+      if (r <= 0) break;
+      if (n + r > b->size || memcmp(buf, b->text + n, r)) {same = 0; break;}
+      n += r;
+    }
+    fclose(f);
+    if (same && n == b->size) return 1;
+  }
+  f = fl_fopen(filename, mode);
+  if (!f) return 0;
+  int x = (int)fwrite(b->text, 1, b->size, f) == b->size;
+  if (fclose(f) < 0) x = 0;
+  return x;
+}
 
 extern char i18n_program[];
 extern int i18n_type;
@@ -44,21 +124,114 @@ int is_id(char c) {
 ////////////////////////////////////////////////////////////////
 // Generate unique but human-readable identifiers:
 
+// Identifiers and declarations are kept in hash tables, which are
+// cleared for every file that is written. Each identifier also
+// remembers how many of its numbered variants are already taken, so
+// that a run of widgets with the same name does not test every
+// variant again.
+
 struct id {
   char* text;
   void* object;
-  id *left, *right;
-  id (const char* t, void* o) : text(strdup(t)), object(o) {left = right = 0;}
-  ~id();
+  unsigned hash;
+  int which;		// variants 1 to which are in use
+  id *next;		// next id with the same text hash
+  id *next_object;	// next id with the same object hash
 };
 
-id::~id() {
-  delete left;
-  free((void *)text);
-  delete right;
+struct id_table {
+  id **text_bucket;
+  id **object_bucket;
+  int size, count;
+  id *find(const char *t, unsigned h);
+  id *add(const char *t, unsigned h, void *o);
+  void clear();
+};
+
+static unsigned id_hash(const char *t) {
+  unsigned h = 2166136261U;
+  while (*t) {h ^= (unsigned char)*t++; h *= 16777619U;}
+  return h;
 }
 
-static id* id_root;
+static unsigned object_hash(void *o) {
+  return (unsigned)((size_t)o >> 3) * 2654435761U;
+}
+
+id *id_table::find(const char *t, unsigned h) {
+  if (!size) return 0;
+  for (id *p = text_bucket[h & (size-1)]; p; p = p->next)
+    if (p->hash == h && !strcmp(p->text, t)) return p;
+  return 0;
+}
+
+id *id_table::add(const char *t, unsigned h, void *o) {
+  if (count >= size) {
+    // grow and rehash both tables:
+    int n = size ? 2*size : 256;
+    id **tb = (id **)calloc(n, sizeof(id *));
+    id **ob = (id **)calloc(n, sizeof(id *));
+    for (int i = 0; i < size; i++) {
+      id *p, *next;
+      for (p = text_bucket[i]; p; p = next) {
+        next = p->next;
+        p->next = tb[p->hash & (n-1)];
+        tb[p->hash & (n-1)] = p;
+      }
+      for (p = object_bucket[i]; p; p = next) {
+        next = p->next_object;
+        unsigned oh = object_hash(p->object) & (n-1);
+        p->next_object = ob[oh];
+        ob[oh] = p;
+      }
+    }
+    free(text_bucket); text_bucket = tb;
+    free(object_bucket); object_bucket = ob;
+    size = n;
+  }
+  id *p = new id;
+  p->text = strdup(t);
+  p->object = o;
+  p->hash = h;
+  p->which = 0;
+  p->next = text_bucket[h & (size-1)];
+  text_bucket[h & (size-1)] = p;
+  unsigned oh = object_hash(o) & (size-1);
+  p->next_object = object_bucket[oh];
+  object_bucket[oh] = p;
+  count++;
+  return p;
+}
+
+void id_table::clear() {
+  for (int i = 0; i < size; i++) {
+    id *p, *next;
+    for (p = text_bucket[i]; p; p = next) {
+      next = p->next;
+      free(p->text);
+      delete p;
+    }
+  }
+  free(text_bucket); text_bucket = 0;
+  free(object_bucket); object_bucket = 0;
+  size = count = 0;
+}
+
+static id_table ids;
+
+// return the number of a variant "%x" suffix, 0 if there is none:
+static unsigned variant(const char *t) {
+  unsigned n = 0;
+  int i;
+  if (*t == '0') return 0;
+  for (i = 0; t[i]; i++) {
+    if (i == 8) return 0;
+    if (t[i] >= '0' && t[i] <= '9') n = n*16 + t[i] - '0';
+    else if (t[i] >= 'a' && t[i] <= 'f') n = n*16 + t[i] - 'a' + 10;
+    else return 0;
+  }
+  return n;
+}
 
 const char* unique_id(void* o, const char* type, const char* name, const char* label) {
   char buffer[128];
@@ -72,23 +245,32 @@ const char* unique_id(void* o, const char* type, const char* name, const char* l
     while (is_id(*n)) *q++ = *n++;
   }
   *q = 0;
-  // okay, search the tree and see if the name was already used:
-  id** p = &id_root;
-  int which = 0;
-  while (*p) {
-    int i = strcmp(buffer, (*p)->text);
-    if (!i) {
-      if ((*p)->object == o) return (*p)->text;
-      // already used, we need to pick a new name:
-      sprintf(q,"%x",++which);
-      p = &id_root;
-      continue;
-    }
-    else if (i < 0) p = &((*p)->left);
-    else p  = &((*p)->right);
+  // okay, search the table and see if the name was already used:
+  unsigned h = id_hash(buffer);
+  id* base = ids.find(buffer, h);
+  if (!base) return ids.add(buffer, h, o)->text;
+  if (base->object == o) return base->text;
+  // already used, we need to pick a new name. Variants that are in use
+  // may belong to this object, the first one of those is the name:
+  int len = (int)(q - buffer);
+  id* own = 0;
+  unsigned which = 0;
+  for (id* p = ids.object_bucket[object_hash(o) & (ids.size-1)]; p; p = p->next_object) {
+    if (p->object != o || strncmp(p->text, buffer, len)) continue;
+    unsigned i = variant(p->text + len);
+    if (i && i <= (unsigned)base->which && (!own || i < which)) {own = p; which = i;}
+  }
+  if (own) return own->text;
+  // otherwise use the first variant that is not in use yet:
+  for (int i = base->which + 1; ; i++) {
+    sprintf(q,"%x",i);
+    h = id_hash(buffer);
+    id* p = ids.find(buffer, h);
+    if (!p) p = ids.add(buffer, h, o);
+    else if (p->object != o) continue;
+    base->which = i;
+    return p->text;
   }
-  *p = new id(buffer, o);
-  return (*p)->text;
 }
 
 ////////////////////////////////////////////////////////////////
@@ -104,25 +286,10 @@ const char* indent() {
 ////////////////////////////////////////////////////////////////
 // declarations/include files:
 // Each string generated by write_declare is written only once to
-// the header file.  This is done by keeping a binary tree of all
-// the calls so far and not printing it if it is in the tree.
-
-struct included {
-  char *text;
-  included *left, *right;
-  included(const char *t) {
-    text = strdup(t);
-    left = right = 0;
-  }
-  ~included();
-};
+// the header file.  This is done by keeping a hash table of all
+// the calls so far and not printing it if it is in the table.
 
-included::~included() {
-  delete left;
-  free((void *)text);
-  delete right;
-}
-static included *included_root;
+static id_table declarations;
 
 int write_declare(const char *format, ...) {
   va_list args;
@@ -130,15 +297,10 @@ int write_declare(const char *format, ...) {
   va_start(args, format);
   vsnprintf(buf, sizeof(buf), format, args);
   va_end(args);
-  included **p = &included_root;
-  while (*p) {
-    int i = strcmp(buf,(*p)->text);
-    if (!i) return 0;
-    else if (i < 0) p = &((*p)->left);
-    else p  = &((*p)->right);
-  }
-  fprintf(header_file,"%s\n",buf);
-  *p = new included(buf);
+  unsigned h = id_hash(buf);
+  if (declarations.find(buf, h)) return 0;
+  buffer_printf(header_file, "%s\n",buf);
+  declarations.add(buf, h, 0);
   return 1;
 }
 
@@ -159,7 +321,7 @@ void write_cstring(const char *s, int length) {
   const char *p = s;
   const char *e = s+length;
   int linelength = 1;
-  putc('\"', code_file);
+  buffer_putc(code_file, '\"');
   for (; p < e;) {
     int c = *p++;
     switch (c) {
@@ -172,9 +334,9 @@ void write_cstring(const char *s, int length) {
     case '\'':
     case '\\':
     QUOTED:
-      if (linelength >= 77) {fputs("\\\n",code_file); linelength = 0;}
-      putc('\\', code_file);
-      putc(c, code_file);
+      if (linelength >= 77) {buffer_puts(code_file, "\\\n"); linelength = 0;}
+      buffer_putc(code_file, '\\');
+      buffer_putc(code_file, c);
       linelength += 2;
       break;
     case '?': // prevent trigraphs by writing ?? as ?\?
@@ -183,24 +345,24 @@ void write_cstring(const char *s, int length) {
     default:
       if (c >= ' ' && c < 127) {
 	// a legal ASCII character
-	if (linelength >= 78) {fputs("\\\n",code_file); linelength = 0;}
-	putc(c, code_file);
+	if (linelength >= 78) {buffer_puts(code_file, "\\\n"); linelength = 0;}
+	buffer_putc(code_file, c);
 	linelength++;
 	break;
       }
       // otherwise we must print it as an octal constant:
       c &= 255;
       if (c < 8) {
-	if (linelength >= 76) {fputs("\\\n",code_file); linelength = 0;}
-	fprintf(code_file, "\\%o",c);
+	if (linelength >= 76) {buffer_puts(code_file, "\\\n"); linelength = 0;}
+	buffer_printf(code_file, "\\%o",c);
 	linelength += 2;
       } else if (c < 64) {
-	if (linelength >= 75) {fputs("\\\n",code_file); linelength = 0;}
-	fprintf(code_file, "\\%o",c);
+	if (linelength >= 75) {buffer_puts(code_file, "\\\n"); linelength = 0;}
+	buffer_printf(code_file, "\\%o",c);
 	linelength += 3;
       } else {
-	if (linelength >= 74) {fputs("\\\n",code_file); linelength = 0;}
-	fprintf(code_file, "\\%o",c);
+	if (linelength >= 74) {buffer_puts(code_file, "\\\n"); linelength = 0;}
+	buffer_printf(code_file, "\\%o",c);
 	linelength += 4;
       }
       // We must not put more numbers after it, because some C compilers
@@ -208,14 +370,14 @@ void write_cstring(const char *s, int length) {
       // pasting to avoid this:
       c = *p;
       if (p < e && ( (c>='0'&&c<='9') || (c>='a'&&c<='f') || (c>='A'&&c<='F') )) {
-	putc('\"', code_file); linelength++;
-	if (linelength >= 79) {fputs("\n",code_file); linelength = 0;}
-	putc('\"', code_file); linelength++;
+	buffer_putc(code_file, '\"'); linelength++;
+	if (linelength >= 79) {buffer_puts(code_file, "\n"); linelength = 0;}
+	buffer_putc(code_file, '\"'); linelength++;
       }
       break;
     }
   }
-  putc('\"', code_file);
+  buffer_putc(code_file, '\"');
 }
 
 // write a C string, quoting characters if necessary:
@@ -229,29 +391,29 @@ void write_cdata(const char *s, int length) {
   }
   if (write_sourceview) {
     if (length>=0)
-      fprintf(code_file, "{ /* ... %d bytes of binary data... */ }", length);
+      buffer_printf(code_file, "{ /* ... %d bytes of binary data... */ }", length);
     else
-      fprintf(code_file, "{ /* ... binary data... */ }");
+      buffer_printf(code_file, "{ /* ... binary data... */ }");
     return;
   }
   if (length==-1) {
-    fprintf(code_file, "{ /* ... undefined size binary data... */ }");
+    buffer_printf(code_file, "{ /* ... undefined size binary data... */ }");
     return;
   }
   const unsigned char *w = (const unsigned char *)s;
   const unsigned char *e = w+length;
   int linelength = 1;
-  putc('{', code_file);
+  buffer_putc(code_file, '{');
   for (; w < e;) {
     unsigned char c = *w++;
     if (c>99) linelength += 4;
     else if (c>9) linelength += 3;
     else linelength += 2;
-    if (linelength >= 77) {fputs("\n",code_file); linelength = 0;}
-    fprintf(code_file, "%d", c);
-    if (w<e) putc(',', code_file);
+    if (linelength >= 77) {buffer_puts(code_file, "\n"); linelength = 0;}
+    buffer_printf(code_file, "%d", c);
+    if (w<e) buffer_putc(code_file, ',');
   }
-  putc('}', code_file);
+  buffer_putc(code_file, '}');
 }
 
 void vwrite_c(const char* format, va_list args) {
@@ -259,7 +421,7 @@ void vwrite_c(const char* format, va_list args) {
     varused = 1;
     return;
   }
-  vfprintf(code_file, format, args);
+  buffer_vprintf(code_file, format, args);
 }
 
 void write_c(const char* format,...) {
@@ -273,7 +435,7 @@ void write_h(const char* format,...) {
   if (varused_test) return;
   va_list args;
   va_start(args, format);
-  vfprintf(header_file, format, args);
+  buffer_vprintf(header_file, format, args);
   va_end(args);
 }
 
@@ -286,9 +448,9 @@ extern Fl_Widget_Class_Type *current_widget_class;
 // of the parent code:
 static Fl_Type* write_code(Fl_Type* p) {
   if (write_sourceview) {
-    p->code_position = (int)ftell(code_file);
+    p->code_position = code_file->size;
     if (p->header_position_end==-1)
-      p->header_position = (int)ftell(header_file);
+      p->header_position = header_file->size;
   }
   // write all code that come before the children code
   // (but don't write the last comment until the very end)
@@ -329,9 +491,9 @@ static Fl_Type* write_code(Fl_Type* p) {
     p->write_code2();
   }
   if (write_sourceview) {
-    p->code_position_end = (int)ftell(code_file);
+    p->code_position_end = code_file->size;
     if (p->header_position_end==-1)
-      p->header_position_end = (int)ftell(header_file);
+      p->header_position_end = header_file->size;
   }
   return q;
 }
@@ -344,43 +506,34 @@ int write_code(const char *s, const char *t) {
   if (write_sourceview) 
     filemode = "wb";
   write_number++;
-  delete id_root; id_root = 0;
+  ids.clear();
   indentation = 0;
   current_class = 0L;
   current_widget_class = 0L;
-  if (!s) code_file = stdout;
-  else {
-    FILE *f = fl_fopen(s, filemode);
-    if (!f) return 0;
-    code_file = f;
-  }
-  if (!t) header_file = stdout;
-  else {
-    FILE *f = fl_fopen(t, filemode);
-    if (!f) {fclose(code_file); return 0;}
-    header_file = f;
-  }
+  code_file = &code_text;
+  header_file = (s || t) ? &header_text : &code_text;
+  code_text.size = header_text.size = 0;
   // if the first entry in the Type tree is a comment, then it is probably 
   // a copyright notice. We print that before anything else in the file!
   Fl_Type* first_type = Fl_Type::first;
   if (first_type && first_type->is_comment()) {
     if (write_sourceview) {
-      first_type->code_position = (int)ftell(code_file);
-      first_type->header_position = (int)ftell(header_file);
+      first_type->code_position = code_file->size;
+      first_type->header_position = header_file->size;
     }
     // it is ok to write non-recusive code here, because comments have no children or code2 blocks
     first_type->write_code1();
     if (write_sourceview) {
-      first_type->code_position_end = (int)ftell(code_file);
-      first_type->header_position_end = (int)ftell(header_file);
+      first_type->code_position_end = code_file->size;
+      first_type->header_position_end = header_file->size;
     }
     first_type = first_type->next;
   }
 
   const char *hdr = "\
 // generated by Fast Light User Interface Designer (fluid) version %.4f\n\n";
-  fprintf(header_file, hdr, FL_VERSION);
-  fprintf(code_file, hdr, FL_VERSION);
+  buffer_printf(header_file, hdr, FL_VERSION);
+  buffer_printf(code_file, hdr, FL_VERSION);
 
   {char define_name[102];
   const char* a = fl_filename_name(t);
@@ -388,8 +541,8 @@ int write_code(const char *s, const char *t) {
   if (!isalpha(*a)) {*b++ = '_';}
   while (*a) {*b++ = isalnum(*a) ? *a : '_'; a++;}
   *b = 0;
-  fprintf(header_file, "#ifndef %s\n", define_name);
-  fprintf(header_file, "#define %s\n", define_name);
+  buffer_printf(header_file, "#ifndef %s\n", define_name);
+  buffer_printf(header_file, "#define %s\n", define_name);
   }  
 
   write_declare("#include <FL/Fl.H>");
@@ -419,17 +572,17 @@ int write_code(const char *s, const char *t) {
   }
   for (Fl_Type* p = first_type; p;) {
     // write all static data for this & all children first
-    if (write_sourceview) p->header_position = (int)ftell(header_file);
+    if (write_sourceview) p->header_position = header_file->size;
     p->write_static();
     if (write_sourceview) {
-      p->header_position_end = (int)ftell(header_file);
+      p->header_position_end = header_file->size;
       if (p->header_position==p->header_position_end) p->header_position_end = -1;
     }
     for (Fl_Type* q = p->next; q && q->level > p->level; q = q->next) {
-      if (write_sourceview) q->header_position = (int)ftell(header_file);
+      if (write_sourceview) q->header_position = header_file->size;
       q->write_static();
       if (write_sourceview) {
-        q->header_position_end = (int)ftell(header_file);
+        q->header_position_end = header_file->size;
         if (q->header_position==q->header_position_end) q->header_position_end = -1;
       }
     }
@@ -437,30 +590,33 @@ int write_code(const char *s, const char *t) {
     p = write_code(p);
   }
 
-  delete included_root; included_root = 0;
+  declarations.clear();
 
-  if (!s) return 1;
+  if (!s) {
+    buffer_write(code_file, 0, filemode);
+    if (t) buffer_write(header_file, t, filemode);
+    return 1;
+  }
 
-  fprintf(header_file, "#endif\n");
+  buffer_printf(header_file, "#endif\n");
 
   Fl_Type* last_type = Fl_Type::last;
   if (last_type && last_type->is_comment()) {
     if (write_sourceview) {
-      last_type->code_position = (int)ftell(code_file);
-      last_type->header_position = (int)ftell(header_file);
+      last_type->code_position = code_file->size;
+      last_type->header_position = header_file->size;
     }
     last_type->write_code1();
     if (write_sourceview) {
-      last_type->code_position_end = (int)ftell(code_file);
-      last_type->header_position_end = (int)ftell(header_file);
+      last_type->code_position_end = code_file->size;
+      last_type->header_position_end = header_file->size;
     }
   }
 
-  int x = fclose(code_file);
-  code_file = 0;
-  int y = fclose(header_file);
-  header_file = 0;
-  return x >= 0 && y >= 0;
+  int x = buffer_write(code_file, s, filemode);
+  int y = x && buffer_write(header_file, t, filemode);
+  code_file = header_file = 0;
+  return x && y;
 }
 
 int write_strings(const char *sfile) {
@@ -935,9 +935,10 @@ extern void select_only(Fl_Type *);
 #include <FL/Fl_Window.H>
 
 static void cb(Fl_Widget *, void *v) {
-  undo_checkpoint();
+  undo_checkpoint_add();
   undo_suspend();
   Fl_Type *t = ((Fl_Type*)v)->make();
+  undo_added(t);
   if (t) {
     if (t->is_widget() && !t->is_window()) {
       Fl_Widget_Type *wt = (Fl_Widget_Type *)t;
@@ -966,9 +967,6 @@ static void cb(Fl_Widget *, void *v) {
     select_only(t);
     set_modflag(1);
     t->open();
-  } else {
-    undo_current --;
-    undo_last --;
   }
   undo_resume();
 }
@@ -1085,18 +1083,65 @@ void fill_in_New_Menu() {
   }
 }
 
-// use keyword to pick the type, this is used to parse files:
-int reading_file;
-Fl_Type *Fl_Type_make(const char *tn) {
-  reading_file = 1; // makes labels be null
-  Fl_Type *r = 0;
+// Type names are looked up in a hash table that is built from New_Menu
+// the first time a file is read. Names are compared ignoring case, and
+// the first type in the menu that uses a name keeps it:
+
+struct type_name_entry {
+  const char *name;
+  Fl_Type *type;
+  type_name_entry *next;
+};
+
+#define TYPE_HASH_SIZE 256
+
+static type_name_entry *type_hash[TYPE_HASH_SIZE];
+static type_name_entry type_names[2*sizeof(New_Menu)/sizeof(*New_Menu)];
+
+static unsigned type_name_hash(const char *n) {
+  unsigned h = 2166136261U;
+  for (; *n; n++) {
+    char c = *n;
+    if (c >= 'A' && c <= 'Z') c += 'a' - 'A';
+    h ^= (unsigned char)c; h *= 16777619U;
+  }
+  return h & (TYPE_HASH_SIZE-1);
+}
+
+static Fl_Type *find_type_name(const char *n) {
+  for (type_name_entry *e = type_hash[type_name_hash(n)]; e; e = e->next)
+    if (!fl_ascii_strcasecmp(n, e->name)) return e->type;
+  return 0;
+}
+
+static void fill_in_type_names() {
+  int k = 0;
   for (unsigned i = 0; i < sizeof(New_Menu)/sizeof(*New_Menu); i++) {
     Fl_Menu_Item *m = New_Menu+i;
     if (!m->user_data()) continue;
     Fl_Type *t = (Fl_Type*)(m->user_data());
-    if (!fl_ascii_strcasecmp(tn,t->type_name())) {r = t->make(); break;}
-    if (!fl_ascii_strcasecmp(tn,t->alt_type_name())) {r = t->make(); break;}
+    const char *n[2] = {t->type_name(), t->alt_type_name()};
+    for (int j = 0; j < 2; j++) {
+      if (find_type_name(n[j])) continue;
+      type_name_entry *e = type_names + k++;
+      unsigned h = type_name_hash(n[j]);
+      e->name = n[j];
+      e->type = t;
+      e->next = type_hash[h];
+      type_hash[h] = e;
+    }
   }
+}
+
+// use keyword to pick the type, this is used to parse files:
+int reading_file;
+Fl_Type *Fl_Type_make(const char *tn) {
+  static char filled_in = 0;
+  if (!filled_in) {fill_in_type_names(); filled_in = 1;}
+  reading_file = 1; // makes labels be null
+  Fl_Type *r = 0;
+  Fl_Type *t = find_type_name(tn);
+  if (t) r = t->make();
   reading_file = 0;
   return r;
 }
@@ -33,6 +33,36 @@
 // BASIC FILE WRITING:
 
 static FILE *fout;
+static char *out_buf;		// output buffer while writing to memory
+static int out_size, out_alloc;
+static int out_mem;		// write to out_buf instead of fout
+
+static void out_reserve(int n) {
+  if (out_size + n > out_alloc) {
+    out_alloc = 2*out_alloc + n;
+    out_buf = (char*)realloc(out_buf, out_alloc);
+  }
+}
+
+static void out_char(int c) {
+  if (out_mem) {
+    out_reserve(1);
+    out_buf[out_size++] = c;
+  } else {
+    putc(c, fout);
+  }
+}
+
+static void out_str(const char *s) {
+  if (out_mem) {
+    int n = (int)strlen(s);
+    out_reserve(n);
+    memcpy(out_buf + out_size, s, n);
+    out_size += n;
+  } else {
+    fputs(s, fout);
+  }
+}
 
 int open_write(const char *s) {
   if (!s) {fout = stdout; return 1;}
@@ -56,13 +86,13 @@ int is_id(char); // in code.C
 
 // write a string, quoting characters if necessary:
 void write_word(const char *w) {
-  if (needspace) putc(' ', fout);
+  if (needspace) out_char(' ');
   needspace = 1;
-  if (!w || !*w) {fprintf(fout,"{}"); return;}
+  if (!w || !*w) {out_str("{}"); return;}
   const char *p;
   // see if it is a single word:
   for (p = w; is_id(*p); p++) ;
-  if (!*p) {fprintf(fout,"%s",w); return;}
+  if (!*p) {out_str(w); return;}
   // see if there are matching braces:
   int n = 0;
   for (p = w; *p; p++) {
@@ -71,7 +101,7 @@ void write_word(const char *w) {
   }
   int mismatched = (n != 0);
   // write out brace-quoted string:
-  putc('{', fout);
+  out_char('{');
   for (; *w; w++) {
     switch (*w) {
     case '{':
@@ -79,12 +109,12 @@ void write_word(const char *w) {
       if (!mismatched) break;
     case '\\':
     case '#':
-      putc('\\',fout);
+      out_char('\\');
       break;
     }
-    putc(*w,fout);
+    out_char(*w);
   }
-  putc('}', fout);
+  out_char('}');
 }
 
 // write an arbitrary formatted word, or a comment, etc.
@@ -92,57 +122,99 @@ void write_word(const char *w) {
 // unless the format starts with a newline character ('\n'):
 void write_string(const char *format, ...) {
   va_list args;
+  if (needspace && *format != '\n') out_char(' ');
   va_start(args, format);
-  if (needspace && *format != '\n') fputc(' ',fout);
-  vfprintf(fout, format, args);
-  va_end(args);
+  if (out_mem) {
+    int n = vsnprintf(out_buf + out_size, out_alloc - out_size, format, args);
+    va_end(args);
+    if (n >= out_alloc - out_size) { // did not fit, format again
+      out_reserve(n + 1);
+      va_start(args, format);
+      vsnprintf(out_buf + out_size, out_alloc - out_size, format, args);
+      va_end(args);
+    }
+    if (n > 0) out_size += n;
+  } else {
+    vfprintf(fout, format, args);
+    va_end(args);
+  }
   needspace = !isspace(format[strlen(format)-1] & 255);
 }
 
 // start a new line and indent it for a given nesting level:
 void write_indent(int n) {
-  fputc('\n',fout);
-  while (n--) {fputc(' ',fout); fputc(' ',fout);}
+  out_char('\n');
+  while (n--) {out_char(' '); out_char(' ');}
   needspace = 0;
 }
 
 // write a '{' at the given indenting level:
 void write_open(int) {
-  if (needspace) fputc(' ',fout);
-  fputc('{',fout);
+  if (needspace) out_char(' ');
+  out_char('{');
   needspace = 0;
 }
 
 // write a '}' at the given indenting level:
 void write_close(int n) {
   if (needspace) write_indent(n);
-  fputc('}',fout);
+  out_char('}');
   needspace = 1;
 }
 
 ////////////////////////////////////////////////////////////////
 // BASIC FILE READING:
 
-static FILE *fin;
+// Files are read into memory as a whole and the lexer works on that
+// buffer, which avoids a locked stdio call for every character:
+static char *in_data;			// file contents while reading a file
+static const char *in_ptr, *in_end;	// input that is left
 static int lineno;
 static const char *fname;
 
+static int in_char() {
+  return in_ptr < in_end ? (*in_ptr++ & 255) : EOF;
+}
+
+static void in_unget(int c) {
+  if (c != EOF) in_ptr--;
+}
+
+static int in_eof() {
+  return in_ptr >= in_end;
+}
+
 int open_read(const char *s) {
   lineno = 1;
-  if (!s) {fin = stdin; fname = "stdin"; return 1;}
-  FILE *f = fl_fopen(s,"r");
-  if (!f) return 0;
-  fin = f;
-  fname = s;
+  FILE *f;
+  if (!s) {f = stdin; fname = "stdin";}
+  else {
+    f = fl_fopen(s,"r");
+    if (!f) return 0;
+    fname = s;
+  }
+  int size = 0, alloc = 0;
+  for (;;) {
+    if (alloc - size < 4096) {
+      alloc = alloc ? 2*alloc : 65536;
+      in_data = (char*)realloc(in_data, alloc);
+    }
+    int n = (int)fread(in_data + size, 1, alloc - size, f);
+    if (n <= 0) break;
+    size += n;
+  }
+  int err = ferror(f);
+  if (f != stdin) fclose(f);
+  if (err) {free(in_data); in_data = 0; return 0;}
+  in_ptr = in_data;
+  in_end = in_data + size;
   return 1;
 }
 
 int close_read() {
-  if (fin != stdin) {
-    int x = fclose(fin);
-    fin = 0;
-    return x >= 0;
-  }
+  free(in_data);
+  in_data = 0;
+  in_ptr = in_end = 0;
   return 1;
 }
 
@@ -151,7 +223,7 @@ int close_read() {
 void read_error(const char *format, ...) {
   va_list args;
   va_start(args, format);
-  if (!fin) {
+  if (!in_ptr) {
     char buffer[1024];
     vsnprintf(buffer, sizeof(buffer), format, args);
     fl_message("%s", buffer);
@@ -173,7 +245,7 @@ static int hexdigit(int x) {
 
 static int read_quoted() {	// read whatever character is after a \ .
   int c,d,x;
-  switch(c = fgetc(fin)) {
+  switch(c = in_char()) {
   case '\n': lineno++; return -1;
   case 'a' : return('\a');
   case 'b' : return('\b');
@@ -184,9 +256,9 @@ static int read_quoted() {	// read whatever character is after a \ .
   case 'v' : return('\v');
   case 'x' :	/* read hex */
     for (c=x=0; x<3; x++) {
-      int ch = fgetc(fin);
+      int ch = in_char();
       d = hexdigit(ch);
-      if (d > 15) {ungetc(ch,fin); break;}
+      if (d > 15) {in_unget(ch); break;}
       c = (c<<4)+d;
     }
     break;
@@ -194,9 +266,9 @@ static int read_quoted() {	// read whatever character is after a \ .
     if (c<'0' || c>'7') break;
     c -= '0';
     for (x=0; x<2; x++) {
-      int ch = fgetc(fin);
+      int ch = in_char();
       d = hexdigit(ch);
-      if (d>7) {ungetc(ch,fin); break;}
+      if (d>7) {in_unget(ch); break;}
       c = (c<<3)+d;
     }
     break;
@@ -232,11 +304,11 @@ const char *read_word(int wantbrace) {
 
   // skip all the whitespace before it:
   for (;;) {
-    x = getc(fin);
-    if (x < 0 && feof(fin)) {	// eof
+    x = in_char();
+    if (x < 0 && in_eof()) {	// eof
       return 0;
     } else if (x == '#') {	// comment
-      do x = getc(fin); while (x >= 0 && x != '\n');
+      do x = in_char(); while (x >= 0 && x != '\n');
       lineno++;
       continue;
     } else if (x == '\n') {
@@ -254,10 +326,10 @@ const char *read_word(int wantbrace) {
     int length = 0;
     int nesting = 0;
     for (;;) {
-      x = getc(fin);
+      x = in_char();
       if (x<0) {read_error("Missing '}'"); break;}
       else if (x == '#') { // embedded comment
-	do x = getc(fin); while (x >= 0 && x != '\n');
+	do x = in_char(); while (x >= 0 && x != '\n');
 	lineno++;
 	continue;
       } else if (x == '\n') lineno++;
@@ -285,9 +357,9 @@ const char *read_word(int wantbrace) {
       else if (x<0 || isspace(x & 255) || x=='{' || x=='}' || x=='#') break;
       buffer[length++] = x;
       expand_buffer(length);
-      x = getc(fin);
+      x = in_char();
     }
-    ungetc(x, fin);
+    in_unget(x);
     buffer[length] = 0;
     return buffer;
 
@@ -309,8 +381,7 @@ extern int code_file_set;
 extern const char* header_file_name;
 extern const char* code_file_name;
 
-int write_file(const char *filename, int selected_only) {
-  if (!open_write(filename)) return 0;
+static void write_project(int selected_only) {
   write_string("# data file for the Fltk User Interface Designer (fluid)\n"
 	       "version %.4f",FL_VERSION);
   if(!include_H_from_C)
@@ -344,9 +415,51 @@ int write_file(const char *filename, int selected_only) {
       p = p->next;
     }
   }
+}
+
+int write_file(const char *filename, int selected_only) {
+  if (!open_write(filename)) return 0;
+  write_project(selected_only);
   return close_write();
 }
 
+static void open_write_memory() {
+  out_mem = 1;
+  out_size = 0;
+  out_alloc = 4096;
+  out_buf = (char*)malloc(out_alloc);
+  needspace = 0;
+}
+
+static char *close_write_memory(int *size) {
+  char *ret = (char*)realloc(out_buf, out_size ? out_size : 1);
+  *size = out_size;
+  out_buf = 0;
+  out_size = out_alloc = 0;
+  out_mem = 0;
+  return ret;
+}
+
+// write the whole project into memory, returns a buffer that must be freed
+char *write_file_to_memory(int *size) {
+  open_write_memory();
+  write_project(0);
+  return close_write_memory(size);
+}
+
+// write n sibling types starting with t and their children into memory,
+// returns a buffer that must be freed
+char *write_types_to_memory(Fl_Type *t, int n, int *size) {
+  open_write_memory();
+  for (; t && n > 0; n --) {
+    t->write();
+    write_string("\n");
+    int q = t->level;
+    for (t = t->next; t && t->level > q; t = t->next) {/*empty*/}
+  }
+  return close_write_memory(size);
+}
+
 ////////////////////////////////////////////////////////////////
 // read all the objects out of the input file:
 
@@ -490,10 +603,8 @@ static void read_children(Fl_Type *p, int paste) {
 
 extern void deselect();
 
-int read_file(const char *filename, int merge) {
+static void read_project(int merge) {
   Fl_Type *o;
-  read_version = 0.0;
-  if (!open_read(filename)) return 0;
   if (merge) deselect(); else    delete_all();
   read_children(Fl_Type::current, merge);
   Fl_Type::current = 0;
@@ -503,9 +614,42 @@ int read_file(const char *filename, int merge) {
   for (o = Fl_Type::first; o; o = o->next)
     if (o->selected) {Fl_Type::current = o; break;}
   selection_changed(Fl_Type::current);
+}
+
+int read_file(const char *filename, int merge) {
+  read_version = 0.0;
+  if (!open_read(filename)) return 0;
+  read_project(merge);
   return close_read();
 }
 
+// read a project that was written by write_file_to_memory()
+int read_file_from_memory(const char *data, int size, int merge) {
+  read_version = 0.0;
+  lineno = 1;
+  fname = "memory";
+  in_ptr = data;
+  in_end = data + size;
+  read_project(merge);
+  in_ptr = in_end = 0;
+  return 1;
+}
+
+// read types that were written by write_types_to_memory() and append them
+// to the children of p, or to the top level if p is 0. Unlike merging a
+// file, this leaves the selection and the menus to the caller.
+int read_types_from_memory(Fl_Type *p, const char *data, int size) {
+  read_version = 0.0;
+  lineno = 1;
+  fname = "memory";
+  in_ptr = data;
+  in_end = data + size;
+  read_children(p, 1);
+  Fl_Type::current = 0;
+  in_ptr = in_end = 0;
+  return 1;
+}
+
 ////////////////////////////////////////////////////////////////
 // Read Forms and XForms fdesign files:
 
@@ -515,8 +659,8 @@ int read_fdesign_line(const char*& name, const char*& value) {
   int x;
   // find a colon:
   for (;;) {
-    x = getc(fin);
-    if (x < 0 && feof(fin)) return 0;
+    x = in_char();
+    if (x < 0 && in_eof()) return 0;
     if (x == '\n') {length = 0; continue;} // no colon this line...
     if (!isspace(x & 255)) {
       buffer[length++] = x;
@@ -529,8 +673,8 @@ int read_fdesign_line(const char*& name, const char*& value) {
 
   // skip to start of value:
   for (;;) {
-    x = getc(fin);
-    if ((x < 0 && feof(fin)) || x == '\n' || !isspace(x & 255)) break;
+    x = in_char();
+    if ((x < 0 && in_eof()) || x == '\n' || !isspace(x & 255)) break;
   }
 
   // read the value:
@@ -539,7 +683,7 @@ int read_fdesign_line(const char*& name, const char*& value) {
     else if (x == '\n') break;
     buffer[length++] = x;
     expand_buffer(length);
-    x = getc(fin);
+    x = in_char();
   }
   buffer[length] = 0;
   name = buffer;
@@ -57,6 +57,7 @@
 #  include <FL/platform.H>
 #else
 #  include <unistd.h>
+#  include <sys/wait.h>
 #endif
 
 #include "about_panel.h"
@@ -686,6 +687,8 @@ int update_file = 0;		// fluid -u
 int compile_file = 0;		// fluid -c
 int compile_strings = 0;	// fluic -cs
 int batch_mode = 0;		// if set (-c, -u) don't open display
+int batch_errors = 0;		// files that could not be read or written
+int batch_jobs = 0;		// fluid -j, worker processes for many files
 int header_file_set = 0;
 int code_file_set = 0;
 const char* header_file_name = ".h";
@@ -724,7 +727,7 @@ void write_cb(Fl_Widget *, void *) {
   strlcat(cname, " and ", sizeof(cname));
   strlcat(cname, hname, sizeof(cname));
   if (batch_mode) {
-    if (!x) {fprintf(stderr,"%s : %s\n",cname,strerror(errno)); exit(1);}
+    if (!x) {fprintf(stderr,"%s : %s\n",cname,strerror(errno)); batch_errors++;}
   } else {
     if (!x) {
       fl_message("Can't write %s: %s", cname, strerror(errno));
@@ -747,7 +750,7 @@ void write_strings_cb(Fl_Widget *, void *) {
   int x = write_strings(sname);
   if (!batch_mode) leave_source_dir();
   if (batch_mode) {
-    if (x) {fprintf(stderr,"%s : %s\n",sname,strerror(errno)); exit(1);}
+    if (x) {fprintf(stderr,"%s : %s\n",sname,strerror(errno)); batch_errors++;}
   } else {
     if (x) {
       fl_message("Can't write %s: %s", sname, strerror(errno));
@@ -799,7 +802,7 @@ void cut_cb(Fl_Widget *, void *) {
     fl_message("Can't write %s: %s", cutfname(), strerror(errno));
     return;
   }
-  undo_checkpoint();
+  undo_checkpoint_selected(UNDO_REMOVE);
   set_modflag(1);
   ipasteoffset = 0;
   Fl_Type *p = Fl_Type::current->parent;
@@ -813,7 +816,7 @@ void delete_cb(Fl_Widget *, void *) {
     fl_beep();
     return;
   }
-  undo_checkpoint();
+  undo_checkpoint_selected(UNDO_REMOVE);
   set_modflag(1);
   ipasteoffset = 0;
   Fl_Type *p = Fl_Type::current->parent;
@@ -1705,6 +1708,11 @@ static int arg(int argc, char** argv, int& i) {
   if (argv[i][1] == 'u' && !argv[i][2]) {update_file++; batch_mode++; i++; return 1;}
   if (argv[i][1] == 'c' && !argv[i][2]) {compile_file++; batch_mode++; i++; return 1;}
   if (argv[i][1] == 'c' && argv[i][2] == 's' && !argv[i][3]) {compile_file++; compile_strings++; batch_mode++; i++; return 1;}
+  if (argv[i][1] == 'j' && !argv[i][2] && i+1 < argc) {
+    batch_jobs = atoi(argv[i+1]);
+    i += 2;
+    return 2;
+  }
   if (argv[i][1] == 'o' && !argv[i][2] && i+1 < argc) {
     code_file_name = argv[i+1];
     code_file_set  = 1;
@@ -1749,17 +1757,85 @@ static void sigint(SIGARG) {
 }
 #endif
 
+// Process one file in batch mode, returns the number of errors:
+static int batch_file(const char *c) {
+  // project settings are not shared between files:
+  if (!header_file_set) header_file_name = ".h";
+  if (!code_file_set) code_file_name = ".cxx";
+  i18n_type = 0;
+  i18n_include = i18n_function = i18n_file = i18n_set = "";
+  batch_errors = 0;
+
+  set_filename(c);
+  undo_suspend();
+  if (!read_file(c,0)) {
+    fprintf(stderr,"%s : %s\n", c, strerror(errno));
+    undo_resume();
+    return 1;
+  }
+  undo_resume();
+
+  if (update_file)		// fluid -u
+    write_file(c,0);
+  if (compile_file) {		// fluid -c[s]
+    if (compile_strings)
+      write_strings_cb(0,0);
+    write_cb(0,0);
+  }
+  return batch_errors;
+}
+
+// Process all files given on the command line in batch mode. The work is
+// shared by worker processes if there is more than one file, as the
+// project data is global and can only hold one file at a time:
+static int batch(int n, char **files) {
+  int errors = 0;
+  int jobs = batch_jobs;
+#if !defined(_WIN32) || defined(__CYGWIN__)
+  if (jobs < 1) jobs = (int)sysconf(_SC_NPROCESSORS_ONLN);
+  if (jobs > n) jobs = n;
+  if (jobs > 1) {
+    int k;
+    fflush(stdout);
+    fflush(stderr);
+    for (k = 0; k < jobs; k++) {
+      pid_t pid = fork();
+      if (pid == 0) {
+        for (int i = k; i < n; i += jobs) errors += batch_file(files[i]);
+        fflush(stdout);
+        _exit(errors ? 1 : 0);
+      }
+      if (pid < 0) break;
+    }
+    // do the share of workers that could not be started here:
+    for (int i = k; i < n; i ++)
+      if (i % jobs >= k) errors += batch_file(files[i]);
+    int status;
+    while (wait(&status) > 0)
+      if (!WIFEXITED(status) || WEXITSTATUS(status)) errors++;
+    return errors;
+  }
+#endif
+  for (int i = 0; i < n; i ++) errors += batch_file(files[i]);
+  return errors;
+}
+
 int main(int argc,char **argv) {
   int i = 1;
   
-  if (!Fl::args(argc,argv,i,arg) || i < argc-1) {
+  if (!Fl::args(argc,argv,i,arg) || (i < argc-1 &&
+      (!batch_mode ||
+       (code_file_set && (*code_file_name != '.' || strchr(code_file_name, '/'))) ||
+       (header_file_set && (*header_file_name != '.' || strchr(header_file_name, '/')))))) {
     static const char *msg = 
-      "usage: %s <switches> name.fl\n"
+      "usage: %s <switches> name.fl ...\n"
       " -u : update .fl file and exit (may be combined with '-c' or '-cs')\n"
       " -c : write .cxx and .h and exit\n"
       " -cs : write .cxx and .h and strings and exit\n"
       " -o <name> : .cxx output filename, or extension if <name> starts with '.'\n"
-      " -h <name> : .h output filename, or extension if <name> starts with '.'\n";
+      " -h <name> : .h output filename, or extension if <name> starts with '.'\n"
+      " -j <n> : number of worker processes if several files are given with\n"
+      "   '-u', '-c' or '-cs'; output files are only written if they changed\n";
     int len = (int)(strlen(msg) + strlen(argv[0]) + strlen(Fl::help));
     Fl_Plugin_Manager pm("commandline");
     int i, n = pm.plugins();
@@ -1791,6 +1867,8 @@ int main(int argc,char **argv) {
 
   make_main_window();
 
+  if (batch_mode && c)
+    exit(batch(argc - i, argv + i) ? 1 : 0);
 
   if (c) set_filename(c);
   if (!batch_mode) {
@@ -699,16 +699,16 @@ Fl_Double_Window* make_comment_panel() {
 }
 
 void type_make_cb(Fl_Widget*,void*d) {
-  undo_checkpoint();
+  undo_checkpoint_add();
+    undo_suspend();
     Fl_Type *t = Fl_Type_make((char*)d);
+    undo_added(t);
     if (t) {
       select_only(t);
       set_modflag(1);
       t->open();
-    } else {
-      undo_current --;
-      undo_last --;
     }
+    undo_resume();
 }
 
 Fl_Window *widgetbin_panel=(Fl_Window *)0;
@@ -19,62 +19,247 @@
 #include <FL/Fl.H>
 #include "Fl_Type.h"
 #include "undo.h"
-#include <FL/Fl_Preferences.H>
-#include <FL/filename.H>
+#include <stdlib.h>
 #include "../src/flstring.h"
 
-#if defined(_WIN32) && !defined(__CYGWIN__)
-#  include <io.h>
-#  include <windows.h>
-#  define getpid (int)GetCurrentProcessId
-#else
-#  include <unistd.h>
-#endif // _WIN32 && !__CYGWIN__
 
-
-extern Fl_Preferences	fluid_prefs;	// FLUID preferences
 extern Fl_Menu_Item	Main_Menu[];	// Main menu
+extern void		deselect();
 
 #define UNDO_ITEM	25		// Undo menu item index
 #define REDO_ITEM	26		// Redo menu item index
 
+#define UNDO_MAX_MEMORY	(32*1024*1024)	// Drop the oldest levels above this size
+
+#define UNDO_PROJECT	-2		// Parent of a change to the whole project
+
 
 //
-// This file implements an undo system using temporary files; ideally
-// we'd like to do this in memory, however the current data structures
-// and design aren't well-suited...  Instead, we save and restore
-// checkpoint files.
+// This file implements an undo system that keeps its levels in memory.
+// Each level is a list of changes. A change names a run of sibling types
+// by the list index of their parent and the child index of the first one,
+// and holds those types as they are in the other state, written as in a
+// .fl file. Undoing or redoing a level swaps the types in the tree with
+// the ones in its changes, so a property change in the widget panel only
+// writes and reads the widgets that are edited. Bulk operations like
+// opening, merging or pasting store the whole project in a single change.
 //
 
 
 int undo_current = 0;			// Current undo level in buffer
 int undo_last = 0;			// Last undo level in buffer
-int undo_max = 0;			// Maximum undo level used
 int undo_save = -1;			// Last undo level that was saved
 static int undo_paused = 0;		// Undo checkpointing paused?
+static int undo_adding = 0;		// Level of undo_checkpoint_add() + 1
+
+struct Undo_Change {
+  int parent;		// List index of the parent, -1 for the top level
+  int index;		// Child index of the first type
+  int count;		// Number of types in the tree
+  char *data;		// The types in the other state
+  int size;		// Size of data
+};
+
+struct Undo_Level {
+  Undo_Change *changes;	// Changes in list order
+  int count;		// Number of changes
+};
+
+static Undo_Level *undo_levels = 0;	// Stored levels
+static int undo_stored = 0;		// Number of stored levels
+static int undo_alloc = 0;		// Allocated levels
+static int undo_memory = 0;		// Bytes used by all levels
+
+
+// Return the type with the given list index
+static Fl_Type *undo_type(int n) {
+  Fl_Type *t;
+  for (t = Fl_Type::first; t && n > 0; t = t->next) n --;
+  return t;
+}
 
+// Return the list index of a type
+static int undo_index(Fl_Type *t) {
+  int n = 0;
+  for (Fl_Type *q = Fl_Type::first; q && q != t; q = q->next) n ++;
+  return n;
+}
 
-// Return the undo filename
-static char *undo_filename(int level, char *buf, int bufsize) {
-  static char	undo_path[FL_PATH_MAX] = "";	// Undo path
+// Return the n-th child of p, or of the top level if p is 0
+static Fl_Type *undo_child(Fl_Type *p, int n) {
+  int level = p ? p->level + 1 : 0;
+  for (Fl_Type *t = p ? p->next : Fl_Type::first; t && t->level >= level; t = t->next)
+    if (t->level == level && !n--) return t;
+  return 0;
+}
 
+// Return the child index of a type
+static int undo_child_index(Fl_Type *t) {
+  int n = 0;
+  for (Fl_Type *q = t->parent ? t->parent->next : Fl_Type::first; q != t; q = q->next)
+    if (q->level == t->level) n ++;
+  return n;
+}
 
-  if (!undo_path[0]) fluid_prefs.getUserdataPath(undo_path, sizeof(undo_path));
+// Return the sibling after a type and its children
+static Fl_Type *undo_next(Fl_Type *t) {
+  Fl_Type *n;
+  for (n = t->next; n && n->level > t->level; n = n->next) {/*empty*/}
+  return n && n->level == t->level ? n : 0;
+}
 
-  snprintf(buf, bufsize, "%sundo_%d_%d.fl", undo_path, getpid(), level);
-  return buf;
+// Free a level
+static void undo_free(int level) {
+  Undo_Level &u = undo_levels[level];
+  for (int i = 0; i < u.count; i ++) {
+    undo_memory -= u.changes[i].size;
+    free(u.changes[i].data);
+  }
+  free(u.changes);
+  u.changes = 0;
+  u.count = 0;
+}
+
+// Drop the oldest levels until the memory limit is met
+static void undo_trim() {
+  int n = 0;
+  while (undo_memory > UNDO_MAX_MEMORY && n < undo_current - 1)
+    undo_free(n ++);
+  if (!n) return;
+  memmove(undo_levels, undo_levels + n, (undo_stored - n) * sizeof(Undo_Level));
+  undo_stored -= n;
+  undo_current -= n;
+  undo_last -= n;
+  if (undo_save >= 0) undo_save = undo_save >= n ? undo_save - n : -1;
+}
+
+// Start a new level at undo_current, dropping all newer levels
+static Undo_Level *undo_begin() {
+  if (undo_paused) return 0;
+
+  while (undo_stored > undo_current) undo_free(-- undo_stored);
+  if (undo_current >= undo_alloc) {
+    undo_alloc = undo_alloc ? 2 * undo_alloc : 16;
+    undo_levels = (Undo_Level *)realloc(undo_levels, undo_alloc * sizeof(Undo_Level));
+  }
+  Undo_Level *u = undo_levels + undo_current;
+  u->changes = 0;
+  u->count = 0;
+  undo_stored = undo_current + 1;
+  undo_adding = 0;
+
+  // Update the saved level...
+  if (modflag && undo_current <= undo_save) undo_save = -1;
+  else if (!modflag) undo_save = undo_current;
+
+  // Update the current undo level...
+  undo_current ++;
+  undo_last = undo_current;
+
+  // Enable the Undo and disable the Redo menu items...
+  Main_Menu[UNDO_ITEM].activate();
+  Main_Menu[REDO_ITEM].deactivate();
+  return u;
+}
+
+// Add a change to a level
+static Undo_Change &undo_add(Undo_Level *u) {
+  u->changes = (Undo_Change *)realloc(u->changes, (u->count + 1) * sizeof(Undo_Change));
+  Undo_Change &c = u->changes[u->count ++];
+  c.parent = -1;
+  c.index = 0;
+  c.count = 0;
+  c.data = 0;
+  c.size = 0;
+  return c;
+}
+
+// Add a change for a type and its children, which are about to be
+// replaced by "after" types
+static void undo_add_type(Undo_Level *u, Fl_Type *t, int after) {
+  Undo_Change &c = undo_add(u);
+  c.parent = t->parent ? undo_index(t->parent) : -1;
+  c.index = undo_child_index(t);
+  c.count = after;
+  c.data = write_types_to_memory(t, 1, &c.size);
+  undo_memory += c.size;
+}
+
+// Swap the types of a change with the ones in its data
+static int undo_apply(Undo_Change &c) {
+  int size;
+  char *data;
+  if (c.parent == UNDO_PROJECT) {
+    data = write_file_to_memory(&size);
+    read_file_from_memory(c.data, c.size, 0);
+  } else {
+    Fl_Type *p = c.parent >= 0 ? undo_type(c.parent) : 0;
+    if (c.parent >= 0 && !p) return 0;
+    Fl_Type *t = undo_child(p, c.index), *g;
+    int i, n;
+    for (g = t, i = 0; g && i < c.count; i ++) g = undo_next(g);
+    if (i < c.count || (!t && c.index && !undo_child(p, c.index - 1))) return 0;
+
+    // Replace the types, new ones are appended and moved before g...
+    data = write_types_to_memory(t, c.count, &size);
+    for (i = 0; i < c.count; i ++) {
+      Fl_Type *nxt = undo_next(t);
+      delete_type(t);
+      t = nxt;
+    }
+    for (t = p ? p->next : Fl_Type::first, n = 0; t && t->level > (p ? p->level : -1); t = t->next)
+      if (t->level == (p ? p->level + 1 : 0)) n ++;
+    read_types_from_memory(p, c.data, c.size);
+    t = undo_child(p, n);
+    c.count = 0;
+    while (t) {
+      Fl_Type *nxt = undo_next(t);
+      if (g) t->move_before(g);
+      c.count ++;
+      t = nxt;
+    }
+  }
+  undo_memory += size - c.size;
+  free(c.data);
+  c.data = data;
+  c.size = size;
+  return 1;
+}
+
+// Undo (dir < 0) or redo (dir > 0) a level
+static int undo_restore(int level, int dir) {
+  Undo_Level &u = undo_levels[level];
+  int i, ret = 1;
+  if (u.count && u.changes[0].parent != UNDO_PROJECT) {
+    // the changes delete types, so let the panel forget the current widget:
+    deselect();
+    selection_changed(0);
+  }
+  // Changes are recorded with their positions before the level, and each
+  // only depends on the changes before it, so undo goes forward and redo
+  // goes backward:
+  for (i = 0; i < u.count && ret; i ++)
+    ret = undo_apply(u.changes[dir < 0 ? i : u.count - 1 - i]);
+  if (u.count && u.changes[0].parent != UNDO_PROJECT) {
+    Fl_Type *o;
+    // Force menu items to be rebuilt...
+    for (o = Fl_Type::first; o; o = o->next)
+      if (o->is_menu_button()) o->add_child(0,0);
+    for (o = Fl_Type::first; o; o = o->next)
+      if (o->new_selected) break;
+    selection_changed(o);
+  }
+  return ret;
 }
 
 
 // Redo menu callback
 void redo_cb(Fl_Widget *, void *) {
-  char	filename[FL_PATH_MAX];			// Undo checkpoint file
-
   if (undo_current >= undo_last) return;
 
   undo_suspend();
-  if (!read_file(undo_filename(undo_current + 1, filename, sizeof(filename)), 0)) {
-    // Unable to read checkpoint file, don't redo...
+  if (!undo_restore(undo_current, 1)) {
+    // Unable to apply the level, don't redo...
     undo_resume();
     return;
   }
@@ -87,21 +272,16 @@ void redo_cb(Fl_Widget *, void *) {
   // Update undo/redo menu items...
   if (undo_current >= undo_last) Main_Menu[REDO_ITEM].deactivate();
   Main_Menu[UNDO_ITEM].activate();
+  undo_resume();
 }
 
 // Undo menu callback
 void undo_cb(Fl_Widget *, void *) {
-  char	filename[FL_PATH_MAX];			// Undo checkpoint file
-
   if (undo_current <= 0) return;
 
-  if (undo_current == undo_last) {
-    write_file(undo_filename(undo_current, filename, sizeof(filename)));
-  }
-
   undo_suspend();
-  if (!read_file(undo_filename(undo_current - 1, filename, sizeof(filename)), 0)) {
-    // Unable to read checkpoint file, don't undo...
+  if (!undo_restore(undo_current - 1, -1)) {
+    // Unable to apply the level, don't undo...
     undo_resume();
     return;
   }
@@ -119,47 +299,97 @@ void undo_cb(Fl_Widget *, void *) {
 
 // Save current file to undo buffer
 void undo_checkpoint() {
-  char	filename[FL_PATH_MAX];			// Undo checkpoint filename
-
 //  printf("undo_checkpoint(): undo_current=%d, undo_paused=%d, modflag=%d\n",
 //         undo_current, undo_paused, modflag);
 
-  // Don't checkpoint if undo_suspend() has been called...
-  if (undo_paused) return;
+  Undo_Level *u = undo_begin();
+  if (!u) return;
+  Undo_Change &c = undo_add(u);
+  c.parent = UNDO_PROJECT;
+  c.data = write_file_to_memory(&c.size);
+  undo_memory += c.size;
+  undo_trim();
+}
 
-  // Save the current UI to a checkpoint file...
-  if (!write_file(undo_filename(undo_current, filename, sizeof(filename)))) {
-    // Don't attempt to do undo stuff if we can't write a checkpoint file...
-    perror(filename);
+// Save a type and its children to undo buffer before they change
+void undo_checkpoint(Fl_Type *t) {
+  if (!t) {
+    undo_checkpoint();
     return;
   }
+  Undo_Level *u = undo_begin();
+  if (!u) return;
+  undo_add_type(u, t, 1);
+  undo_trim();
+}
 
-  // Update the saved level...
-  if (modflag && undo_current <= undo_save) undo_save = -1;
-  else if (!modflag) undo_save = undo_current;
+// Save the selected types, or their parents, to undo buffer before they
+// change or are removed
+void undo_checkpoint_selected(int what) {
+  Fl_Type *t, *p, *end = 0;
+  int n = 0;
+  for (t = Fl_Type::first; t; t = t->next) if (t->selected) n ++;
+  if (!n) return;
+
+  if (what == UNDO_PARENTS) {
+    // Changing the siblings of a top level type changes the project...
+    for (t = Fl_Type::first; t; t = t->next)
+      if (t->selected && !t->parent) {
+        undo_checkpoint();
+        return;
+      }
+  }
 
-  // Update the current undo level...
-  undo_current ++;
-  undo_last = undo_current;
-  if (undo_current > undo_max) undo_max = undo_current;
+  Undo_Level *u = undo_begin();
+  if (!u) return;
+  for (t = Fl_Type::first; t; t = t->next) {
+    if (end && t->level <= end->level) end = 0;
+    if (end) continue;			// already saved with an ancestor
+    if (what == UNDO_PARENTS) {
+      // save the parent if one of its children is selected
+      for (p = t->next; p && p->level > t->level; p = p->next)
+        if (p->selected && p->parent == t) break;
+      if (!p || p->level <= t->level) continue;
+    } else if (!t->selected) continue;
+    undo_add_type(u, t, what == UNDO_REMOVE ? 0 : 1);
+    end = t;
+  }
+  undo_trim();
+}
 
-  // Enable the Undo and disable the Redo menu items...
-  Main_Menu[UNDO_ITEM].activate();
-  Main_Menu[REDO_ITEM].deactivate();
+// Start an undo level for a type that is about to be added; call
+// undo_added() with the new type, or 0 if none was added
+void undo_checkpoint_add() {
+  if (undo_begin()) undo_adding = undo_current;
+}
+
+// Save the position of a type added since undo_checkpoint_add()
+void undo_added(Fl_Type *t) {
+  if (!undo_adding || undo_adding != undo_current) return;
+  undo_adding = 0;
+  if (!t) {
+    // Nothing was added, drop the level...
+    undo_free(-- undo_stored);
+    undo_current --;
+    undo_last --;
+    if (undo_current <= 0) Main_Menu[UNDO_ITEM].deactivate();
+    return;
+  }
+  Undo_Change &c = undo_add(undo_levels + undo_current - 1);
+  c.parent = t->parent ? undo_index(t->parent) : -1;
+  c.index = undo_child_index(t);
+  c.count = 1;
+  c.data = (char *)malloc(1);
+  undo_trim();
 }
 
 // Clear undo buffer
 void undo_clear() {
-  char	filename[FL_PATH_MAX];			// Undo checkpoint filename
-
-
-  // Remove old checkpoint files...
-  for (int i = 0; i <= undo_max; i ++) {
-    fl_unlink(undo_filename(i, filename, sizeof(filename)));
-  }
+  // Free all levels...
+  while (undo_stored > 0) undo_free(-- undo_stored);
 
   // Reset current, last, and save indices...
-  undo_current = undo_last = undo_max = 0;
+  undo_current = undo_last = undo_adding = 0;
   if (modflag) undo_save = -1;
   else undo_save = 0;
 }
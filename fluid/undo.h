@@ -19,6 +19,12 @@
 #ifndef undo_h
 #  define undo_h
 
+#  define UNDO_CHANGE	0		// The selected types change
+#  define UNDO_REMOVE	1		// The selected types are removed
+#  define UNDO_PARENTS	2		// The siblings of the selected types change
+
+class Fl_Type;
+
 extern int undo_current;		// Current undo level in buffer
 extern int undo_last;			// Last undo level in buffer
 extern int undo_save;			// Last undo level that was saved
@@ -26,6 +32,11 @@ extern int undo_save;			// Last undo level that was saved
 void redo_cb(Fl_Widget *, void *);	// Redo menu callback
 void undo_cb(Fl_Widget *, void *);	// Undo menu callback
 void undo_checkpoint();			// Save current file to undo buffer
+void undo_checkpoint(Fl_Type *t);	// Save a type to undo buffer
+void undo_checkpoint_selected(int what = UNDO_CHANGE);
+					// Save the selected types to undo buffer
+void undo_checkpoint_add();		// Start undo level for a new type
+void undo_added(Fl_Type *t);		// Finish undo level for a new type
 void undo_clear();			// Clear undo buffer
 void undo_resume();			// Resume undo checkpoints
 void undo_suspend();			// Suspend undo checkpoints
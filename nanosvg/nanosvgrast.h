@@ -25,6 +25,11 @@
 /* Modified by FLTK to support non-square X,Y axes scaling.
  *
  * Added: nsvgRasterizeXY()
+ *
+ * Modified by FLTK to support rasterization of horizontal bands
+ * in parallel threads, with results identical to nsvgRasterizeXY().
+ *
+ * Added: nsvgCreateRasterJob(), nsvgRasterizeJobBand(), nsvgDeleteRasterJob()
 */
 
 
@@ -77,6 +82,34 @@ void nsvgRasterizeXY(NSVGrasterizer* r,
 // Deletes rasterizer context.
 void nsvgDeleteRasterizer(NSVGrasterizer*);
 
+/* Banded rasterization:
+	// Flatten and sort the edges of all shapes once
+	NSVGrasterJob* job = nsvgCreateRasterJob(rast, image, 0,0,1,1, img, w, h, w*4);
+	// Rasterize disjoint bands of rows [y0,y1), possibly in several threads,
+	// each thread using its own rasterizer context
+	nsvgRasterizeJobBand(job, rast1, 0, h/2);
+	nsvgRasterizeJobBand(job, rast2, h/2, h);
+	// When all bands are done, finish the image and free the job
+	nsvgDeleteRasterJob(job);
+	// img now contains exactly what nsvgRasterizeXY() would produce
+*/
+
+typedef struct NSVGrasterJob NSVGrasterJob;
+
+// Prepares the banded rasterization of an image (arguments as in nsvgRasterizeXY).
+// r is only used while this function runs. Returns NULL on memory errors.
+NSVGrasterJob* nsvgCreateRasterJob(NSVGrasterizer* r,
+				   NSVGimage* image, float tx, float ty,
+				   float sx, float sy,
+				   unsigned char* dst, int w, int h, int stride);
+
+// Rasterizes rows y0 to y1-1 of the job. Distinct bands can be rasterized
+// concurrently as long as each call uses a distinct rasterizer context.
+void nsvgRasterizeJobBand(NSVGrasterJob* job, NSVGrasterizer* r, int y0, int y1);
+
+// Completes the image after all bands are rasterized and deletes the job.
+void nsvgDeleteRasterJob(NSVGrasterJob* job);
+
 
 #ifdef __cplusplus
 }
@@ -1123,7 +1156,11 @@ static void nsvg__scanlineSolid(unsigned char* dst, int count, unsigned char* co
 	}
 }
 
-static void nsvg__rasterizeSortedEdges(NSVGrasterizer *r, float tx, float ty, float sx, float sy, NSVGcachedPaint* cache, char fillRule)
+// Rasterizes the sorted edges into rows ystart to yend-1 of the bitmap.
+// The active edges must be tracked from the top of the image even if
+// ystart > 0 so that the result does not depend on ystart.
+static void nsvg__rasterizeSortedEdgesBand(NSVGrasterizer *r, NSVGedge* edges, int nedges, int ystart, int yend,
+										   float tx, float ty, float sx, float sy, NSVGcachedPaint* cache, char fillRule)
 {
 	NSVGactiveEdge *active = NULL;
 	int y, s;
@@ -1131,7 +1168,18 @@ static void nsvg__rasterizeSortedEdges(NSVGrasterizer *r, float tx, float ty, fl
 	int maxWeight = (255 / NSVG__SUBSAMPLES);  // weight per vertical scanline
 	int xmin, xmax;
 
-	for (y = 0; y < r->height; y++) {
+	for (y = 0; y < yend; y++) {
+		if (active == NULL) {
+			int ynext;
+			if (e >= nedges) break; // nothing left to draw
+			// skip rows above the band before the next edge starts
+			ynext = (int)(edges[e].y0 / NSVG__SUBSAMPLES);
+			if (ynext > ystart) ynext = ystart;
+			if (ynext > y) {
+				y = ynext - 1;
+				continue;
+			}
+		}
 		memset(r->scanline, 0, r->width);
 		xmin = r->width;
 		xmax = 0;
@@ -1173,9 +1221,9 @@ static void nsvg__rasterizeSortedEdges(NSVGrasterizer *r, float tx, float ty, fl
 			}
 
 			// insert all edges that start before the center of this scanline -- omit ones that also end on this scanline
-			while (e < r->nedges && r->edges[e].y0 <= scany) {
-				if (r->edges[e].y1 > scany) {
-					NSVGactiveEdge* z = nsvg__addActive(r, &r->edges[e], scany);
+			while (e < nedges && edges[e].y0 <= scany) {
+				if (edges[e].y1 > scany) {
+					NSVGactiveEdge* z = nsvg__addActive(r, &edges[e], scany);
 					if (z == NULL) break;
 					// find insertion point
 					if (active == NULL) {
@@ -1198,9 +1246,10 @@ static void nsvg__rasterizeSortedEdges(NSVGrasterizer *r, float tx, float ty, fl
 			}
 
 			// now process all active edges in non-zero fashion
-			if (active != NULL)
+			if (active != NULL && y >= ystart)
 				nsvg__fillActiveEdges(r->scanline, r->width, active, maxWeight, &xmin, &xmax, fillRule);
 		}
+		if (y < ystart) continue;
 		// Blit
 		if (xmin < 0) xmin = 0;
 		if (xmax > r->width-1) xmax = r->width-1;
@@ -1211,7 +1260,12 @@ static void nsvg__rasterizeSortedEdges(NSVGrasterizer *r, float tx, float ty, fl
 
 }
 
-static void nsvg__unpremultiplyAlpha(unsigned char* image, int w, int h, int stride)
+static void nsvg__rasterizeSortedEdges(NSVGrasterizer *r, float tx, float ty, float sx, float sy, NSVGcachedPaint* cache, char fillRule)
+{
+	nsvg__rasterizeSortedEdgesBand(r, r->edges, r->nedges, 0, r->height, tx, ty, sx, sy, cache, fillRule);
+}
+
+static void nsvg__unpremultiplyRows(unsigned char* image, int w, int h, int stride)
 {
 	int x,y;
 
@@ -1228,6 +1282,13 @@ static void nsvg__unpremultiplyAlpha(unsigned char* image, int w, int h, int str
 			row += 4;
 		}
 	}
+}
+
+// Only reads pixels with alpha != 0 and only writes pixels with alpha == 0,
+// so the result does not depend on the order in which rows are processed.
+static void nsvg__defringe(unsigned char* image, int w, int h, int stride)
+{
+	int x,y;
 
 	// Defringe
 	for (y = 0; y < h; y++) {
@@ -1270,6 +1331,12 @@ static void nsvg__unpremultiplyAlpha(unsigned char* image, int w, int h, int str
 	}
 }
 
+static void nsvg__unpremultiplyAlpha(unsigned char* image, int w, int h, int stride)
+{
+	nsvg__unpremultiplyRows(image, w, h, stride);
+	nsvg__defringe(image, w, h, stride);
+}
+
 
 static void nsvg__initPaint(NSVGcachedPaint* cache, NSVGpaint* paint, float opacity)
 {
@@ -1468,6 +1535,176 @@ void nsvgRasterize(NSVGrasterizer* r,
 	nsvgRasterizeXY(r,image, tx, ty, scale, scale, dst, w, h, stride);
 }
 
+// One fill or stroke of a shape, with its flattened and sorted edges
+typedef struct NSVGrasterPass {
+	int firstEdge, nedges;
+	float ymax;			// largest y of all edges, in subsamples
+	char fillRule;
+	NSVGcachedPaint cache;
+} NSVGrasterPass;
+
+struct NSVGrasterJob {
+	NSVGrasterPass* passes;
+	int npasses, cpasses;
+	NSVGedge* edges;		// edges of all passes
+	int nedges, cedges;
+	float tx, ty, sx, sy;
+	unsigned char* bitmap;
+	int width, height, stride;
+};
+
+// Moves the edges just flattened by r into a new pass of the job
+static int nsvg__addRasterPass(NSVGrasterJob* job, NSVGrasterizer* r, float tx, float ty,
+							   NSVGpaint* paint, float opacity, char fillRule)
+{
+	NSVGrasterPass* pass;
+	int i;
+
+	if (r->nedges == 0) return 1;
+
+	// Scale and translate edges
+	for (i = 0; i < r->nedges; i++) {
+		NSVGedge* e = &r->edges[i];
+		e->x0 = tx + e->x0;
+		e->y0 = (ty + e->y0) * NSVG__SUBSAMPLES;
+		e->x1 = tx + e->x1;
+		e->y1 = (ty + e->y1) * NSVG__SUBSAMPLES;
+	}
+	qsort(r->edges, r->nedges, sizeof(NSVGedge), nsvg__cmpEdge);
+
+	if (job->npasses+1 > job->cpasses) {
+		job->cpasses = job->cpasses > 0 ? job->cpasses * 2 : 64;
+		job->passes = (NSVGrasterPass*)realloc(job->passes, sizeof(NSVGrasterPass) * job->cpasses);
+		if (job->passes == NULL) return 0;
+	}
+	if (job->nedges + r->nedges > job->cedges) {
+		job->cedges = job->cedges > 0 ? job->cedges * 2 : 1024;
+		if (job->cedges < job->nedges + r->nedges) job->cedges = job->nedges + r->nedges;
+		job->edges = (NSVGedge*)realloc(job->edges, sizeof(NSVGedge) * job->cedges);
+		if (job->edges == NULL) return 0;
+	}
+
+	pass = &job->passes[job->npasses++];
+	pass->firstEdge = job->nedges;
+	pass->nedges = r->nedges;
+	pass->fillRule = fillRule;
+	pass->ymax = r->edges[0].y1;
+	for (i = 1; i < r->nedges; i++)
+		if (r->edges[i].y1 > pass->ymax) pass->ymax = r->edges[i].y1;
+	nsvg__initPaint(&pass->cache, paint, opacity);
+
+	memcpy(&job->edges[job->nedges], r->edges, sizeof(NSVGedge) * r->nedges);
+	job->nedges += r->nedges;
+	return 1;
+}
+
+NSVGrasterJob* nsvgCreateRasterJob(NSVGrasterizer* r,
+				   NSVGimage* image, float tx, float ty,
+				   float sx, float sy,
+				   unsigned char* dst, int w, int h, int stride)
+{
+	NSVGshape *shape = NULL;
+	NSVGrasterJob* job = (NSVGrasterJob*)malloc(sizeof(NSVGrasterJob));
+	if (job == NULL) return NULL;
+	memset(job, 0, sizeof(NSVGrasterJob));
+	job->tx = tx;
+	job->ty = ty;
+	job->sx = sx;
+	job->sy = sy;
+	job->bitmap = dst;
+	job->width = w;
+	job->height = h;
+	job->stride = stride;
+
+	for (shape = image->shapes; shape != NULL; shape = shape->next) {
+		if (!(shape->flags & NSVG_FLAGS_VISIBLE))
+			continue;
+
+		if (shape->fill.type != NSVG_PAINT_NONE) {
+			nsvg__resetPool(r);
+			r->freelist = NULL;
+			r->nedges = 0;
+
+			nsvg__flattenShape(r, shape, sx, sy);
+
+			if (!nsvg__addRasterPass(job, r, tx, ty, &shape->fill, shape->opacity, shape->fillRule))
+				goto error;
+		}
+		if (shape->stroke.type != NSVG_PAINT_NONE && (shape->strokeWidth * sx) > 0.01f) {
+			nsvg__resetPool(r);
+			r->freelist = NULL;
+			r->nedges = 0;
+
+			nsvg__flattenShapeStroke(r, shape, sx, sy);
+
+			if (!nsvg__addRasterPass(job, r, tx, ty, &shape->stroke, shape->opacity, NSVG_FILLRULE_NONZERO))
+				goto error;
+		}
+	}
+	return job;
+
+error:
+	if (job->passes) free(job->passes);
+	if (job->edges) free(job->edges);
+	free(job);
+	return NULL;
+}
+
+void nsvgRasterizeJobBand(NSVGrasterJob* job, NSVGrasterizer* r, int y0, int y1)
+{
+	int i;
+	float top, bottom;
+
+	if (y0 < 0) y0 = 0;
+	if (y1 > job->height) y1 = job->height;
+	if (y0 >= y1) return;
+
+	r->bitmap = job->bitmap;
+	r->width = job->width;
+	r->height = job->height;
+	r->stride = job->stride;
+
+	if (job->width > r->cscanline) {
+		r->cscanline = job->width;
+		r->scanline = (unsigned char*)realloc(r->scanline, job->width);
+		if (r->scanline == NULL) return;
+	}
+
+	for (i = y0; i < y1; i++)
+		memset(&job->bitmap[i*job->stride], 0, job->width*4);
+
+	// first and last scanline centers of the band, in subsamples
+	top = (float)(y0*NSVG__SUBSAMPLES) + 0.5f;
+	bottom = (float)(y1*NSVG__SUBSAMPLES - 1) + 0.5f;
+
+	for (i = 0; i < job->npasses; i++) {
+		NSVGrasterPass* pass = &job->passes[i];
+		NSVGedge* edges = &job->edges[pass->firstEdge];
+		if (pass->ymax <= top || edges[0].y0 > bottom)
+			continue; // no edge of this pass is active within the band
+		nsvg__resetPool(r);
+		r->freelist = NULL;
+		nsvg__rasterizeSortedEdgesBand(r, edges, pass->nedges, y0, y1,
+									   job->tx, job->ty, job->sx, job->sy, &pass->cache, pass->fillRule);
+	}
+
+	nsvg__unpremultiplyRows(&job->bitmap[y0*job->stride], job->width, y1-y0, job->stride);
+
+	r->bitmap = NULL;
+	r->width = 0;
+	r->height = 0;
+	r->stride = 0;
+}
+
+void nsvgDeleteRasterJob(NSVGrasterJob* job)
+{
+	if (job == NULL) return;
+	nsvg__defringe(job->bitmap, job->width, job->height, job->stride);
+	if (job->passes) free(job->passes);
+	if (job->edges) free(job->edges);
+	free(job);
+}
+
 #endif // NANOSVGRAST_IMPLEMENTATION
 
 
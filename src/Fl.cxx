@@ -25,6 +25,7 @@
 #include <FL/Fl_System_Driver.H>
 #include <FL/Fl_Window.H>
 #include <FL/Fl_Tooltip.H>
+#include <FL/Fl_Event_Stats.H>
 #include <FL/fl_draw.H>
 
 #include <ctype.h>
@@ -436,7 +437,11 @@ void Fl::run_checks()
     while (next_check) {
       Check* checkp = next_check;
       next_check = checkp->next;
-      (checkp->cb)(checkp->arg);
+      void (*cb)(void*) = checkp->cb;
+      void *argp = checkp->arg;
+      double t = Fl_Event_Stats::start();
+      cb(argp);
+      if (t >= 0) Fl_Event_Stats::record(Fl_Event_Stats::CHECK, t, (void*)cb, argp);
     }
     next_check = first_check;
   }
@@ -691,15 +696,19 @@ void Fl::redraw() {
   event queue.
 */
 void Fl::flush() {
+  double t = -1.0;
   if (damage()) {
+    t = Fl_Event_Stats::start();
     damage_ = 0;
     for (Fl_X* i = Fl_X::first; i; i = i->next) {
       Fl_Window* wi = i->w;
       if (wi->driver()->wait_for_expose_value) {damage_ = 1; continue;}
       if (!wi->visible_r()) continue;
       if (wi->damage()) {
+        double td = Fl_Event_Stats::start();
         wi->driver()->flush();
         wi->clear_damage();
+        if (td >= 0) Fl_Event_Stats::record(Fl_Event_Stats::DRAW, td, 0, 0, wi);
       }
       // destroy damage regions for windows that don't use them:
       if (i->region) {
@@ -709,6 +718,7 @@ void Fl::flush() {
     }
   }
   screen_driver()->flush();
+  if (t >= 0) Fl_Event_Stats::record(Fl_Event_Stats::FLUSH, t);
 }
 
 
@@ -2018,6 +2028,15 @@ int Fl::clipboard_contains(const char *type)
  Fl::remove_fd() gets rid of <I>all</I> the callbacks for a given
  file descriptor.
 
+ If FL_EDGE is added to the bits, the callback is only done when the
+ file descriptor becomes ready, not again while it stays ready, so the
+ callback must read or write until the operation would block. This is
+ supported on Linux, where FLTK uses epoll() to watch file descriptors,
+ and is ignored elsewhere, so callbacks written this way work everywhere.
+ On Linux the number of file descriptors is not limited by FD_SETSIZE,
+ and the time Fl::wait() takes does not depend on the number of file
+ descriptors, but on the number that are ready.
+
  Under UNIX/Linux/MacOS <I>any</I> file descriptor can be monitored (files,
  devices, pipes, sockets, etc.). Due to limitations in Microsoft Windows,
  Windows applications can only monitor sockets.
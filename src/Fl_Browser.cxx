@@ -30,15 +30,27 @@
 
 // I modified this from the original Forms data to use a linked list
 // so that the number of items in the browser and size of those items
-// is unlimited. The only problem is that the old browser used an
-// index number to identify a line, and it is slow to convert from/to
-// a pointer. I use a cache of the last match to try to speed this up.
+// is unlimited. The old browser used an index number to identify a
+// line, so the lines are also kept in an array (with a gap where the
+// last line was inserted or removed, like Fl_Text_Buffer), and each
+// line remembers its line number. Line numbers after an insertion or
+// removal are only corrected when they are asked for.
+
+// The height of each line is remembered as well. Unless all lines have
+// the same height, a Fenwick tree of the heights finds the position of a
+// line and the line at a position in O(log n) time, so Fl_Browser_ can
+// scroll without walking the list.
 
 // Also added the ability to "hide" a line. This sets its height to
 // zero, so the Fl_Browser_ cannot pick it.
 
+// In model mode (see model()) there are no FL_BLINE's at all: an item
+// is the line number cast to a pointer, the lines have a uniform height,
+// and the selection is kept in a bit array.
+
 #define SELECTED 1
 #define NOTDISPLAYED 2
+#define INBLOCK 4	// allocated in a Fl_Browser_Block, see load()
 
 // WARNING:
 //       Fl_File_Chooser.cxx also has a definition of this structure (FL_BLINE).
@@ -50,11 +62,34 @@ struct FL_BLINE {	// data is in a linked list of these
   FL_BLINE* next;
   void* data;
   Fl_Image* icon;
+  int line;		// line number, see Fl_Browser::lineno()
+  int height;		// height used for the position of the following lines
   short length;		// sizeof(txt)-1, may be longer than string
   char flags;		// selected, displayed
   char txt[1];		// start of allocated array
 };
 
+#define MODEL_LINE(item) ((int)(fl_intptr_t)(item))
+
+// The lines read by load() are allocated in large blocks, which are
+// only freed by clear(). Lines removed before are just unlinked.
+struct Fl_Browser_Block {
+  Fl_Browser_Block* next;
+  int used;		// bytes used after the header
+  int size;		// bytes allocated after the header
+};
+
+#define BLOCK_HEADER ((int(sizeof(Fl_Browser_Block))+7) & ~7)
+#define BLOCK_SIZE (256*1024)
+
+static void free_line(FL_BLINE* l) {
+  if (!(l->flags & INBLOCK)) free(l);
+}
+
+/** Destructor. */
+Fl_Browser_Model::~Fl_Browser_Model() {
+}
+
 /**
   Returns the very first item in the list.
   Example of use:
@@ -67,7 +102,10 @@ struct FL_BLINE {	// data is in a linked list of these
   \returns The first item, or NULL if list is empty.
   \see item_first(), item_last(), item_next(), item_prev()
 */
-void* Fl_Browser::item_first() const {return first;}
+void* Fl_Browser::item_first() const {
+  if (model_) return lines ? (void*)1 : 0;
+  return first;
+}
 
 /**
   Returns the next item after \p item.
@@ -75,7 +113,10 @@ void* Fl_Browser::item_first() const {return first;}
   \returns The next item after \p item, or NULL if there are none after this one.
   \see item_first(), item_last(), item_next(), item_prev()
 */
-void* Fl_Browser::item_next(void* item) const {return ((FL_BLINE*)item)->next;}
+void* Fl_Browser::item_next(void* item) const {
+  if (model_) return MODEL_LINE(item) < lines ? (void*)(fl_intptr_t)(MODEL_LINE(item)+1) : 0;
+  return ((FL_BLINE*)item)->next;
+}
 
 /**
   Returns the previous item before \p item.
@@ -83,7 +124,10 @@ void* Fl_Browser::item_next(void* item) const {return ((FL_BLINE*)item)->next;}
   \returns The previous item before \p item, or NULL if there are none before this one.
   \see item_first(), item_last(), item_next(), item_prev()
 */
-void* Fl_Browser::item_prev(void* item) const {return ((FL_BLINE*)item)->prev;}
+void* Fl_Browser::item_prev(void* item) const {
+  if (model_) return MODEL_LINE(item) > 1 ? (void*)(fl_intptr_t)(MODEL_LINE(item)-1) : 0;
+  return ((FL_BLINE*)item)->prev;
+}
 
 /**
   Returns the very last item in the list.
@@ -97,7 +141,10 @@ void* Fl_Browser::item_prev(void* item) const {return ((FL_BLINE*)item)->prev;}
   \returns The last item, or NULL if list is empty.
   \see item_first(), item_last(), item_next(), item_prev()
 */
-void* Fl_Browser::item_last() const {return last;}
+void* Fl_Browser::item_last() const {
+  if (model_) return lines ? (void*)(fl_intptr_t)lines : 0;
+  return last;
+}
 
 /**
   See if \p item is selected.
@@ -106,6 +153,10 @@ void* Fl_Browser::item_last() const {return last;}
   \see select(), selected(), value(), item_select(), item_selected()
 */
 int Fl_Browser::item_selected(void* item) const {
+  if (model_) {
+    int n = MODEL_LINE(item)-1;
+    return (model_sel_[n>>3] >> (n&7)) & 1;
+  }
   return ((FL_BLINE*)item)->flags&SELECTED;
 }
 /**
@@ -115,6 +166,12 @@ int Fl_Browser::item_selected(void* item) const {
   \see select(), selected(), value(), item_select(), item_selected()
 */
 void Fl_Browser::item_select(void *item, int val) {
+  if (model_) {
+    int n = MODEL_LINE(item)-1;
+    if (val) model_sel_[n>>3] |= (unsigned char)(1 << (n&7));
+    else     model_sel_[n>>3] &= (unsigned char)~(1 << (n&7));
+    return;
+  }
   if (val) ((FL_BLINE*)item)->flags |= SELECTED;
   else     ((FL_BLINE*)item)->flags &= ~SELECTED;
 }
@@ -125,19 +182,16 @@ void Fl_Browser::item_select(void *item, int val) {
   \returns The item's text string. (Can be NULL)
 */
 const char *Fl_Browser::item_text(void *item) const { 
+  if (model_) return model_->text(MODEL_LINE(item));
   return ((FL_BLINE*)item)->txt;
 }
 
 /**
   Returns the item for specified \p line.
 
-  Note: This call is slow. It's fine for e.g. responding to user
-  clicks, but slow if called often, such as in a tight sorting loop.
-  Finding an item 'by line' involves a linear lookup on the internal
-  linked list. The performance hit can be significant if the browser's
-  contents is large, and the method is called often (e.g. during a sort).
-  If you're writing a subclass, use the protected methods item_first(),
-  item_next(), etc. to access the internal linked list more efficiently.
+  The lines are kept in an array, so this is fast.
+  There are no items of this type in model mode (see model()), where
+  NULL is returned. Use item_at() to get an item in either mode.
 
   \param[in] line The line number of the item to return. (1 based)
   \retval item that was found.
@@ -145,72 +199,283 @@ const char *Fl_Browser::item_text(void *item) const {
   \see item_at(), find_line(), lineno()
 */
 FL_BLINE* Fl_Browser::find_line(int line) const {
-  int n; FL_BLINE* l;
-  if (line == cacheline) return cache;
-  if (cacheline && line > (cacheline/2) && line < ((cacheline+lines)/2)) {
-    n = cacheline; l = cache;
-  } else if (line <= (lines/2)) {
-    n = 1; l = first;
-  } else {
-    n = lines; l = last;
-  }
-  for (; n < line && l; n++) l = l->next;
-  for (; n > line && l; n--) l = l->prev;
-  ((Fl_Browser*)this)->cacheline = line;
-  ((Fl_Browser*)this)->cache = l;
-  return l;
+  if (line < 1 || line > lines || model_) return 0;
+  line--;
+  return index_[line < gap_ ? line : line+gapsize_];
+}
+
+/**
+  Return the item at specified \p line.
+  \param[in] line The line of the item to return. (1 based)
+  \returns The item, or NULL if line out of range.
+  \see item_at(), find_line(), lineno()
+*/
+void *Fl_Browser::item_at(int line) const {
+  if (model_) return (line < 1 || line > lines) ? 0 : (void*)(fl_intptr_t)line;
+  return (void*)find_line(line);
 }
 
 /**
   Returns line number corresponding to \p item, or zero if not found.
-  Caveat: See efficiency note in find_line().
+  Each item remembers its line number. After lines were inserted or
+  removed, the numbers of the lines below are updated the first time
+  one of them is asked for.
   \param[in] item The item to be found
   \returns The line number of the item, or 0 if not found.
   \see item_at(), find_line(), lineno()
 */
 int Fl_Browser::lineno(void *item) const {
+  if (!item) return 0;
+  if (model_) return MODEL_LINE(item);
   FL_BLINE* l = (FL_BLINE*)item;
-  if (!l) return 0;
-  if (l == cache) return cacheline;
-  if (l == first) return 1;
-  if (l == last) return lines;
-  if (!cache) {
-    ((Fl_Browser*)this)->cache = first;
-    ((Fl_Browser*)this)->cacheline = 1;
-  }
-  // assume it is near cache, search both directions:
-  FL_BLINE* b = cache->prev;
-  int bnum = cacheline-1;
-  FL_BLINE* f = cache->next;
-  int fnum = cacheline+1;
+  if (l->line <= numbered_ && find_line(l->line) == l) return l->line;
+  // renumber the lines below the last insertion or removal up to item:
+  for (int n = numbered_+1; n <= lines; n++) {
+    FL_BLINE* t = find_line(n);
+    t->line = n;
+    numbered_ = n;
+    if (t == l) return n;
+  }
+  return 0;
+}
+
+// Internal: moves the gap in index_ to position pos (0 based)
+void Fl_Browser::index_gap(int pos) {
+  if (pos < gap_)
+    memmove(index_+pos+gapsize_, index_+pos, (gap_-pos)*sizeof(FL_BLINE*));
+  else if (pos > gap_)
+    memmove(index_+gap_, index_+gap_+gapsize_, (pos-gap_)*sizeof(FL_BLINE*));
+  gap_ = pos;
+}
+
+// Internal: (re)builds the Fenwick tree of the line heights
+void Fl_Browser::heights_build() const {
+  if (heights_size_ <= lines) {
+    free(heights_);
+    heights_size_ = lines+gapsize_+1;
+    heights_ = (long*)malloc(heights_size_*sizeof(long));
+  }
+  int n;
+  for (n = 1; n <= lines; n++) heights_[n] = find_line(n)->height;
+  for (n = 1; n <= lines; n++) {
+    int p = n + (n & -n);
+    if (p <= lines) heights_[p] += heights_[n];
+  }
+  heights_lines_ = lines;
+}
+
+// Internal: updates the Fenwick tree after a line of height h was
+// inserted as line 'line'. Appending a line is cheap, anything else
+// makes the tree be rebuilt when it is needed again.
+void Fl_Browser::heights_insert(int line, int h) {
+  if (heights_lines_ < 0) return;
+  if (line != lines || heights_lines_ != lines-1 || line >= heights_size_) {
+    heights_lines_ = -1;
+    return;
+  }
+  // the new entry covers the lines line-lowbit(line)+1 .. line:
+  long s = h;
+  for (int n = line-1; n > line-(line & -line); n -= (n & -n)) s += heights_[n];
+  heights_[line] = s;
+  heights_lines_ = line;
+}
+
+// Internal: updates the Fenwick tree after line 'line' was removed
+void Fl_Browser::heights_remove(int line) {
+  if (heights_lines_ < 0) return;
+  if (line == heights_lines_) heights_lines_ = line-1;	// the last line
+  else heights_lines_ = -1;
+}
+
+// Internal: updates the Fenwick tree after the height of 'line' changed by dh
+void Fl_Browser::heights_change(int line, int dh) {
+  if (heights_lines_ < 0) return;
+  for (; line <= heights_lines_; line += (line & -line)) heights_[line] += dh;
+}
+
+// Internal: sets the height of line l, which must be in the browser
+void Fl_Browser::set_height(FL_BLINE *l, int h) {
+  int dh = h - l->height;
+  if (!dh) return;
+  if (l->height != uniform_height_) odd_heights_--;
+  if (h != uniform_height_) odd_heights_++;
+  l->height = h;
+  full_height_ += dh;
+  if (heights_lines_ >= 0) heights_change(lineno(l), dh);
+}
+
+// Internal: returns the position of 'line' (1 based) in pixels,
+// i.e. the height of all lines above it.
+long Fl_Browser::line_position(int line) const {
+  if (model_) return (long)(line-1)*model_height();
+  if (!odd_heights_) return (long)(line-1)*uniform_height_;
+  if (heights_lines_ < 0) heights_build();
+  long s = 0;
+  for (line--; line > 0; line -= (line & -line)) s += heights_[line];
+  return s;
+}
+
+// Internal: returns the line covering position pos, i.e. the first line
+// whose position plus height is larger than pos, or size()+1 if pos is
+// below the last line.
+int Fl_Browser::position_line(long pos) const {
+  if (pos < 0) pos = 0;
+  int hh = model_ ? model_height() : (odd_heights_ ? 0 : uniform_height_);
+  if (hh > 0) return pos/hh < lines ? int(pos/hh)+1 : lines+1;
+  if (heights_lines_ < 0) heights_build();
+  int n = 0, step = 1;
+  while (step <= lines/2) step *= 2;
+  for (; step; step /= 2) {
+    if (n+step <= lines && heights_[n+step] <= pos) {
+      n += step;
+      pos -= heights_[n];
+    }
+  }
+  return n+1;
+}
+
+/**
+  Returns the vertical position of \p item in pixels, i.e. the height
+  of all lines above it.
+  \param[in] item The item whose position is returned.
+  \returns The position in pixels, or -1 if \p item is not in the browser.
+  \see item_at_position()
+  \version 1.4.0
+*/
+int Fl_Browser::item_position(void *item) const {
+  int n = lineno(item);
+  return n ? (int)line_position(n) : -1;
+}
+
+/**
+  Returns the item covering the vertical position \p pos, or the last
+  visible item if \p pos is below the last line.
+  \param[in] pos The vertical position in pixels.
+  \param[out] itempos The position of the returned item.
+  \returns The item, or NULL if the browser is empty.
+  \see item_position()
+  \version 1.4.0
+*/
+void *Fl_Browser::item_at_position(int pos, int &itempos) const {
+  if (!lines) return 0;
+  int n = position_line(pos);
+  if (n > lines) {
+    // skip hidden lines at the end:
+    for (n = lines; n > 1 && !model_ && find_line(n)->height == 0; n--) {}
+  }
+  itempos = (int)line_position(n);
+  return item_at(n);
+}
+
+// Internal: returns the height of all lines in model mode
+int Fl_Browser::model_height() const {
+  fl_font(textfont(), textsize());
+  int hh = fl_height();
+  return hh > 2 ? hh : 2;
+}
+
+// Internal: returns a temporary FL_BLINE with the text of an item
+// in model mode, valid until the next call
+FL_BLINE *Fl_Browser::model_item(void *item) const {
+  int n = MODEL_LINE(item);
+  const char *t = model_->text(n);
+  if (!t) t = "";
+  int l = (int) strlen(t);
+  if (l > model_line_size_) {
+    free(model_line_);
+    model_line_ = (FL_BLINE*)malloc(sizeof(FL_BLINE)+l);
+    model_line_size_ = l;
+  }
+  FL_BLINE* b = model_line_;
+  b->prev = b->next = 0;
+  b->data = 0;
+  b->icon = model_->icon(n);
+  b->line = n;
+  b->height = 0;
+  b->length = (short)l;
+  b->flags = item_selected(item) ? SELECTED : 0;
+  memcpy(b->txt, t, l+1);
+  return b;
+}
+
+// Internal: appends a line with the text s[0..n-1] for load().
+// The line is only linked, load_done() adds it to the index.
+void Fl_Browser::load_line(const char *s, int n) {
+  int size = (int(sizeof(FL_BLINE))+n+7) & ~7;
+  if (!blocks_ || blocks_->size - blocks_->used < size) {
+    int bsize = size > BLOCK_SIZE ? size : BLOCK_SIZE;
+    Fl_Browser_Block* b = (Fl_Browser_Block*)malloc(BLOCK_HEADER+bsize);
+    b->next = blocks_;
+    b->used = 0;
+    b->size = bsize;
+    blocks_ = b;
+  }
+  FL_BLINE* t = (FL_BLINE*)((char*)blocks_ + BLOCK_HEADER + blocks_->used);
+  blocks_->used += size;
+  t->length = (short)n;
+  t->flags = INBLOCK;
+  if (n) memcpy(t->txt, s, n);
+  t->txt[n] = 0;
+  t->data = 0;
+  t->icon = 0;
+  t->height = 0;
+  t->next = 0;
+  t->prev = last;
+  if (last) last->next = t;
+  else first = t;
+  last = t;
+}
+
+// Internal: adds the lines appended by load_line() to the index,
+// and measures their heights
+void Fl_Browser::load_done() {
+  FL_BLINE* l = lines ? find_line(lines)->next : first;
   int n = 0;
-  for (;;) {
-    if (b == l) {n = bnum; break;}
-    if (f == l) {n = fnum; break;}
-    if (b) {b = b->prev; bnum--;}
-    if (f) {f = f->next; fnum++;}
+  for (FL_BLINE* t = l; t; t = t->next) n++;
+  if (!n) return;
+  index_gap(lines);
+  if (gapsize_ < n) {
+    int size = lines+n < 32 ? 64 : lines+n + (lines+n)/4;
+    index_ = (FL_BLINE**)realloc(index_, size*sizeof(FL_BLINE*));
+    gapsize_ = size-lines;
+  }
+  int numbered = (numbered_ == lines);
+  for (; l; l = l->next) {
+    index_[gap_++] = l;
+    gapsize_--;
+    lines++;
+    l->line = lines;
+    int h = item_height(l);
+    if (lines == 1) {uniform_height_ = h; odd_heights_ = 0;}
+    l->height = h;
+    if (h != uniform_height_) odd_heights_++;
+    full_height_ += h;
+    heights_insert(lines, h);
   }
-  ((Fl_Browser*)this)->cache = l;
-  ((Fl_Browser*)this)->cacheline = n;
-  return n;
+  if (numbered) numbered_ = lines;
+  redraw_lines();
 }
 
 /**
   Removes the item at the specified \p line.
-  Caveat: See efficiency note in find_line().
   You must call redraw() to make any changes visible.
   \param[in] line The line number to be removed. (1 based) Must be in range!
   \returns Pointer to browser item that was removed (and is no longer valid).
+             Items read by load() are not allocated with malloc() and must
+             not be freed.
   \see add(), insert(), remove(), swap(int,int), clear()
 */
 FL_BLINE* Fl_Browser::_remove(int line) {
   FL_BLINE* ttt = find_line(line);
   deleting(ttt);
 
-  cacheline = line-1;
-  cache = ttt->prev;
+  index_gap(line-1);
+  gapsize_++;
   lines--;
-  full_height_ -= item_height(ttt);
+  if (numbered_ >= line) numbered_ = line-1;
+  full_height_ -= ttt->height;
+  if (ttt->height != uniform_height_) odd_heights_--;
+  heights_remove(line);
   if (ttt->prev) ttt->prev->next = ttt->next;
   else first = ttt->next;
   if (ttt->next) ttt->next->prev = ttt->prev;
@@ -227,46 +492,55 @@ FL_BLINE* Fl_Browser::_remove(int line) {
   \see add(), insert(), remove(), swap(int,int), clear()
 */
 void Fl_Browser::remove(int line) {
-  if (line < 1 || line > lines) return;
-  free(_remove(line));
+  if (model_ || line < 1 || line > lines) return;
+  free_line(_remove(line));
 }
 
 /**
   Insert specified \p item above \p line.
   If \p line > size() then the line is added to the end.
 
-  Caveat: See efficiency note in find_line().
-
   \param[in] line  The new line will be inserted above this line (1 based).
   \param[in] item  The item to be added.
 */
 void Fl_Browser::insert(int line, FL_BLINE* item) {
+  if (line < 1) line = 1;
+  if (line > lines) line = lines+1;
+  FL_BLINE* n = find_line(line);
   if (!first) {
     item->prev = item->next = 0;
     first = last = item;
-  } else if (line <= 1) {
-    inserting(first, item);
-    item->prev = 0;
-    item->next = first;
-    item->next->prev = item;
-    first = item;
-  } else if (line > lines) {
+  } else if (!n) {
     item->prev = last;
     item->prev->next = item;
     item->next = 0;
     last = item;
   } else {
-    FL_BLINE* n = find_line(line);
     inserting(n, item);
     item->next = n;
     item->prev = n->prev;
-    item->prev->next = item;
+    if (item->prev) item->prev->next = item;
+    else first = item;
     n->prev = item;
   }
-  cacheline = line;
-  cache = item;
+  if (!gapsize_) {
+    int size = lines < 32 ? 64 : 2*lines;
+    index_ = (FL_BLINE**)realloc(index_, size*sizeof(FL_BLINE*));
+    gap_ = lines;			// no gap, so the lines are contiguous
+    gapsize_ = size-lines;
+  }
+  index_gap(line-1);
+  index_[gap_++] = item;
+  gapsize_--;
   lines++;
-  full_height_ += item_height(item);
+  item->line = line;
+  if (numbered_ >= line-1) numbered_ = line;
+  int h = item_height(item);
+  if (lines == 1) {uniform_height_ = h; odd_heights_ = 0;}
+  item->height = h;
+  if (h != uniform_height_) odd_heights_++;
+  full_height_ += h;
+  heights_insert(line, h);
   redraw_line(item);
 }
 
@@ -278,12 +552,15 @@ void Fl_Browser::insert(int line, FL_BLINE* item) {
 
   The optional void * argument \p d will be the data() of the new item.
 
+  Does nothing in model mode.
+
   \param[in] line Line position for insert. (1 based) \n
              If \p line > size(), the entry will be added at the end.
   \param[in] newtext The label text for the new line.
   \param[in] d Optional pointer to user data to be associated with the new line.
 */
 void Fl_Browser::insert(int line, const char* newtext, void* d) {
+  if (model_) return;
   if (!newtext) newtext = "";		// STR #3269
   int l = (int) strlen(newtext);
   FL_BLINE* t = (FL_BLINE*)malloc(sizeof(FL_BLINE)+l);
@@ -292,6 +569,7 @@ void Fl_Browser::insert(int line, const char* newtext, void* d) {
   strcpy(t->txt, newtext);
   t->data = d;
   t->icon = 0;
+  t->height = 0;
   insert(line, t);
 }
 
@@ -302,7 +580,7 @@ void Fl_Browser::insert(int line, const char* newtext, void* d) {
   \param[in] from Line number of item to be moved
 */
 void Fl_Browser::move(int to, int from) {
-  if (from < 1 || from > lines) return;
+  if (model_ || from < 1 || from > lines) return;
   insert(to, _remove(from));
 }
 
@@ -312,43 +590,48 @@ void Fl_Browser::move(int to, int from) {
   Text may contain format characters; see format_char() for details.
   \p newtext is copied using the strdup() function, and can be NULL to make a blank line.
 
-  Does nothing if \p line is out of range.
+  Does nothing if \p line is out of range, or in model mode.
 
   \param[in] line The line of the item whose text will be changed. (1 based)
   \param[in] newtext The new string to be assigned to the item.
 */
 void Fl_Browser::text(int line, const char* newtext) {
-  if (line < 1 || line > lines) return;
+  if (model_ || line < 1 || line > lines) return;
   FL_BLINE* t = find_line(line);
   if (!newtext) newtext = "";		// STR #3269
   int l = (int) strlen(newtext);
   if (l > t->length) {
     FL_BLINE* n = (FL_BLINE*)malloc(sizeof(FL_BLINE)+l);
     replacing(t, n);
-    cache = n;
     n->data = t->data;
     n->icon = t->icon;
+    n->line = line;
+    n->height = t->height;
     n->length = (short)l;
-    n->flags = t->flags;
+    n->flags = t->flags & ~INBLOCK;
     n->prev = t->prev;
     if (n->prev) n->prev->next = n; else first = n;
     n->next = t->next;
     if (n->next) n->next->prev = n; else last = n;
-    free(t);
+    index_[line-1 < gap_ ? line-1 : line-1+gapsize_] = n;
+    free_line(t);
     t = n;
   }
   strcpy(t->txt, newtext);
-  redraw_line(t);
+  int h = t->height;
+  set_height(t, item_height(t));
+  if (t->height != h) redraw_lines();
+  else redraw_line(t);
 }
 
 /**
   Sets the user data for specified \p line to \p d.
-  Does nothing if \p line is out of range.
+  Does nothing if \p line is out of range, or in model mode.
   \param[in] line The line of the item whose data() is to be changed. (1 based)
   \param[in] d The new data to be assigned to the item. (can be NULL)
 */
 void Fl_Browser::data(int line, void* d) {
-  if (line < 1 || line > lines) return;
+  if (model_ || line < 1 || line > lines) return;
   find_line(line)->data = d;
 }
 
@@ -361,6 +644,7 @@ void Fl_Browser::data(int line, void* d) {
        incr_height(), full_height()
 */
 int Fl_Browser::item_height(void *item) const {
+  if (model_) return model_height();
   FL_BLINE* l = (FL_BLINE*)item;
   if (l->flags & NOTDISPLAYED) return 0;
 
@@ -423,7 +707,7 @@ int Fl_Browser::item_height(void *item) const {
        incr_height(), full_height()
 */
 int Fl_Browser::item_width(void *item) const {
-  FL_BLINE* l=(FL_BLINE*)item;
+  FL_BLINE* l = model_ ? model_item(item) : (FL_BLINE*)item;
   char* str = l->txt;
   const int* i = column_widths();
   int ww = 0;
@@ -485,6 +769,7 @@ int Fl_Browser::item_width(void *item) const {
        incr_height(), full_height()
 */
 int Fl_Browser::full_height() const {
+  if (model_) return lines*model_height();
   return full_height_;
 }
 
@@ -507,7 +792,7 @@ int Fl_Browser::incr_height() const {
   \param[in] X,Y,W,H position and size.
 */
 void Fl_Browser::item_draw(void* item, int X, int Y, int W, int H) const {
-  FL_BLINE* l = (FL_BLINE*)item;
+  FL_BLINE* l = model_ ? model_item(item) : (FL_BLINE*)item;
   char* str = l->txt;
   const int* i = column_widths();
 
@@ -610,10 +895,22 @@ Fl_Browser::Fl_Browser(int X, int Y, int W, int H, const char *L)
   column_widths_ = no_columns;
   lines = 0;
   full_height_ = 0;
-  cacheline = 0;
   format_char_ = '@';
   column_char_ = '\t';
-  first = last = cache = 0;
+  first = last = 0;
+  index_ = 0;
+  gap_ = gapsize_ = 0;
+  numbered_ = 0;
+  uniform_height_ = 0;
+  odd_heights_ = 0;
+  heights_ = 0;
+  heights_size_ = 0;
+  heights_lines_ = -1;
+  model_ = 0;
+  model_sel_ = 0;
+  model_line_ = 0;
+  model_line_size_ = -1;
+  blocks_ = 0;
 }
 
 /**
@@ -623,15 +920,14 @@ Fl_Browser::Fl_Browser(int X, int Y, int W, int H, const char *L)
   \see topline(), middleline(), bottomline()
 */
 void Fl_Browser::lineposition(int line, Fl_Line_Position pos) {
-  if (line<1) line = 1;
   if (line>lines) line = lines;
+  if (line<1) line = 1;
   int p = 0;
 
-  FL_BLINE* l;
-  for (l=first; l && line>1; l = l->next) {
-    line--; p += item_height(l);
+  if (lines) {
+    p = (int)line_position(line);
+    if (pos == BOTTOM) p += model_ ? model_height() : find_line(line)->height;
   }
-  if (l && (pos == BOTTOM)) p += item_height (l);
 
   int final = p, X, Y, W, H;
   bbox(X, Y, W, H);
@@ -676,30 +972,127 @@ void Fl_Browser::textsize(Fl_Fontsize newSize) {
     return; // avoid recalculation
   Fl_Browser_::textsize(newSize);
   new_list();
+  item_heights_changed();
+}
+
+/**
+  Sets the default text font for the lines in the browser to \p font.
+
+  Like textsize(Fl_Fontsize), this recalculates all item heights, and
+  returns immediately if \p font equals the current textfont().
+  \version 1.4.0
+*/
+void Fl_Browser::textfont(Fl_Font font) {
+  if (font == textfont())
+    return; // avoid recalculation
+  Fl_Browser_::textfont(font);
+  item_heights_changed();
+}
+
+/**
+  Measures the heights of all lines again.
+
+  Fl_Browser keeps the height of each line, so a subclass whose
+  item_height() changes for all lines, e.g. because it draws larger
+  icons, must call this.
+  \version 1.4.0
+*/
+void Fl_Browser::item_heights_changed() {
+  redraw_lines();
   full_height_ = 0;
-  if (lines == 0) return;
-  for (FL_BLINE* itm=(FL_BLINE *)item_first(); itm; itm=(FL_BLINE *)item_next(itm)) {
-    full_height_ += item_height(itm);
+  odd_heights_ = 0;
+  heights_lines_ = -1;
+  if (lines == 0 || model_) return;
+  uniform_height_ = item_height(first);
+  for (FL_BLINE* itm=first; itm; itm=itm->next) {
+    itm->height = item_height(itm);
+    if (itm->height != uniform_height_) odd_heights_++;
+    full_height_ += itm->height;
   }
 }
 
 /**
   Removes all the lines in the browser.
+  In model mode this leaves model mode, see model().
   \see add(), insert(), remove(), swap(int,int), clear()
 */
 void Fl_Browser::clear() {
   for (FL_BLINE* l = first; l;) {
     FL_BLINE* n = l->next;
-    free(l);
+    free_line(l);
     l = n;
   }
+  while (blocks_) {
+    Fl_Browser_Block* b = blocks_->next;
+    free(blocks_);
+    blocks_ = b;
+  }
+  free(index_);
+  free(heights_);
+  free(model_sel_);
+  free(model_line_);
+  index_ = 0;
+  gap_ = gapsize_ = 0;
+  numbered_ = 0;
   full_height_ = 0;
+  odd_heights_ = 0;
+  heights_ = 0;
+  heights_size_ = 0;
+  heights_lines_ = -1;
+  model_ = 0;
+  model_sel_ = 0;
+  model_line_ = 0;
+  model_line_size_ = -1;
   first = 0;
   last = 0;
   lines = 0;
   new_list();
 }
 
+/**
+  Shows the lines of data model \p m instead of the browser's own lines.
+
+  Any lines that were added to the browser are removed. While the
+  browser is in model mode, the methods that add, remove or change lines
+  (add(), insert(), remove(), move(), swap(int,int), text(int, const char*),
+  data(int, void*), icon(int, Fl_Image*), hide(int) and show(int)) do
+  nothing; the other methods work as usual, where text() and icon() ask
+  the model. The selection is kept by the browser, and cleared by
+  model_changed().
+
+  All lines have the same height in model mode.
+  Subclasses that draw their own items, like Fl_File_Browser, do not
+  support model mode.
+
+  The browser does not take ownership of the model. clear() and
+  model(NULL) leave model mode.
+
+  \param[in] m The data model, or NULL to show the browser's own lines again.
+  \see Fl_Browser_Model, model_changed()
+  \version 1.4.0
+*/
+void Fl_Browser::model(Fl_Browser_Model *m) {
+  clear();
+  model_ = m;
+  if (model_) {
+    lines = model_->size();
+    if (lines < 0) lines = 0;
+    model_sel_ = (unsigned char*)calloc(lines/8+1, 1);
+  }
+  redraw();
+}
+
+/**
+  Tells the browser that the number of lines of its model has changed.
+  The selection is cleared and the browser scrolls to the top.
+  Call redraw() if only the text of some lines changed.
+  \see model(Fl_Browser_Model*)
+  \version 1.4.0
+*/
+void Fl_Browser::model_changed() {
+  model(model_);
+}
+
 /**
   Adds a new line to the end of the browser.
 
@@ -726,6 +1119,7 @@ void Fl_Browser::add(const char* newtext, void* d) {
 */
 const char* Fl_Browser::text(int line) const {
   if (line < 1 || line > lines) return 0;
+  if (model_) return model_->text(line);
   return find_line(line)->txt;
 }
 
@@ -738,7 +1132,7 @@ const char* Fl_Browser::text(int line) const {
 
 */
 void* Fl_Browser::data(int line) const {
-  if (line < 1 || line > lines) return 0;
+  if (model_ || line < 1 || line > lines) return 0;
   return find_line(line)->data;
 }
 
@@ -752,7 +1146,7 @@ void* Fl_Browser::data(int line) const {
 */
 int Fl_Browser::select(int line, int val) {
   if (line < 1 || line > lines) return 0;
-  return Fl_Browser_::select(find_line(line), val);
+  return Fl_Browser_::select(item_at(line), val);
 }
 
 /**
@@ -763,7 +1157,7 @@ int Fl_Browser::select(int line, int val) {
   */
 int Fl_Browser::selected(int line) const {
   if (line < 1 || line > lines) return 0;
-  return find_line(line)->flags & SELECTED;
+  return item_selected(item_at(line));
 }
 
 /**
@@ -776,9 +1170,9 @@ int Fl_Browser::selected(int line) const {
 */
 void Fl_Browser::show(int line) {
   FL_BLINE* t = find_line(line);
-  if (t->flags & NOTDISPLAYED) {
+  if (t && (t->flags & NOTDISPLAYED)) {
     t->flags &= ~NOTDISPLAYED;
-    full_height_ += item_height(t);
+    set_height(t, item_height(t));
     if (Fl_Browser_::displayed(t)) redraw();
   }
 }
@@ -794,9 +1188,9 @@ void Fl_Browser::show(int line) {
 */
 void Fl_Browser::hide(int line) {
   FL_BLINE* t = find_line(line);
-  if (!(t->flags & NOTDISPLAYED)) {
-    full_height_ -= item_height(t);
+  if (t && !(t->flags & NOTDISPLAYED)) {
     t->flags |= NOTDISPLAYED;
+    set_height(t, 0);
     if (Fl_Browser_::displayed(t)) redraw();
   }
 }
@@ -820,6 +1214,7 @@ void Fl_Browser::display(int line, int val) {
 */
 int Fl_Browser::visible(int line) const {
   if (line < 1 || line > lines) return 0;
+  if (model_) return 1;
   return !(find_line(line)->flags&NOTDISPLAYED);
 }
 
@@ -840,7 +1235,9 @@ int Fl_Browser::value() const {
 */
 void Fl_Browser::swap(FL_BLINE *a, FL_BLINE *b) {
 
-  if ( a == b || !a || !b) return;          // nothing to do
+  if ( a == b || !a || !b || model_) return; // nothing to do
+  int aline = lineno(a);
+  int bline = lineno(b);
   swapping(a, b);
   FL_BLINE *aprev  = a->prev;
   FL_BLINE *anext  = a->next;
@@ -872,9 +1269,13 @@ void Fl_Browser::swap(FL_BLINE *a, FL_BLINE *b) {
      if ( bprev ) bprev->next = a; else first = a;
      a->next = bnext;
   }
-  // Disable cache -- we played around with positions
-  cacheline = 0;
-  cache = 0;
+  // Swap the lines in the index
+  index_[aline-1 < gap_ ? aline-1 : aline-1+gapsize_] = b;
+  index_[bline-1 < gap_ ? bline-1 : bline-1+gapsize_] = a;
+  a->line = bline;
+  b->line = aline;
+  heights_change(aline, b->height - a->height);
+  heights_change(bline, a->height - b->height);
 }
 
 /**
@@ -900,20 +1301,15 @@ void Fl_Browser::swap(int a, int b) {
 */
 void Fl_Browser::icon(int line, Fl_Image* icon) {
 
-  if (line<1 || line > lines) return;
+  if (model_ || line<1 || line > lines) return;
 
   FL_BLINE* bl = find_line(line);
 
-  int old_h = bl->icon ? bl->icon->h()+2 : 0;	// init with *old* icon height
-  bl->icon = 0;					// remove icon, if any
-  int th = item_height(bl);			// height of text only
-  int new_h = icon ? icon->h()+2 : 0;		// init with *new* icon height
-  if (th > old_h) old_h = th;
-  if (th > new_h) new_h = th;
-  int dh = new_h - old_h;
-  full_height_ += dh;				// do this *always*
-
+  int old_h = bl->height;
   bl->icon = icon;				// set new icon
+  set_height(bl, item_height(bl));
+  int dh = bl->height - old_h;
+
   if (dh>0) {
     redraw();					// icon larger than item? must redraw widget
   } else {
@@ -929,6 +1325,7 @@ void Fl_Browser::icon(int line, Fl_Image* icon) {
   \returns The icon defined, or NULL if none.
 */
 Fl_Image* Fl_Browser::icon(int line) const {
+  if (model_) return (line<1 || line > lines) ? 0 : model_->icon(line);
   FL_BLINE* l = find_line(line);
   return(l ? l->icon : NULL);
 }
@@ -132,10 +132,29 @@ void Fl_Browser_::redraw_line(void* item) {
 // Figure out top() based on position():
 void Fl_Browser_::update_top() {
   if (!top_) top_ = item_first();
+  // if the subclass knows where top() is, keep showing it even if items
+  // above it were added, removed or resized:
+  if (top_ && position_ == real_position_) {
+    int p = item_position(top_);
+    if (p >= 0 && p+offset_ != real_position_) {
+      position_ = real_position_ = p+offset_;
+      damage(FL_DAMAGE_SCROLL);
+    }
+  }
   if (position_ != real_position_) {
     void* l;
     int ly;
     int yy = position_;
+    // ask the subclass, if it knows the item positions:
+    if (top_ && (l = item_at_position(yy, ly)) != 0) {
+      int hh = item_height(l);
+      if ((ly+hh) <= yy) yy = hh > 0 ? ly+hh-1 : ly; // past the end
+      top_ = l;
+      offset_ = yy-ly;
+      real_position_ = yy;
+      damage(FL_DAMAGE_SCROLL);
+      return;
+    }
     // start from either head or current position, whichever is closer:
     if (!top_ || yy <= (real_position_/2)) {
       l = item_first();
@@ -260,6 +279,25 @@ void Fl_Browser_::display(void* item) {
   void* lp = item_prev(l);
   if (lp == item) {position(real_position_+Y-item_quick_height(lp)); return;}
 
+  // if the subclass knows the item's position, no need to search for it:
+  int p = item_position(item);
+  if (p >= 0) {
+    h1 = item_quick_height(item);
+    Y = p-real_position_;
+    if (Y >= 0) {
+      if (Y <= H) { // it is visible or right at bottom
+	Y = Y+h1-H; // find where bottom edge is
+	if (Y > 0) position(real_position_+Y); // scroll down a bit
+      } else {
+	position(real_position_+Y-(H-h1)/2); // center it
+      }
+    } else {
+      if ((Y + h1) >= 0) position(real_position_+Y);
+      else position(real_position_+Y-(H-h1)/2);
+    }
+    return;
+  }
+
 #ifdef DISPLAY_SEARCH_BOTH_WAYS_AT_ONCE
   // search for item.  We search both up and down the list at the same time,
   // this evens up the execution time for the two cases - the old way was
@@ -19,6 +19,8 @@
 #include <FL/Fl.H>
 #include <FL/Fl_Browser.H>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <FL/fl_utf8.h>
 
 /**
@@ -28,32 +30,53 @@
   was any error in opening or reading the file, in which case errno
   is set to the system error.  The data() of each line is set
   to NULL.
+
+  The file is read in large blocks and lines may have any length. The
+  memory of the lines is allocated in large blocks as well, which makes
+  loading large files fast.
   \param[in] filename The filename to load
   \returns 1 if OK, 0 on error (errno has reason)
   \see add()
 */
 int Fl_Browser::load(const char *filename) {
-#define MAXFL_BLINE 1024
-    char newtext[MAXFL_BLINE];
-    int c;
-    int i;
-    clear();
-    if (!filename || !(filename[0])) return 1;
-    FILE *fl = fl_fopen(filename,"r");
-    if (!fl) return 0;
-    i = 0;
-    do {
-	c = getc(fl);
-	if (c == '\n' || c <= 0 || i>=(MAXFL_BLINE-1)) {
-	    newtext[i] = 0;
-	    add(newtext);
-	    i = 0;
-	} else {
-	    newtext[i++] = c;
+#define LOAD_BLOCK 65536
+  clear();
+  if (!filename || !(filename[0])) return 1;
+  FILE *fl = fl_fopen(filename,"r");
+  if (!fl) return 0;
+  char *buf = (char*)malloc(LOAD_BLOCK);
+  char *part = 0;		// start of a line continued in the next block
+  int partlen = 0, partsize = 0;
+  size_t n;
+  while ((n = fread(buf, 1, LOAD_BLOCK, fl)) > 0) {
+    const char *p = buf, *end = buf+n;
+    while (p < end) {
+      const char *e = p;
+      while (e < end && *e != '\n' && *e) e++;
+      int len = int(e-p);
+      if (e == end || partlen) {
+	if (partlen+len > partsize) {
+	  partsize = 2*(partlen+len);
+	  part = (char*)realloc(part, partsize);
 	}
-    } while (c >= 0);
-    fclose(fl);
-    return 1;
+	memcpy(part+partlen, p, len);
+	partlen += len;
+	if (e == end) break;
+	load_line(part, partlen);
+	partlen = 0;
+      } else {
+	load_line(p, len);
+      }
+      p = e+1;
+    }
+  }
+  load_line(part, partlen);	// the last line, even if empty
+  int err = ferror(fl);
+  free(part);
+  free(buf);
+  fclose(fl);
+  load_done();
+  return !err;
 }
 
 //
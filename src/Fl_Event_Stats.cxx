@@ -0,0 +1,433 @@
+//
+// "$Id$"
+//
+// Event loop statistics for the Fast Light Tool Kit (FLTK).
+//
+// Copyright 1998-2018 by Bill Spitzak and others.
+//
+// This library is free software. Distribution and use rights are outlined in
+// the file "COPYING" which should have been included with this file.  If this
+// file is missing or damaged, see the license at:
+//
+//     http://www.fltk.org/COPYING.php
+//
+// Please report all bugs and problems on the following page:
+//
+//     http://www.fltk.org/str.php
+//
+
+#include <FL/Fl_Event_Stats.H>
+#include <FL/Fl.H>
+#include <FL/Fl_Widget.H>
+#include <FL/Fl_System_Driver.H>
+#include <FL/fl_utf8.h>
+#include "flstring.h"
+
+#include <stdlib.h>
+#include <math.h>
+
+char Fl_Event_Stats::enabled_ = 0;
+
+static Fl_Event_Stats::Histogram phases[Fl_Event_Stats::PHASES];
+
+// all sources, and a hash table of their indices + 1 (0 = empty slot):
+static Fl_Event_Stats::Source *sources_;
+static int nsources, asources;
+static int *source_hash;
+static int source_hash_size;
+
+// the trace, a ring buffer of the most recent calls:
+struct Fl_Event_Stats_Trace {
+  double start;
+  double duration;
+  int source;
+};
+static Fl_Event_Stats_Trace *trace_;
+static int trace_size, trace_next, trace_count;
+
+static Fl_Event_Stats::Slow_Handler slow_handler_;
+static double slow_threshold;
+static void *slow_data;
+
+static const char * const phase_names[Fl_Event_Stats::PHASES] = {
+  "event", "fd", "timeout", "check", "idle", "awake",
+  "widget", "flush", "draw", "wait", "user"
+};
+
+/**
+  Adds a call that took \p seconds.
+*/
+void Fl_Event_Stats::Histogram::add(double seconds) {
+  if (seconds < 0.0) seconds = 0.0;
+  count++;
+  total += seconds;
+  if (seconds > max) max = seconds;
+  int i = 0;
+  double us = seconds * 1e6;
+  if (us >= 1.0) {
+    int e;
+    double m = frexp(us, &e); // us = m * 2^e, 0.5 <= m < 1
+    i = 1 + 4 * (e - 1) + int((2.0 * m - 1.0) * 4.0);
+    if (i >= BUCKETS) i = BUCKETS - 1;
+  }
+  bucket[i]++;
+}
+
+/**
+  Returns the shortest duration in seconds counted by bucket \p i.
+*/
+double Fl_Event_Stats::Histogram::bucket_start(int i) {
+  if (i <= 0) return 0.0;
+  i--;
+  return ldexp(1.0 + (i % 4) / 4.0, i / 4) * 1e-6;
+}
+
+/**
+  Returns the duration in seconds that \p p percent of the calls did
+  not exceed.
+  For instance percentile(50) is the median and percentile(100) is max.
+*/
+double Fl_Event_Stats::Histogram::percentile(double p) const {
+  if (!count) return 0.0;
+  if (p >= 100.0) return max;
+  if (p < 0.0) p = 0.0;
+  double target = count * p / 100.0;
+  double n = 0.0;
+  for (int i = 0; i < BUCKETS; i++) {
+    if (!bucket[i]) continue;
+    if (n + bucket[i] >= target) {
+      // interpolate within the bucket:
+      double lo = bucket_start(i), hi = bucket_start(i + 1);
+      double d = lo + (hi - lo) * (target - n) / bucket[i];
+      return d < max ? d : max;
+    }
+    n += bucket[i];
+  }
+  return max;
+}
+
+/**
+  Turns measuring the event loop on or off.
+  The statistics collected so far are kept, see reset().
+*/
+void Fl_Event_Stats::enable(int on) {
+  if (on) now(); // start the clock
+  enabled_ = (on != 0);
+}
+
+/**
+  Clears all statistics and the trace.
+*/
+void Fl_Event_Stats::reset() {
+  memset(phases, 0, sizeof(phases));
+  for (int i = 0; i < nsources; i++) free((void*)sources_[i].label);
+  free(sources_);
+  free(source_hash);
+  sources_ = 0;
+  source_hash = 0;
+  nsources = asources = source_hash_size = 0;
+  trace_next = trace_count = 0;
+}
+
+/**
+  Returns the histogram of all calls of a phase.
+*/
+const Fl_Event_Stats::Histogram &Fl_Event_Stats::phase(Phase p) {
+  static Histogram none;
+  if (p < 0 || p >= PHASES) return none;
+  return phases[p];
+}
+
+/**
+  Returns a short lowercase name of a phase, like "timeout".
+*/
+const char *Fl_Event_Stats::phase_name(Phase p) {
+  if (p < 0 || p >= PHASES) return "unknown";
+  return phase_names[p];
+}
+
+/**
+  Returns the number of sources measured so far.
+*/
+int Fl_Event_Stats::sources() {
+  return nsources;
+}
+
+/**
+  Returns the source with index \p i, from 0 to sources()-1.
+  The reference is valid until the next call is measured.
+*/
+const Fl_Event_Stats::Source &Fl_Event_Stats::source(int i) {
+  static Source none;
+  if (i < 0 || i >= nsources) return none;
+  return sources_[i];
+}
+
+/**
+  Sets a function that is called after every call that took \p threshold
+  seconds or longer. Waiting for events (phase WAIT) is not a call.
+
+  The handler is not measured, and it is not called for slow calls
+  of its own. Use NULL to remove the handler.
+*/
+void Fl_Event_Stats::slow_handler(Slow_Handler handler, double threshold, void *data) {
+  slow_handler_ = handler;
+  slow_threshold = threshold;
+  slow_data = data;
+}
+
+/**
+  Keeps the last \p n calls for write_trace().
+  A value of 0 (the default) turns the trace off. Each call uses
+  24 bytes. Changing the size clears the trace.
+*/
+void Fl_Event_Stats::trace(int n) {
+  if (n < 0) n = 0;
+  trace_ = (Fl_Event_Stats_Trace*)realloc(trace_, n * sizeof(Fl_Event_Stats_Trace));
+  if (!trace_) n = 0;
+  trace_size = n;
+  trace_next = trace_count = 0;
+}
+
+/**
+  Returns the number of calls kept for write_trace().
+*/
+int Fl_Event_Stats::trace() {
+  return trace_size;
+}
+
+// write the characters of a JSON string:
+static void write_json_chars(FILE *f, const char *s) {
+  for (; *s; s++) {
+    unsigned char c = (unsigned char)*s;
+    if (c == '"' || c == '\\') fprintf(f, "\\%c", c);
+    else if (c < 0x20) fprintf(f, "\\u%04x", c);
+    else putc(c, f);
+  }
+}
+
+/**
+  Writes the calls kept by trace() as a JSON file in the trace event
+  format, which can be opened with chrome://tracing or
+  https://ui.perfetto.dev .
+
+  Each call is a complete event ("ph":"X") named after its phase and
+  the label of its widget, the system event type or the function address,
+  with time stamps in microseconds since measuring started.
+  The addresses of the function, data and widget are stored in "args".
+  Returns 0 on success and -1 on error.
+*/
+int Fl_Event_Stats::write_trace(FILE *f) {
+  fprintf(f, "{\"traceEvents\":[");
+  int first = trace_next - trace_count;
+  if (first < 0) first += trace_size;
+  for (int i = 0; i < trace_count; i++) {
+    const Fl_Event_Stats_Trace &t = trace_[(first + i) % trace_size];
+    const Source &s = sources_[t.source];
+    fprintf(f, "%s\n{\"name\":\"%s", i ? "," : "", phase_names[s.phase]);
+    if (s.label) {
+      putc(' ', f);
+      write_json_chars(f, s.label);
+    } else if (s.phase == EVENT) {
+      fprintf(f, " %ld", (long)(fl_intptr_t)s.data);
+    } else if (s.function) {
+      fprintf(f, " %p", s.function);
+    }
+    putc('"', f);
+    fprintf(f, ",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":1,"
+            "\"args\":{\"function\":\"%p\",\"data\":\"%p\",\"widget\":\"%p\"}}",
+            phase_names[s.phase], t.start * 1e6, t.duration * 1e6,
+            s.function, s.data, (void*)s.widget);
+  }
+  fprintf(f, "\n],\"displayTimeUnit\":\"ms\"}\n");
+  return ferror(f) ? -1 : 0;
+}
+
+/**
+  Writes the trace to a file.
+  \see write_trace(FILE*)
+*/
+int Fl_Event_Stats::write_trace(const char *filename) {
+  FILE *f = fl_fopen(filename, "w");
+  if (!f) return -1;
+  int ret = write_trace(f);
+  if (fclose(f)) ret = -1;
+  return ret;
+}
+
+/**
+  Returns a monotonic time in seconds since measuring was first turned on.
+*/
+double Fl_Event_Stats::now() {
+  static double zero = -1.0;
+  double t = Fl::system_driver()->monotonic_clock();
+  if (zero < 0.0) zero = t;
+  return t - zero;
+}
+
+// hash value of a source:
+static unsigned source_key(int p, void *function, void *data, Fl_Widget *widget) {
+  unsigned h = (unsigned)p;
+  h = h * 31 + (unsigned)((fl_uintptr_t)function >> 3);
+  h = h * 31 + (unsigned)((fl_uintptr_t)data);
+  h = h * 31 + (unsigned)((fl_uintptr_t)widget >> 3);
+  return h ^ (h >> 16);
+}
+
+// rebuild the hash table of the sources with \p size slots:
+static int rehash_sources(int size) {
+  int *hash = (int*)calloc(size, sizeof(int));
+  if (!hash) return -1;
+  for (int n = 0; n < nsources; n++) {
+    const Fl_Event_Stats::Source &s = sources_[n];
+    unsigned i = source_key(s.phase, s.function, s.data, s.widget) & (size - 1);
+    while (hash[i]) i = (i + 1) & (size - 1);
+    hash[i] = n + 1;
+  }
+  free(source_hash);
+  source_hash = hash;
+  source_hash_size = size;
+  return 0;
+}
+
+// find a source, adding it if it is new:
+static int find_source(Fl_Event_Stats::Phase p, void *function, void *data, Fl_Widget *widget) {
+  Fl_Widget *label_widget = widget;
+  if (p == Fl_Event_Stats::WIDGET) widget = 0;
+  for (;;) {
+    unsigned h = source_key(p, function, data, widget);
+    if (source_hash_size) {
+      for (unsigned i = h & (source_hash_size - 1); source_hash[i];
+           i = (i + 1) & (source_hash_size - 1)) {
+        Fl_Event_Stats::Source &s = sources_[source_hash[i] - 1];
+        if (s.phase == p && s.function == function && s.data == data &&
+            s.widget == widget)
+          return source_hash[i] - 1;
+      }
+    }
+    // too many sources: count the call in the source of the phase
+    if (nsources < Fl_Event_Stats::MAX_SOURCES || (!function && !data && !widget)) break;
+    function = data = 0;
+    widget = label_widget = 0;
+  }
+  unsigned h = source_key(p, function, data, widget);
+  if (2 * (nsources + 1) > source_hash_size &&
+      rehash_sources(source_hash_size ? 2 * source_hash_size : 64) < 0)
+    return -1;
+  if (nsources >= asources) {
+    int size = asources ? 2 * asources : 32;
+    Fl_Event_Stats::Source *a = (Fl_Event_Stats::Source*)realloc(sources_, size * sizeof(Fl_Event_Stats::Source));
+    if (!a) return -1;
+    sources_ = a;
+    asources = size;
+  }
+  Fl_Event_Stats::Source &s = sources_[nsources];
+  memset(&s, 0, sizeof(s));
+  s.phase = p;
+  s.function = function;
+  s.data = data;
+  s.widget = widget;
+  if (label_widget && label_widget->label()) s.label = strdup(label_widget->label());
+  unsigned i = h & (source_hash_size - 1);
+  while (source_hash[i]) i = (i + 1) & (source_hash_size - 1);
+  source_hash[i] = ++nsources;
+  return nsources - 1;
+}
+
+// Adds the sources of a window that is deleted to the sources without
+// a window, and removes them, see Source:
+void Fl_Event_Stats::window_deleted(Fl_Widget *window) {
+  int i, n = 0;
+  for (i = 0; i < nsources; i++)
+    if (sources_[i].widget == window) n++;
+  if (!n) return;
+  // to[i] is the source that source i is added to, -1 if it is kept:
+  int *to = (int*)malloc(nsources * sizeof(int));
+  if (!to) return;
+  for (i = 0; i < nsources; i++) {
+    to[i] = -1;
+    Source &s = sources_[i];
+    if (s.widget != window) continue;
+    free((void*)s.label);
+    s.label = 0;
+    s.widget = 0;
+    int j;
+    for (j = 0; j < nsources; j++) {
+      const Source &a = sources_[j];
+      if (j != i && to[j] < 0 && a.phase == s.phase && a.function == s.function &&
+          a.data == s.data && !a.widget) break;
+    }
+    if (j >= nsources) continue; // the first one of its kind stays
+    Histogram &h = sources_[j].histogram;
+    h.count += s.histogram.count;
+    h.total += s.histogram.total;
+    if (s.histogram.max > h.max) h.max = s.histogram.max;
+    for (int b = 0; b < BUCKETS; b++) h.bucket[b] += s.histogram.bucket[b];
+    to[i] = j;
+  }
+  // remove the sources that were added to others, and renumber the rest:
+  int *index = (int*)malloc(nsources * sizeof(int));
+  if (!index) { free(to); return; }
+  n = 0;
+  for (i = 0; i < nsources; i++)
+    if (to[i] < 0) {
+      index[i] = n;
+      if (n != i) sources_[n] = sources_[i];
+      n++;
+    }
+  for (i = 0; i < nsources; i++)
+    if (to[i] >= 0) index[i] = index[to[i]];
+  for (i = 0; i < trace_count; i++) {
+    int k = trace_next - 1 - i;
+    if (k < 0) k += trace_size;
+    trace_[k].source = index[trace_[k].source];
+  }
+  nsources = n;
+  free(index);
+  free(to);
+  rehash_sources(source_hash_size);
+}
+
+/**
+  Measures a call.
+
+  FLTK measures the event loop with
+  \code
+  double t = Fl_Event_Stats::start();
+  callback(data);
+  if (t >= 0) Fl_Event_Stats::record(Fl_Event_Stats::TIMEOUT, t, (void*)callback, data);
+  \endcode
+  and applications can measure their own code the same way, usually
+  with phase USER.
+
+  \param[in] p the phase
+  \param[in] start the value returned by start(), nothing is recorded if it is negative
+  \param[in] function, data, widget identify the source, see Source
+*/
+void Fl_Event_Stats::record(Phase p, double start, void *function, void *data, Fl_Widget *widget) {
+  static char in_slow_handler = 0;
+  if (!enabled_ || start < 0.0 || p < 0 || p >= PHASES || in_slow_handler) return;
+  double seconds = now() - start;
+  if (seconds < 0.0) seconds = 0.0;
+  phases[p].add(seconds);
+  int i = find_source(p, function, data, widget);
+  if (i < 0) return;
+  sources_[i].histogram.add(seconds);
+  if (trace_size) {
+    Fl_Event_Stats_Trace &t = trace_[trace_next];
+    t.start = start;
+    t.duration = seconds;
+    t.source = i;
+    if (++trace_next >= trace_size) trace_next = 0;
+    if (trace_count < trace_size) trace_count++;
+  }
+  if (slow_handler_ && seconds >= slow_threshold && p != WAIT) {
+    in_slow_handler = 1;
+    slow_handler_(sources_[i], seconds, slow_data);
+    in_slow_handler = 0;
+  }
+}
+
+//
+// End of "$Id$".
+//
@@ -23,6 +23,11 @@
 //   Fl_File_Browser::item_width()      - Return the width of a list item.
 //   Fl_File_Browser::item_draw()       - Draw a list item.
 //   Fl_File_Browser::Fl_File_Browser() - Create a Fl_File_Browser widget.
+//   Fl_File_Browser::~Fl_File_Browser() - Destroy a Fl_File_Browser widget.
+//   Fl_File_Browser::add_entry()       - Add a directory entry to the list.
+//   Fl_File_Browser::start_load()      - Start loading a directory in the background.
+//   Fl_File_Browser::load_poll_cb()    - Show the entries loaded in the background.
+//   Fl_File_Browser::cancel_load()     - Stop loading a directory in the background.
 //   Fl_File_Browser::load()            - Load a directory into the browser.
 //   Fl_File_Browser::filter()          - Set the filename filter.
 //
@@ -37,9 +42,14 @@
 #include <FL/fl_draw.H>
 #include <FL/filename.H>
 #include <FL/Fl_Image.H>	// icon
+#include <FL/fl_utf8.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/stat.h>
 #include "flstring.h"
+#include "fl_threads.h"
 
 //
 // FL_BLINE definition from "Fl_Browser.cxx"...
@@ -59,6 +69,8 @@ struct FL_BLINE			// data is in a linked list of these
   FL_BLINE	*next;		// Next item in list
   void		*data;		// Pointer to data (function)
   Fl_Image      *icon;		// Pointer to optional icon
+  int		line;		// Line number
+  int		height;		// Height used for the position of the following lines
   short		length;		// sizeof(txt)-1, may be longer than string
   char		flags;		// selected, displayed
   char		txt[1];		// start of allocated array
@@ -372,6 +384,386 @@ Fl_File_Browser::Fl_File_Browser(int        X,  // I - Upper-lefthand X coordina
   directory_ = "";
   iconsize_  = (uchar)(3 * textsize() / 2);
   filetype_  = FILES;
+  background_load_ = 0;
+  loader_    = 0;
+  load_cb_   = 0;
+  load_data_ = 0;
+}
+
+
+//
+// 'Fl_File_Browser::~Fl_File_Browser()' - Destroy a Fl_File_Browser widget.
+//
+
+Fl_File_Browser::~Fl_File_Browser()
+{
+  cancel_load();
+}
+
+
+//
+// 'sort_order()' - Get the fl_filename_list() sort order of a sort function,
+//                  or -1 for a sort function of the application.
+//
+
+static int
+sort_order(Fl_File_Sort_F *sort)
+{
+  if (sort == fl_numericsort)     return FL_FILENAME_SORT_NUMERIC;
+  if (sort == fl_casenumericsort) return FL_FILENAME_SORT_CASENUMERIC;
+  if (sort == fl_alphasort)       return FL_FILENAME_SORT_ALPHA;
+  if (sort == fl_casealphasort)   return FL_FILENAME_SORT_CASEALPHA;
+  if (!sort)                      return FL_FILENAME_SORT_NONE;
+  return (-1);
+}
+
+
+//
+// 'Fl_File_Browser::add_entry()' - Add a directory entry to the list.
+//
+// Directories are inserted after the first *num_dirs lines and counted;
+// if num_dirs is NULL all entries are added at the end of the list.
+//
+
+void
+Fl_File_Browser::add_entry(const char *dir,	// I - Directory of the entry
+                           const char *name,	// I - Name of the entry
+                           int        type,	// I - FL_FILENAME_ type
+                           int        *num_dirs)// IO - Directories in list
+{
+  char		filename[4096];			// Full filename
+  Fl_File_Icon	*icon;				// Icon to use
+
+
+  if (!strcmp(name, "./"))
+    return;
+
+  snprintf(filename, sizeof(filename), "%s/%s", dir, name);
+
+  //
+  // The file type comes with the entry, so unlike
+  // Fl_File_Icon::find(filename) this does not stat() the file...
+  //
+  icon = Fl_File_Icon::find(filename, type);
+  if (type == FL_FILENAME_DIRECTORY) {
+    if (num_dirs) {
+      (*num_dirs) ++;
+      insert(*num_dirs, name, icon);
+    } else
+      add(name, icon);
+  } else if (filetype_ == FILES &&
+             fl_filename_match(name, pattern_)) {
+    add(name, icon);
+  }
+}
+
+
+//
+// Background loading of directories...
+//
+// A thread lists the directory and queues the entries it finds, and a
+// timeout on the main thread adds them to the browser.  Fl::awake() is
+// not used since it needs the application to call Fl::lock().
+//
+
+#define LOAD_POLL_INTERVAL	0.05	// Seconds between checks for entries
+#define LOAD_CACHE_SIZE		8	// Number of directories kept in memory
+
+// Internal: lists a directory for Fl_File_Browser::load() in a thread.
+// Both the browser and the thread hold a reference; the members after
+// the mutex are shared and only used with the mutex locked.
+struct Fl_File_Browser_Loader
+{
+  char			*directory;	// Directory to list
+  int			sort;		// fl_filename_list() sort order
+  long			cache_mtime;	// Time of the cached list shown, or 0
+  Fl_Internal_Thread	thread;		// The listing thread
+  Fl_Internal_Mutex	mutex;		// Lock for the members below
+  int			refs;		// Number of references
+  int			cancel;		// Set to stop the listing
+  int			done;		// Set when the listing is finished
+  int			unchanged;	// Set if the cached list is still valid
+  long			mtime;		// Time of the directory, or 0 if too recent
+  int			num_entries;	// Number of entries, or -1 on error
+  Fl_Filename_Entry	*entries;	// Sorted entries
+  char			*pending;	// Entries not shown yet: type, name, nul
+  int			pending_size,	// Bytes used in pending
+			pending_alloc;	// Bytes allocated for pending
+};
+
+// Internal: free a loader when the last reference is released
+static void
+loader_release(Fl_File_Browser_Loader *l)
+{
+  l->mutex.lock();
+  int refs = --l->refs;
+  l->mutex.unlock();
+  if (refs)
+    return;
+  fl_filename_free_list(&l->entries);
+  free(l->pending);
+  free(l->directory);
+  delete l;
+}
+
+// Internal: queue an entry found by the listing thread; returns
+// non-zero to stop the listing
+static int
+loader_progress(void *data, const char *name, int type)
+{
+  Fl_File_Browser_Loader *l = (Fl_File_Browser_Loader *)data;
+  int len = (int) strlen(name);
+  l->mutex.lock();
+  int cancel = l->cancel;
+  // with a cached list shown only the final list is shown
+  if (!cancel && !l->cache_mtime) {
+    if (l->pending_size + len + 2 > l->pending_alloc) {
+      l->pending_alloc = l->pending_alloc ? 2 * l->pending_alloc : 4096;
+      if (l->pending_alloc < l->pending_size + len + 2)
+        l->pending_alloc = l->pending_size + len + 2;
+      l->pending = (char *)realloc(l->pending, l->pending_alloc);
+    }
+    l->pending[l->pending_size++] = (char)type;
+    memcpy(l->pending + l->pending_size, name, len + 1);
+    l->pending_size += len + 1;
+  }
+  l->mutex.unlock();
+  return cancel;
+}
+
+// Internal: the listing thread
+static void *
+loader_proc(void *data)
+{
+  Fl_File_Browser_Loader *l = (Fl_File_Browser_Loader *)data;
+  char			filename[4096];		// Scratch buffer for the driver
+  struct stat		s;			// Directory information
+  long			mtime = 0;		// Directory time
+  int			unchanged = 0;		// Cached list still valid?
+  int			n = -1;			// Number of entries
+  Fl_Filename_Entry	*entries = 0;		// Sorted entries
+
+  // Get the time before the listing, so that any change during the listing
+  // invalidates it; a directory changed in the last second may still change
+  // without a new time, so it is not cached...
+  if (!fl_stat(l->directory, &s) && (long)s.st_mtime < (long)time(NULL) - 1)
+    mtime = (long)s.st_mtime;
+
+  if (mtime && mtime == l->cache_mtime)
+    unchanged = 1;
+  else
+    n = Fl::system_driver()->file_browser_load_directory(l->directory, filename, sizeof(filename),
+                                                         &entries, l->sort, loader_progress, l);
+
+  l->mutex.lock();
+  l->done        = 1;
+  l->unchanged   = unchanged;
+  l->mtime       = mtime;
+  l->num_entries = n;
+  l->entries     = entries;
+  l->mutex.unlock();
+  loader_release(l);
+  return 0;
+}
+
+// Internal: a directory list kept in memory
+struct Fl_File_Browser_Cache
+{
+  char			*directory;	// Directory name
+  int			sort;		// fl_filename_list() sort order
+  long			mtime;		// Time of the directory
+  int			num_entries;	// Number of entries
+  Fl_Filename_Entry	*entries;	// Sorted entries
+  unsigned long		used;		// Time of last use
+};
+
+static Fl_File_Browser_Cache	load_cache[LOAD_CACHE_SIZE];
+static unsigned long		load_cache_used = 0;
+
+// Internal: find a directory list in memory
+static Fl_File_Browser_Cache *
+cache_find(const char *directory, int sort)
+{
+  for (int i = 0; i < LOAD_CACHE_SIZE; i ++)
+    if (load_cache[i].directory && load_cache[i].sort == sort &&
+        !strcmp(load_cache[i].directory, directory)) {
+      load_cache[i].used = ++load_cache_used;
+      return load_cache + i;
+    }
+  return 0;
+}
+
+// Internal: keep a directory list in memory, replacing the oldest one;
+// NULL entries remove the directory
+static void
+cache_store(const char *directory, int sort, long mtime,
+            Fl_Filename_Entry *entries, int num_entries)
+{
+  Fl_File_Browser_Cache *c = cache_find(directory, sort);
+  if (!c) {
+    if (!entries)
+      return;
+    c = load_cache;
+    for (int i = 1; i < LOAD_CACHE_SIZE; i ++)
+      if (load_cache[i].used < c->used)
+        c = load_cache + i;
+    free(c->directory);
+    c->directory = strdup(directory);
+    c->sort      = sort;
+    c->used      = ++load_cache_used;
+  }
+  fl_filename_free_list(&c->entries);
+  if (!entries) {
+    free(c->directory);
+    c->directory = 0;
+    c->used      = 0;
+    return;
+  }
+  c->mtime       = mtime;
+  c->entries     = entries;
+  c->num_entries = num_entries;
+}
+
+
+//
+// 'Fl_File_Browser::start_load()' - Start loading a directory in the background.
+//
+// Shows the list kept in memory, if any, and returns its number of entries,
+// or -1 if no thread could be started.
+//
+
+int
+Fl_File_Browser::start_load(int sort)
+{
+  int			i;			// Looping var
+  int			num_dirs = 0;		// Number of directories in list
+  Fl_File_Browser_Loader *l;			// New loader
+  Fl_File_Browser_Cache	*c;			// Cached list, if any
+
+
+  l = new Fl_File_Browser_Loader;
+  l->directory   = strdup(directory_);
+  l->sort        = sort;
+  l->cache_mtime = 0;
+  l->refs        = 2;
+  l->cancel      = 0;
+  l->done        = 0;
+  l->unchanged   = 0;
+  l->mtime       = 0;
+  l->num_entries = -1;
+  l->entries     = 0;
+  l->pending     = 0;
+  l->pending_size = l->pending_alloc = 0;
+
+  c = cache_find(directory_, sort);
+  if (c)
+    l->cache_mtime = c->mtime;
+
+  if (fl_thread_create(l->thread, loader_proc, l, 1)) {
+    l->refs = 1;
+    loader_release(l);
+    return (-1);
+  }
+
+  loader_ = l;
+  Fl::add_timeout(LOAD_POLL_INTERVAL, load_poll_cb, this);
+
+  if (!c)
+    return (0);
+
+  for (i = 0; i < c->num_entries; i ++)
+    add_entry(l->directory, c->entries[i].name, c->entries[i].type, &num_dirs);
+
+  return (c->num_entries);
+}
+
+
+//
+// 'Fl_File_Browser::load_poll_cb()' - Show the entries loaded in the background.
+//
+
+void
+Fl_File_Browser::load_poll_cb(void *d)
+{
+  Fl_File_Browser	*fb = (Fl_File_Browser *)d;
+  Fl_File_Browser_Loader *l = fb->loader_;
+  int			i;			// Looping var
+  int			first;			// First new line
+  int			num_dirs = 0;		// Number of directories in list
+  int			done;			// Listing finished?
+  char			*pending;		// Entries not shown yet
+  int			pending_size;		// Bytes in pending
+
+
+  l->mutex.lock();
+  done         = l->done;
+  pending      = l->pending;
+  pending_size = l->pending_size;
+  l->pending   = 0;
+  l->pending_size = l->pending_alloc = 0;
+  l->mutex.unlock();
+
+  if (!done) {
+    //
+    // Add the entries found so far at the end of the list, in the
+    // order in which they were found...
+    //
+    if (pending_size) {
+      first = fb->size() + 1;
+      for (i = 0; i < pending_size; i += (int) strlen(pending + i + 1) + 2)
+        fb->add_entry(l->directory, pending + i + 1, pending[i], 0);
+      if (fb->load_cb_ && fb->size() >= first)
+        (*fb->load_cb_)(fb, first, fb->load_data_);
+    }
+    free(pending);
+    Fl::repeat_timeout(LOAD_POLL_INTERVAL, load_poll_cb, d);
+    return;
+  }
+
+  free(pending);
+  fb->loader_ = 0;
+
+  if (!l->unchanged) {
+    //
+    // Replace the list with the sorted one and keep it in memory...
+    //
+    fb->clear();
+    for (i = 0; i < l->num_entries; i ++)
+      fb->add_entry(l->directory, l->entries[i].name, l->entries[i].type, &num_dirs);
+
+    if (l->num_entries >= 0 && l->mtime) {
+      cache_store(l->directory, l->sort, l->mtime, l->entries, l->num_entries);
+      l->entries = 0;
+    } else
+      cache_store(l->directory, l->sort, 0, 0, 0);
+  }
+
+  // The list kept in memory may still be valid, but the callback must
+  // see the final list in any case...
+  if (fb->load_cb_)
+    (*fb->load_cb_)(fb, 1, fb->load_data_);
+
+  loader_release(l);
+}
+
+
+/**
+  Stops loading a directory in the background, see background_load().
+  The entries added so far stay in the browser.
+  \version 1.4.0
+*/
+void
+Fl_File_Browser::cancel_load()
+{
+  if (!loader_)
+    return;
+
+  Fl::remove_timeout(load_poll_cb, this);
+  loader_->mutex.lock();
+  loader_->cancel = 1;
+  loader_->mutex.unlock();
+  loader_release(loader_);
+  loader_ = 0;
 }
 
 
@@ -392,6 +784,7 @@ Fl_File_Browser::load(const char     *directory,// I - Directory to load
 
 //  printf("Fl_File_Browser::load(\"%s\")\n", directory);
 
+  cancel_load();
   clear();
 
   directory_ = directory;
@@ -409,6 +802,32 @@ Fl_File_Browser::load(const char     *directory,// I - Directory to load
       icon = Fl_File_Icon::find("any", Fl_File_Icon::DIRECTORY);
     num_files = Fl::system_driver()->file_browser_load_filesystem(this, filename, (int)sizeof(filename), icon);
   }
+  else if (background_load_ && sort_order(sort) >= 0 &&
+           (num_files = start_load(sort_order(sort))) >= 0)
+  {
+    //
+    // The directory is listed by a thread and the entries are added
+    // by load_poll_cb()...
+    //
+  }
+  else if (sort_order(sort) >= 0)
+  {
+    Fl_Filename_Entry	*entries;	// Files in directory with their types
+    //
+    // Build the file list...
+    //
+    num_files = Fl::system_driver()->file_browser_load_directory(directory_, filename, sizeof(filename),
+                                                                 &entries, sort_order(sort));
+    if (num_files <= 0) {
+      fl_filename_free_list(&entries);
+      return (0);
+    }
+
+    for (i = 0, num_dirs = 0; i < num_files; i ++)
+      add_entry(directory_, entries[i].name, entries[i].type, &num_dirs);
+
+    fl_filename_free_list(&entries);
+  }
   else
   {
     dirent	**files;	// Files in in directory
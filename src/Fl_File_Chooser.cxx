@@ -201,6 +201,7 @@ Fl_File_Chooser::Fl_File_Chooser(const char *d, const char *p, int t, const char
         fileList->type(2);
         fileList->callback((Fl_Callback*)cb_fileList);
         fileList->window()->hotspot(fileList);
+        fileList->load_callback(fileListLoadCB, this);
       } // Fl_File_Browser* fileList
       { previewBox = new Fl_Box(305, 45, 175, 225, "?");
         previewBox->box(FL_DOWN_BOX);
@@ -324,6 +325,14 @@ Fl_File_Chooser::~Fl_File_Chooser() {
   delete favWindow;
 }
 
+void Fl_File_Chooser::background_load(int b) {
+  fileList->background_load(b);
+}
+
+int Fl_File_Chooser::background_load() {
+  return (fileList->background_load());
+}
+
 void Fl_File_Chooser::callback(void (*cb)(Fl_File_Chooser *, void *), void *d ) {
   callback_ = cb;
   data_     = d;
@@ -172,6 +172,21 @@
 /** \fn Fl_File_Chooser::~Fl_File_Chooser()
   Destroys the widget and frees all memory used by it.*/
 
+/** \fn void Fl_File_Chooser::background_load(int b)
+  Sets whether the Fl_File_Browser lists directories in the background,
+  see Fl_File_Browser::background_load(). The default is off.
+
+  When enabled, directory() and rescan() return before the list is
+  complete, so count() and value(int) only see the files found so far.
+  The current filename is selected when the list is complete.
+  \version 1.4.0
+*/
+
+/** \fn int Fl_File_Chooser::background_load()
+  Returns whether the Fl_File_Browser lists directories in the background.
+  \version 1.4.0
+*/
+
 /** \fn void Fl_File_Chooser::color(Fl_Color c)
   Sets the background color of the Fl_File_Browser list.*/
 
@@ -761,6 +776,66 @@ Fl_File_Chooser::fileListCB()
 }
 
 
+//
+// 'Fl_File_Chooser::fileListLoadCB()' - Handle entries that the Fl_File_Browser
+//                                       loaded in the background.
+//
+
+void
+Fl_File_Chooser::fileListLoadCB(Fl_File_Browser *fb,	// I - File list
+                                int             first,	// I - First new line
+                                void            *d)	// I - File chooser
+{
+  Fl_File_Chooser	*fc = (Fl_File_Chooser *)d;
+  int			i;			// Looping var
+  int			hidden;			// Remove hidden files?
+  const char		*fn;			// Current filename
+  const char		*slash;			// Name in current filename
+
+
+  hidden = Fl::system_driver()->dot_file_hidden() && !fc->showHiddenButton->value();
+
+  if (fb->loading()) {
+    // Only remove the new hidden files...
+    if (hidden)
+      for (i = fb->size(); i >= first; i --) {
+        const char *p = fb->text(i);
+        if (*p == '.' && strcmp(p, "../") != 0) fb->remove(i);
+      }
+    return;
+  }
+
+  // The final list replaced the one that was shown, so do what
+  // rescan_keep_filename() does after loading the list...
+  if (hidden) fc->remove_hidden_files();
+  fc->update_preview();
+
+  fn = fc->fileName->value();
+  if (!fn || !*fn || fn[strlen(fn) - 1] == '/')
+    return;
+
+  slash = strrchr(fn, '/');
+  if (slash)
+    slash++;
+  else
+    slash = fn;
+
+  char found = 0;
+  for (i = 1; i <= fb->size(); i ++)
+    if ( (Fl::system_driver()->case_insensitive_filenames() ? strcasecmp(fb->text(i), slash) : strcmp(fb->text(i), slash)) == 0) {
+      fb->topline(i);
+      fb->select(i);
+      found = 1;
+      break;
+    }
+
+  if (found || fc->type_ & CREATE)
+    fc->okButton->activate();
+  else
+    fc->okButton->deactivate();
+}
+
+
 //
 // 'Fl_File_Chooser::fileNameCB()' - Handle text entry in the FileBrowser.
 //
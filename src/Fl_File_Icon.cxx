@@ -50,6 +50,296 @@
 Fl_File_Icon	*Fl_File_Icon::first_ = (Fl_File_Icon *)0;
 
 
+//
+// Compiled patterns...
+//
+// find() is called for every file that is shown in a file browser, and
+// load_system_icons() may add hundreds of icons for the file types of the
+// desktop.  So the patterns are compiled when find() is first called after
+// icons have been added or removed:
+//
+//   - "*.ext" is looked up in a hash table of extensions,
+//   - "text*", "text", and "*" are looked up in a trie of the name,
+//   - "*text" is looked up in a trie of the reversed name,
+//   - only other patterns are matched with fl_filename_match().
+//
+// A pattern with one "{a|b}" is expanded to its alternatives first.  Every
+// rule keeps the position of its icon in the list, so the first matching
+// icon in the list is still found.
+//
+
+// Internal: an icon with a compiled pattern
+struct Fl_File_Icon_Rule {
+  int		index;			// Position of the icon in the list
+  Fl_File_Icon	*icon;			// The icon
+  int		next;			// Next rule with the same key, or -1
+};
+
+// Internal: a node of a trie of names
+struct Fl_File_Icon_Node {
+  char		c;			// Lowercase character
+  int		child;			// First child node, or -1
+  int		sibling;		// Next child of the parent, or -1
+  int		rules;			// Rules for "text*" or "*text", or -1
+  int		exact;			// Rules for "text", or -1
+};
+
+// Internal: an extension in the hash table
+struct Fl_File_Icon_Ext {
+  char		*ext;			// Lowercase extension without '.', or NULL
+  int		rules;			// Rules for "*.ext"
+};
+
+// Internal: all compiled patterns
+static struct {
+  int			valid;		// Compiled for the current list?
+  Fl_File_Icon_Rule	*rules;		// All rules
+  int			num_rules, alloc_rules;
+  Fl_File_Icon_Node	*nodes;		// Trie nodes; 0 is the root of names,
+  int			num_nodes, alloc_nodes; // 1 the root of reversed names
+  Fl_File_Icon_Ext	*exts;		// Hash table of extensions
+  int			num_exts, alloc_exts; // alloc_exts is a power of 2
+  int			complex;	// Rules matched with fl_filename_match()
+} icon_index;
+
+// Internal: lowercase an ASCII character like fl_filename_match() does
+static inline char icon_lower(char c) {
+  return (c >= 'A' && c <= 'Z') ? (char)(c - 'A' + 'a') : c;
+}
+
+// Internal: add a rule in front of a list of rules
+static int icon_rule(int index, Fl_File_Icon *icon, int next) {
+  if (icon_index.num_rules >= icon_index.alloc_rules) {
+    icon_index.alloc_rules = icon_index.alloc_rules ? 2 * icon_index.alloc_rules : 256;
+    icon_index.rules = (Fl_File_Icon_Rule *)realloc(icon_index.rules,
+                         icon_index.alloc_rules * sizeof(Fl_File_Icon_Rule));
+  }
+  Fl_File_Icon_Rule *r = icon_index.rules + icon_index.num_rules;
+  r->index = index;
+  r->icon  = icon;
+  r->next  = next;
+  return icon_index.num_rules++;
+}
+
+// Internal: find or add the child node of a trie node, or add a root
+static int icon_node(int parent, char c) {
+  int n;
+  if (parent >= 0)
+    for (n = icon_index.nodes[parent].child; n >= 0; n = icon_index.nodes[n].sibling)
+      if (icon_index.nodes[n].c == c) return n;
+  if (icon_index.num_nodes >= icon_index.alloc_nodes) {
+    icon_index.alloc_nodes = icon_index.alloc_nodes ? 2 * icon_index.alloc_nodes : 256;
+    icon_index.nodes = (Fl_File_Icon_Node *)realloc(icon_index.nodes,
+                         icon_index.alloc_nodes * sizeof(Fl_File_Icon_Node));
+  }
+  n = icon_index.num_nodes++;
+  Fl_File_Icon_Node *node = icon_index.nodes + n;
+  node->c       = c;
+  node->child   = -1;
+  node->rules   = -1;
+  node->exact   = -1;
+  if (parent >= 0) {
+    node->sibling = icon_index.nodes[parent].child;
+    icon_index.nodes[parent].child = n;
+  } else
+    node->sibling = -1;
+  return n;
+}
+
+// Internal: hash an extension of len characters, ignoring case
+static unsigned icon_hash(const char *ext, int len) {
+  unsigned h = 2166136261U;
+  for (int i = 0; i < len; i ++)
+    h = (h ^ (unsigned char)icon_lower(ext[i])) * 16777619U;
+  return h;
+}
+
+// Internal: find an extension of len characters in the hash table, or
+// the empty slot for it
+static Fl_File_Icon_Ext *icon_ext(const char *ext, int len) {
+  unsigned mask = icon_index.alloc_exts - 1;
+  for (unsigned i = icon_hash(ext, len) & mask;; i = (i + 1) & mask) {
+    Fl_File_Icon_Ext *e = icon_index.exts + i;
+    if (!e->ext) return e;
+    int j;
+    for (j = 0; j < len && e->ext[j] == icon_lower(ext[j]); j ++) {/*empty*/}
+    if (j == len && !e->ext[j]) return e;
+  }
+}
+
+// Internal: find or add the rules for an extension of len characters
+static int *icon_ext_rules(const char *ext, int len) {
+  if (2 * (icon_index.num_exts + 1) > icon_index.alloc_exts) {
+    Fl_File_Icon_Ext *old = icon_index.exts;
+    int old_alloc = icon_index.alloc_exts;
+    icon_index.alloc_exts = old_alloc ? 2 * old_alloc : 256;
+    icon_index.exts = (Fl_File_Icon_Ext *)calloc(icon_index.alloc_exts, sizeof(Fl_File_Icon_Ext));
+    for (int i = 0; i < old_alloc; i ++)
+      if (old[i].ext)
+        *icon_ext(old[i].ext, (int) strlen(old[i].ext)) = old[i];
+    free(old);
+  }
+  Fl_File_Icon_Ext *e = icon_ext(ext, len);
+  if (!e->ext) {
+    e->ext = (char *)malloc(len + 1);
+    for (int i = 0; i < len; i ++) e->ext[i] = icon_lower(ext[i]);
+    e->ext[len] = 0;
+    e->rules = -1;
+    icon_index.num_exts ++;
+  }
+  return &e->rules;
+}
+
+// Internal: add the rule for a pattern without "{a|b}", or return 0 if it
+// is not one of "*.ext", "*text", "text*", "text", or "*"
+static int icon_compile(const char *p, int len, int index, Fl_File_Icon *icon, int add) {
+  int i, n;
+  for (i = 0; i < len; i ++)
+    if (strchr("?[\\{}|,", p[i]) || (p[i] == '*' && i > 0 && i < len - 1))
+      return 0;
+  if (len > 1 && p[0] == '*' && p[len - 1] == '*')
+    return 0;
+  if (!add)
+    return 1;
+
+  if (len > 1 && p[0] == '*') {
+    if (p[1] == '.' && !memchr(p + 2, '.', len - 2)) {
+      // "*.ext"
+      int *rules = icon_ext_rules(p + 2, len - 2);
+      *rules = icon_rule(index, icon, *rules);
+    } else {
+      // "*text"
+      for (i = len - 1, n = 1; i > 0; i --)
+        n = icon_node(n, icon_lower(p[i]));
+      icon_index.nodes[n].rules = icon_rule(index, icon, icon_index.nodes[n].rules);
+    }
+  } else if (len > 0 && p[len - 1] == '*') {
+    // "text*" or "*"
+    for (i = 0, n = 0; i < len - 1; i ++)
+      n = icon_node(n, icon_lower(p[i]));
+    icon_index.nodes[n].rules = icon_rule(index, icon, icon_index.nodes[n].rules);
+  } else {
+    // "text"
+    for (i = 0, n = 0; i < len; i ++)
+      n = icon_node(n, icon_lower(p[i]));
+    icon_index.nodes[n].exact = icon_rule(index, icon, icon_index.nodes[n].exact);
+  }
+  return 1;
+}
+
+// Internal: add the rules for a pattern, or return 0 if it is too complex;
+// with add = 0 only check the pattern
+static int icon_compile(const char *p, int index, Fl_File_Icon *icon, int add) {
+  const char *open = strchr(p, '{');
+  if (!open)
+    return icon_compile(p, (int) strlen(p), index, icon, add);
+
+  const char *close = strchr(open, '}');
+  if (!close || memchr(open + 1, '{', close - open - 1) ||
+      strpbrk(close + 1, "{}|,") || strpbrk(p, "\\"))
+    return 0;
+
+  // Expand "pre{a|b}post" to "preapost" and "prebpost"...
+  int pre = (int)(open - p), post = (int) strlen(close + 1);
+  char *buf = (char *)malloc(strlen(p) + 1);
+  const char *alt = open + 1;
+  int ok = 1;
+  memcpy(buf, p, pre);
+  while (ok) {
+    const char *end = alt;
+    while (end < close && *end != '|' && *end != ',') end ++;
+    int len = (int)(end - alt);
+    memcpy(buf + pre, alt, len);
+    memcpy(buf + pre + len, close + 1, post);
+    ok = icon_compile(buf, pre + len + post, index, icon, add);
+    if (end == close) break;
+    alt = end + 1;
+  }
+  free(buf);
+  return ok;
+}
+
+// Internal: compile the patterns of all icons
+static void icon_compile_all() {
+  Fl_File_Icon	*current;		// Current icon in list
+  Fl_File_Icon	**icons;		// All icons in list
+  int		i, n;
+
+
+  // Free the old patterns...
+  for (i = 0; i < icon_index.alloc_exts; i ++)
+    free(icon_index.exts[i].ext);
+  free(icon_index.exts);
+  icon_index.exts       = 0;
+  icon_index.num_exts   = 0;
+  icon_index.alloc_exts = 0;
+  icon_index.num_rules  = 0;
+  icon_index.num_nodes  = 0;
+  icon_index.complex    = -1;
+  icon_node(-1, 0);
+  icon_node(-1, 0);
+
+  // Add the rules from the last icon to the first, so that every list of
+  // rules is sorted by the position of the icons...
+  for (n = 0, current = Fl_File_Icon::first(); current; current = current->next())
+    n ++;
+  icons = (Fl_File_Icon **)malloc((n + 1) * sizeof(Fl_File_Icon *));
+  for (n = 0, current = Fl_File_Icon::first(); current; current = current->next())
+    icons[n ++] = current;
+
+  for (i = n - 1; i >= 0; i --) {
+    const char *p = icons[i]->pattern();
+    if (!p || !icon_compile(p, i, icons[i], 0))
+      icon_index.complex = icon_rule(i, icons[i], icon_index.complex);
+    else
+      icon_compile(p, i, icons[i], 1);
+  }
+
+  free(icons);
+  icon_index.valid = 1;
+}
+
+// Internal: set *best to the first rule in the list that matches the
+// file type, if it comes before *best
+static void icon_check(int r, int filetype, int *best) {
+  for (; r >= 0; r = icon_index.rules[r].next) {
+    if (*best >= 0 && icon_index.rules[r].index >= icon_index.rules[*best].index)
+      return;
+    int t = icon_index.rules[r].icon->type();
+    if (t == filetype || t == Fl_File_Icon::ANY) {
+      *best = r;
+      return;
+    }
+  }
+}
+
+// Internal: check the rules for "text*", "text", and "*" on a name
+static void icon_check_prefix(const char *s, int filetype, int *best) {
+  int n = 0;
+  icon_check(icon_index.nodes[n].rules, filetype, best);
+  for (; *s; s ++) {
+    char c = icon_lower(*s);
+    for (n = icon_index.nodes[n].child; n >= 0 && icon_index.nodes[n].c != c;
+         n = icon_index.nodes[n].sibling) {/*empty*/}
+    if (n < 0) return;
+    icon_check(icon_index.nodes[n].rules, filetype, best);
+  }
+  icon_check(icon_index.nodes[n].exact, filetype, best);
+}
+
+// Internal: check the rules for "*text" on a name
+static void icon_check_suffix(const char *s, int filetype, int *best) {
+  int n = 1;
+  for (const char *e = s + strlen(s); e > s; e --) {
+    char c = icon_lower(e[-1]);
+    for (n = icon_index.nodes[n].child; n >= 0 && icon_index.nodes[n].c != c;
+         n = icon_index.nodes[n].sibling) {/*empty*/}
+    if (n < 0) return;
+    icon_check(icon_index.nodes[n].rules, filetype, best);
+  }
+}
+
+
 /**
   Creates a new Fl_File_Icon with the specified information.
   \param[in] p filename pattern
@@ -83,6 +373,7 @@ Fl_File_Icon::Fl_File_Icon(const char *p,	/* I - Filename pattern */
   // And add the icon to the list of icons...
   next_  = first_;
   first_ = this;
+  icon_index.valid = 0;
 }
 
 
@@ -107,6 +398,7 @@ Fl_File_Icon::~Fl_File_Icon() {
       prev->next_ = current->next_;
     else
       first_ = current->next_;
+    icon_index.valid = 0;
   }
 
   // Free any memory used...
@@ -159,8 +451,10 @@ Fl_File_Icon *				// O - Matching file icon or NULL
 Fl_File_Icon::find(const char *filename,// I - Name of file */
                    int        filetype)	// I - Enumerated file type
 {
-  Fl_File_Icon	*current;		// Current file in list
   const char	*name;			// Base name of filename
+  const char	*ext;			// Extension of filename
+  int		best = -1;		// First matching rule
+  int		r;			// Current rule
 
 
   // Get file information if needed...
@@ -171,16 +465,39 @@ Fl_File_Icon::find(const char *filename,// I - Name of file */
   // Look at the base name in the filename
   name = fl_filename_name(filename);
 
-  // Loop through the available file types and return any match that
-  // is found...
-  for (current = first_; current != (Fl_File_Icon *)0; current = current->next_)
-    if ((current->type_ == filetype || current->type_ == ANY) &&
-        (fl_filename_match(filename, current->pattern_) ||
-	 fl_filename_match(name, current->pattern_)))
+  // Compile the patterns as needed...
+  if (!icon_index.valid)
+    icon_compile_all();
+
+  // Find the first icon that matches the filename or the base name; a
+  // name or extension at the end of the filename is also one of the base
+  // name...
+  icon_check_prefix(name, filetype, &best);
+  if (name != filename)
+    icon_check_prefix(filename, filetype, &best);
+  icon_check_suffix(filename, filetype, &best);
+  if (icon_index.num_exts && (ext = strrchr(filename, '.')) != NULL) {
+    ext ++;
+    Fl_File_Icon_Ext *e = icon_ext(ext, (int) strlen(ext));
+    if (e->ext)
+      icon_check(e->rules, filetype, &best);
+  }
+
+  // Then try the other patterns that come before it...
+  for (r = icon_index.complex; r >= 0; r = icon_index.rules[r].next) {
+    Fl_File_Icon_Rule *rule = icon_index.rules + r;
+    if (best >= 0 && rule->index >= icon_index.rules[best].index)
       break;
+    if ((rule->icon->type_ == filetype || rule->icon->type_ == ANY) &&
+        (fl_filename_match(filename, rule->icon->pattern_) ||
+	 fl_filename_match(name, rule->icon->pattern_))) {
+      best = r;
+      break;
+    }
+  }
 
   // Return the match (if any)...
-  return (current);
+  return (best >= 0 ? icon_index.rules[best].icon : (Fl_File_Icon *)0);
 }
 
 /**
@@ -363,11 +363,14 @@ Fl_Group::Fl_Group(int X,int Y,int W,int H,const char *l)
 : Fl_Widget(X,Y,W,H,l) {
   align(FL_ALIGN_TOP);
   children_ = 0;
+  alloc_ = 0;
+  update_level_ = 0;
   array_ = 0;
   savedfocus_ = 0;
   resizable_ = this;
   bounds_ = 0; // this is allocated when first resize() is done
   sizes_ = 0; // see bounds_ (FLTK 1.3 compatibility)
+  update_rect_ = 0; // see begin_update()
 
   // Subclasses may want to construct child objects as part of their
   // constructor, so make sure they are add()'d to this object.
@@ -453,6 +456,7 @@ void Fl_Group::clear() {
 */
 Fl_Group::~Fl_Group() {
   clear();
+  delete update_rect_;
 }
 
 /**
@@ -476,13 +480,16 @@ void Fl_Group::insert(Fl_Widget &o, int index) {
     array_ = (Fl_Widget**)&o;
   } else if (children_ == 1) { // go from 1 to 2 children
     Fl_Widget* t = (Fl_Widget*)array_;
-    array_ = (Fl_Widget**)malloc(2*sizeof(Fl_Widget*));
+    if (alloc_ < 2) alloc_ = 2; // honor a previous reserve()
+    array_ = (Fl_Widget**)malloc(alloc_*sizeof(Fl_Widget*));
     if (index) {array_[0] = t; array_[1] = &o;}
     else {array_[0] = &o; array_[1] = t;}
   } else {
-    if (!(children_ & (children_-1))) // double number of children
+    if (children_ >= alloc_) { // double number of children
+      alloc_ = 2*children_;
       array_ = (Fl_Widget**)realloc((void*)array_,
-				    2*children_*sizeof(Fl_Widget*));
+				    alloc_*sizeof(Fl_Widget*));
+    }
     int j; for (j = children_; j > index; j--) array_[j] = array_[j-1];
     array_[j] = &o;
   }
@@ -521,6 +528,7 @@ void Fl_Group::remove(int index) {
     Fl_Widget *t = array_[!index];
     free((void*)array_);
     array_ = (Fl_Widget**)t;
+    alloc_ = 0;
   } else if (children_ > 1) { // delete from array
     for (; index < children_; index++) array_[index] = array_[index+1];
   }
@@ -546,6 +554,90 @@ void Fl_Group::remove(Fl_Widget &o) {
   if (i < children_) remove(i);
 }
 
+/**
+  Reserves space for at least \p n children.
+
+  Adding many children to a group one by one reallocates the internal
+  array of children several times. If you know in advance how many
+  children you are going to add, call reserve() before adding them so the
+  array is allocated only once.
+
+  This never shrinks the array and it does not change children().
+
+  \param[in] n number of children the group should be able to hold
+
+  \see begin_update()
+  \since FLTK 1.4.0
+*/
+void Fl_Group::reserve(int n) {
+  if (n <= alloc_) return;
+  if (children_ < 2) { // array_ is not (yet) allocated, see insert()
+    alloc_ = n;
+    return;
+  }
+  alloc_ = n;
+  array_ = (Fl_Widget**)realloc((void*)array_, alloc_*sizeof(Fl_Widget*));
+}
+
+/**
+  Starts a batch update of the group's children.
+
+  Between begin_update() and end_update() the group defers the layout of
+  its children: if the group is resized, only the group's own position
+  and size are changed, and its children are moved and resized once,
+  when end_update() is called. The internal bounds() array is built
+  only once as well, after all children have been added or removed.
+
+  Use this if you add, remove, or rearrange lots of children, particularly
+  if the group or its window can be resized in between. Calls can be
+  nested, the layout is done when the outermost end_update() is called.
+
+  \code
+    group->begin_update();
+    group->reserve(group->children() + 10000);
+    for (int i = 0; i < 10000; i++)
+      group->add(new Fl_Box(X, Y + i*20, W, 20));
+    group->end_update();
+  \endcode
+
+  \note You must call end_update() exactly once for each call of
+	begin_update().
+
+  \see end_update(), reserve()
+  \since FLTK 1.4.0
+*/
+void Fl_Group::begin_update() {
+  update_level_++;
+}
+
+/**
+  Ends a batch update of the group's children.
+
+  If this ends the outermost begin_update() call, the internal array of
+  widget sizes and positions is reset (see init_sizes()), and if the
+  group was resized in between, all children are laid out once from their
+  current positions to the new size of the group. This calls the virtual
+  resize() method, so derived classes see the deferred resize.
+
+  \see begin_update()
+  \since FLTK 1.4.0
+*/
+void Fl_Group::end_update() {
+  if (update_level_ <= 0 || --update_level_ > 0) return;
+  init_sizes();
+  if (update_rect_) {
+    // go back to the geometry the children were laid out for and
+    // do all deferred resizing in one step, through the resize() method
+    // of derived classes (Fl_Scroll, Fl_Tile, Fl_Pack, ...)
+    int X = x(), Y = y(), W = w(), H = h();
+    Fl_Widget::resize(update_rect_->x(), update_rect_->y(),
+                      update_rect_->w(), update_rect_->h());
+    delete update_rect_;
+    update_rect_ = 0;
+    resize(X, Y, W, H);
+  }
+}
+
 /**
   Resets the internal array of widget sizes and positions.
 
@@ -693,12 +785,21 @@ int* Fl_Group::sizes()
   all its children according to the rules documented for
   Fl_Group::resizable(Fl_Widget*)
 
+  Between begin_update() and end_update() only the group itself is resized,
+  the children are laid out when end_update() is called.
+
   \sa Fl_Group::resizable(Fl_Widget*)
   \sa Fl_Group::resizable()
   \sa Fl_Widget::resize(int,int,int,int)
 */
 void Fl_Group::resize(int X, int Y, int W, int H) {
 
+  if (update_level_) { // defer layout of children until end_update()
+    if (!update_rect_) update_rect_ = new Fl_Rect(x(), y(), w(), h());
+    Fl_Widget::resize(X, Y, W, H);
+    return;
+  }
+
   int dx = X - x();
   int dy = Y - y();
   int dw = W - w();
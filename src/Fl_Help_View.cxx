@@ -176,6 +176,114 @@ struct fl_margins {
   }
 };
 
+//
+// Parsed document...
+//
+// value() and load() split the document once into words, whitespace and
+// elements, and format() lays out these tokens instead of parsing the
+// HTML text again. A word caches its width in the font it was last
+// measured in, so formatting the document again after a resize does not
+// measure the text again.
+//
+
+enum {
+  HV_WORD,			// Text, including character entities
+  HV_WORD_SPACE,		// Whitespace right after a word
+  HV_SPACE,			// Other whitespace
+  HV_ELEMENT,			// Element, see below
+  HV_END			// End of the document
+};
+
+enum {				// Element names, HV_CLOSE is set for end tags
+  HV_OTHER, HV_A, HV_B, HV_BODY, HV_BR, HV_CENTER, HV_CODE, HV_DD, HV_DL,
+  HV_DT, HV_EM, HV_FONT, HV_H1, HV_H2, HV_H3, HV_H4, HV_H5, HV_H6, HV_HEAD,
+  HV_HR, HV_I, HV_IMG, HV_KBD, HV_LI, HV_OL, HV_P, HV_PRE, HV_STRONG,
+  HV_TABLE, HV_TD, HV_TH, HV_TITLE, HV_TR, HV_TT, HV_U, HV_UL, HV_VAR,
+  HV_NAMES,
+  HV_CLOSE = 0x40
+};
+
+static const char * const element_names[HV_NAMES] = {
+  "", "A", "B", "BODY", "BR", "CENTER", "CODE", "DD", "DL",
+  "DT", "EM", "FONT", "H1", "H2", "H3", "H4", "H5", "H6", "HEAD",
+  "HR", "I", "IMG", "KBD", "LI", "OL", "P", "PRE", "STRONG",
+  "TABLE", "TD", "TH", "TITLE", "TR", "TT", "U", "UL", "VAR"
+};
+
+struct Fl_Help_Token {
+  const char	*start;		// Start of the token in the document
+  int		length,		// Length in bytes
+		data,		// Width of a word, target index of <A NAME>
+		key;		// Font and size of the width, -1 if none
+  uchar		type,		// HV_WORD, HV_SPACE, ...
+		name;		// Element name
+};
+
+//
+// Layout checkpoints...
+//
+// The document is divided into segments that start right after a block
+// element or a table row. Each segment records the state of the layout
+// at its start, so format() only lays out the segments in view. A
+// segment only starts where its layout does not depend on the width of
+// the view, i.e. not in a table cell.
+//
+
+#define HV_SEGMENT	256		// Minimum number of tokens per segment
+#define HV_PASSES	256		// Maximum number of times the document is widened
+#define HV_WIDTH	32767		// Maximum width the document is widened to
+
+struct Fl_Help_Segment {
+  int		first,		// First token
+		y,		// Y position of the first block
+		h,		// Height, measured or estimated
+		width,		// Document width of h, 0 if never estimated
+		lines,		// Line breaks for the estimate
+		chars;		// Characters for the estimate
+  // Layout state at the start of the segment...
+  const char	*start;		// Start of the first block
+  int		x,		// Left margin of the first block
+		hh;		// Height of the current line
+  Fl_Color	bgcolor,	// Background color
+		textcolor,	// Text color
+		linkcolor,	// Link color
+		tc, rc;		// Table/row background color
+  int		link,		// Token of the current link, or -1
+		table,		// Token of the current table, or -1
+		table_x;	// Left margin of the table
+  Fl_Font	table_font;	// Font and size at the table
+  Fl_Fontsize	table_size;
+  signed char	table_align,	// Alignment of the table
+		talign,		// Current alignment
+		newalign;	// New alignment
+  uchar		border,		// Draw table border?
+		head,		// In the <HEAD> section?
+		pre,		// <PRE> text?
+		row,		// Is the first block a table row?
+		nfonts,		// Depth of the font stack
+		nmargins;	// Depth of the margin stack
+  int		stack;		// Margins, then fonts in stacks_
+};
+
+//
+// Column widths of the tables formatted last (see format_table())...
+//
+
+struct HV_Table {
+  const Fl_Help_View *view;	// Help view, NULL if unused
+  int		table,		// Token of the table
+		key,		// Default font and size
+		hsize,		// Document width, -1 if the widths don't depend on it
+		num_columns;	// Number of columns
+  int		columns[MAX_COLUMNS],
+				// Maximum column widths
+		minwidths[MAX_COLUMNS];
+				// Minimum column widths
+};
+
+static HV_Table	table_cache[8];
+static int	table_next = 0;
+
 //
 // All the stuff needed to implement text selection in Fl_Help_View
 //
@@ -478,6 +586,118 @@ void HV_Edit_Buffer::print(const char *text) {
 } // print()
 #endif
 
+/*
+  Returns the width of a word in the given font, using the width cached in
+  the token if it was measured in the same font before.
+*/
+static int token_width(Fl_Help_Token *t, Fl_Font font, Fl_Fontsize fsize) {
+
+  int key = (font << 16) | fsize;
+
+  if (t->key != key) {
+    if (fl_font() != font || fl_size() != fsize) fl_font(font, fsize);
+    if (memchr(t->start, '&', t->length)) {
+      HV_Edit_Buffer buf;
+      const char *ptr = t->start, *end = ptr + t->length;
+      while (ptr < end) {
+        if (*ptr == '&') {
+          int qch = quote_char(++ptr);
+          if (qch < 0) buf.add('&');
+          else {
+            buf.add(qch);
+            ptr = strchr(ptr, ';') + 1;
+          }
+        } else buf.add(*ptr++);
+      }
+      t->data = buf.width();
+    } else t->data = (int)fl_width(t->start, t->length);
+    t->key = key;
+  }
+
+  return t->data;
+}
+
+/*
+  Width of a space, measured once per font while formatting.
+*/
+struct HV_Space {
+  Fl_Font font;
+  Fl_Fontsize fsize;
+  int width_;
+
+  HV_Space() : font(-1), fsize(0), width_(0) {}
+  int width(Fl_Font f, Fl_Fontsize s) {
+    if (f != font || s != fsize) {
+      if (fl_font() != f || fl_size() != s) fl_font(f, s);
+      font = f;
+      fsize = s;
+      width_ = (int)fl_width(' ');
+    }
+    return width_;
+  }
+};
+
+/*
+  Returns the name of an element, see element_names[].
+*/
+static int element_name(const char *name, int length) {
+
+  int close = 0;
+
+  if (length > 1 && *name == '/') {
+    close = HV_CLOSE;
+    name ++;
+    length --;
+  }
+
+  for (int i = 1; i < HV_NAMES; i ++)
+    if ((int)strlen(element_names[i]) == length &&
+        !strncasecmp(element_names[i], name, length)) return i | close;
+
+  return HV_OTHER;
+}
+
+/*
+  Returns the attributes of an element, after its name.
+*/
+static const char *element_attrs(const Fl_Help_Token *t) {
+
+  const char *ptr = t->start + 1;
+
+  while (*ptr && *ptr != '>' && !isspace((*ptr)&255)) ptr ++;
+
+  return ptr;
+}
+
+/*
+  Returns 1 if the element starts a new block.
+*/
+static int block_element(int name) {
+  switch (name) {
+    case HV_CENTER : case HV_P : case HV_H1 : case HV_H2 : case HV_H3 :
+    case HV_H4 : case HV_H5 : case HV_H6 : case HV_UL : case HV_OL :
+    case HV_DL : case HV_LI : case HV_DD : case HV_DT : case HV_HR :
+    case HV_PRE : case HV_TABLE :
+      return 1;
+    default :
+      return 0;
+  }
+}
+
+/*
+  Returns 1 if the element ends a block.
+*/
+static int end_block_element(int name) {
+  switch (name & ~HV_CLOSE) {
+    case HV_CENTER : case HV_P : case HV_H1 : case HV_H2 : case HV_H3 :
+    case HV_H4 : case HV_H5 : case HV_H6 : case HV_PRE : case HV_UL :
+    case HV_OL : case HV_DL : case HV_TABLE :
+      return (name & HV_CLOSE) != 0;
+    default :
+      return 0;
+  }
+}
+
 /** Adds a text block to the list. */
 Fl_Help_Block *					// O - Pointer to new block
 Fl_Help_View::add_block(const char   *s,	// I - Pointer to start of block text
@@ -495,7 +715,7 @@ Fl_Help_View::add_block(const char   *s,	// I - Pointer to start of block text
 
   if (nblocks_ >= ablocks_)
   {
-    ablocks_ += 16;
+    ablocks_ = ablocks_ ? 2 * ablocks_ : 16;
 
     if (ablocks_ == 16)
       blocks_ = (Fl_Help_Block *)malloc(sizeof(Fl_Help_Block) * ablocks_);
@@ -532,7 +752,7 @@ void Fl_Help_View::add_link(const char *n,	// I - Name of link
 
   if (nlinks_ >= alinks_)
   {
-    alinks_ += 16;
+    alinks_ = alinks_ ? 2 * alinks_ : 16;
 
     if (alinks_ == 16)
       links_ = (Fl_Help_Link *)malloc(sizeof(Fl_Help_Link) * alinks_);
@@ -570,7 +790,7 @@ void Fl_Help_View::add_target(const char *n,	// I - Name of target
 
   if (ntargets_ >= atargets_)
   {
-    atargets_ += 16;
+    atargets_ = atargets_ ? 2 * atargets_ : 16;
 
     if (atargets_ == 16)
       targets_ = (Fl_Help_Target *)malloc(sizeof(Fl_Help_Target) * atargets_);
@@ -657,6 +877,9 @@ Fl_Help_View::draw()
 
   DEBUG_FUNCTION(__LINE__,__FUNCTION__);
 
+  // Bring the layout up to date after resize(), textfont() or textsize()
+  update_format();
+
   // Draw the scrollbar(s) and box first...
   ww = w();
   hh = h();
@@ -709,7 +932,8 @@ Fl_Help_View::draw()
   fl_color(textcolor_);
 
   // Draw all visible blocks...
-  for (i = 0, block = blocks_; i < nblocks_; i ++, block ++)
+  for (i = find_block(topline_), block = blocks_ + i;
+       i < nblocks_ && block->ymin < (topline_ + h()); i ++, block ++)
     if ((block->y + block->h) >= topline_ && block->y < (topline_ + h()))
     {
       line      = 0;
@@ -1179,6 +1403,36 @@ Fl_Help_View::draw()
 
 
 
+/*
+  Returns 1 if the text at \p bp matches the search string \p s, comparing
+  it like find() does.
+*/
+static int match_text(const char *bp,	// I - Text to compare
+                      const char *end,	// I - End of the text
+		      const char *s)	// I - Search string
+{
+  int	c;				// Current character
+
+
+  for (; *s && bp < end && *bp; bp ++) {
+    if (*bp == '<') {
+      // skip to end of element...
+      while (bp < end && *bp && *bp != '>') bp ++;
+      continue;
+    } else if (*bp == '&') {
+      // decode HTML entity...
+      if ((c = quote_char(bp + 1)) < 0) c = '&';
+      else bp = strchr(bp + 1, ';') + 1;
+    } else c = *bp;
+
+    if (tolower(*s) != tolower(c)) return 0;
+    s ++;
+  }
+
+  return !*s;
+}
+
+
 /** Finds the specified string \p s at starting position \p p.
 
     \return the matching position or -1 if not found
@@ -1188,11 +1442,16 @@ Fl_Help_View::find(const char *s,		// I - String to find
                    int        p)		// I - Starting position
 {
   int		i,				// Looping var
-		c;				// Current character
+		c,				// Current character
+		seg,				// Current segment
+		pass,				// Formatting pass
+		top,				// Top line of the match
+		len;				// Length of the document
   Fl_Help_Block	*b;				// Current block
   const char	*bp,				// Block matching pointer
 		*bs,				// Start of current comparison
-		*sp;				// Search string pointer
+		*sp,				// Search string pointer
+		*end;				// End of the segment text
 
 
   DEBUG_FUNCTION(__LINE__,__FUNCTION__);
@@ -1200,49 +1459,79 @@ Fl_Help_View::find(const char *s,		// I - String to find
   // Range check input and value...
   if (!s || !value_) return -1;
 
-  if (p < 0 || p >= (int)strlen(value_)) p = 0;
+  update_format();
+
+  len = (int)strlen(value_);
+  if (p < 0 || p >= len) p = 0;
   else if (p > 0) p ++;
 
-  // Look for the string...
-  for (i = nblocks_, b = blocks_; i > 0; i --, b ++) {
-    if (b->end < (value_ + p))
+  // Look for the string in the text of each segment, and then in the
+  // blocks of the segment that contains it...
+  for (seg = 0; seg < nsegments_; seg ++) {
+    if (seg + 1 < nsegments_) end = tokens_[segments_[seg + 1].first].start;
+    else end = value_ + len;
+
+    if (end < (value_ + p))
+      continue;
+
+    if (seg > 0) bp = tokens_[segments_[seg].first - 1].start;
+    else bp = value_;
+
+    if (bp < (value_ + p)) bp = value_ + p;
+
+    while (bp < end && !match_text(bp, end, s)) bp ++;
+
+    if (bp >= end)
       continue;
 
-    if (b->start < (value_ + p)) bp = value_ + p;
-    else bp = b->start;
+    if (seg < first_segment_ || seg >= last_segment_)
+      for (pass = 0; !format_segments(seg, seg + 1, pass < HV_PASSES); pass ++) {/*empty*/}
 
-    for (sp = s, bs = bp; *sp && *bp && bp < b->end; bp ++) {
-      if (*bp == '<') {
-        // skip to end of element...
-	while (*bp && bp < b->end && *bp != '>') bp ++;
+    for (i = nblocks_, b = blocks_; i > 0; i --, b ++) {
+      if (b->end < (value_ + p))
 	continue;
-      } else if (*bp == '&') {
-        // decode HTML entity...
-	if ((c = quote_char(bp + 1)) < 0) c = '&';	// *FIXME* UTF-8, see below
-	else bp = strchr(bp + 1, ';') + 1;
-      } else c = *bp;
-
-      // *FIXME* *UTF-8* (A.S. 02/14/2016)
-      // At this point c may be an arbitrary Unicode Code Point corresponding
-      // to a quoted character (see above), i.e. it _can_ be a multi byte
-      // UTF-8 sequence and must be compared with the corresponding
-      // multi byte string in (*sp)...
-      // For instance: "&euro;" == 0x20ac -> 0xe2 0x82 0xac (UTF-8: 3 bytes).
-      // Hint: use fl_utf8encode() [see below]
-
-      if (tolower(*sp) == tolower(c)) sp ++;
-      else {
-        // No match, so reset to start of search...
-	sp = s;
-	bs ++;
-	bp = bs;
+
+      if (b->start < (value_ + p)) bp = value_ + p;
+      else bp = b->start;
+
+      for (sp = s, bs = bp; *sp && bp < b->end && *bp; bp ++) {
+	if (*bp == '<') {
+	  // skip to end of element...
+	  while (bp < b->end && *bp && *bp != '>') bp ++;
+	  continue;
+	} else if (*bp == '&') {
+	  // decode HTML entity...
+	  if ((c = quote_char(bp + 1)) < 0) c = '&';	// *FIXME* UTF-8, see below
+	  else bp = strchr(bp + 1, ';') + 1;
+	} else c = *bp;
+
+	// *FIXME* *UTF-8* (A.S. 02/14/2016)
+	// At this point c may be an arbitrary Unicode Code Point corresponding
+	// to a quoted character (see above), i.e. it _can_ be a multi byte
+	// UTF-8 sequence and must be compared with the corresponding
+	// multi byte string in (*sp)...
+	// For instance: "&euro;" == 0x20ac -> 0xe2 0x82 0xac (UTF-8: 3 bytes).
+	// Hint: use fl_utf8encode() [see below]
+
+	if (tolower(*sp) == tolower(c)) sp ++;
+	else {
+	  // No match, so reset to start of search...
+	  sp = s;
+	  bs ++;
+	  bp = bs;
+	}
       }
-    }
 
-    if (!*sp) {
-      // Found a match!
-      topline(b->y - b->h);
-      return (int) (b->end - value_);
+      if (!*sp) {
+	// Found a match! Format the segments around it, keeping the
+	// segment with the match in place...
+	top      = b->y - b->h - segments_[seg].y;
+	p        = (int) (b->end - value_);
+	topline_ = segments_[seg].y + top;
+	update_format();
+	topline(segments_[seg].y + top);
+	return p;
+      }
     }
   }
 
@@ -1250,19 +1539,512 @@ Fl_Help_View::find(const char *s,		// I - String to find
   return (-1);
 }
 
-/** Formats the help text. */
-void Fl_Help_View::format() {
+/**
+  Internal: splits the document into tokens.
+
+  This is done once for each document, see Fl_Help_Token. Comments are
+  skipped, and the text of the \<TITLE> element is copied to title_.
+*/
+void Fl_Help_View::parse() {
+  const char	*ptr,		// Pointer into document
+		*start;		// Start of token
+  Fl_Help_Token	*t;		// New token
+  int		type,		// Type of token
+		name;		// Element name
+
+
+  DEBUG_FUNCTION(__LINE__,__FUNCTION__);
+
+  strcpy(title_, "Untitled");
+  ntokens_ = 0;
+
+  for (ptr = value_; ptr;) {
+    name = HV_OTHER;
+    start = ptr;
+
+    if (!*ptr)
+      type = HV_END;
+    else if (*ptr == '<') {
+      ptr ++;
+
+      if (strncmp(ptr, "!--", 3) == 0) {
+        // Comment...
+        if ((ptr = strstr(ptr + 3, "-->")) != NULL)
+          ptr += 3;
+        continue;
+      }
+
+      while (*ptr && *ptr != '>' && !isspace((*ptr)&255))
+        ptr ++;
+
+      type = HV_ELEMENT;
+      name = element_name(start + 1, (int)(ptr - start - 1));
+
+      while (*ptr && *ptr != '>')
+        ptr ++;
+
+      if (*ptr == '>')
+        ptr ++;
+    } else if (isspace((*ptr)&255)) {
+      while (isspace((*ptr)&255))
+        ptr ++;
+
+      if (ntokens_ && tokens_[ntokens_ - 1].type == HV_WORD &&
+          tokens_[ntokens_ - 1].start + tokens_[ntokens_ - 1].length == start)
+        type = HV_WORD_SPACE;
+      else
+        type = HV_SPACE;
+    } else {
+      // A word, including character entities like "&amp;"...
+      while (*ptr && *ptr != '<' && !isspace((*ptr)&255)) {
+        if (*ptr == '&' && quote_char(ptr + 1) >= 0)
+          ptr = strchr(ptr + 1, ';') + 1;
+        else
+          ptr ++;
+      }
+
+      type = HV_WORD;
+    }
+
+    if (ntokens_ >= atokens_) {
+      atokens_ = atokens_ ? 2 * atokens_ : 1024;
+      tokens_  = (Fl_Help_Token *)realloc(tokens_, sizeof(Fl_Help_Token) * atokens_);
+    }
+
+    t = tokens_ + ntokens_;
+    t->start  = start;
+    t->length = (int)(ptr - start);
+    t->data   = 0;
+    t->key    = -1;
+    t->type   = (uchar)type;
+    t->name   = (uchar)name;
+
+    if (type == HV_END)
+      break;
+
+    ntokens_ ++;
+
+    if (name == HV_TITLE) {
+      // Copy the title in the document...
+      char *st;
+      for (st = title_;
+	   *ptr != '<' && *ptr && st < (title_ + sizeof(title_) - 1);
+	   *st++ = *ptr++) {/*empty*/}
+      *st = '\0';
+    }
+  }
+
+  if (!ptr) {
+    // The document ends with an unterminated comment...
+    if (ntokens_ >= atokens_) {
+      atokens_ = atokens_ ? 2 * atokens_ : 1024;
+      tokens_  = (Fl_Help_Token *)realloc(tokens_, sizeof(Fl_Help_Token) * atokens_);
+    }
+
+    memset(tokens_ + ntokens_, 0, sizeof(Fl_Help_Token));
+    tokens_[ntokens_].key  = -1;
+    tokens_[ntokens_].type = HV_END;
+  }
+}
+
+
+/**
+  Internal: divides the parsed document into segments.
+
+  This follows the elements of the document like format_segments() does,
+  without measuring any text, and saves the layout state at each point
+  where a segment can start. It also finds the targets and, when a
+  document is loaded, its images. It is done again when the font or the
+  colors of the view change.
+*/
+void Fl_Help_View::find_segments() {
+  int		i;		// Looping var
+  Fl_Help_Token	*t;		// Current token
+  Fl_Help_Segment *seg;		// New segment
+  const char	*start,		// Start of the next block
+		*attrs,		// Pointer to start of element attributes
+		*ptr;		// Pointer into whitespace
+  char		attr[1024],	// Attribute buffer
+		wattr[1024],	// Width attribute buffer
+		hattr[1024];	// Height attribute buffer
+  Fl_Font	font;
+  Fl_Fontsize	fsize;		// Current font and size
+  Fl_Color	fcolor;		// Current font color
+  fl_margins	margins;	// Left margin stack...
+  uchar		tainted[100];	// Does the margin depend on the view width?
+  int		x, xtainted,	// Left margin of the current block
+		row_x, row_tainted,
+				// Left margin of the current table row
+		row,		// In a table row?
+		head,		// In the <HEAD> section?
+		pre,		// <PRE> text?
+		talign,		// Current alignment
+		newalign,	// New alignment
+		border,		// Draw border?
+		link,		// Current link
+		table,		// Current table
+		table_x,	// Left margin of the current table
+		table_tainted,
+		table_align,	// Alignment of the current table
+		name,		// Element name
+		cut,		// Can a segment start after this element?
+		save,		// Start a segment at this token?
+		hr,		// Is this a <HR> element?
+		last,		// First token of the last segment
+		lines,		// Line breaks in the last segment
+		chars;		// Characters in the last segment
+  Fl_Font	table_font;
+  Fl_Fontsize	table_size;	// Font and size of the current table
+  Fl_Color	tc, rc;		// Table/row background color
+
+
+  DEBUG_FUNCTION(__LINE__,__FUNCTION__);
+
+  nsegments_ = 0;
+  nstacks_   = 0;
+  ntargets_  = 0;
+  bgcolor_   = color();
+  textcolor_ = textcolor();
+  linkcolor_ = fl_contrast(FL_BLUE, color());
+
+  tc = rc = bgcolor_;
+
+  initfont(font, fsize, fcolor);
+
+  x             = margins.clear();
+  xtainted      = 0;
+  tainted[0]    = 0;
+  row_x         = 0;
+  row_tainted   = 0;
+  row           = 0;
+  head          = 0;
+  pre           = 0;
+  talign        = LEFT;
+  newalign      = LEFT;
+  border        = 0;
+  link          = -1;
+  table         = -1;
+  table_x       = 0;
+  table_tainted = 0;
+  table_align   = LEFT;
+  table_font    = font;
+  table_size    = fsize;
+  start         = value_;
+  hr            = 0;
+  last          = 0;
+  lines         = 0;
+  chars         = 0;
+
+  for (t = tokens_, save = 1;; t ++) {
+    if (save || t->type == HV_END) {
+      // Save the layout state, the end of the document gets a segment, too...
+      if (nsegments_ + 1 >= asegments_) {
+        asegments_ = asegments_ ? 2 * asegments_ : 16;
+        segments_  = (Fl_Help_Segment *)realloc(segments_, sizeof(Fl_Help_Segment) * asegments_);
+      }
+
+      if (nsegments_) {
+        segments_[nsegments_ - 1].lines = lines;
+        segments_[nsegments_ - 1].chars = chars;
+      }
+
+      seg = segments_ + nsegments_;
+      memset(seg, 0, sizeof(Fl_Help_Segment));
+      seg->first       = (int)(t - tokens_);
+      seg->start       = start;
+      seg->x           = x;
+      seg->hh          = hr ? 2 * fsize : 0;
+      seg->bgcolor     = bgcolor_;
+      seg->textcolor   = textcolor_;
+      seg->linkcolor   = linkcolor_;
+      seg->tc          = tc;
+      seg->rc          = rc;
+      seg->link        = link;
+      seg->table       = table;
+      seg->table_x     = table_x;
+      seg->table_font  = table_font;
+      seg->table_size  = table_size;
+      seg->table_align = (signed char)table_align;
+      seg->talign      = (signed char)talign;
+      seg->newalign    = (signed char)newalign;
+      seg->border      = (uchar)border;
+      seg->head        = (uchar)head;
+      seg->pre         = (uchar)pre;
+      seg->row         = (uchar)row;
+      seg->nfonts      = (uchar)fstack_.count();
+      seg->nmargins    = (uchar)margins.depth_;
+      seg->stack       = nstacks_;
+
+      // Save the margin and font stacks...
+      if (nstacks_ + seg->nmargins + 3 * seg->nfonts + 4 > astacks_) {
+        astacks_ = nstacks_ + seg->nmargins + 3 * seg->nfonts + 4 + 1024;
+        stacks_  = (int *)realloc(stacks_, sizeof(int) * astacks_);
+      }
+
+      for (i = 0; i <= seg->nmargins; i ++)
+        stacks_[nstacks_ ++] = margins.margins_[i];
+      for (i = 0; i <= seg->nfonts; i ++) {
+        stacks_[nstacks_ ++] = fstack_.elt(i).f;
+        stacks_[nstacks_ ++] = fstack_.elt(i).s;
+        stacks_[nstacks_ ++] = (int)fstack_.elt(i).c;
+      }
+
+      if (t->type == HV_END)
+        break;
+
+      nsegments_ ++;
+      last  = seg->first;
+      lines = 0;
+      chars = 0;
+      save  = 0;
+    }
+
+    if (t->type == HV_WORD) {
+      chars += t->length;
+      continue;
+    } else if (t->type != HV_ELEMENT) {
+      if (pre) {
+        for (ptr = t->start; ptr < t->start + t->length; ptr ++)
+          if (*ptr == '\n') lines ++;
+      }
+      continue;
+    }
+
+    attrs = element_attrs(t);
+    name  = t->name;
+    cut   = 0;
+    hr    = 0;
+
+    if (name == HV_HEAD)
+      head = 1;
+    else if (name == (HV_HEAD | HV_CLOSE))
+      head = 0;
+    else if (name == HV_A) {
+      if (get_attr(attrs, "NAME", attr, sizeof(attr)) != NULL) {
+        add_target(attr, 0);
+        targets_[ntargets_ - 1].token = (int)(t - tokens_);
+      }
+
+      if (get_attr(attrs, "HREF", attr, sizeof(attr)) != NULL)
+        link = (int)(t - tokens_);
+    }
+    else if (name == (HV_A | HV_CLOSE))
+      link = -1;
+    else if (name == HV_BODY) {
+      bgcolor_   = get_color(get_attr(attrs, "BGCOLOR", attr, sizeof(attr)),
+			     color());
+      textcolor_ = get_color(get_attr(attrs, "TEXT", attr, sizeof(attr)),
+			     textcolor());
+      linkcolor_ = get_color(get_attr(attrs, "LINK", attr, sizeof(attr)),
+			     fl_contrast(FL_BLUE, color()));
+    }
+    else if (name == HV_BR)
+      lines ++;
+    else if (block_element(name)) {
+      if (name == HV_UL || name == HV_OL || name == HV_DL) {
+        i        = margins.depth_;
+        x        = margins.push(4 * fsize);
+        xtainted = tainted[i];
+        if (margins.depth_ > i) tainted[margins.depth_] = (uchar)xtainted;
+      } else if (name == HV_TABLE) {
+	if (get_attr(attrs, "BORDER", attr, sizeof(attr)))
+	  border = (uchar)atoi(attr);
+	else
+	  border = 0;
+
+        tc = rc = get_color(get_attr(attrs, "BGCOLOR", attr, sizeof(attr)), bgcolor_);
+
+        table         = (int)(t - tokens_);
+        table_x       = x;
+        table_tainted = xtainted;
+        table_align   = get_align(attrs, talign);
+        table_font    = font;
+        table_size    = fsize;
+      }
+
+      if (name >= HV_H1 && name <= HV_H6) {
+        font  = FL_HELVETICA_BOLD;
+        fsize = textsize_ + HV_H1 + 6 - name;
+      } else if (name == HV_DT) {
+        font  = textfont_ | FL_ITALIC;
+        fsize = textsize_;
+      } else if (name == HV_PRE) {
+        font  = FL_COURIER;
+        fsize = textsize_;
+        pre   = 1;
+      } else {
+        font  = textfont_;
+        fsize = textsize_;
+      }
+
+      pushfont(font, fsize);
+
+      if (name == HV_CENTER)
+        newalign = talign = CENTER;
+      else
+        newalign = get_align(attrs, talign);
+
+      start = t->start;
+      hr    = name == HV_HR;
+      cut   = !row;
+      lines ++;
+    }
+    else if (end_block_element(name)) {
+      if (name == (HV_UL | HV_CLOSE) || name == (HV_OL | HV_CLOSE) ||
+          name == (HV_DL | HV_CLOSE)) {
+        x        = margins.pop();
+        xtainted = tainted[margins.depth_];
+      } else if (name == (HV_TABLE | HV_CLOSE)) {
+        x        = margins.current();
+        xtainted = tainted[margins.depth_];
+      } else if (name == (HV_PRE | HV_CLOSE))
+        pre = 0;
+      else if (name == (HV_CENTER | HV_CLOSE))
+        talign = LEFT;
+
+      popfont(font, fsize, fcolor);
+
+      start = t->start + t->length;
+      if (t[1].type == HV_SPACE && t[1].start == start) {
+        t ++;
+        start += t->length;
+      }
+
+      newalign = talign;
+      cut      = !row;
+      lines ++;
+    }
+    else if (name == HV_TR) {
+      rc = get_color(get_attr(attrs, "BGCOLOR", attr, sizeof(attr)), tc);
+
+      row_x       = x;
+      row_tainted = xtainted;
+      row         = 1;
+      start       = t->start;
+      cut         = 1;
+      lines ++;
+    }
+    else if (name == (HV_TR | HV_CLOSE) && row) {
+      talign   = LEFT;
+      x        = row_x;
+      xtainted = row_tainted;
+      row      = 0;
+    }
+    else if ((name == HV_TD || name == HV_TH) && row) {
+      font  = (name == HV_TH) ? textfont_ | FL_BOLD : textfont_;
+      fsize = textsize_;
+
+      // The cell margin depends on the column widths...
+      i        = margins.depth_;
+      margins.push(0);
+      if (margins.depth_ > i) tainted[margins.depth_] = 1;
+      xtainted = 1;
+
+      pushfont(font, fsize);
+
+      newalign = get_align(attrs, name == HV_TH ? CENTER : LEFT);
+      talign   = newalign;
+    }
+    else if ((name == (HV_TD | HV_CLOSE) || name == (HV_TH | HV_CLOSE)) && row) {
+      popfont(font, fsize, fcolor);
+      margins.pop();
+      talign = LEFT;
+    }
+    else if (name == HV_FONT) {
+      if (get_attr(attrs, "FACE", attr, sizeof(attr)) != NULL) {
+	if (!strncasecmp(attr, "helvetica", 9) ||
+	    !strncasecmp(attr, "arial", 5) ||
+	    !strncasecmp(attr, "sans", 4)) font = FL_HELVETICA;
+	else if (!strncasecmp(attr, "times", 5) ||
+		 !strncasecmp(attr, "serif", 5)) font = FL_TIMES;
+	else if (!strncasecmp(attr, "symbol", 6)) font = FL_SYMBOL;
+	else font = FL_COURIER;
+      }
+
+      if (get_attr(attrs, "SIZE", attr, sizeof(attr)) != NULL) {
+	if (isdigit(attr[0] & 255)) {
+	  // Absolute size
+	  fsize = (int)(textsize_ * pow(1.2, atoi(attr) - 3.0));
+	} else {
+	  // Relative size
+	  fsize = (int)(fsize * pow(1.2, atoi(attr)));
+	}
+      }
+
+      pushfont(font, fsize);
+    }
+    else if (name == (HV_FONT | HV_CLOSE))
+      popfont(font, fsize, fcolor);
+    else if (name == HV_B || name == HV_STRONG)
+      pushfont(font |= FL_BOLD, fsize);
+    else if (name == HV_I || name == HV_EM)
+      pushfont(font |= FL_ITALIC, fsize);
+    else if (name == HV_CODE || name == HV_TT)
+      pushfont(font = FL_COURIER, fsize);
+    else if (name == HV_KBD)
+      pushfont(font = FL_COURIER_BOLD, fsize);
+    else if (name == HV_VAR)
+      pushfont(font = FL_COURIER_ITALIC, fsize);
+    else if (name == (HV_B | HV_CLOSE) || name == (HV_STRONG | HV_CLOSE) ||
+             name == (HV_I | HV_CLOSE) || name == (HV_EM | HV_CLOSE) ||
+             name == (HV_CODE | HV_CLOSE) || name == (HV_TT | HV_CLOSE) ||
+             name == (HV_KBD | HV_CLOSE) || name == (HV_VAR | HV_CLOSE))
+      popfont(font, fsize, fcolor);
+    else if (name == HV_IMG && initial_load) {
+      // Load the images once, format_segments() and format_table() find
+      // them, and free_data() releases them...
+      get_attr(attrs, "WIDTH", wattr, sizeof(wattr));
+      get_attr(attrs, "HEIGHT", hattr, sizeof(hattr));
+
+      if (get_attr(attrs, "SRC", attr, sizeof(attr)))
+        get_image(attr, get_length(wattr), get_length(hattr));
+    }
+
+    // A segment can start after this element if its layout does not
+    // depend on the width of the view...
+    save = cut && t[1].type != HV_END && t + 1 - tokens_ - last >= HV_SEGMENT &&
+           !xtainted && !tainted[margins.depth_] &&
+           (table < 0 || !table_tainted);
+  }
+
+  if (ntargets_ > 1)
+    qsort(targets_, ntargets_, sizeof(Fl_Help_Target),
+          (compare_func_t)compare_targets);
+
+  for (i = 0; i < ntargets_; i ++)
+    tokens_[targets_[i].token].data = i;
+}
+
+
+/**
+  Internal: formats the segments from \p first up to, but not including,
+  \p last into blocks_ and links_.
+
+  The layout starts with the state saved in the first segment. The
+  heights of the segments are updated, and the positions of the
+  segments after them are moved.
+
+  Returns 0 if the document is wider than hsize_. hsize_ is set to the
+  new width, and the segments must be formatted again. If \p grow is 0,
+  hsize_ is kept and wider text runs past the right edge. This is also
+  done once the document is wider than HV_WIDTH: tables whose position
+  depends on hsize_, like a nested table in a centered one, would
+  otherwise widen the document forever.
+*/
+int Fl_Help_View::format_segments(int first, int last, int grow) {
   int		i;		// Looping var
   int		done;		// Are we done yet?
+  Fl_Help_Segment *seg;		// Current segment
+  const int	*stack;		// Saved stacks of the segment
+  Fl_Help_Token	*t;		// Current token
   Fl_Help_Block	*block,		// Current block
 		*cell;		// Current table cell
   int		cells[MAX_COLUMNS],
 				// Cells in the current row...
-		row;		// Current table row (block number)
-  const char	*ptr,		// Pointer into block
+		row;		// Current table row (block number), or -1
+  const char	*ptr,		// Pointer into whitespace
 		*start,		// Pointer to start of element
 		*attrs;		// Pointer to start of element attributes
-  HV_Edit_Buffer buf;		// Text buffer
   char		attr[1024],	// Attribute buffer
 		wattr[1024],	// Width attribute buffer
 		hattr[1024],	// Height attribute buffer
@@ -1274,7 +2056,8 @@ void Fl_Help_View::format() {
   Fl_Fontsize   fsize;          // Current font and size
   Fl_Color      fcolor;         // Current font color
   unsigned char	border;		// Draw border?
-  int		talign,		// Current alignment
+  int		name,		// Element name
+		talign,		// Current alignment
 		newalign,	// New alignment
 		head,		// In the <HEAD> section?
 		pre,		// <PRE> text?
@@ -1285,729 +2068,850 @@ void Fl_Help_View::format() {
 		columns[MAX_COLUMNS];
 				// Column widths
   Fl_Color	tc, rc;		// Table/row background color
-  Fl_Boxtype	b = box() ? box() : FL_DOWN_BOX;
-				// Box to draw...
   fl_margins	margins;	// Left margin stack...
+  HV_Space	space;		// Width of a space
+
 
   DEBUG_FUNCTION(__LINE__,__FUNCTION__);
 
-  // Reset document width...
-  int scrollsize = scrollbar_size_ ? scrollbar_size_ : Fl::scrollbar_size();
-  hsize_ = w() - scrollsize - Fl::box_dw(b);
+  if (hsize_ > HV_WIDTH)
+    grow = 0;
 
-  done = 0;
-  while (!done)
-  {
-    // Reset state variables...
-    done       = 1;
-    nblocks_   = 0;
-    nlinks_    = 0;
-    ntargets_  = 0;
-    size_      = 0;
-    bgcolor_   = color();
-    textcolor_ = textcolor();
-    linkcolor_ = fl_contrast(FL_BLUE, color());
+  // Restore the layout state at the start of the first segment...
+  seg = segments_ + first;
 
-    tc = rc = bgcolor_;
+  nblocks_   = 0;
+  nlinks_    = 0;
+  bgcolor_   = seg->bgcolor;
+  textcolor_ = seg->textcolor;
+  linkcolor_ = seg->linkcolor;
 
-    strcpy(title_, "Untitled");
+  stack = stacks_ + seg->stack;
+
+  margins.depth_ = seg->nmargins;
+  for (i = 0; i <= seg->nmargins; i ++)
+    margins.margins_[i] = *stack ++;
+
+  fstack_.init(stack[0], stack[1], (Fl_Color)stack[2]);
+  for (i = 1, stack += 3; i <= seg->nfonts; i ++, stack += 3)
+    fstack_.push(stack[0], stack[1], (Fl_Color)stack[2]);
+  fstack_.top(font, fsize, fcolor);
 
-    if (!value_)
-      return;
-
-    // Setup for formatting...
-    initfont(font, fsize, fcolor);
-
-    line         = 0;
-    links        = 0;
-    xx           = margins.clear();
-    yy           = fsize + 2;
-    ww           = 0;
-    column       = 0;
-    border       = 0;
-    hh           = 0;
-    block        = add_block(value_, xx, yy, hsize_, 0);
-    row          = 0;
-    head         = 0;
-    pre          = 0;
-    talign       = LEFT;
-    newalign     = LEFT;
-    needspace    = 0;
-    linkdest[0]  = '\0';
-    table_offset = 0;
-
-    // Html text character loop
-    for (ptr = value_, buf.clear(); *ptr;)
+  done         = 1;
+  tc           = seg->tc;
+  rc           = seg->rc;
+  line         = 0;
+  links        = 0;
+  xx           = seg->x;
+  yy           = seg->y;
+  ww           = 0;
+  column       = 0;
+  border       = seg->border;
+  hh           = seg->hh;
+  row          = -1;
+  head         = seg->head;
+  pre          = seg->pre;
+  talign       = seg->talign;
+  newalign     = seg->newalign;
+  needspace    = 0;
+  linkdest[0]  = '\0';
+  table_width  = 0;
+  table_offset = 0;
+
+  memset(cells, 0, sizeof(cells));
+
+  if (seg->link >= 0)
+    get_attr(element_attrs(tokens_ + seg->link), "HREF", linkdest, sizeof(linkdest));
+
+  if (seg->table >= 0) {
+    // Get the column widths of the current table...
+    format_table(&table_width, columns, seg->table, seg->table_font, seg->table_size);
+
+    if (grow && (seg->table_x + table_width) > hsize_) {
+      hsize_ = seg->table_x + table_width;
+      done   = 0;
+    }
+
+    switch (seg->table_align)
     {
-      // End of word?
-      if ((*ptr == '<' || isspace((*ptr)&255)) && buf.size() > 0)
-      {
-        // Get width of word parsed so far...
-        ww = buf.width();
+      default :
+	  table_offset = 0;
+	  break;
 
-	if (!head && !pre)
-	{
-          // Check width...
-          if (ww > hsize_) {
-	    hsize_ = ww;
-	    done   = 0;
-	    break;
-	  }
+      case CENTER :
+	  table_offset = (hsize_ - table_width) / 2 - textsize_;
+	  break;
 
-          if (needspace && xx > block->x)
-	    ww += (int)fl_width(' ');
+      case RIGHT :
+	  table_offset = hsize_ - table_width - textsize_;
+	  break;
+    }
+  }
 
-  //        printf("line = %d, xx = %d, ww = %d, block->x = %d, block->w = %d\n",
-  //	       line, xx, ww, block->x, block->w);
+  block = add_block(seg->start, xx, yy, hsize_, 0);
+  if (seg->row)
+    row = 0;
 
-          if ((xx + ww) > block->w)
-	  {
-            line     = do_align(block, line, xx, newalign, links);
-	    xx       = block->x;
-	    yy       += hh;
-	    block->h += hh;
-	    hh       = 0;
-	  }
+  // Token loop
+  for (t = tokens_ + seg->first, seg ++; done && t->type != HV_END; t ++)
+  {
+    if (t - tokens_ == seg->first) {
+      // Start of the next segment...
+      seg[-1].h     = yy - seg[-1].y;
+      seg[-1].width = hsize_;
+      seg->y        = yy;
 
-          if (linkdest[0])
-	    add_link(linkdest, xx, yy - fsize, ww, fsize);
+      if (seg - segments_ == last)
+        break;
 
-	  xx += ww;
-	  if ((fsize + 2) > hh)
-	    hh = fsize + 2;
+      seg ++;
+    }
 
-	  needspace = 0;
-	}
-	else if (pre)
-	{
-          // Add a link as needed...
-          if (linkdest[0])
-	    add_link(linkdest, xx, yy - hh, ww, hh);
+    if (t->type == HV_WORD)
+    {
+      if ((fsize + 2) > hh)
+        hh = fsize + 2;
 
-	  xx += ww;
-	  if ((fsize + 2) > hh)
-	    hh = fsize + 2;
+      // Get width of word...
+      ww = token_width(t, font, fsize);
 
-          // Handle preformatted text...
-	  while (isspace((*ptr)&255))
+      if (!t->start[t->length])
+      {
+        // Last word of the document...
+        if (head)
+          continue;
+
+	if (grow && ww > hsize_) {
+	  hsize_ = ww;
+	  done   = 0;
+	  break;
+	}
+
+	if (needspace && xx > block->x)
+	  ww += space.width(font, fsize);
+
+	if ((xx + ww) > block->w)
+	{
+	  line     = do_align(block, line, xx, newalign, links);
+	  xx       = block->x;
+	  yy       += hh;
+	  block->h += hh;
+	  hh       = 0;
+	}
+
+	if (linkdest[0])
+	  add_link(linkdest, xx, yy - fsize, ww, fsize);
+
+	xx += ww;
+      }
+      else if (!head && !pre)
+      {
+	// Check width...
+	if (grow && ww > hsize_) {
+	  hsize_ = ww;
+	  done   = 0;
+	  break;
+	}
+
+	if (needspace && xx > block->x)
+	  ww += space.width(font, fsize);
+
+	if ((xx + ww) > block->w)
+	{
+	  line     = do_align(block, line, xx, newalign, links);
+	  xx       = block->x;
+	  yy       += hh;
+	  block->h += hh;
+	  hh       = 0;
+	}
+
+	if (linkdest[0])
+	  add_link(linkdest, xx, yy - fsize, ww, fsize);
+
+	xx += ww;
+	if ((fsize + 2) > hh)
+	  hh = fsize + 2;
+
+	needspace = 0;
+      }
+      else if (pre)
+      {
+	// Add a link as needed...
+	if (linkdest[0])
+	  add_link(linkdest, xx, yy - hh, ww, hh);
+
+	xx += ww;
+	if ((fsize + 2) > hh)
+	  hh = fsize + 2;
+
+	// Handle preformatted text...
+	if (t[1].type == HV_WORD_SPACE)
+	{
+	  for (t ++, ptr = t->start; ptr < t->start + t->length; ptr ++)
 	  {
 	    if (*ptr == '\n')
 	    {
-              if (xx > hsize_) break;
+	      if (grow && xx > hsize_) break;
 
-              line     = do_align(block, line, xx, newalign, links);
-              xx       = block->x;
+	      line     = do_align(block, line, xx, newalign, links);
+	      xx       = block->x;
 	      yy       += hh;
 	      block->h += hh;
 	      hh       = fsize + 2;
 	    }
 	    else
-              xx += (int)fl_width(' ');
+	      xx += space.width(font, fsize);
 
-            if ((fsize + 2) > hh)
+	    if ((fsize + 2) > hh)
 	      hh = fsize + 2;
-
-            ptr ++;
 	  }
+	}
 
-          if (xx > hsize_) {
+	if (grow && xx > hsize_) {
+	  hsize_ = xx;
+	  done   = 0;
+	  break;
+	}
+
+	needspace = 0;
+      }
+      else if (t[1].type == HV_WORD_SPACE)
+      {
+	// Skip whitespace in the <HEAD> section...
+	t ++;
+      }
+    }
+    else if (t->type == HV_SPACE || t->type == HV_WORD_SPACE)
+    {
+      for (ptr = t->start; ptr < t->start + t->length; ptr ++)
+      {
+	if (*ptr == '\n' && pre)
+	{
+	  if (linkdest[0])
+	    add_link(linkdest, xx, yy - hh, ww, hh);
+
+	  if (grow && xx > hsize_) {
 	    hsize_ = xx;
 	    done   = 0;
 	    break;
 	  }
 
+	  line      = do_align(block, line, xx, newalign, links);
+	  xx        = block->x;
+	  yy        += hh;
+	  block->h  += hh;
 	  needspace = 0;
 	}
 	else
 	{
-          // Handle normal text or stuff in the <HEAD> section...
-	  while (isspace((*ptr)&255))
-            ptr ++;
+	  needspace = 1;
+	  if ( pre ) {
+	    xx += space.width(font, fsize);
+	  }
 	}
-
-	buf.clear();
       }
-
-      if (*ptr == '<')
+    }
+    else
+    {
+      // Handle html tags..
+      start = t->start;
+      attrs = element_attrs(t);
+      name  = t->name;
+
+      if (name == HV_HEAD)
+	head = 1;
+      else if (name == (HV_HEAD | HV_CLOSE))
+	head = 0;
+      else if (name == HV_A)
       {
-	// Handle html tags..
-	start = ptr;
-	ptr ++;
+	if (get_attr(attrs, "NAME", attr, sizeof(attr)) != NULL)
+	  targets_[t->data].y = yy - fsize - 2;
 
-        if (strncmp(ptr, "!--", 3) == 0)
+	if (get_attr(attrs, "HREF", attr, sizeof(attr)) != NULL)
+	  strlcpy(linkdest, attr, sizeof(linkdest));
+      }
+      else if (name == (HV_A | HV_CLOSE))
+	linkdest[0] = '\0';
+      else if (name == HV_BODY)
+      {
+	bgcolor_   = get_color(get_attr(attrs, "BGCOLOR", attr, sizeof(attr)),
+			       color());
+	textcolor_ = get_color(get_attr(attrs, "TEXT", attr, sizeof(attr)),
+			       textcolor());
+	linkcolor_ = get_color(get_attr(attrs, "LINK", attr, sizeof(attr)),
+			       fl_contrast(FL_BLUE, color()));
+      }
+      else if (name == HV_BR)
+      {
+	line     = do_align(block, line, xx, newalign, links);
+	xx       = block->x;
+	block->h += hh;
+	yy       += hh;
+	hh       = 0;
+      }
+      else if (block_element(name))
+      {
+	block->end = start;
+	ww         = 0;
+	line       = do_align(block, line, xx, newalign, links);
+	newalign   = (name == HV_CENTER) ? CENTER : LEFT;
+	xx         = block->x;
+	block->h   += hh;
+
+	if (name == HV_UL || name == HV_OL || name == HV_DL)
 	{
-	  // Comment...
-	  ptr += 3;
-	  if ((ptr = strstr(ptr, "-->")) != NULL)
-	  {
-	    ptr += 3;
-	    continue;
-	  }
+	  block->h += fsize + 2;
+	  xx       = margins.push(4 * fsize);
+	}
+	else if (name == HV_TABLE)
+	{
+	  if (get_attr(attrs, "BORDER", attr, sizeof(attr)))
+	    border = (uchar)atoi(attr);
 	  else
+	    border = 0;
+
+	  tc = rc = get_color(get_attr(attrs, "BGCOLOR", attr, sizeof(attr)), bgcolor_);
+
+	  block->h += fsize + 2;
+
+	  format_table(&table_width, columns, (int)(t - tokens_), font, fsize);
+
+	  if (grow && (xx + table_width) > hsize_) {
+#ifdef DEBUG
+	    printf("xx=%d, table_width=%d, hsize_=%d\n", xx, table_width,
+		   hsize_);
+#endif // DEBUG
+	    hsize_ = xx + table_width;
+	    done   = 0;
 	    break;
+	  }
+
+	  switch (get_align(attrs, talign))
+	  {
+	    default :
+		table_offset = 0;
+		break;
+
+	    case CENTER :
+		table_offset = (hsize_ - table_width) / 2 - textsize_;
+		break;
+
+	    case RIGHT :
+		table_offset = hsize_ - table_width - textsize_;
+		break;
+	  }
+
+	  column = 0;
 	}
 
-	while (*ptr && *ptr != '>' && !isspace((*ptr)&255))
-	  buf.add(*ptr++);
+	if (name >= HV_H1 && name <= HV_H6)
+	{
+	  font  = FL_HELVETICA_BOLD;
+	  fsize = textsize_ + HV_H1 + 6 - name;
+	}
+	else if (name == HV_DT)
+	{
+	  font  = textfont_ | FL_ITALIC;
+	  fsize = textsize_;
+	}
+	else if (name == HV_PRE)
+	{
+	  font  = FL_COURIER;
+	  fsize = textsize_;
+	  pre   = 1;
+	}
+	else
+	{
+	  font  = textfont_;
+	  fsize = textsize_;
+	}
 
-	attrs = ptr;
-	while (*ptr && *ptr != '>')
-          ptr ++;
+	pushfont(font, fsize);
 
-	if (*ptr == '>')
-          ptr ++;
+	yy = block->y + block->h;
+	hh = 0;
 
-	if (buf.cmp("HEAD"))
-          head = 1;
-	else if (buf.cmp("/HEAD"))
-          head = 0;
-	else if (buf.cmp("TITLE"))
+	if ((name >= HV_H1 && name <= HV_H6) ||
+	    name == HV_DD ||
+	    name == HV_DT ||
+	    name == HV_P)
+	  yy += fsize + 2;
+	else if (name == HV_HR)
 	{
-          // Copy the title in the document...
-	  char *st;
-          for (st = title_;
-	       *ptr != '<' && *ptr && st < (title_ + sizeof(title_) - 1);
-	       *st++ = *ptr++) {/*empty*/}
+	  hh += 2 * fsize;
+	  yy += fsize;
+	}
 
-	  *st = '\0';
-	  buf.clear();
+	if (row >= 0)
+	  block = add_block(start, xx, yy, block->w, 0);
+	else
+	  block = add_block(start, xx, yy, hsize_, 0);
+
+	needspace = 0;
+	line      = 0;
+
+	if (name == HV_CENTER)
+	  newalign = talign = CENTER;
+	else
+	  newalign = get_align(attrs, talign);
+      }
+      else if (end_block_element(name))
+      {
+	ptr        = start + t->length;
+	ww         = 0;
+	line       = do_align(block, line, xx, newalign, links);
+	xx         = block->x;
+	block->end = ptr;
+
+	if (name == (HV_UL | HV_CLOSE) ||
+	    name == (HV_OL | HV_CLOSE) ||
+	    name == (HV_DL | HV_CLOSE))
+	{
+	  xx       = margins.pop();
+	  block->h += fsize + 2;
 	}
-	else if (buf.cmp("A"))
+	else if (name == (HV_TABLE | HV_CLOSE))
 	{
-          if (get_attr(attrs, "NAME", attr, sizeof(attr)) != NULL)
-	    add_target(attr, yy - fsize - 2);
-
-	  if (get_attr(attrs, "HREF", attr, sizeof(attr)) != NULL)
-	    strlcpy(linkdest, attr, sizeof(linkdest));
+	  block->h += fsize + 2;
+	  xx       = margins.current();
 	}
-	else if (buf.cmp("/A"))
-          linkdest[0] = '\0';
-	else if (buf.cmp("BODY"))
+	else if (name == (HV_PRE | HV_CLOSE))
 	{
-          bgcolor_   = get_color(get_attr(attrs, "BGCOLOR", attr, sizeof(attr)),
-	                	 color());
-          textcolor_ = get_color(get_attr(attrs, "TEXT", attr, sizeof(attr)),
-	                	 textcolor());
-          linkcolor_ = get_color(get_attr(attrs, "LINK", attr, sizeof(attr)),
-	                	 fl_contrast(FL_BLUE, color()));
+	  pre = 0;
+	  hh  = 0;
 	}
-	else if (buf.cmp("BR"))
+	else if (name == (HV_CENTER | HV_CLOSE))
+	  talign = LEFT;
+
+	popfont(font, fsize, fcolor);
+
+	// Skip the whitespace after the element...
+	if (t[1].type == HV_SPACE && t[1].start == ptr)
 	{
-          line     = do_align(block, line, xx, newalign, links);
-          xx       = block->x;
-	  block->h += hh;
-          yy       += hh;
-	  hh       = 0;
+	  t ++;
+	  ptr += t->length;
 	}
-	else if (buf.cmp("CENTER") ||
-		 buf.cmp("P") ||
-		 buf.cmp("H1") ||
-		 buf.cmp("H2") ||
-		 buf.cmp("H3") ||
-		 buf.cmp("H4") ||
-		 buf.cmp("H5") ||
-		 buf.cmp("H6") ||
-		 buf.cmp("UL") ||
-		 buf.cmp("OL") ||
-		 buf.cmp("DL") ||
-		 buf.cmp("LI") ||
-		 buf.cmp("DD") ||
-		 buf.cmp("DT") ||
-		 buf.cmp("HR") ||
-		 buf.cmp("PRE") ||
-		 buf.cmp("TABLE"))
+
+	block->h += hh;
+	yy       += hh;
+
+	if (name == (HV_UL | HV_CLOSE) ||
+	    name == (HV_OL | HV_CLOSE) ||
+	    name == (HV_DL | HV_CLOSE))
+	  yy += fsize + 2;
+
+	if (row >= 0)
+	  block = add_block(ptr, xx, yy, block->w, 0);
+	else
+	  block = add_block(ptr, xx, yy, hsize_, 0);
+
+	needspace = 0;
+	hh        = 0;
+	line      = 0;
+	newalign  = talign;
+      }
+      else if (name == HV_TR)
+      {
+	block->end = start;
+	ww         = 0;
+	line       = do_align(block, line, xx, newalign, links);
+	xx         = block->x;
+	block->h   += hh;
+
+	if (row >= 0)
 	{
-          block->end = start;
-          line       = do_align(block, line, xx, newalign, links);
-	  newalign   = buf.cmp("CENTER") ? CENTER : LEFT;
-          xx         = block->x;
-          block->h   += hh;
-
-          if (buf.cmp("UL") ||
-	      buf.cmp("OL") ||
-	      buf.cmp("DL"))
-          {
-	    block->h += fsize + 2;
-	    xx       = margins.push(4 * fsize);
-	  }
-          else if (buf.cmp("TABLE"))
-	  {
-	    if (get_attr(attrs, "BORDER", attr, sizeof(attr)))
-	      border = (uchar)atoi(attr);
-	    else
-	      border = 0;
+	  yy = blocks_[row].y + blocks_[row].h;
 
-            tc = rc = get_color(get_attr(attrs, "BGCOLOR", attr, sizeof(attr)), bgcolor_);
+	  for (cell = blocks_ + row + 1; cell <= block; cell ++)
+	    if ((cell->y + cell->h) > yy)
+	      yy = cell->y + cell->h;
 
-	    block->h += fsize + 2;
+	  block = blocks_ + row;
 
-            format_table(&table_width, columns, start);
+	  block->h = yy - block->y + 2;
 
-            if ((xx + table_width) > hsize_) {
-#ifdef DEBUG
-              printf("xx=%d, table_width=%d, hsize_=%d\n", xx, table_width,
-	             hsize_);
-#endif // DEBUG
-	      hsize_ = xx + table_width;
-	      done   = 0;
-	      break;
+	  for (i = 0; i < column; i ++)
+	    if (cells[i])
+	    {
+	      cell = blocks_ + cells[i];
+	      cell->h = block->h;
 	    }
+	}
 
-            switch (get_align(attrs, talign))
-	    {
-	      default :
-	          table_offset = 0;
-	          break;
+	memset(cells, 0, sizeof(cells));
 
-	      case CENTER :
-	          table_offset = (hsize_ - table_width) / 2 - textsize_;
-	          break;
+	yy        = block->y + block->h - 4;
+	hh        = 0;
+	block     = add_block(start, xx, yy, hsize_, 0);
+	row       = (int) (block - blocks_);
+	needspace = 0;
+	column    = 0;
+	line      = 0;
 
-	      case RIGHT :
-	          table_offset = hsize_ - table_width - textsize_;
-	          break;
-	    }
+	rc = get_color(get_attr(attrs, "BGCOLOR", attr, sizeof(attr)), tc);
+      }
+      else if (name == (HV_TR | HV_CLOSE) && row >= 0)
+      {
+	line       = do_align(block, line, xx, newalign, links);
+	block->end = start;
+	block->h   += hh;
+	talign     = LEFT;
 
-	    column = 0;
-	  }
+	xx = blocks_[row].x;
+	yy = blocks_[row].y + blocks_[row].h;
 
-          if (tolower(buf[0]) == 'h' && isdigit(buf[1]))
-	  {
-	    font  = FL_HELVETICA_BOLD;
-	    fsize = textsize_ + '7' - buf[1];
-	  }
-	  else if (buf.cmp("DT"))
-	  {
-	    font  = textfont_ | FL_ITALIC;
-	    fsize = textsize_;
-	  }
-	  else if (buf.cmp("PRE"))
-	  {
-	    font  = FL_COURIER;
-	    fsize = textsize_;
-	    pre   = 1;
-	  }
-	  else
-	  {
-	    font  = textfont_;
-	    fsize = textsize_;
-	  }
+	for (cell = blocks_ + row + 1; cell <= block; cell ++)
+	  if ((cell->y + cell->h) > yy)
+	    yy = cell->y + cell->h;
 
-	  pushfont(font, fsize);
+	block = blocks_ + row;
 
-          yy = block->y + block->h;
-          hh = 0;
+	block->h = yy - block->y + 2;
 
-          if ((tolower(buf[0]) == 'h' && isdigit(buf[1])) ||
-	      buf.cmp("DD") ||
-	      buf.cmp("DT") ||
-	      buf.cmp("P"))
-            yy += fsize + 2;
-	  else if (buf.cmp("HR"))
+	for (i = 0; i < column; i ++)
+	  if (cells[i])
 	  {
-	    hh += 2 * fsize;
-	    yy += fsize;
+	    cell = blocks_ + cells[i];
+	    cell->h = block->h;
 	  }
 
-          if (row)
-	    block = add_block(start, xx, yy, block->w, 0);
-	  else
-	    block = add_block(start, xx, yy, hsize_, 0);
+	yy        = block->y + block->h /*- 4*/;
+	block     = add_block(start, xx, yy, hsize_, 0);
+	needspace = 0;
+	row       = -1;
+	line      = 0;
+      }
+      else if ((name == HV_TD || name == HV_TH) && row >= 0)
+      {
+	int	colspan;		// COLSPAN attribute
 
-	  needspace = 0;
-	  line      = 0;
 
-	  if (buf.cmp("CENTER"))
-	    newalign = talign = CENTER;
-	  else
-	    newalign = get_align(attrs, talign);
-	}
-	else if (buf.cmp("/CENTER") ||
-		 buf.cmp("/P") ||
-		 buf.cmp("/H1") ||
-		 buf.cmp("/H2") ||
-		 buf.cmp("/H3") ||
-		 buf.cmp("/H4") ||
-		 buf.cmp("/H5") ||
-		 buf.cmp("/H6") ||
-		 buf.cmp("/PRE") ||
-		 buf.cmp("/UL") ||
-		 buf.cmp("/OL") ||
-		 buf.cmp("/DL") ||
-		 buf.cmp("/TABLE"))
-	{
-          line       = do_align(block, line, xx, newalign, links);
-          xx         = block->x;
-          block->end = ptr;
+	line       = do_align(block, line, xx, newalign, links);
+	block->end = start;
+	block->h   += hh;
 
-          if (buf.cmp("/UL") ||
-	      buf.cmp("/OL") ||
-	      buf.cmp("/DL"))
-	  {
-	    xx       = margins.pop();
-	    block->h += fsize + 2;
-	  }
-	  else if (buf.cmp("/TABLE"))
-          {
-	    block->h += fsize + 2;
-            xx       = margins.current();
-          }
-	  else if (buf.cmp("/PRE"))
-	  {
-	    pre = 0;
-	    hh  = 0;
-	  }
-	  else if (buf.cmp("/CENTER"))
-	    talign = LEFT;
+	if (name == HV_TH)
+	  font = textfont_ | FL_BOLD;
+	else
+	  font = textfont_;
 
-          popfont(font, fsize, fcolor);
+	fsize = textsize_;
 
-	  //#if defined(__GNUC__)
-          //#warning FIXME this isspace & 255 test will probably not work on a utf8 stream... And we use it everywhere!
-	  //#endif /*__GNUC__*/
-          while (isspace((*ptr)&255))
-	    ptr ++;
+	xx = blocks_[row].x + fsize + 3 + table_offset;
+	for (i = 0; i < column; i ++)
+	  xx += columns[i] + 6;
 
-          block->h += hh;
-          yy       += hh;
+	margins.push(xx - margins.current());
 
-          if (tolower(buf[2]) == 'l')
-            yy += fsize + 2;
+	if (get_attr(attrs, "COLSPAN", attr, sizeof(attr)) != NULL)
+	  colspan = atoi(attr);
+	else
+	  colspan = 1;
 
-          if (row)
-	    block = add_block(ptr, xx, yy, block->w, 0);
-	  else
-	    block = add_block(ptr, xx, yy, hsize_, 0);
+	for (i = 0, ww = -6; i < colspan; i ++)
+	  ww += columns[column + i] + 6;
 
-	  needspace = 0;
-	  hh        = 0;
-	  line      = 0;
-	  newalign  = talign;
-	}
-	else if (buf.cmp("TR"))
-	{
-          block->end = start;
-          line       = do_align(block, line, xx, newalign, links);
-          xx         = block->x;
-          block->h   += hh;
+	// Remove an empty block, but not the first block of the document...
+	if (block->end == block->start && (nblocks_ > 1 || first > 0))
+	  nblocks_ --;
 
-          if (row)
-	  {
-            yy = blocks_[row].y + blocks_[row].h;
+	pushfont(font, fsize);
 
-	    for (cell = blocks_ + row + 1; cell <= block; cell ++)
-	      if ((cell->y + cell->h) > yy)
-		yy = cell->y + cell->h;
+	yy        = blocks_[row].y;
+	hh        = 0;
+	block     = add_block(start, xx, yy, xx + ww, 0, border);
+	needspace = 0;
+	line      = 0;
+	newalign  = get_align(attrs, name == HV_TH ? CENTER : LEFT);
+	talign    = newalign;
 
-            block = blocks_ + row;
+	cells[column] = (int) (block - blocks_);
 
-            block->h = yy - block->y + 2;
+	column += colspan;
 
-	    for (i = 0; i < column; i ++)
-	      if (cells[i])
-	      {
-		cell = blocks_ + cells[i];
-		cell->h = block->h;
-	      }
+	block->bgcolor = get_color(get_attr(attrs, "BGCOLOR", attr,
+					    sizeof(attr)), rc);
+      }
+      else if ((name == (HV_TD | HV_CLOSE) || name == (HV_TH | HV_CLOSE)) && row >= 0)
+      {
+	line = do_align(block, line, xx, newalign, links);
+	popfont(font, fsize, fcolor);
+	xx = margins.pop();
+	talign = LEFT;
+      }
+      else if (name == HV_FONT)
+      {
+	if (get_attr(attrs, "FACE", attr, sizeof(attr)) != NULL) {
+	  if (!strncasecmp(attr, "helvetica", 9) ||
+	      !strncasecmp(attr, "arial", 5) ||
+	      !strncasecmp(attr, "sans", 4)) font = FL_HELVETICA;
+	  else if (!strncasecmp(attr, "times", 5) ||
+		   !strncasecmp(attr, "serif", 5)) font = FL_TIMES;
+	  else if (!strncasecmp(attr, "symbol", 6)) font = FL_SYMBOL;
+	  else font = FL_COURIER;
+	}
+
+	if (get_attr(attrs, "SIZE", attr, sizeof(attr)) != NULL) {
+	  if (isdigit(attr[0] & 255)) {
+	    // Absolute size
+	    fsize = (int)(textsize_ * pow(1.2, atoi(attr) - 3.0));
+	  } else {
+	    // Relative size
+	    fsize = (int)(fsize * pow(1.2, atoi(attr)));
 	  }
+	}
 
-          memset(cells, 0, sizeof(cells));
+	pushfont(font, fsize);
+      }
+      else if (name == (HV_FONT | HV_CLOSE))
+	popfont(font, fsize, fcolor);
+      else if (name == HV_B || name == HV_STRONG)
+	pushfont(font |= FL_BOLD, fsize);
+      else if (name == HV_I || name == HV_EM)
+	pushfont(font |= FL_ITALIC, fsize);
+      else if (name == HV_CODE || name == HV_TT)
+	pushfont(font = FL_COURIER, fsize);
+      else if (name == HV_KBD)
+	pushfont(font = FL_COURIER_BOLD, fsize);
+      else if (name == HV_VAR)
+	pushfont(font = FL_COURIER_ITALIC, fsize);
+      else if (name == (HV_B | HV_CLOSE) || name == (HV_STRONG | HV_CLOSE) ||
+	       name == (HV_I | HV_CLOSE) || name == (HV_EM | HV_CLOSE) ||
+	       name == (HV_CODE | HV_CLOSE) || name == (HV_TT | HV_CLOSE) ||
+	       name == (HV_KBD | HV_CLOSE) || name == (HV_VAR | HV_CLOSE))
+	popfont(font, fsize, fcolor);
+      else if (name == HV_IMG)
+      {
+	Fl_Shared_Image	*img = 0;
+	int		width;
+	int		height;
 
-	  yy        = block->y + block->h - 4;
-	  hh        = 0;
-          block     = add_block(start, xx, yy, hsize_, 0);
-	  row       = (int) (block - blocks_);
-	  needspace = 0;
-	  column    = 0;
-	  line      = 0;
 
-          rc = get_color(get_attr(attrs, "BGCOLOR", attr, sizeof(attr)), tc);
+	get_attr(attrs, "WIDTH", wattr, sizeof(wattr));
+	get_attr(attrs, "HEIGHT", hattr, sizeof(hattr));
+	width  = get_length(wattr);
+	height = get_length(hattr);
+
+	if (get_attr(attrs, "SRC", attr, sizeof(attr))) {
+	  img    = get_image(attr, width, height);
+	  width  = img->w();
+	  height = img->h();
 	}
-	else if (buf.cmp("/TR") && row)
-	{
-          line       = do_align(block, line, xx, newalign, links);
-          block->end = start;
-	  block->h   += hh;
-	  talign     = LEFT;
 
-          xx = blocks_[row].x;
-          yy = blocks_[row].y + blocks_[row].h;
+	ww = width;
 
-	  for (cell = blocks_ + row + 1; cell <= block; cell ++)
-	    if ((cell->y + cell->h) > yy)
-	      yy = cell->y + cell->h;
+	if (grow && ww > hsize_) {
+	  hsize_ = ww;
+	  done   = 0;
+	  break;
+	}
 
-          block = blocks_ + row;
+	if (needspace && xx > block->x)
+	  ww += space.width(font, fsize);
 
-          block->h = yy - block->y + 2;
+	if ((xx + ww) > block->w)
+	{
+	  line     = do_align(block, line, xx, newalign, links);
+	  xx       = block->x;
+	  yy       += hh;
+	  block->h += hh;
+	  hh       = 0;
+	}
 
-	  for (i = 0; i < column; i ++)
-	    if (cells[i])
-	    {
-	      cell = blocks_ + cells[i];
-	      cell->h = block->h;
-	    }
+	if (linkdest[0])
+	  add_link(linkdest, xx, yy-fsize, ww, height);
 
-	  yy        = block->y + block->h /*- 4*/;
-          block     = add_block(start, xx, yy, hsize_, 0);
-	  needspace = 0;
-	  row       = 0;
-	  line      = 0;
-	}
-	else if ((buf.cmp("TD") ||
-                  buf.cmp("TH")) && row)
-	{
-          int	colspan;		// COLSPAN attribute
+	xx += ww;
+	if ((height + 2) > hh)
+	  hh = height + 2;
 
+	needspace = 0;
+      }
+    }
+  }
 
-          line       = do_align(block, line, xx, newalign, links);
-          block->end = start;
-	  block->h   += hh;
+  if (done)
+  {
+    if (t->type != HV_END)
+    {
+      // Remove the first block of the next segment...
+      nblocks_ --;
+    }
+    else
+    {
+      do_align(block, line, xx, newalign, links);
 
-          if (buf.cmp("TH"))
-	    font = textfont_ | FL_BOLD;
-	  else
-	    font = textfont_;
+      block->end = t->start;
+      seg[-1].h     = yy + hh - seg[-1].y;
+      seg[-1].width = hsize_;
+      seg->y        = yy + hh;
+    }
 
-          fsize = textsize_;
+    // Move the segments after the formatted ones...
+    for (seg = segments_ + last; seg < segments_ + nsegments_; seg ++)
+      seg[1].y = seg->y + seg->h;
 
-          xx = blocks_[row].x + fsize + 3 + table_offset;
-	  for (i = 0; i < column; i ++)
-	    xx += columns[i] + 6;
+    size_          = segments_[nsegments_].y;
+    first_segment_ = first;
+    last_segment_  = last;
 
-          margins.push(xx - margins.current());
+    index_layout();
+  }
 
-          if (get_attr(attrs, "COLSPAN", attr, sizeof(attr)) != NULL)
-	    colspan = atoi(attr);
-	  else
-	    colspan = 1;
+  // Restore the colors at the end of the document for draw()...
+  seg        = segments_ + nsegments_;
+  bgcolor_   = seg->bgcolor;
+  textcolor_ = seg->textcolor;
+  linkcolor_ = seg->linkcolor;
+
+  return done;
+}
 
-          for (i = 0, ww = -6; i < colspan; i ++)
-	    ww += columns[column + i] + 6;
 
-          if (block->end == block->start && nblocks_ > 1)
-	  {
-	    nblocks_ --;
-	    block --;
-	  }
+/**
+  Formats the help text.
 
-	  pushfont(font, fsize);
+  The document is parsed and divided into segments once, see parse() and
+  find_segments(). Only the segments in view are laid out, see
+  format_view(), the heights of the other segments are estimated from
+  their text, or scaled from the height they had at another width.
+*/
+void Fl_Help_View::format() {
+  Fl_Help_Segment *seg;		// Current segment
+  int		lh,		// Height of a line
+		cw,		// Average width of a character
+		tw;		// Width of the text
+  Fl_Boxtype	b = box() ? box() : FL_DOWN_BOX;
+				// Box to draw...
 
-	  yy        = blocks_[row].y;
-	  hh        = 0;
-          block     = add_block(start, xx, yy, xx + ww, 0, border);
-	  needspace = 0;
-	  line      = 0;
-	  newalign  = get_align(attrs, tolower(buf[1]) == 'h' ? CENTER : LEFT);
-	  talign    = newalign;
+  DEBUG_FUNCTION(__LINE__,__FUNCTION__);
 
-          cells[column] = (int) (block - blocks_);
+  // Reset document width...
+  int scrollsize = scrollbar_size_ ? scrollbar_size_ : Fl::scrollbar_size();
+  hsize_ = w() - scrollsize - Fl::box_dw(b);
 
-	  column += colspan;
+  format_pending_ = 0;
+  format_width_   = w();
+  nblocks_        = 0;
+  nlinks_         = 0;
+  size_           = 0;
+  first_segment_  = 0;
+  last_segment_   = 0;
 
-          block->bgcolor = get_color(get_attr(attrs, "BGCOLOR", attr,
-	                                      sizeof(attr)), rc);
-	}
-	else if ((buf.cmp("/TD") ||
-                  buf.cmp("/TH")) && row)
-	{
-          line = do_align(block, line, xx, newalign, links);
-          popfont(font, fsize, fcolor);
-	  xx = margins.pop();
-	  talign = LEFT;
-	}
-	else if (buf.cmp("FONT"))
-	{
-          if (get_attr(attrs, "FACE", attr, sizeof(attr)) != NULL) {
-	    if (!strncasecmp(attr, "helvetica", 9) ||
-	        !strncasecmp(attr, "arial", 5) ||
-		!strncasecmp(attr, "sans", 4)) font = FL_HELVETICA;
-            else if (!strncasecmp(attr, "times", 5) ||
-	             !strncasecmp(attr, "serif", 5)) font = FL_TIMES;
-            else if (!strncasecmp(attr, "symbol", 6)) font = FL_SYMBOL;
-	    else font = FL_COURIER;
-          }
+  if (!value_) {
+    bgcolor_   = color();
+    textcolor_ = textcolor();
+    linkcolor_ = fl_contrast(FL_BLUE, color());
 
-          if (get_attr(attrs, "SIZE", attr, sizeof(attr)) != NULL) {
-            if (isdigit(attr[0] & 255)) {
-	      // Absolute size
-	      fsize = (int)(textsize_ * pow(1.2, atoi(attr) - 3.0));
-	    } else {
-	      // Relative size
-	      fsize = (int)(fsize * pow(1.2, atoi(attr)));
-	    }
-	  }
+    strcpy(title_, "Untitled");
+    return;
+  }
 
-          pushfont(font, fsize);
-	}
-	else if (buf.cmp("/FONT"))
-	  popfont(font, fsize, fcolor);
-	else if (buf.cmp("B") ||
-		 buf.cmp("STRONG"))
-	  pushfont(font |= FL_BOLD, fsize);
-	else if (buf.cmp("I") ||
-		 buf.cmp("EM"))
-	  pushfont(font |= FL_ITALIC, fsize);
-	else if (buf.cmp("CODE") ||
-		 buf.cmp("TT"))
-	  pushfont(font = FL_COURIER, fsize);
-	else if (buf.cmp("KBD"))
-	  pushfont(font = FL_COURIER_BOLD, fsize);
-	else if (buf.cmp("VAR"))
-	  pushfont(font = FL_COURIER_ITALIC, fsize);
-	else if (buf.cmp("/B") ||
-		 buf.cmp("/STRONG") ||
-		 buf.cmp("/I") ||
-		 buf.cmp("/EM") ||
-		 buf.cmp("/CODE") ||
-		 buf.cmp("/TT") ||
-		 buf.cmp("/KBD") ||
-		 buf.cmp("/VAR"))
-	  popfont(font, fsize, fcolor);
-	else if (buf.cmp("IMG"))
-	{
-	  Fl_Shared_Image	*img = 0;
-	  int		width;
-	  int		height;
+  // Parse the document and find the segments...
+  if (!tokens_)
+    parse();
 
+  // The stacks of the first segment are the left margin and the base font...
+  if (!segments_ || stacks_[1] != textfont_ ||
+      stacks_[2] != textsize_ || segments_->bgcolor != color() ||
+      segments_->textcolor != textcolor())
+    find_segments();
 
-	  get_attr(attrs, "WIDTH", wattr, sizeof(wattr));
-	  get_attr(attrs, "HEIGHT", hattr, sizeof(hattr));
-	  width  = get_length(wattr);
-	  height = get_length(hattr);
+  // Estimate the heights of the segments...
+  lh = textsize_ + 2;
+  cw = textsize_ / 2 + 1;
+  tw = hsize_ > 4 * lh ? hsize_ : 4 * lh;
 
-	  if (get_attr(attrs, "SRC", attr, sizeof(attr))) {
-	    img    = get_image(attr, width, height);
-	    width  = img->w();
-	    height = img->h();
-	  }
+  for (seg = segments_; seg < segments_ + nsegments_; seg ++) {
+    int fixed = seg->lines * lh;
 
-	  ww = width;
+    if (!seg->width)
+      seg->h = fixed + (seg->chars * cw + tw - 1) / tw * lh;
+    else if (seg->width != tw && seg->h > fixed)
+      seg->h = fixed + (int)((double)(seg->h - fixed) * seg->width / tw);
 
-          if (ww > hsize_) {
-	    hsize_ = ww;
-	    done   = 0;
-	    break;
-	  }
+    seg->width = tw;
+  }
 
-	  if (needspace && xx > block->x)
-	    ww += (int)fl_width(' ');
+  segments_->y = textsize_ + 2;
+  for (seg = segments_; seg < segments_ + nsegments_; seg ++)
+    seg[1].y = seg->y + seg->h;
 
-	  if ((xx + ww) > block->w)
-	  {
-	    line     = do_align(block, line, xx, newalign, links);
-	    xx       = block->x;
-	    yy       += hh;
-	    block->h += hh;
-	    hh       = 0;
-	  }
+  size_ = segments_[nsegments_].y;
 
-	  if (linkdest[0])
-	    add_link(linkdest, xx, yy-fsize, ww, height);
+  format_view();
+}
 
-	  xx += ww;
-	  if ((height + 2) > hh)
-	    hh = height + 2;
 
-	  needspace = 0;
-	}
-	buf.clear();
-      }
-      else if (*ptr == '\n' && pre)
-      {
-	if (linkdest[0])
-	  add_link(linkdest, xx, yy - hh, ww, hh);
+/**
+  Internal: formats the segments in view.
 
-        if (xx > hsize_) {
-	  hsize_ = xx;
-          done   = 0;
-	  break;
-	}
+  When the view is scrolled up into segments whose height was estimated,
+  the text that was at the top of the view stays in place.
+*/
+void Fl_Help_View::format_view() {
+  int	i,			// Looping var
+	pass,			// Formatting pass
+	first, last,		// Segments in view
+	anchor, anchor_y;	// First segment formatted before and its position
 
-	line      = do_align(block, line, xx, newalign, links);
-	xx        = block->x;
-	yy        += hh;
-	block->h  += hh;
-	needspace = 0;
-	ptr ++;
-      }
-      else if (isspace((*ptr)&255))
-      {
-	needspace = 1;
-	if ( pre ) {
-	  xx += (int)fl_width(' ');
-        }
-	ptr ++;
-      }
-      else if (*ptr == '&')
-      {
-        // Handle html '&' codes, eg. "&amp;"
-	ptr ++;
 
-        int qch = quote_char(ptr);
+  DEBUG_FUNCTION(__LINE__,__FUNCTION__);
 
-	if (qch < 0)
-	  buf.add('&');
-	else {
-	  buf.add(qch);
-	  ptr = strchr(ptr, ';') + 1;
-	}
+  anchor   = last_segment_ > first_segment_ ? first_segment_ : -1;
+  anchor_y = anchor >= 0 ? segments_[anchor].y : 0;
 
-	if ((fsize + 2) > hh)
-          hh = fsize + 2;
-      }
-      else
-      {
-        buf.add(*ptr++);
+  for (i = 0; i < 8; i ++) {
+    first = find_segment(topline_);
+    for (last = first + 1;
+         last < nsegments_ && segments_[last].y < topline_ + h();
+         last ++) {/*empty*/}
 
-	if ((fsize + 2) > hh)
-          hh = fsize + 2;
-      }
-    }
+    for (pass = 0; !format_segments(first, last, pass < HV_PASSES); pass ++) {/*empty*/}
 
-    if (buf.size() > 0 && !head)
-    {
-      ww = buf.width();
+    if (anchor > first && anchor < last && segments_[anchor].y != anchor_y) {
+      topline_ += segments_[anchor].y - anchor_y;
+      anchor_y = segments_[anchor].y;
+    } else if (last >= nsegments_ || segments_[last].y >= topline_ + h())
+      break;
+  }
 
-  //    printf("line = %d, xx = %d, ww = %d, block->x = %d, block->w = %d\n",
-  //	   line, xx, ww, block->x, block->w);
+  format_scrollbars();
+}
 
-      if (ww > hsize_) {
-	hsize_ = ww;
-	done   = 0;
-	break;
-      }
 
-      if (needspace && xx > block->x)
-	ww += (int)fl_width(' ');
+/**
+  Internal: formats the document if needed, or the segments in view if
+  the view was scrolled past the formatted ones.
+*/
+void Fl_Help_View::update_format() {
+  static int busy = 0;		// format_view() sets the scrollbars
 
-      if ((xx + ww) > block->w)
-      {
-	line     = do_align(block, line, xx, newalign, links);
-	xx       = block->x;
-	yy       += hh;
-	block->h += hh;
-	hh       = 0;
-      }
+  if (format_pending_)
+    format();
 
-      if (linkdest[0])
-	add_link(linkdest, xx, yy - fsize, ww, fsize);
+  if (busy || !segments_)
+    return;
 
-      xx += ww;
-    }
+  busy = 1;
 
-    do_align(block, line, xx, newalign, links);
+  for (int i = 0; i < 4; i ++) {
+    if ((first_segment_ == 0 || segments_[first_segment_].y <= topline_) &&
+        last_segment_ > first_segment_ &&
+        (last_segment_ >= nsegments_ || segments_[last_segment_].y >= topline_ + h()))
+      break;
 
-    block->end = ptr;
-    size_      = yy + hh;
+    format_view();
   }
 
-//  printf("margins.depth_=%d\n", margins.depth_);
-
-  if (ntargets_ > 1)
-    qsort(targets_, ntargets_, sizeof(Fl_Help_Target),
-          (compare_func_t)compare_targets);
+  busy = 0;
+}
 
+
+/** Shows, hides and positions the scrollbars for the current document size. */
+void Fl_Help_View::format_scrollbars() {
+  Fl_Boxtype	b = box() ? box() : FL_DOWN_BOX;
+				// Box to draw...
   int dx = Fl::box_dw(b) - Fl::box_dx(b);
   int dy = Fl::box_dh(b) - Fl::box_dy(b);
   int ss = scrollbar_size_ ? scrollbar_size_ : Fl::scrollbar_size();
@@ -2057,11 +2961,82 @@ void Fl_Help_View::format() {
 }
 
 
-/** Formats a table */
+/**
+  Internal: builds the search keys used by find_block() and find_link().
+
+  Blocks and links are stored in document order, but their y positions
+  are not sorted: the cells of a table row all start at the row's y,
+  after the contents of the previous cell. ymax is the largest bottom
+  of an entry and all entries before it and ymin the smallest top of
+  an entry and all entries after it, so both are sorted and the entries
+  that intersect a range of lines can be found with a binary search.
+*/
+void Fl_Help_View::index_layout() {
+  int i, ymax, ymin;
+
+  for (i = 0, ymax = 0; i < nblocks_; i ++) {
+    if (blocks_[i].y + blocks_[i].h > ymax) ymax = blocks_[i].y + blocks_[i].h;
+    blocks_[i].ymax = ymax;
+  }
+  for (i = nblocks_ - 1, ymin = size_; i >= 0; i --) {
+    if (blocks_[i].y < ymin) ymin = blocks_[i].y;
+    blocks_[i].ymin = ymin;
+  }
+
+  // Note: Fl_Help_Link::h is the bottom of the link, not its height
+  for (i = 0, ymax = 0; i < nlinks_; i ++) {
+    if (links_[i].h > ymax) ymax = links_[i].h;
+    links_[i].ymax = ymax;
+  }
+  for (i = nlinks_ - 1, ymin = size_; i >= 0; i --) {
+    if (links_[i].y < ymin) ymin = links_[i].y;
+    links_[i].ymin = ymin;
+  }
+}
+
+
+/**
+  Internal: returns the index of the first block that ends at or below
+  line \p yy, or nblocks_ if there is none.
+*/
+int Fl_Help_View::find_block(int yy) const {
+  int lo = 0, hi = nblocks_;
+  while (lo < hi) {
+    int mid = (lo + hi) / 2;
+    if (blocks_[mid].ymax < yy) lo = mid + 1;
+    else hi = mid;
+  }
+  return lo;
+}
+
+
+/**
+  Internal: returns the index of the segment that contains line \p yy.
+*/
+int Fl_Help_View::find_segment(int yy) const {
+  int lo = 0, hi = nsegments_ - 1;
+  while (lo < hi) {
+    int mid = (lo + hi + 1) / 2;
+    if (segments_[mid].y <= yy) lo = mid;
+    else hi = mid - 1;
+  }
+  return lo;
+}
+
+
+/**
+  Formats a table.
+
+  The column widths only depend on the fonts, and on the width of the
+  view if a cell uses a relative width, so they are kept in a small cache
+  and only the scaling to the width of the view is done for each layout.
+*/
 void
 Fl_Help_View::format_table(int        *table_width,	// O - Total table width
                            int        *columns,		// O - Column widths
-	                   const char *table)		// I - Pointer to start of table
+	                   int        table,		// I - Token of the table
+			   Fl_Font    font,		// I - Font at the table
+			   Fl_Fontsize fsize)		// I - Font size at the table
 {
   int		column,					// Current column
 		num_columns,				// Number of columns
@@ -2071,326 +3046,292 @@ Fl_Help_View::format_table(int        *table_width,	// O - Total table width
 		max_width,				// Maximum width
 		incell,					// In a table cell?
 		pre,					// <PRE> text?
-		needspace;				// Need whitespace?
-  HV_Edit_Buffer buf;					// Text buffer
+		needspace,				// Need whitespace?
+		name,					// Element name
+		key,					// Default font and size
+		relative;				// Are widths relative to the view?
   char		attr[1024],				// Other attribute
 		wattr[1024],				// WIDTH attribute
 		hattr[1024];				// HEIGHT attribute
-  const char	*ptr,					// Pointer into table
-		*attrs,					// Pointer to attributes
-		*start;					// Start of element
-  int		minwidths[MAX_COLUMNS];			// Minimum widths for each column
-  Fl_Font       font;
-  Fl_Fontsize   fsize;				        // Current font and size
+  Fl_Help_Token	*t;					// Current token
+  const char	*ptr,					// Pointer into whitespace
+		*attrs;					// Pointer to attributes
+  int		*minwidths;				// Minimum widths for each column
   Fl_Color      fcolor;                                 // Currrent font color
+  Fl_Help_Font_Stack fstack;				// Fonts in the table
+  HV_Space	space;					// Width of a space
+  HV_Table	*cache;					// Cached column widths
 
   DEBUG_FUNCTION(__LINE__,__FUNCTION__);
 
-  // Clear widths...
-  *table_width = 0;
-  for (column = 0; column < MAX_COLUMNS; column ++)
-  {
-    columns[column]   = 0;
-    minwidths[column] = 0;
-  }
-
-  num_columns = 0;
-  colspan     = 0;
-  max_width   = 0;
-  pre         = 0;
-  needspace   = 0;
-  fstack_.top(font, fsize, fcolor);
-
-  // Scan the table...
-  for (ptr = table, column = -1, width = 0, incell = 0; *ptr;)
-  {
-    if ((*ptr == '<' || isspace((*ptr)&255)) && buf.size() > 0 && incell)
-    {
-      // Check width...
-      if (needspace)
-      {
-	buf.add(' ');
-	needspace = 0;
-      }
+  // See if the column widths are known...
+  key = (textfont_ << 16) | textsize_;
 
-      temp_width = buf.width();
-      buf.clear();
+  for (cache = table_cache; cache < table_cache + sizeof(table_cache) / sizeof(table_cache[0]); cache ++)
+    if (cache->view == this && cache->table == table && cache->key == key &&
+        (cache->hsize < 0 || cache->hsize == hsize_)) break;
 
-      if (temp_width > minwidths[column])
-        minwidths[column] = temp_width;
+  if (cache >= table_cache + sizeof(table_cache) / sizeof(table_cache[0])) {
+    cache = table_cache + table_next;
+    table_next = (table_next + 1) % (int)(sizeof(table_cache) / sizeof(table_cache[0]));
 
-      width += temp_width;
+    minwidths = cache->minwidths;
 
-      if (width > max_width)
-        max_width = width;
+    // Clear widths...
+    for (column = 0; column < MAX_COLUMNS; column ++)
+    {
+      cache->columns[column] = 0;
+      minwidths[column]      = 0;
     }
 
-    if (*ptr == '<')
+    num_columns = 0;
+    colspan     = 0;
+    max_width   = 0;
+    pre         = 0;
+    needspace   = 0;
+    relative    = 0;
+    fstack.init(font, fsize, textcolor_);
+
+    // Scan the table...
+    for (t = tokens_ + table, column = -1, width = 0, incell = 0; t->type != HV_END; t ++)
     {
-      start = ptr;
+      if (t->type == HV_WORD)
+      {
+	// The last word of the document is not measured...
+	if (!t->start[t->length])
+	  break;
 
-      for (buf.clear(), ptr ++; *ptr && *ptr != '>' && !isspace((*ptr)&255);)
-	buf.add(*ptr++);
+	if (incell)
+	{
+	  // Check width...
+	  temp_width = token_width(t, font, fsize);
 
-      attrs = ptr;
-      while (*ptr && *ptr != '>')
-        ptr ++;
+	  if (needspace)
+	  {
+	    temp_width += space.width(font, fsize);
+	    needspace  = 0;
+	  }
 
-      if (*ptr == '>')
-        ptr ++;
+	  if (temp_width > minwidths[column])
+	    minwidths[column] = temp_width;
 
-      if (buf.cmp("BR") ||
-	  buf.cmp("HR"))
-      {
-        width     = 0;
-	needspace = 0;
-      }
-      else if (buf.cmp("TABLE") && start > table)
-        break;
-      else if (buf.cmp("CENTER") ||
-               buf.cmp("P") ||
-               buf.cmp("H1") ||
-	       buf.cmp("H2") ||
-	       buf.cmp("H3") ||
-	       buf.cmp("H4") ||
-	       buf.cmp("H5") ||
-	       buf.cmp("H6") ||
-	       buf.cmp("UL") ||
-	       buf.cmp("OL") ||
-	       buf.cmp("DL") ||
-	       buf.cmp("LI") ||
-	       buf.cmp("DD") ||
-	       buf.cmp("DT") ||
-	       buf.cmp("PRE"))
-      {
-        width     = 0;
-	needspace = 0;
+	  width += temp_width;
 
-        if (tolower(buf[0]) == 'h' && isdigit(buf[1]))
-	{
-	  font  = FL_HELVETICA_BOLD;
-	  fsize = textsize_ + '7' - buf[1];
-	}
-	else if (buf.cmp("DT"))
-	{
-	  font  = textfont_ | FL_ITALIC;
-	  fsize = textsize_;
+	  if (width > max_width)
+	    max_width = width;
 	}
-	else if (buf.cmp("PRE"))
-	{
-	  font  = FL_COURIER;
-	  fsize = textsize_;
-	  pre   = 1;
-	}
-	else if (buf.cmp("LI"))
-	{
-	  width  += 4 * fsize;
-	  font   = textfont_;
-	  fsize  = textsize_;
-	}
-	else
-	{
-	  font  = textfont_;
-	  fsize = textsize_;
-	}
-
-	pushfont(font, fsize);
-      }
-      else if (buf.cmp("/CENTER") ||
-	       buf.cmp("/P") ||
-	       buf.cmp("/H1") ||
-	       buf.cmp("/H2") ||
-	       buf.cmp("/H3") ||
-	       buf.cmp("/H4") ||
-	       buf.cmp("/H5") ||
-	       buf.cmp("/H6") ||
-	       buf.cmp("/PRE") ||
-	       buf.cmp("/UL") ||
-	       buf.cmp("/OL") ||
-	       buf.cmp("/DL"))
-      {
-        width     = 0;
-	needspace = 0;
-
-        popfont(font, fsize, fcolor);
       }
-      else if (buf.cmp("TR") || buf.cmp("/TR") ||
-               buf.cmp("/TABLE"))
+      else if (t->type != HV_ELEMENT)
       {
-//        printf("%s column = %d, colspan = %d, num_columns = %d\n",
-//	       buf.c_str(), column, colspan, num_columns);
-
-        if (column >= 0)
+	for (ptr = t->start; ptr < t->start + t->length; ptr ++)
 	{
-	  // This is a hack to support COLSPAN...
-	  max_width /= colspan;
-
-	  while (colspan > 0)
+	  if (*ptr == '\n' && pre)
 	  {
-	    if (max_width > columns[column])
-	      columns[column] = max_width;
-
-	    column ++;
-	    colspan --;
+	    width     = 0;
+	    needspace = 0;
 	  }
+	  else
+	    needspace = 1;
 	}
-
-	if (buf.cmp("/TABLE"))
-	  break;
-
-	needspace = 0;
-	column    = -1;
-	width     = 0;
-	max_width = 0;
-	incell    = 0;
       }
-      else if (buf.cmp("TD") ||
-               buf.cmp("TH"))
+      else
       {
-//        printf("BEFORE column = %d, colspan = %d, num_columns = %d\n",
-//	       column, colspan, num_columns);
+	attrs = element_attrs(t);
+	name  = t->name;
 
-        if (column >= 0)
+	if (name == HV_BR || name == HV_HR)
+	{
+	  width     = 0;
+	  needspace = 0;
+	}
+	else if (name == HV_TABLE && t > tokens_ + table)
+	  break;
+	else if (block_element(name) && name != HV_TABLE)
 	{
-	  // This is a hack to support COLSPAN...
-	  max_width /= colspan;
+	  width     = 0;
+	  needspace = 0;
 
-	  while (colspan > 0)
+	  if (name >= HV_H1 && name <= HV_H6)
 	  {
-	    if (max_width > columns[column])
-	      columns[column] = max_width;
-
-	    column ++;
-	    colspan --;
+	    font  = FL_HELVETICA_BOLD;
+	    fsize = textsize_ + HV_H1 + 6 - name;
+	  }
+	  else if (name == HV_DT)
+	  {
+	    font  = textfont_ | FL_ITALIC;
+	    fsize = textsize_;
+	  }
+	  else if (name == HV_PRE)
+	  {
+	    font  = FL_COURIER;
+	    fsize = textsize_;
+	    pre   = 1;
+	  }
+	  else if (name == HV_LI)
+	  {
+	    width  += 4 * fsize;
+	    font   = textfont_;
+	    fsize  = textsize_;
 	  }
+	  else
+	  {
+	    font  = textfont_;
+	    fsize = textsize_;
+	  }
+
+	  fstack.push(font, fsize, textcolor_);
 	}
-	else
-	  column ++;
+	else if (end_block_element(name) && name != (HV_TABLE | HV_CLOSE))
+	{
+	  width     = 0;
+	  needspace = 0;
 
-        if (get_attr(attrs, "COLSPAN", attr, sizeof(attr)) != NULL)
-	  colspan = atoi(attr);
-	else
-	  colspan = 1;
+	  fstack.pop(font, fsize, fcolor);
+	}
+	else if (name == HV_TR || name == (HV_TR | HV_CLOSE) ||
+		 name == (HV_TABLE | HV_CLOSE))
+	{
+	  if (column >= 0)
+	  {
+	    // This is a hack to support COLSPAN...
+	    max_width /= colspan;
+
+	    while (colspan > 0)
+	    {
+	      if (max_width > cache->columns[column])
+		cache->columns[column] = max_width;
 
-//        printf("AFTER column = %d, colspan = %d, num_columns = %d\n",
-//	       column, colspan, num_columns);
+	      column ++;
+	      colspan --;
+	    }
+	  }
 
-        if ((column + colspan) >= num_columns)
-	  num_columns = column + colspan;
+	  if (name == (HV_TABLE | HV_CLOSE))
+	    break;
 
-	needspace = 0;
-	width     = 0;
-	incell    = 1;
+	  needspace = 0;
+	  column    = -1;
+	  width     = 0;
+	  max_width = 0;
+	  incell    = 0;
+	}
+	else if (name == HV_TD || name == HV_TH)
+	{
+	  if (column >= 0)
+	  {
+	    // This is a hack to support COLSPAN...
+	    max_width /= colspan;
 
-        if (buf.cmp("TH"))
-	  font = textfont_ | FL_BOLD;
-	else
-	  font = textfont_;
+	    while (colspan > 0)
+	    {
+	      if (max_width > cache->columns[column])
+		cache->columns[column] = max_width;
 
-        fsize = textsize_;
+	      column ++;
+	      colspan --;
+	    }
+	  }
+	  else
+	    column ++;
 
-	pushfont(font, fsize);
+	  if (get_attr(attrs, "COLSPAN", attr, sizeof(attr)) != NULL)
+	    colspan = atoi(attr);
+	  else
+	    colspan = 1;
 
-        if (get_attr(attrs, "WIDTH", attr, sizeof(attr)) != NULL)
-	  max_width = get_length(attr);
-	else
-	  max_width = 0;
+	  if ((column + colspan) >= num_columns)
+	    num_columns = column + colspan;
 
-//        printf("max_width = %d\n", max_width);
-      }
-      else if (buf.cmp("/TD") ||
-               buf.cmp("/TH"))
-      {
-	incell = 0;
-        popfont(font, fsize, fcolor);
-      }
-      else if (buf.cmp("B") ||
-               buf.cmp("STRONG"))
-	pushfont(font |= FL_BOLD, fsize);
-      else if (buf.cmp("I") ||
-               buf.cmp("EM"))
-	pushfont(font |= FL_ITALIC, fsize);
-      else if (buf.cmp("CODE") ||
-               buf.cmp("TT"))
-	pushfont(font = FL_COURIER, fsize);
-      else if (buf.cmp("KBD"))
-	pushfont(font = FL_COURIER_BOLD, fsize);
-      else if (buf.cmp("VAR"))
-	pushfont(font = FL_COURIER_ITALIC, fsize);
-      else if (buf.cmp("/B") ||
-	       buf.cmp("/STRONG") ||
-	       buf.cmp("/I") ||
-	       buf.cmp("/EM") ||
-	       buf.cmp("/CODE") ||
-	       buf.cmp("/TT") ||
-	       buf.cmp("/KBD") ||
-	       buf.cmp("/VAR"))
-	popfont(font, fsize, fcolor);
-      else if (buf.cmp("IMG") && incell)
-      {
-	Fl_Shared_Image	*img = 0;
-	int		iwidth, iheight;
+	  needspace = 0;
+	  width     = 0;
+	  incell    = 1;
+
+	  if (name == HV_TH)
+	    font = textfont_ | FL_BOLD;
+	  else
+	    font = textfont_;
 
+	  fsize = textsize_;
 
-        get_attr(attrs, "WIDTH", wattr, sizeof(wattr));
-        get_attr(attrs, "HEIGHT", hattr, sizeof(hattr));
-	iwidth  = get_length(wattr);
-	iheight = get_length(hattr);
+	  fstack.push(font, fsize, textcolor_);
 
-        if (get_attr(attrs, "SRC", attr, sizeof(attr))) {
-	  img     = get_image(attr, iwidth, iheight);
-	  iwidth  = img->w();
-	  iheight = img->h();
+	  if (get_attr(attrs, "WIDTH", attr, sizeof(attr)) != NULL) {
+	    max_width = get_length(attr);
+	    if (attr[0] && attr[strlen(attr) - 1] == '%') relative = 1;
+	  } else
+	    max_width = 0;
+	}
+	else if (name == (HV_TD | HV_CLOSE) || name == (HV_TH | HV_CLOSE))
+	{
+	  incell = 0;
+	  fstack.pop(font, fsize, fcolor);
 	}
+	else if (name == HV_B || name == HV_STRONG)
+	  fstack.push(font |= FL_BOLD, fsize, textcolor_);
+	else if (name == HV_I || name == HV_EM)
+	  fstack.push(font |= FL_ITALIC, fsize, textcolor_);
+	else if (name == HV_CODE || name == HV_TT)
+	  fstack.push(font = FL_COURIER, fsize, textcolor_);
+	else if (name == HV_KBD)
+	  fstack.push(font = FL_COURIER_BOLD, fsize, textcolor_);
+	else if (name == HV_VAR)
+	  fstack.push(font = FL_COURIER_ITALIC, fsize, textcolor_);
+	else if (name == (HV_B | HV_CLOSE) || name == (HV_STRONG | HV_CLOSE) ||
+		 name == (HV_I | HV_CLOSE) || name == (HV_EM | HV_CLOSE) ||
+		 name == (HV_CODE | HV_CLOSE) || name == (HV_TT | HV_CLOSE) ||
+		 name == (HV_KBD | HV_CLOSE) || name == (HV_VAR | HV_CLOSE))
+	  fstack.pop(font, fsize, fcolor);
+	else if (name == HV_IMG && incell)
+	{
+	  Fl_Shared_Image	*img = 0;
+	  int		iwidth, iheight;
 
-	if (iwidth > minwidths[column])
-          minwidths[column] = iwidth;
 
-        width += iwidth;
-	if (needspace)
-	  width += (int)fl_width(' ');
+	  get_attr(attrs, "WIDTH", wattr, sizeof(wattr));
+	  get_attr(attrs, "HEIGHT", hattr, sizeof(hattr));
+	  iwidth  = get_length(wattr);
+	  iheight = get_length(hattr);
+
+	  if ((wattr[0] && wattr[strlen(wattr) - 1] == '%') ||
+	      (hattr[0] && hattr[strlen(hattr) - 1] == '%')) relative = 1;
 
-	if (width > max_width)
-          max_width = width;
+	  if (get_attr(attrs, "SRC", attr, sizeof(attr))) {
+	    img     = get_image(attr, iwidth, iheight);
+	    iwidth  = img->w();
+	    iheight = img->h();
+	  }
 
-	needspace = 0;
-      }
-      buf.clear();
-    }
-    else if (*ptr == '\n' && pre)
-    {
-      width     = 0;
-      needspace = 0;
-      ptr ++;
-    }
-    else if (isspace((*ptr)&255))
-    {
-      needspace = 1;
+	  if (iwidth > minwidths[column])
+	    minwidths[column] = iwidth;
 
-      ptr ++;
-    }
-    else if (*ptr == '&' )
-    {
-      ptr ++;
+	  width += iwidth;
+	  if (needspace)
+	    width += space.width(font, fsize);
 
-      int qch = quote_char(ptr);
+	  if (width > max_width)
+	    max_width = width;
 
-      if (qch < 0)
-	buf.add('&');
-      else {
-	buf.add(qch);
-	ptr = strchr(ptr, ';') + 1;
+	  needspace = 0;
+	}
       }
     }
-    else
-    {
-      buf.add(*ptr++);
-    }
+
+    cache->view        = this;
+    cache->table       = table;
+    cache->key         = key;
+    cache->hsize       = relative ? hsize_ : -1;
+    cache->num_columns = num_columns;
   }
 
   // Now that we have scanned the entire table, adjust the table and
   // cell widths to fit on the screen...
-  if (get_attr(table + 6, "WIDTH", attr, sizeof(attr)))
+  num_columns = cache->num_columns;
+  minwidths   = cache->minwidths;
+
+  for (column = 0; column < MAX_COLUMNS; column ++)
+    columns[column] = cache->columns[column];
+
+  if (get_attr(tokens_[table].start + 6, "WIDTH", attr, sizeof(attr)))
     *table_width = get_length(attr);
   else
     *table_width = 0;
@@ -2484,68 +3425,37 @@ void
 Fl_Help_View::free_data() {
   // Release all images...
   if (value_) {
-    const char	*ptr,		// Pointer into block
-		*attrs;		// Pointer to start of element attributes
-    HV_Edit_Buffer buf;		// Text buffer
+    Fl_Help_Token *t;		// Current token
+    const char	*attrs;		// Pointer to start of element attributes
     char	attr[1024],	// Attribute buffer
 		wattr[1024],	// Width attribute buffer
 		hattr[1024];	// Height attribute buffer
 
     DEBUG_FUNCTION(__LINE__,__FUNCTION__);
 
-    for (ptr = value_; *ptr;)
+    for (t = tokens_; t && t->type != HV_END; t ++)
     {
-      if (*ptr == '<')
+      if (t->type == HV_ELEMENT && t->name == HV_IMG)
       {
-	ptr ++;
-
-        if (strncmp(ptr, "!--", 3) == 0)
-	{
-	  // Comment...
-	  ptr += 3;
-	  if ((ptr = strstr(ptr, "-->")) != NULL)
-	  {
-	    ptr += 3;
-	    continue;
-	  }
-	  else
-	    break;
-	}
-
-        buf.clear();
-
-	while (*ptr && *ptr != '>' && !isspace((*ptr)&255))
-	  buf.add(*ptr++);
-
-	attrs = ptr;
-	while (*ptr && *ptr != '>')
-          ptr ++;
-
-	if (*ptr == '>')
-          ptr ++;
-
-	if (buf.cmp("IMG"))
-	{
-	  Fl_Shared_Image	*img;
-	  int		width;
-	  int		height;
-
-          get_attr(attrs, "WIDTH", wattr, sizeof(wattr));
-          get_attr(attrs, "HEIGHT", hattr, sizeof(hattr));
-	  width  = get_length(wattr);
-	  height = get_length(hattr);
-
-	  if (get_attr(attrs, "SRC", attr, sizeof(attr))) {
-	    // Get and release the image to free it from memory...
-	    img = get_image(attr, width, height);
-	    if ((void*)img != &broken_image) {
-	      img->release();
-	    }
+	Fl_Shared_Image	*img;
+	int		width;
+	int		height;
+
+	attrs = element_attrs(t);
+
+	get_attr(attrs, "WIDTH", wattr, sizeof(wattr));
+	get_attr(attrs, "HEIGHT", hattr, sizeof(hattr));
+	width  = get_length(wattr);
+	height = get_length(hattr);
+
+	if (get_attr(attrs, "SRC", attr, sizeof(attr))) {
+	  // Get and release the image to free it from memory...
+	  img = get_image(attr, width, height);
+	  if ((void*)img != &broken_image) {
+	    img->release();
 	  }
 	}
       }
-      else
-        ptr ++;
     }
 
     free((void *)value_);
@@ -2553,7 +3463,7 @@ Fl_Help_View::free_data() {
   }
 
   // Free all of the arrays...
-  if (nblocks_) {
+  if (blocks_) {
     free(blocks_);
 
     ablocks_ = 0;
@@ -2561,7 +3471,7 @@ Fl_Help_View::free_data() {
     blocks_  = 0;
   }
 
-  if (nlinks_) {
+  if (links_) {
     free(links_);
 
     alinks_ = 0;
@@ -2569,13 +3479,43 @@ Fl_Help_View::free_data() {
     links_  = 0;
   }
 
-  if (ntargets_) {
+  if (targets_) {
     free(targets_);
 
     atargets_ = 0;
     ntargets_ = 0;
     targets_  = 0;
   }
+
+  if (tokens_) {
+    free(tokens_);
+
+    atokens_ = 0;
+    ntokens_ = 0;
+    tokens_  = 0;
+  }
+
+  if (segments_) {
+    free(segments_);
+
+    asegments_     = 0;
+    nsegments_     = 0;
+    segments_      = 0;
+    first_segment_ = 0;
+    last_segment_  = 0;
+  }
+
+  if (stacks_) {
+    free(stacks_);
+
+    astacks_ = 0;
+    nstacks_ = 0;
+    stacks_  = 0;
+  }
+
+  // Forget the column widths of the tables...
+  for (int i = 0; i < (int)(sizeof(table_cache) / sizeof(table_cache[0])); i ++)
+    if (table_cache[i].view == this) table_cache[i].view = 0;
 } // free_data()
 
 /** Gets an alignment attribute. */
@@ -2849,14 +3789,22 @@ Fl_Help_View::get_length(const char *l) {	// I - Value
 
 Fl_Help_Link *Fl_Help_View::find_link(int xx, int yy)
 {
-  int		i;
+  int		lo, hi;
   Fl_Help_Link	*linkp;
-  for (i = nlinks_, linkp = links_; i > 0; i --, linkp ++) {
+
+  // Find the first link that may contain yy (see index_layout())...
+  for (lo = 0, hi = nlinks_; lo < hi;) {
+    int mid = (lo + hi) / 2;
+    if (links_[mid].ymax <= yy) lo = mid + 1;
+    else hi = mid;
+  }
+
+  for (linkp = links_ + lo; lo < nlinks_ && linkp->ymin <= yy; lo ++, linkp ++) {
     if (xx >= linkp->x && xx < linkp->w &&
         yy >= linkp->y && yy < linkp->h)
-      break;
+      return linkp;
   }
-  return i ? linkp : 0L;
+  return 0L;
 }
 
 void Fl_Help_View::follow_link(Fl_Help_Link *linkp)
@@ -3123,6 +4071,8 @@ Fl_Help_View::handle(int event)	// I - Event to handle
 {
   static Fl_Help_Link *linkp;   // currently clicked link
 
+  update_format();
+
   int xx = Fl::event_x() - x() + leftline_;
   int yy = Fl::event_y() - y() + topline_;
 
@@ -3242,6 +4192,20 @@ Fl_Help_View::Fl_Help_View(int        xx,	// I - Left position
   ntargets_     = 0;
   targets_      = (Fl_Help_Target *)0;
 
+  atokens_      = 0;
+  ntokens_      = 0;
+  tokens_       = (Fl_Help_Token *)0;
+
+  asegments_    = 0;
+  nsegments_    = 0;
+  segments_     = (Fl_Help_Segment *)0;
+  first_segment_ = 0;
+  last_segment_ = 0;
+
+  astacks_      = 0;
+  nstacks_      = 0;
+  stacks_       = (int *)0;
+
   directory_[0] = '\0';
   filename_[0]  = '\0';
 
@@ -3250,6 +4214,8 @@ Fl_Help_View::Fl_Help_View(int        xx,	// I - Left position
   size_         = 0;
   hsize_        = 0;
   scrollbar_size_ = 0;
+  format_width_ = -1;
+  format_pending_ = 0;
 
   scrollbar_.value(0, hh, 0, 1);
   scrollbar_.step(8.0);
@@ -3426,7 +4392,29 @@ Fl_Help_View::resize(int xx,	// I - New left position
                      y() + h() - scrollsize - Fl::box_dh(b) + Fl::box_dy(b),
                      w() - scrollsize - Fl::box_dw(b), scrollsize);
 
-  format();
+  // The layout only depends on the width: defer reformatting to the next
+  // draw() so that interactive resizing formats once per redraw, and
+  // only update the scrollbars if the height changed.
+  if (w() != format_width_) {
+    format_pending_ = 1;
+    redraw();
+  } else if (!format_pending_) {
+    format_scrollbars();
+  }
+}
+
+
+/** Gets the height of the document in pixels.
+
+  Only the text in view is laid out, and the heights of the other parts
+  of the document are estimated from their text. The size is therefore
+  an estimate that changes while the document is scrolled, searched with
+  find(), or scrolled to a target with topline(const char*), as the
+  estimated parts are laid out.
+*/
+int Fl_Help_View::size() const {
+  ((Fl_Help_View *)this)->update_format();
+  return (size_);
 }
 
 
@@ -3439,7 +4427,12 @@ Fl_Help_View::topline(const char *n)	// I - Target name
 {
   Fl_Help_Target key,			// Target name key
 		*target;		// Pointer to matching target
+  int		seg,			// Segment of the target
+		pass,			// Formatting pass
+		lo, hi;			// Binary search range
+
 
+  update_format();
 
   if (ntargets_ == 0)
     return;
@@ -3449,8 +4442,22 @@ Fl_Help_View::topline(const char *n)	// I - Target name
   target = (Fl_Help_Target *)bsearch(&key, targets_, ntargets_, sizeof(Fl_Help_Target),
                                  (compare_func_t)compare_targets);
 
-  if (target != NULL)
+  if (target != NULL) {
+    // Format the segment of the target, and then the segments around it...
+    for (lo = 0, hi = nsegments_ - 1; lo < hi;) {
+      seg = (lo + hi + 1) / 2;
+      if (segments_[seg].first <= target->token) lo = seg;
+      else hi = seg - 1;
+    }
+    seg = lo;
+
+    if (seg < first_segment_ || seg >= last_segment_)
+      for (pass = 0; !format_segments(seg, seg + 1, pass < HV_PASSES); pass ++) {/*empty*/}
+
+    topline_ = target->y;
+    update_format();
     topline(target->y);
+  }
 }
 
 
@@ -3467,6 +4474,8 @@ Fl_Help_View::topline(int top)	// I - Top line number
   if (!value_)
     return;
 
+  update_format();
+
   int scrollsize = scrollbar_size_ ? scrollbar_size_ : Fl::scrollbar_size();
   if (size_ < (h() - scrollsize) || top < 0)
     top = 0;
@@ -3496,6 +4505,8 @@ Fl_Help_View::leftline(int left)	// I - Left position
   if (!value_)
     return;
 
+  update_format();
+
   int scrollsize = scrollbar_size_ ? scrollbar_size_ : Fl::scrollbar_size();
   if (hsize_ < (w() - scrollsize) || left < 0)
     left = 0;
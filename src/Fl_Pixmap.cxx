@@ -288,10 +288,8 @@ void Fl_Pixmap::color_average(Fl_Color c, float i) {
         g = (ia * g + ig) >> 8;
         b = (ia * b + ib) >> 8;
 
-        if (chars_per_pixel > 1) sprintf(line, "%c%c c #%02X%02X%02X",
-	                                 data()[color + 1][0],
-	                                 data()[color + 1][1], r, g, b);
-        else sprintf(line, "%c c #%02X%02X%02X", data()[color + 1][0], r, g, b);
+        snprintf(line, sizeof(line), "%.*s c #%02X%02X%02X", chars_per_pixel,
+                 data()[color + 1], r, g, b);
 
         delete[] (char *)data()[color + 1];
 	((char **)data())[color + 1] = new char[strlen(line) + 1];
@@ -301,8 +299,11 @@ void Fl_Pixmap::color_average(Fl_Color c, float i) {
   }
 }
 
+extern void fl_uncache_pixmap_colors(const char *const *cdata);
+
 void Fl_Pixmap::delete_data() {
   if (alloc_data) {
+    fl_uncache_pixmap_colors(data());
     for (int i = 0; i < count(); i ++) delete[] (char *)data()[i];
     delete[] (char **)data();
   }
@@ -364,9 +365,8 @@ void Fl_Pixmap::desaturate() {
       if (fl_parse_color(p, r, g, b)) {
         g = (uchar)((r * 31 + g * 61 + b * 8) / 100);
 
-        if (chars_per_pixel > 1) sprintf(line, "%c%c c #%02X%02X%02X", data()[i + 1][0],
-	                                 data()[i + 1][1], g, g, g);
-        else sprintf(line, "%c c #%02X%02X%02X", data()[i + 1][0], g, g, g);
+        snprintf(line, sizeof(line), "%.*s c #%02X%02X%02X", chars_per_pixel,
+                 data()[i + 1], g, g, g);
 
         delete[] (char *)data()[i + 1];
 	((char **)data())[i + 1] = new char[strlen(line) + 1];
@@ -27,6 +27,7 @@
 #include <stdarg.h>
 #include <FL/fl_utf8.h>
 #include "flstring.h"
+#include "fl_threads.h"
 
 
 char Fl_Preferences::nameBuffer[128];
@@ -744,6 +745,78 @@ void Fl_Preferences::flush() {
     rootNode->write();
 }
 
+/**
+ Writes all preferences to disk on a background thread.
+
+ The preferences are copied into memory right away, so they can be changed
+ again while the file is being written. If another flush of the same file
+ is still waiting, it is replaced by this newer copy. The file is written
+ synchronously if the platform does not support threads.
+
+ All pending writes are finished before flush() or the destructor of the
+ base preferences group write the file, and when the program exits.
+
+ \version 1.4.0
+ */
+void Fl_Preferences::flushInBackground() {
+  if ( rootNode && node->dirty() )
+    rootNode->write( 1 );
+}
+
+/**
+ Returns non-zero if any preferences in this database were changed since the
+ file was read or last written.
+
+ flush() and the destructor of the base preferences group write the file only
+ if this returns non-zero.
+
+ \version 1.4.0
+ */
+char Fl_Preferences::dirty() {
+  Node *nd = node;
+  while ( nd->parent() ) nd = nd->parent();
+  return nd->dirty();
+}
+
+/**
+ Sets the format of the preferences file.
+
+ Binary files are read into memory in one piece when the preferences are
+ opened, and groups are built from that copy only when they are used, so
+ opening even a large database costs little more than reading the file.
+ Entry names and values are used right from the copy until the file is
+ written again. The file is not mapped, so other processes, including older
+ FLTK versions, can rewrite it at any time.
+
+ The format is detected when the file is read, so any application can open
+ files in either format. Reading a binary file selects the binary format.
+ Changing the format marks the preferences as changed, so the next flush()
+ converts the file. The format applies to the whole database, not only to
+ this group.
+
+ \note FLTK versions before 1.4.0 can not read binary preferences files.
+
+ \param[in] fmt Fl_Preferences::TEXT or Fl_Preferences::BINARY
+ \version 1.4.0
+ */
+void Fl_Preferences::fileFormat( FileFormat fmt ) {
+  if ( rootNode && rootNode->format() != fmt ) {
+    rootNode->format( fmt );
+    Node *nd = node;
+    while ( nd->parent() ) nd = nd->parent();
+    nd->setDirty();
+  }
+}
+
+/**
+ Returns the format of the preferences file.
+ \see fileFormat(FileFormat)
+ \version 1.4.0
+ */
+Fl_Preferences::FileFormat Fl_Preferences::fileFormat() {
+  return rootNode ? rootNode->format() : TEXT;
+}
+
 //-----------------------------------------------------------------------------
 // helper class to create dynamic group and entry names on the fly
 //
@@ -801,13 +874,158 @@ Fl_Preferences::Name::~Name() {
 
 int Fl_Preferences::Node::lastEntrySet = -1;
 
+// the contents of a preferences file, assembled in memory before writing
+struct Fl_Preferences::Buffer {
+  char *data;
+  size_t size, alloc;
+  Buffer() : data(0L), size(0), alloc(0) { }
+  ~Buffer() { if ( data ) free( data ); }
+  void add( const char *s, size_t n ) {
+    if ( size + n > alloc ) {
+      alloc = alloc ? alloc*2 : 4096;
+      if ( alloc < size + n ) alloc = size + n;
+      data = (char*)realloc( data, alloc );
+    }
+    memcpy( data+size, s, n );
+    size += n;
+  }
+  void add( const char *s ) { add( s, strlen( s ) ); }
+  void add( char c ) { add( &c, 1 ); }
+  void add32( unsigned v ) {
+    char c[4] = { char(v), char(v>>8), char(v>>16), char(v>>24) };
+    add( c, 4 );
+  }
+  void set32( size_t pos, unsigned v ) {
+    data[pos] = char(v); data[pos+1] = char(v>>8);
+    data[pos+2] = char(v>>16); data[pos+3] = char(v>>24);
+  }
+  void align() { while ( size & 3 ) add( '\0' ); }
+};
+
+//
+// Binary preferences files. All numbers are 32 bit little endian, offsets
+// count from the start of the file, and strings end in a NUL byte.
+//
+//   header: "FLTKPREF", version (1), file size, offset of the root group
+//   group:  offset of the path, number of entries, number of children,
+//           size of the hash table (0 or a power of 2),
+//           entries (offset of the name, offset of the value or 0),
+//           offsets of the children (always after the group),
+//           hash table (entry index + 1 by prefs_hash() of the name, or 0)
+//
+// The file ends in a NUL byte, so every string in it is terminated.
+//
+static const char prefs_magic[8] = { 'F','L','T','K','P','R','E','F' };
+
+static unsigned prefs_get32( const char *p ) {
+  const unsigned char *u = (const unsigned char*)p;
+  return u[0] | ( u[1]<<8 ) | ( u[2]<<16 ) | ( (unsigned)u[3]<<24 );
+}
+
+// FNV-1a hash of the first 'len' bytes of a group or entry name
+static unsigned prefs_hash( const char *s, int len ) {
+  unsigned h = 2166136261U;
+  for ( int i = 0; i < len; i++ )
+    h = ( h ^ (unsigned char)s[i] ) * 16777619U;
+  return h;
+}
+
+//
+// Writing preferences files in the background. A single thread writes the
+// queued snapshots one after the other. Writing the same file again before
+// the thread got to it replaces the queued data.
+//
+
+struct Fl_Prefs_Write_Job {
+  Fl_Prefs_Write_Job *next;
+  char *filename, *data;
+  size_t size;
+};
+
+#if defined(FL_HAVE_INTERNAL_THREADS)
+
+static Fl_Internal_Mutex prefs_write_mutex;
+// not a static object: the writer thread keeps waiting for it at exit
+static Fl_Internal_Condition *prefs_write_cond = NULL;
+static Fl_Prefs_Write_Job *write_first = NULL, *write_last = NULL;
+static int write_busy = 0;
+static int writer_state = 0; // 0: not started, 1: running, -1: can't start
+
+static void *prefs_writer( void * ) {
+  Fl_Internal_Lock lock( prefs_write_mutex );
+  for (;;) {
+    while ( !write_first ) prefs_write_cond->wait( prefs_write_mutex );
+    Fl_Prefs_Write_Job *job = write_first;
+    write_first = job->next;
+    if ( !write_first ) write_last = NULL;
+    write_busy = 1;
+    prefs_write_mutex.unlock();
+    Fl::system_driver()->replace_file( job->filename, job->data, job->size );
+    free( job->filename );
+    free( job->data );
+    delete job;
+    prefs_write_mutex.lock();
+    write_busy = 0;
+    prefs_write_cond->broadcast();
+  }
+  return NULL;
+}
+
+// wait until all queued files are written
+static void prefs_write_wait() {
+  Fl_Internal_Lock lock( prefs_write_mutex );
+  while ( write_first || write_busy ) prefs_write_cond->wait( prefs_write_mutex );
+}
+
+// hand the buffer over to the writer thread, returns 0 if there is no such thread
+static int prefs_write_queue( const char *filename, Fl_Preferences::Buffer &b ) {
+  Fl_Internal_Lock lock( prefs_write_mutex );
+  if ( writer_state == 0 ) {
+    prefs_write_cond = new Fl_Internal_Condition;
+    Fl_Internal_Thread t;
+    writer_state = fl_thread_create( t, prefs_writer, NULL, 1 ) ? -1 : 1;
+    if ( writer_state > 0 ) atexit( prefs_write_wait );
+  }
+  if ( writer_state < 0 ) return 0;
+  Fl_Prefs_Write_Job *job;
+  for ( job = write_first; job; job = job->next ) {
+    if ( strcmp( job->filename, filename ) == 0 ) {
+      free( job->data );
+      break;
+    }
+  }
+  if ( !job ) {
+    job = new Fl_Prefs_Write_Job;
+    job->filename = strdup( filename );
+    job->next = NULL;
+    if ( write_last ) write_last->next = job;
+    else write_first = job;
+    write_last = job;
+  }
+  job->data = b.data;
+  job->size = b.size;
+  b.data = 0L;
+  prefs_write_cond->broadcast();
+  return 1;
+}
+
+#else
+
+static void prefs_write_wait() { }
+static int prefs_write_queue( const char *, Fl_Preferences::Buffer & ) { return 0; }
+
+#endif // FL_HAVE_INTERNAL_THREADS
+
 // create the root node
 // - construct the name of the file that will hold our preferences
 Fl_Preferences::RootNode::RootNode( Fl_Preferences *prefs, Root root, const char *vendor, const char *application )
 : prefs_(prefs),
   filename_(0L),
   vendor_(0L),
-  application_(0L) {
+  application_(0L),
+  format_(TEXT),
+  map_(0L),
+  mapSize_(0) {
 
   char *filename = Fl::system_driver()->preference_rootnode(prefs, root, vendor, application);
     filename_    = filename ? strdup(filename) : 0L;
@@ -822,7 +1040,10 @@ Fl_Preferences::RootNode::RootNode( Fl_Preferences *prefs, const char *path, con
 : prefs_(prefs),
   filename_(0L),
   vendor_(0L),
-  application_(0L) {
+  application_(0L),
+  format_(TEXT),
+  map_(0L),
+  mapSize_(0) {
 
   if (!vendor)
     vendor = "unknown";
@@ -845,7 +1066,10 @@ Fl_Preferences::RootNode::RootNode( Fl_Preferences *prefs )
 : prefs_(prefs),
   filename_(0L),
   vendor_(0L),
-  application_(0L) {
+  application_(0L),
+  format_(TEXT),
+  map_(0L),
+  mapSize_(0) {
 }
 
 // destroy the root node and all depending nodes
@@ -866,75 +1090,169 @@ Fl_Preferences::RootNode::~RootNode() {
   }
   delete prefs_->node;
   prefs_->node = 0L;
+  if ( map_ ) {
+    Fl::system_driver()->unmap_file( map_, mapSize_ );
+    map_ = 0L;
+  }
 }
 
 // read a preferences file and construct the group tree and with all entry leafs
+// - binary files stay in memory, their groups are loaded when they are used
+// - text files are copied and parsed in place, lines can have any length
 int Fl_Preferences::RootNode::read() {
   if (!filename_)   // RUNTIME preferences
     return -1; 
-  char buf[1024];
-  FILE *f = fl_fopen( filename_, "rb" );
-  if ( !f )
+  prefs_write_wait(); // see what was flushed in the background
+  size_t size = 0;
+  char *data = (char*)Fl::system_driver()->map_file( filename_, &size );
+  if ( !data )
     return -1; 
-  if (fgets( buf, 1024, f )==0) { /* ignore */ }
-  if (fgets( buf, 1024, f )==0) { /* ignore */ }
-  if (fgets( buf, 1024, f )==0) { /* ignore */ }
+  if ( size >= sizeof(prefs_magic) && memcmp( data, prefs_magic, sizeof(prefs_magic) ) == 0 ) {
+    map_ = data;
+    mapSize_ = size;
+    if ( readBinary() == 0 )
+      return 0;
+    Fl::system_driver()->unmap_file( map_, mapSize_ );
+    map_ = 0L;
+    mapSize_ = 0;
+    return -1;
+  }
+  char *buf = (char*)malloc( size+1 );
+  memcpy( buf, data, size );
+  Fl::system_driver()->unmap_file( data, size );
+  char *end = buf + size;
+  *end = 0;
   Node *nd = prefs_->node;
-  for (;;) {
-    if ( !fgets( buf, 1024, f ) ) break;	// EOF or Error
-    if ( buf[0]=='[' ) {			// read a new group
-      size_t end = strcspn( buf+1, "]\n\r" );
-      buf[ end+1 ] = 0;
-      nd = prefs_->node->find( buf+1 );
-    } else if ( buf[0]=='+' ) {			// value of previous name/value pair spans multiple lines
-      size_t end = strcspn( buf+1, "\n\r" );
-      if ( end != 0 ) {				// if entry is not empty
-        buf[ end+1 ] = 0;
-        nd->add( buf+1 );
-      }
-    } else {					 // read a name/value pair
-      size_t end = strcspn( buf, "\n\r" );
-      if ( end != 0 ) {				// if entry is not empty
-        buf[ end ] = 0;
-        nd->set( buf );
+  int nLine = 0;
+  for ( char *s = buf, *next; s < end; s = next ) {
+    // find the end of this line and the start of the next one
+    char *e = (char*)memchr( s, '\n', end-s );
+    next = e ? e+1 : end;
+    e = s + strcspn( s, "\n\r" );
+    *e = 0;
+    if ( nLine++ < 3 ) continue;		// skip the file header
+    if ( s[0]=='[' ) {				// read a new group
+      s[ strcspn( s+1, "]" ) + 1 ] = 0;
+      nd = prefs_->node->find( s+1 );
+    } else if ( !nd ) {				// inside a group outside of this tree
+      continue;
+    } else if ( s[0]=='+' ) {			// value of previous name/value pair spans multiple lines
+      if ( s[1] )				// if entry is not empty
+        nd->add( s+1 );
+    } else if ( s[0] ) {			// read a name/value pair
+      // append the continuation lines in place and set the whole value at once
+      while ( next < end && next[0]=='+' ) {
+        char *ce = (char*)memchr( next, '\n', end-next );
+        char *cnext = ce ? ce+1 : end;
+        size_t n = strcspn( next+1, "\n\r" );
+        memmove( e, next+1, n );
+        e += n;
+        next = cnext;
       }
+      *e = 0;
+      nd->set( s );
     }
   }
-  fclose( f );
+  free( buf );
   prefs_->node->clearDirtyFlags();
   return 0;
 }
 
 // write the group tree and all entry leafs
-int Fl_Preferences::RootNode::write() {
+// - the file is assembled in memory and replaces the old file in one step,
+//   so that a crash can not leave a partially written file behind
+// - if inBackground is set, the file is written by a background thread
+int Fl_Preferences::RootNode::write( char inBackground ) {
   if (!filename_)   // RUNTIME preferences
     return -1;
   fl_make_path_for_file(filename_);
-  FILE *f = fl_fopen( filename_, "wb" );
-  if ( !f )
+  detach();
+  Buffer b;
+  if ( format_ == BINARY ) {
+    if ( writeBinary( b ) != 0 )
+      return -1;
+  } else {
+    b.add( "; FLTK preferences file format 1.0\n; vendor: " );
+    b.add( vendor_ );
+    b.add( "\n; application: " );
+    b.add( application_ );
+    b.add( '\n' );
+    prefs_->node->write( b );
+  }
+  // unix: make sure that system prefs are user-readable
+  char protect = Fl::system_driver()->preferences_need_protection_check()
+                 && strncmp(filename_, "/etc/fltk/", 10) == 0;
+  if ( inBackground && !protect && prefs_write_queue( filename_, b ) )
+    return 0;
+  prefs_write_wait(); // don't let an older copy overwrite this one
+  if ( Fl::system_driver()->replace_file( filename_, b.data, b.size ) != 0 )
     return -1;
-  fprintf( f, "; FLTK preferences file format 1.0\n" );
-  fprintf( f, "; vendor: %s\n", vendor_ );
-  fprintf( f, "; application: %s\n", application_ );
-  prefs_->node->write( f );
-  fclose( f );
-  if (Fl::system_driver()->preferences_need_protection_check()) {
-    // unix: make sure that system prefs are user-readable
-    if (strncmp(filename_, "/etc/fltk/", 10) == 0) {
-      char *p;
-      p = filename_ + 9;
-      do {			 // for each directory to the pref file
-        *p = 0;
-        fl_chmod(filename_, 0755); // rwxr-xr-x
-        *p = '/';
-        p = strchr(p+1, '/');
-      } while (p);
-      fl_chmod(filename_, 0644);   // rw-r--r--
-    }
+  if (protect) {
+    char *p;
+    p = filename_ + 9;
+    do {			 // for each directory to the pref file
+      *p = 0;
+      fl_chmod(filename_, 0755); // rwxr-xr-x
+      *p = '/';
+      p = strchr(p+1, '/');
+    } while (p);
+    fl_chmod(filename_, 0644);   // rw-r--r--
   }
   return 0;
 }
 
+// check the header of a mapped binary file and let the root node load from it
+int Fl_Preferences::RootNode::readBinary() {
+  if ( mapSize_ < 20 || memcmp( map_, prefs_magic, sizeof(prefs_magic) ) != 0 )
+    return -1;
+  if ( prefs_get32( map_+8 ) != 1 || prefs_get32( map_+12 ) != mapSize_ || map_[mapSize_-1] != 0 )
+    return -1;
+  unsigned root = prefs_get32( map_+16 );
+  if ( root < 20 || root > mapSize_-16 )
+    return -1;
+  prefs_->node->setMap( map_+root );
+  format_ = BINARY;
+  return 0;
+}
+
+// write the group tree into a binary file
+int Fl_Preferences::RootNode::writeBinary( Buffer &b ) {
+  b.add( prefs_magic, sizeof(prefs_magic) );
+  b.add32( 1 );
+  b.add32( 0 );	// file size, set below
+  b.add32( 0 );	// root group, set below
+  unsigned root = prefs_->node->writeBinary( b );
+  b.add( '\0' );
+  if ( b.size > 0xFFFFFFF0U ) // offsets are 32 bit
+    return -1;
+  b.set32( 12, (unsigned)b.size );
+  b.set32( 16, root );
+  return 0;
+}
+
+// copy all entries that point into a mapped binary file
+static void detach_node( Fl_Preferences::RootNode *root, Fl_Preferences::Node *nd ) {
+  int i, n = nd->nEntry();
+  for ( i = 0; i < n; i++ ) {
+    Fl_Preferences::Entry &e = nd->entry( i );
+    if ( root->mapped( e.name ) ) e.name = strdup( e.name );
+    if ( e.value && root->mapped( e.value ) ) e.value = strdup( e.value );
+  }
+  n = nd->nChildren();
+  for ( i = 0; i < n; i++ )
+    detach_node( root, nd->childNode( i ) );
+}
+
+// load all groups from a mapped binary file, copy their entries, and
+// release the file, so that it can be replaced
+void Fl_Preferences::RootNode::detach() {
+  if ( !map_ ) return;
+  detach_node( this, prefs_->node );
+  Fl::system_driver()->unmap_file( map_, mapSize_ );
+  map_ = 0L;
+  mapSize_ = 0;
+}
+
 // get the path to the preferences directory
 // - copy the path into the buffer at "path"
 // - if the resulting path is longer than "pathlen", it will be cropped
@@ -998,9 +1316,15 @@ Fl_Preferences::Node::Node( const char *path ) {
   indexed_ = 0;
   index_ = 0;
   nIndex_ = NIndex_ = 0;
+  entryHash_ = 0;
+  NEntryHash_ = 0;
+  childHash_ = 0;
+  nChildHash_ = NChildHash_ = 0;
+  map_ = 0;
 }
 
 void Fl_Preferences::Node::deleteAllChildren() {
+  if ( map_ ) load();
   Node *nx;
   for ( Node *nd = child_; nd; nd = nx ) {
     nx = nd->next_;
@@ -1009,33 +1333,35 @@ void Fl_Preferences::Node::deleteAllChildren() {
   child_ = 0L;
   dirty_ = 1;
   updateIndex();
+  deleteChildHash();
 }
 
 void Fl_Preferences::Node::deleteAllEntries() {
+  if ( map_ ) load();
   if ( entry_ ) {
+    RootNode *root = findRoot();
     for ( int i = 0; i < nEntry_; i++ ) {
-      if ( entry_[i].name ) {
-	free( entry_[i].name );
-	entry_[i].name = 0L;
-      }
-      if ( entry_[i].value ) {
-	free( entry_[i].value );
-	entry_[i].value = 0L;
-      }
+      freeEntryText( root, entry_[i].name );
+      entry_[i].name = 0L;
+      freeEntryText( root, entry_[i].value );
+      entry_[i].value = 0L;
     }
     free( entry_ );
     entry_ = 0L;
     nEntry_ = 0;
     NEntry_ = 0;
   }
+  deleteEntryHash();
   dirty_ = 1;
 }
 
 // delete this and all depending nodes
 Fl_Preferences::Node::~Node() {
+  map_ = 0; // no need to load anything from a mapped file
   deleteAllChildren();
   deleteAllEntries();
   deleteIndex();
+  deleteChildHash();
   if ( path_ ) {
     free( path_ );
     path_ = 0L;
@@ -1046,9 +1372,10 @@ Fl_Preferences::Node::~Node() {
 
 // recursively check if any entry is dirty (was changed after loading a fresh prefs file)
 char Fl_Preferences::Node::dirty() {
-  if ( dirty_ ) return 1;
-  if ( next_ && next_->dirty() ) return 1;
-  if ( child_ && child_->dirty() ) return 1;
+  for ( Node *nd = this; nd; nd = nd->next_ ) {
+    if ( nd->dirty_ ) return 1;
+    if ( nd->child_ && nd->child_->dirty() ) return 1;
+  }
   return 0;
 }
 
@@ -1062,36 +1389,45 @@ void Fl_Preferences::Node::clearDirtyFlags() {
   }
 }
 
-// write this node (recursively from the last neighbor back to this)
-// write all entries
-// write all children
-int Fl_Preferences::Node::write( FILE *f ) {
-  if ( next_ ) next_->write( f );
-  fprintf( f, "\n[%s]\n\n", path_ );
-  for ( int i = 0; i < nEntry_; i++ ) {
-    char *src = entry_[i].value;
-    if ( src ) {		// hack it into smaller pieces if needed
-      fprintf( f, "%s:", entry_[i].name );
-      size_t cnt, written = 0;
-      for ( cnt = 0; cnt < 60; cnt++ )
-	if ( src[cnt]==0 ) break;
-      written += fwrite( src, cnt, 1, f );
-      fprintf( f, "\n" );
-      src += cnt;
-      for (;*src;) {
-	for ( cnt = 0; cnt < 80; cnt++ )
-	  if ( src[cnt]==0 ) break;
-        fputc( '+', f );
-	written += fwrite( src, cnt, 1, f );
-        fputc( '\n', f );
-	src += cnt;
+// write this node and its neighbors, from the last neighbor back to this
+// for each node, write all entries and then all children
+int Fl_Preferences::Node::write( Buffer &b ) {
+  int n = 0;
+  Node *nd;
+  for ( nd = this; nd; nd = nd->next_ ) n++;
+  Node **list = (Node**)malloc( n * sizeof(Node*) );
+  n = 0;
+  for ( nd = this; nd; nd = nd->next_ ) list[n++] = nd;
+  while ( n > 0 ) {
+    nd = list[--n];
+    if ( nd->map_ ) nd->load();
+    b.add( "\n[" );
+    b.add( nd->path_ );
+    b.add( "]\n\n" );
+    for ( int i = 0; i < nd->nEntry_; i++ ) {
+      const char *src = nd->entry_[i].value;
+      b.add( nd->entry_[i].name );
+      if ( src ) {		// hack it into smaller pieces if needed
+        size_t cnt;
+        b.add( ':' );
+        for ( cnt = 0; cnt < 60; cnt++ )
+          if ( src[cnt]==0 ) break;
+        b.add( src, cnt );
+        src += cnt;
+        for (;*src;) {
+          for ( cnt = 0; cnt < 80; cnt++ )
+            if ( src[cnt]==0 ) break;
+          b.add( "\n+" );
+          b.add( src, cnt );
+          src += cnt;
+        }
       }
+      b.add( '\n' );
     }
-    else
-      fprintf( f, "%s\n", entry_[i].name );
+    if ( nd->child_ ) nd->child_->write( b );
+    nd->dirty_ = 0;
   }
-  if ( child_ ) child_->write( f );
-  dirty_ = 0;
+  free( list );
   return 0;
 }
 
@@ -1100,9 +1436,12 @@ void Fl_Preferences::Node::setParent( Node *pn ) {
   parent_ = pn;
   next_ = pn->child_;
   pn->child_ = this;
-  sprintf( nameBuffer, "%s/%s", pn->path_, path_ );
+  size_t len = strlen( pn->path_ ) + strlen( path_ ) + 2;
+  char *path = (char*)malloc( len );
+  snprintf( path, len, "%s/%s", pn->path_, path_ );
   free( path_ );
-  path_ = strdup( nameBuffer );
+  path_ = path;
+  if ( pn->childHash_ ) pn->addChildHash( this );
 }
 
 // find the corresponding root node
@@ -1118,8 +1457,9 @@ Fl_Preferences::RootNode *Fl_Preferences::Node::findRoot() {
 
 // add a child to this node and set its path (try to find it first...)
 Fl_Preferences::Node *Fl_Preferences::Node::addChild( const char *path ) {
-  sprintf( nameBuffer, "%s/%s", path_, path );
-  char *name = strdup( nameBuffer );
+  size_t len = strlen( path_ ) + strlen( path ) + 2;
+  char *name = (char*)malloc( len );
+  snprintf( name, len, "%s/%s", path_, path );
   Node *nd = find( name );
   free( name );
   updateIndex();
@@ -1129,18 +1469,16 @@ Fl_Preferences::Node *Fl_Preferences::Node::addChild( const char *path ) {
 // create and set, or change an entry within this node
 void Fl_Preferences::Node::set( const char *name, const char *value )
 {
-  for ( int i=0; i<nEntry_; i++ ) {
-    if ( strcmp( name, entry_[i].name ) == 0 ) {
-      if ( !value ) return; // annotation
-      if ( strcmp( value, entry_[i].value ) != 0 ) {
-	if ( entry_[i].value )
-	  free( entry_[i].value );
-	entry_[i].value = strdup( value );
-	dirty_ = 1;
-      }
-      lastEntrySet = i;
-      return;
+  int i = getEntry( name );
+  if ( i >= 0 ) {
+    if ( !value ) return; // annotation
+    if ( !entry_[i].value || strcmp( value, entry_[i].value ) != 0 ) {
+      freeEntryText( findRoot(), entry_[i].value );
+      entry_[i].value = strdup( value );
+      dirty_ = 1;
     }
+    lastEntrySet = i;
+    return;
   }
   if ( NEntry_==nEntry_ ) {
     NEntry_ = NEntry_ ? NEntry_*2 : 10;
@@ -1151,6 +1489,16 @@ void Fl_Preferences::Node::set( const char *name, const char *value )
   lastEntrySet = nEntry_;
   nEntry_++;
   dirty_ = 1;
+  if ( entryHash_ ) {
+    if ( nEntry_*2 > NEntryHash_ ) {
+      deleteEntryHash();	// rebuilt larger when needed
+    } else {
+      unsigned m = NEntryHash_ - 1;
+      unsigned h = prefs_hash( name, (int)strlen( name ) ) & m;
+      while ( entryHash_[h] ) h = ( h+1 ) & m;
+      entryHash_[h] = nEntry_;
+    }
+  }
 }
 
 // create or set a value (or annotation) from a single line in the file buffer
@@ -1163,11 +1511,12 @@ void Fl_Preferences::Node::set( const char *line ) {
   } else {
     const char *c = strchr( line, ':' );
     if ( c ) {
-      size_t len = c-line+1;
-      if ( len >= sizeof( nameBuffer ) )
-        len = sizeof( nameBuffer );
-      strlcpy( nameBuffer, line, len );
-      set( nameBuffer, c+1 );
+      size_t len = c-line;
+      char *name = len < sizeof( nameBuffer ) ? nameBuffer : (char*)malloc( len+1 );
+      memcpy( name, line, len );
+      name[len] = 0;
+      set( name, c+1 );
+      if ( name != nameBuffer ) free( name );
     } else {
       set( line, "" );
     }
@@ -1178,8 +1527,11 @@ void Fl_Preferences::Node::set( const char *line ) {
 // Append data to an existing node. This is only used in read operations when
 // a single entry stretches over multiple lines in the prefs file.
 void Fl_Preferences::Node::add( const char *line ) {
+  if ( map_ ) load();
   if ( lastEntrySet<0 || lastEntrySet>=nEntry_ ) return;
   char *&dst = entry_[ lastEntrySet ].value;
+  RootNode *root = findRoot();
+  if ( root && root->mapped( dst ) ) dst = strdup( dst );
   size_t a = strlen( dst );
   size_t b = strlen( line );
   dst = (char*)realloc( dst, a+b+1 );
@@ -1193,7 +1545,20 @@ const char *Fl_Preferences::Node::get( const char *name ) {
 }
 
 // find the index of an entry, returns -1 if no such entry
+// - groups with many entries are searched through a hash table
 int Fl_Preferences::Node::getEntry( const char *name ) {
+  if ( map_ ) load();
+  if ( !entryHash_ && nEntry_ >= 16 )
+    createEntryHash();
+  if ( entryHash_ ) {
+    unsigned m = NEntryHash_ - 1;
+    for ( unsigned h = prefs_hash( name, (int)strlen( name ) ) & m; entryHash_[h]; h = ( h+1 ) & m ) {
+      int i = entryHash_[h] - 1;
+      if ( strcmp( name, entry_[i].name ) == 0 )
+        return i;
+    }
+    return -1;
+  }
   for ( int i=0; i<nEntry_; i++ ) {
     if ( strcmp( name, entry_[i].name ) == 0 ) {
       return i;
@@ -1206,8 +1571,12 @@ int Fl_Preferences::Node::getEntry( const char *name ) {
 char Fl_Preferences::Node::deleteEntry( const char *name ) {
   int ix = getEntry( name );
   if ( ix == -1 ) return 0;
+  RootNode *root = findRoot();
+  freeEntryText( root, entry_[ix].name );
+  freeEntryText( root, entry_[ix].value );
   memmove( entry_+ix, entry_+ix+1, (nEntry_-ix-1) * sizeof(Entry) );
   nEntry_--;
+  deleteEntryHash();
   dirty_ = 1;
   return 1;
 }
@@ -1217,26 +1586,31 @@ char Fl_Preferences::Node::deleteEntry( const char *name ) {
 // - if the node was not found, 'find' will create the required branch
 Fl_Preferences::Node *Fl_Preferences::Node::find( const char *path ) {
   int len = (int) strlen( path_ );
-  if ( strncmp( path, path_, len ) == 0 ) {
-    if ( path[ len ] == 0 )
-      return this;
-    if ( path[ len ] == '/' ) {
-      Node *nd;
-      for ( nd = child_; nd; nd = nd->next_ ) {
-        Node *nn = nd->find( path );
-        if ( nn ) return nn;
-      }
-      const char *s = path+len+1;
-      const char *e = strchr( s, '/' );
-      if (e) strlcpy( nameBuffer, s, e-s+1 );
-      else strlcpy( nameBuffer, s, sizeof(nameBuffer));
-      nd = new Node( nameBuffer );
-      nd->setParent( this );
-      dirty_ = 1;
-      return nd->find( path );
+  if ( strncmp( path, path_, len ) != 0 )
+    return 0;
+  if ( path[ len ] == 0 )
+    return this;
+  if ( path[ len ] != '/' )
+    return 0;
+  Node *nd = this;
+  for ( const char *s = path+len+1; ; ) {
+    const char *e = strchr( s, '/' );
+    int n = e ? (int)(e-s) : (int)strlen( s );
+    Node *nn = nd->findChild( s, n );
+    if ( !nn ) {
+      char *name = (char*)malloc( n+1 );
+      memcpy( name, s, n );
+      name[n] = 0;
+      nn = new Node( name );
+      free( name );
+      nn->setParent( nd );
+      nd->dirty_ = 1;
+      nd->updateIndex();
     }
+    if ( !e ) return nn;
+    nd = nn;
+    s = e+1;
   }
-  return 0;
 }
 
 // find a group somewhere in the tree starting here
@@ -1246,40 +1620,54 @@ Fl_Preferences::Node *Fl_Preferences::Node::find( const char *path ) {
 // - if the pathname is "./" (root node) return the topmost node
 // - if the pathname starts with "./", start the search at the root node instead
 Fl_Preferences::Node *Fl_Preferences::Node::search( const char *path, int offset ) { 
-  if ( offset == 0 ) {
-    if ( path[0] == '.' ) {
-      if ( path[1] == 0 ) {
-	return this; // user was searching for current node
-      } else if ( path[1] == '/' ) {
-	Node *nn = this;
-	while ( nn->parent() ) nn = nn->parent();
-	if ( path[2]==0 ) {		// user is searching for root ( "./" )
-	  return nn;
-	}
-	return nn->search( path+2, 2 ); // do a relative search on the root node
+  Node *nd = this;
+  if ( path[0] == '.' ) {
+    if ( path[1] == 0 ) {
+      return this; // user was searching for current node
+    } else if ( path[1] == '/' ) {
+      while ( nd->parent() ) nd = nd->parent();
+      if ( path[2]==0 ) {		// user is searching for root ( "./" )
+        return nd;
       }
+      path += 2;			// do a relative search on the root node
     }
-    offset = (int) strlen( path_ ) + 1;
   }
-  int len = (int) strlen( path_ );
-  if ( len < offset-1 ) return 0;
-  len -= offset;
-  if ( ( len <= 0 ) || ( strncmp( path, path_+offset, len ) == 0 ) ) {
-    if ( len > 0 && path[ len ] == 0 )
-      return this;
-    if ( len <= 0 || path[ len ] == '/' ) {
-      for ( Node *nd = child_; nd; nd = nd->next_ ) {
-	Node *nn = nd->search( path, offset );
-	if ( nn ) return nn;
-      }
-      return 0;
+  if ( !path[0] ) return 0;
+  for ( const char *s = path; ; ) {
+    const char *e = strchr( s, '/' );
+    nd = nd->findChild( s, e ? (int)(e-s) : (int)strlen( s ) );
+    if ( !nd || !e ) return nd;
+    s = e+1;
+  }
+}
+
+// find a direct child node by name, returns 0 if there is no such child
+// - nodes with many children are searched through a hash table
+Fl_Preferences::Node *Fl_Preferences::Node::findChild( const char *name, int len ) {
+  if ( map_ ) load();
+  if ( !childHash_ ) {
+    int cnt = 0;
+    Node *nd;
+    for ( nd = child_; nd && cnt < 16; nd = nd->next_, cnt++ ) {
+      const char *nn = nd->name();
+      if ( strncmp( nn, name, len ) == 0 && nn[len] == 0 )
+        return nd;
     }
+    if ( !nd ) return 0;
+    createChildHash();
+  }
+  unsigned m = NChildHash_ - 1;
+  for ( unsigned h = prefs_hash( name, len ) & m; childHash_[h]; h = ( h+1 ) & m ) {
+    const char *nn = childHash_[h]->name();
+    if ( strncmp( nn, name, len ) == 0 && nn[len] == 0 )
+      return childHash_[h];
   }
   return 0;
 }
 
 // return the number of child nodes (groups)
 int Fl_Preferences::Node::nChildren() {
+  if ( map_ ) load();
   if (indexed_) {
     return nIndex_;
   } else {
@@ -1344,6 +1732,7 @@ char Fl_Preferences::Node::remove() {
     }
     parent()->dirty_ = 1;
     parent()->updateIndex();
+    parent()->deleteChildHash();
   }
   delete this;
   return ( nd != 0 );
@@ -1376,6 +1765,179 @@ void Fl_Preferences::Node::deleteIndex() {
   indexed_ = 0;
 }
 
+// hash all entry names, keeping the table at most half full
+void Fl_Preferences::Node::createEntryHash() {
+  int n = 64;
+  while ( n < nEntry_*2 ) n *= 2;
+  entryHash_ = (int*)calloc( n, sizeof(int) );
+  NEntryHash_ = n;
+  unsigned m = n - 1;
+  for ( int i = 0; i < nEntry_; i++ ) {
+    unsigned h = prefs_hash( entry_[i].name, (int)strlen( entry_[i].name ) ) & m;
+    while ( entryHash_[h] ) h = ( h+1 ) & m;
+    entryHash_[h] = i+1;
+  }
+}
+
+void Fl_Preferences::Node::deleteEntryHash() {
+  if (entryHash_) free(entryHash_);
+  entryHash_ = 0;
+  NEntryHash_ = 0;
+}
+
+// hash all child nodes by name, keeping the table at most half full
+void Fl_Preferences::Node::createChildHash() {
+  int cnt = 0, n = 64;
+  Node *nd;
+  for ( nd = child_; nd; nd = nd->next_ ) cnt++;
+  while ( n < cnt*2 ) n *= 2;
+  childHash_ = (Node**)calloc( n, sizeof(Node*) );
+  NChildHash_ = n;
+  nChildHash_ = 0;
+  for ( nd = child_; nd; nd = nd->next_ )
+    addChildHash( nd );
+}
+
+// add a child node to the hash table, or delete the table if it gets too full
+void Fl_Preferences::Node::addChildHash( Node *nd ) {
+  if ( (nChildHash_+1)*2 > NChildHash_ ) {
+    deleteChildHash();		// rebuilt larger when needed
+    return;
+  }
+  unsigned m = NChildHash_ - 1;
+  const char *name = nd->name();
+  int len = (int)strlen( name );
+  unsigned h = prefs_hash( name, len ) & m;
+  for ( ; childHash_[h]; h = ( h+1 ) & m )
+    if ( strcmp( childHash_[h]->name(), name ) == 0 ) return;
+  childHash_[h] = nd;
+  nChildHash_++;
+}
+
+void Fl_Preferences::Node::deleteChildHash() {
+  if (childHash_) free(childHash_);
+  childHash_ = 0;
+  nChildHash_ = NChildHash_ = 0;
+}
+
+// free the name or value of an entry, unless it points into a mapped file
+void Fl_Preferences::Node::freeEntryText( RootNode *root, char *text ) {
+  if ( text && !( root && root->mapped( text ) ) )
+    free( text );
+}
+
+// create the entries and child groups of a group in a mapped binary file
+// - entry names and values point into the file instead of being copied
+// - broken records are skipped
+void Fl_Preferences::Node::load() {
+  const char *g = map_;
+  map_ = 0;
+  RootNode *root = findRoot();
+  const char *base = root->map();
+  size_t size = root->mapSize();
+  size_t off = g - base;
+  if ( off + 16 > size ) return;
+  unsigned nE = prefs_get32( g+4 ), nC = prefs_get32( g+8 ), nH = prefs_get32( g+12 );
+  size_t avail = ( size - off - 16 ) / 4;
+  if ( nE > avail/2 || nC > avail - 2*nE || nH > avail - 2*nE - nC ) return;
+  const char *p = g + 16;
+  unsigned i;
+  if ( nE ) {
+    entry_ = (Entry*)malloc( nE * sizeof(Entry) );
+    NEntry_ = nE;
+    for ( i = 0; i < nE; i++, p += 8 ) {
+      unsigned name = prefs_get32( p ), value = prefs_get32( p+4 );
+      if ( name >= size || value >= size ) continue;
+      entry_[nEntry_].name = (char*)base + name;
+      entry_[nEntry_].value = value ? (char*)base + value : 0L;
+      nEntry_++;
+    }
+  }
+  size_t plen = strlen( path_ );
+  for ( i = 0; i < nC; i++, p += 4 ) {
+    unsigned co = prefs_get32( p );
+    if ( co <= off || co > size-16 ) continue;
+    unsigned po = prefs_get32( base+co );
+    if ( po >= size ) continue;
+    // the path of a child is the path of this group plus one more name
+    const char *path = base + po;
+    if ( strncmp( path, path_, plen ) != 0 || path[plen] != '/' || strchr( path+plen+1, '/' ) )
+      continue;
+    Node *nd = new Node( path );
+    nd->map_ = base + co;
+    nd->parent_ = this;
+    nd->next_ = child_;
+    child_ = nd;
+  }
+  // use the hash table from the file if it is sound
+  if ( nH && ( nH & (nH-1) ) == 0 && nH >= 2*nE && nEntry_ == (int)nE ) {
+    entryHash_ = (int*)malloc( nH * sizeof(int) );
+    NEntryHash_ = nH;
+    unsigned used = 0;
+    for ( i = 0; i < nH; i++, p += 4 ) {
+      unsigned v = prefs_get32( p );
+      if ( v > nE || ( v && ++used > nE ) ) {
+        deleteEntryHash();
+        break;
+      }
+      entryHash_[i] = v;
+    }
+  }
+}
+
+// write this group and all its children to a binary file,
+// returns the offset of the group record
+unsigned Fl_Preferences::Node::writeBinary( Buffer &b ) {
+  if ( map_ ) load();
+  int i;
+  // strings first, so the group record is followed by the child records only
+  unsigned *str = (unsigned*)malloc( ( 2*nEntry_+1 ) * sizeof(unsigned) );
+  str[0] = (unsigned)b.size;
+  b.add( path_, strlen( path_ ) + 1 );
+  for ( i = 0; i < nEntry_; i++ ) {
+    str[2*i+1] = (unsigned)b.size;
+    b.add( entry_[i].name, strlen( entry_[i].name ) + 1 );
+    str[2*i+2] = 0;
+    if ( entry_[i].value ) {
+      str[2*i+2] = (unsigned)b.size;
+      b.add( entry_[i].value, strlen( entry_[i].value ) + 1 );
+    }
+  }
+  b.align();
+  createIndex();
+  int nc = nIndex_, nh = 0;
+  if ( nEntry_ >= 16 ) {
+    nh = 64;
+    while ( nh < nEntry_*2 ) nh *= 2;
+  }
+  unsigned rec = (unsigned)b.size;
+  b.add32( str[0] );
+  b.add32( nEntry_ );
+  b.add32( nc );
+  b.add32( nh );
+  for ( i = 0; i < 2*nEntry_; i++ )
+    b.add32( str[i+1] );
+  free( str );
+  size_t children = b.size;
+  for ( i = 0; i < nc; i++ )
+    b.add32( 0 );
+  if ( nh ) {
+    size_t table = b.size;
+    for ( i = 0; i < nh; i++ )
+      b.add32( 0 );
+    unsigned m = nh - 1;
+    for ( i = 0; i < nEntry_; i++ ) {
+      unsigned h = prefs_hash( entry_[i].name, (int)strlen( entry_[i].name ) ) & m;
+      while ( prefs_get32( b.data + table + 4*h ) ) h = ( h+1 ) & m;
+      b.set32( table + 4*h, i+1 );
+    }
+  }
+  for ( i = 0; i < nc; i++ )
+    b.set32( children + 4*i, index_[i]->writeBinary( b ) );
+  dirty_ = 0;
+  return rec;
+}
+
 /**
  * \brief Create a plugin.
  *
@@ -24,8 +24,11 @@
 #include <FL/fl_utf8.h>
 #include <FL/fl_draw.H>
 #include <FL/Fl_Screen_Driver.H>
+#include "fl_threads.h"
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
 #if defined(HAVE_LIBZ)
 #include <zlib.h>
 #endif
@@ -44,6 +47,315 @@ static double strtoll(const char *str, char **endptr, int base) {
 #include "../nanosvg/nanosvgrast.h"
 
 
+// One rasterization of an SVG image, kept in the raster cache
+struct Fl_SVG_Raster {
+  Fl_SVG_Raster *next;			// next raster of the same image
+  Fl_SVG_Raster *lru_prev, *lru_next;	// all rasters, most recently used first
+  Fl_SVG_Counted_Image *owner;
+  int w, h;
+  bool proportional;
+  uchar *data;				// w*h*4 bytes, RGBA
+};
+
+// Parsed SVG data shared by all copies of an image and by all images
+// created from the same file
+struct Fl_SVG_Counted_Image {
+  NSVGimage* svg_image;
+  int ref_count;
+  Fl_SVG_Raster *rasters;		// cached rasterizations of svg_image
+  char *filename;			// file svg_image was parsed from, or NULL
+  time_t mtime;				// ... its modification time
+  off_t size;				// ... and its size
+  Fl_SVG_Counted_Image *next_file;	// next entry in the list of files
+};
+
+// The mutex protects reference counts, the raster cache, the list of
+// files, the rasterizer pool, and the queue of the background thread.
+static Fl_Internal_Mutex svg_mutex;
+static Fl_SVG_Counted_Image *svg_files = NULL;
+static Fl_SVG_Raster *lru_first = NULL, *lru_last = NULL;
+static int raster_cache_used = 0;
+static int raster_cache_max = 16 * 1024 * 1024;
+
+// Rasterizers are not reentrant: each thread takes one from the pool
+static const int RASTERIZER_POOL_SIZE = 8;
+static NSVGrasterizer *rasterizer_pool[RASTERIZER_POOL_SIZE];
+static int rasterizer_pool_count = 0;
+
+static NSVGrasterizer *get_rasterizer() {
+  {
+    Fl_Internal_Lock lock(svg_mutex);
+    if (rasterizer_pool_count > 0) return rasterizer_pool[--rasterizer_pool_count];
+  }
+  return nsvgCreateRasterizer();
+}
+
+static void release_rasterizer(NSVGrasterizer *r) {
+  {
+    Fl_Internal_Lock lock(svg_mutex);
+    if (rasterizer_pool_count < RASTERIZER_POOL_SIZE) {
+      rasterizer_pool[rasterizer_pool_count++] = r;
+      return;
+    }
+  }
+  nsvgDeleteRasterizer(r);
+}
+
+// scaling factor that makes the image fit into W x H, keeping its aspect ratio
+static float svg_scaling(NSVGimage *svg, int W, int H) {
+  float f1 = float(W) / int(svg->width+0.5);
+  float f2 = float(H) / int(svg->height+0.5);
+  return (f1 < f2) ? f1 : f2;
+}
+
+// adjust W and H to the size Fl_SVG_Image::resize() actually uses
+static void raster_size(NSVGimage *svg, bool proportional, int &W, int &H) {
+  if (proportional) {
+    float f = svg_scaling(svg, W, H);
+    W = int( int(svg->width+0.5)*f + 0.5 );
+    H = int( int(svg->height+0.5)*f + 0.5 );
+  }
+}
+
+// Large images are split into horizontal bands rasterized by several threads
+static int raster_thread_count = 0; // 0: one per CPU
+static const int MAX_RASTER_THREADS = 16;
+static const int MIN_BANDED_PIXELS = 512 * 512;
+static const int MIN_BAND_HEIGHT = 16;
+
+struct Fl_SVG_Band_Work {
+  NSVGrasterJob *job;
+  int band_h, nbands;
+  int next_band;			// next band to rasterize, protected by mutex
+  Fl_Internal_Mutex mutex;
+};
+
+static void *rasterize_bands(void *data) {
+  Fl_SVG_Band_Work *work = (Fl_SVG_Band_Work*)data;
+  NSVGrasterizer *rasterizer = get_rasterizer();
+  for (;;) {
+    int band;
+    {
+      Fl_Internal_Lock lock(work->mutex);
+      band = work->next_band++;
+    }
+    if (band >= work->nbands) break;
+    nsvgRasterizeJobBand(work->job, rasterizer, band * work->band_h, (band + 1) * work->band_h);
+  }
+  release_rasterizer(rasterizer);
+  return NULL;
+}
+
+static void rasterize_svg(NSVGimage *svg, bool proportional, int W, int H, uchar *dst) {
+  double fx, fy;
+  if (proportional) {
+    fx = svg_scaling(svg, W, H);
+    fy = fx;
+  } else {
+    fx = (double)W / svg->width;
+    fy = (double)H / svg->height;
+  }
+  NSVGrasterizer *rasterizer = get_rasterizer();
+  int nthreads = raster_thread_count > 0 ? raster_thread_count : fl_thread_cpu_count();
+  if (nthreads > MAX_RASTER_THREADS) nthreads = MAX_RASTER_THREADS;
+  if (nthreads > H / MIN_BAND_HEIGHT) nthreads = H / MIN_BAND_HEIGHT;
+  NSVGrasterJob *job = NULL;
+  if (nthreads > 1 && W * H >= MIN_BANDED_PIXELS)
+    job = nsvgCreateRasterJob(rasterizer, svg, 0, 0, fx, fy, dst, W, H, W*4);
+  if (!job) {
+    nsvgRasterizeXY(rasterizer, svg, 0, 0, fx, fy, dst, W, H, W*4);
+    release_rasterizer(rasterizer);
+    return;
+  }
+  release_rasterizer(rasterizer);
+  // more bands than threads balance bands of unequal complexity
+  Fl_SVG_Band_Work work;
+  work.job = job;
+  work.nbands = 4 * nthreads;
+  if (work.nbands > H / MIN_BAND_HEIGHT) work.nbands = H / MIN_BAND_HEIGHT;
+  work.band_h = (H + work.nbands - 1) / work.nbands;
+  work.next_band = 0;
+  Fl_Internal_Thread threads[MAX_RASTER_THREADS];
+  int started = 0;
+  while (started < nthreads - 1 &&
+         fl_thread_create(threads[started], rasterize_bands, &work) == 0)
+    started++;
+  rasterize_bands(&work);
+  while (started > 0) fl_thread_join(threads[--started]);
+  nsvgDeleteRasterJob(job);
+}
+
+// must be called with svg_mutex locked
+static Fl_SVG_Raster *find_raster(Fl_SVG_Counted_Image *img, int W, int H, bool proportional) {
+  for (Fl_SVG_Raster *r = img->rasters; r; r = r->next) {
+    if (r->w == W && r->h == H && r->proportional == proportional) return r;
+  }
+  return NULL;
+}
+
+// must be called with svg_mutex locked
+static void unlink_raster(Fl_SVG_Raster *r) {
+  if (r->lru_prev) r->lru_prev->lru_next = r->lru_next;
+  else lru_first = r->lru_next;
+  if (r->lru_next) r->lru_next->lru_prev = r->lru_prev;
+  else lru_last = r->lru_prev;
+  r->lru_prev = r->lru_next = NULL;
+}
+
+// must be called with svg_mutex locked
+static void link_raster(Fl_SVG_Raster *r) {
+  r->lru_prev = NULL;
+  r->lru_next = lru_first;
+  if (lru_first) lru_first->lru_prev = r;
+  else lru_last = r;
+  lru_first = r;
+}
+
+// must be called with svg_mutex locked
+static void delete_raster(Fl_SVG_Raster *r) {
+  Fl_SVG_Raster **p = &r->owner->rasters;
+  while (*p != r) p = &(*p)->next;
+  *p = r->next;
+  unlink_raster(r);
+  raster_cache_used -= r->w * r->h * 4;
+  delete[] r->data;
+  delete r;
+}
+
+// must be called with svg_mutex locked
+static void trim_raster_cache(int limit) {
+  while (raster_cache_used > limit && lru_last) delete_raster(lru_last);
+}
+
+// copies a cached rasterization to dst, returns false if there is none
+static bool cached_raster(Fl_SVG_Counted_Image *img, int W, int H, bool proportional, uchar *dst) {
+  Fl_Internal_Lock lock(svg_mutex);
+  Fl_SVG_Raster *r = find_raster(img, W, H, proportional);
+  if (!r) return false;
+  memcpy(dst, r->data, W * H * 4);
+  if (r != lru_first) {
+    unlink_raster(r);
+    link_raster(r);
+  }
+  return true;
+}
+
+// adds a copy of a rasterization to the cache
+static void cache_raster(Fl_SVG_Counted_Image *img, int W, int H, bool proportional, const uchar *src) {
+  int size = W * H * 4;
+  if (size > raster_cache_max / 2) return; // keep room for others
+  uchar *data = new uchar[size];
+  memcpy(data, src, size);
+  Fl_Internal_Lock lock(svg_mutex);
+  if (find_raster(img, W, H, proportional)) { // done by another thread
+    delete[] data;
+    return;
+  }
+  trim_raster_cache(raster_cache_max - size);
+  Fl_SVG_Raster *r = new Fl_SVG_Raster;
+  r->owner = img;
+  r->w = W;
+  r->h = H;
+  r->proportional = proportional;
+  r->data = data;
+  r->next = img->rasters;
+  img->rasters = r;
+  link_raster(r);
+  raster_cache_used += size;
+}
+
+static void release_counted_image(Fl_SVG_Counted_Image *img) {
+  {
+    Fl_Internal_Lock lock(svg_mutex);
+    if (--img->ref_count > 0) return;
+    while (img->rasters) delete_raster(img->rasters);
+    for (Fl_SVG_Counted_Image **p = &svg_files; *p; p = &(*p)->next_file) {
+      if (*p == img) {
+        *p = img->next_file;
+        break;
+      }
+    }
+  }
+  if (img->svg_image) nsvgDelete(img->svg_image);
+  free(img->filename);
+  delete img;
+}
+
+// Background rasterization: one worker thread, started on demand,
+// processes a queue of requests sent by Fl_SVG_Image::prerasterize()
+
+struct Fl_SVG_Raster_Job {
+  Fl_SVG_Counted_Image *img;		// holds a reference while queued
+  int w, h;
+  bool proportional;
+  Fl_SVG_Raster_Job *next;
+};
+
+static Fl_SVG_Raster_Job *job_first = NULL, *job_last = NULL;
+
+static void run_raster_job(Fl_SVG_Raster_Job *job) {
+  bool done;
+  {
+    Fl_Internal_Lock lock(svg_mutex);
+    done = (find_raster(job->img, job->w, job->h, job->proportional) != NULL);
+  }
+  if (!done) {
+    uchar *data = new uchar[job->w * job->h * 4];
+    rasterize_svg(job->img->svg_image, job->proportional, job->w, job->h, data);
+    cache_raster(job->img, job->w, job->h, job->proportional, data);
+    delete[] data;
+  }
+  release_counted_image(job->img);
+  delete job;
+}
+
+#if defined(FL_HAVE_INTERNAL_THREADS)
+
+// not a static object: the worker thread keeps waiting for it at exit
+static Fl_Internal_Condition *job_cond = NULL;
+static int worker_state = 0; // 0: not started, 1: running, -1: can't start
+
+static void *raster_worker(void *) {
+  for (;;) {
+    Fl_SVG_Raster_Job *job;
+    {
+      Fl_Internal_Lock lock(svg_mutex);
+      while (!job_first) job_cond->wait(svg_mutex);
+      job = job_first;
+      job_first = job->next;
+      if (!job_first) job_last = NULL;
+    }
+    run_raster_job(job);
+  }
+  return NULL;
+}
+
+#endif // FL_HAVE_INTERNAL_THREADS
+
+// queues the job, or runs it now if there is no background thread
+static void queue_raster_job(Fl_SVG_Raster_Job *job) {
+#if defined(FL_HAVE_INTERNAL_THREADS)
+  {
+    Fl_Internal_Lock lock(svg_mutex);
+    if (worker_state == 0) {
+      job_cond = new Fl_Internal_Condition;
+      Fl_Internal_Thread t;
+      worker_state = fl_thread_create(t, raster_worker, NULL, 1) ? -1 : 1;
+    }
+    if (worker_state > 0) {
+      job->next = NULL;
+      if (job_last) job_last->next = job;
+      else job_first = job;
+      job_last = job;
+      job_cond->signal();
+      return;
+    }
+  }
+#endif // FL_HAVE_INTERNAL_THREADS
+  run_raster_job(job);
+}
+
+
 /** The constructor loads the SVG image from the given .svg/.svgz filename or in-memory data.
  \param filename The full path and name of a .svg or .svgz file, or NULL.
  \param svg_data A pointer to the memory location of the SVG image data.
@@ -61,19 +373,11 @@ Fl_SVG_Image::Fl_SVG_Image(Fl_SVG_Image *source) : Fl_RGB_Image(NULL, 0, 0, 4) {
 }
 
 
-/** The destructor frees all memory and server resources that are used by the SVG image. */
+/** The destructor frees all memory and server resources that are used by the SVG image.
+ The parsed SVG data and its cached rasterizations are freed when the last image
+ using them is deleted. */
 Fl_SVG_Image::~Fl_SVG_Image() {
-  if ( --counted_svg_image_->ref_count <= 0) {
-    nsvgDelete(counted_svg_image_->svg_image);
-    delete counted_svg_image_;
-  }
-}
-
-
-float Fl_SVG_Image::svg_scaling_(int W, int H) {
-  float f1 = float(W) / int(counted_svg_image_->svg_image->width+0.5);
-  float f2 = float(H) / int(counted_svg_image_->svg_image->height+0.5);
-  return (f1 < f2) ? f1 : f2;
+  release_counted_image(counted_svg_image_);
 }
 
 #if defined(HAVE_LIBZ)
@@ -116,19 +420,44 @@ static char *svg_inflate(const char *fname) {
 #endif
 
 void Fl_SVG_Image::init_(const char *filename, const char *in_filedata, Fl_SVG_Image *copy_source) {
+  to_desaturate_ = false;
+  average_weight_ = 1;
+  proportional = true;
+  rasterized_ = false;
+  struct stat st;
+  if (filename && fl_stat(filename, &st) == 0) {
+    // share the data of an image already loaded from this unmodified file
+    Fl_SVG_Counted_Image *f;
+    {
+      Fl_Internal_Lock lock(svg_mutex);
+      for (f = svg_files; f; f = f->next_file) {
+        if (f->mtime == st.st_mtime && f->size == st.st_size && !strcmp(f->filename, filename)) {
+          f->ref_count++;
+          break;
+        }
+      }
+    }
+    if (f) {
+      counted_svg_image_ = f;
+      w(f->svg_image->width + 0.5);
+      h(f->svg_image->height + 0.5);
+      return;
+    }
+  }
   if (copy_source) {
     filename = in_filedata = NULL;
+    Fl_Internal_Lock lock(svg_mutex);
     counted_svg_image_ = copy_source->counted_svg_image_;
     counted_svg_image_->ref_count++;
   } else {
-    counted_svg_image_ = new counted_NSVGimage;
+    counted_svg_image_ = new Fl_SVG_Counted_Image;
     counted_svg_image_->svg_image = NULL;
     counted_svg_image_->ref_count = 1;
+    counted_svg_image_->rasters = NULL;
+    counted_svg_image_->filename = NULL;
+    counted_svg_image_->next_file = NULL;
   }
   char *filedata = NULL;
-  to_desaturate_ = false;
-  average_weight_ = 1;
-  proportional = true;
   if (filename) {
 #if defined(HAVE_LIBZ)
     filedata = svg_inflate(filename);
@@ -164,27 +493,29 @@ void Fl_SVG_Image::init_(const char *filename, const char *in_filedata, Fl_SVG_I
     } else {
       w(counted_svg_image_->svg_image->width + 0.5);
       h(counted_svg_image_->svg_image->height + 0.5);
+      if (filename && fl_stat(filename, &st) == 0) { // allow sharing, see above
+        counted_svg_image_->filename = strdup(filename);
+        counted_svg_image_->mtime = st.st_mtime;
+        counted_svg_image_->size = st.st_size;
+        Fl_Internal_Lock lock(svg_mutex);
+        counted_svg_image_->next_file = svg_files;
+        svg_files = counted_svg_image_;
+      }
     }
   } else if (copy_source) {
     w(copy_source->w());
     h(copy_source->h());
   }
-  rasterized_ = false;
 }
 
 
 void Fl_SVG_Image::rasterize_(int W, int H) {
-  static NSVGrasterizer *rasterizer = nsvgCreateRasterizer();
-  double fx, fy;
-  if (proportional) {
-    fx = svg_scaling_(W, H);
-    fy = fx;
-  } else {
-    fx = (double)W / counted_svg_image_->svg_image->width;
-    fy = (double)H / counted_svg_image_->svg_image->height;
+  uchar *pixels = new uchar[W*H*4];
+  if (!cached_raster(counted_svg_image_, W, H, proportional, pixels)) {
+    rasterize_svg(counted_svg_image_->svg_image, proportional, W, H, pixels);
+    cache_raster(counted_svg_image_, W, H, proportional, pixels);
   }
-  array = new uchar[W*H*4];
-  nsvgRasterizeXY(rasterizer, counted_svg_image_->svg_image, 0, 0, fx, fy, (uchar* )array, W, H, W*4);
+  array = pixels;
   alloc_array = 1;
   data((const char * const *)&array, 1);
   d(4);
@@ -217,11 +548,7 @@ void Fl_SVG_Image::resize(int width, int height) {
     return;
   }
   int w1 = width, h1 = height;
-  if (proportional) {
-    float f = svg_scaling_(width, height);
-    w1 = int( int(counted_svg_image_->svg_image->width+0.5)*f + 0.5 );
-    h1 = int( int(counted_svg_image_->svg_image->height+0.5)*f + 0.5 );
-  }
+  raster_size(counted_svg_image_->svg_image, proportional, w1, h1);
   w(w1); h(h1);
   if (rasterized_ && w1 == raster_w_ && h1 == raster_h_) return;
   if (array) {
@@ -251,6 +578,75 @@ void Fl_SVG_Image::draw(int X, int Y, int W, int H, int cx, int cy) {
 }
 
 
+/** Prepares the rasterization of the image to the given size in pixels.
+ Use this for images that will be drawn at sizes known in advance, e.g. toolbar
+ icons drawn at w() x h() FLTK units on screens with scaling factors 1 and 2:
+ \code
+ icon->prerasterize(icon->w(), icon->h());
+ icon->prerasterize(2 * icon->w(), 2 * icon->h());
+ \endcode
+ The rasterization is stored in the cache of rasterizations shared by all copies
+ of this image, and is computed by a background thread if the platform supports it,
+ or else immediately. Drawing the image, or calling resize(), with that size later
+ only needs to copy the cached data. The aspect ratio is handled as in resize().
+ This does not change the size of the image.
+ \see raster_cache_limit(int)
+ */
+void Fl_SVG_Image::prerasterize(int width, int height) {
+  if (ld() < 0 || width <= 0 || height <= 0) return;
+  raster_size(counted_svg_image_->svg_image, proportional, width, height);
+  Fl_SVG_Raster_Job *job = new Fl_SVG_Raster_Job;
+  job->img = counted_svg_image_;
+  job->w = width;
+  job->h = height;
+  job->proportional = proportional;
+  {
+    Fl_Internal_Lock lock(svg_mutex);
+    if (find_raster(job->img, width, height, proportional)) {
+      delete job;
+      return;
+    }
+    job->img->ref_count++;
+  }
+  queue_raster_job(job);
+}
+
+
+/** Sets the maximum amount of memory used to cache rasterizations of all SVG images.
+ The least recently used rasterizations are freed when the limit is reached.
+ Rasterizations that need more than half of this amount are not cached.
+ Setting 0 disables the cache. The default value is 16 MB.
+ */
+void Fl_SVG_Image::raster_cache_limit(int bytes) {
+  Fl_Internal_Lock lock(svg_mutex);
+  raster_cache_max = (bytes > 0 ? bytes : 0);
+  trim_raster_cache(raster_cache_max);
+}
+
+
+/** Returns the maximum amount of memory used to cache rasterizations of all SVG images. */
+int Fl_SVG_Image::raster_cache_limit() {
+  return raster_cache_max;
+}
+
+
+/** Sets the number of threads used to rasterize large SVG images.
+ Large images are split into horizontal bands that are rasterized in parallel.
+ The result is identical to the rasterization by a single thread.
+ The default value 0 uses one thread per CPU, 1 disables the use of threads.
+ */
+void Fl_SVG_Image::raster_threads(int n) {
+  raster_thread_count = (n > 0 ? n : 0);
+}
+
+
+/** Returns the number of threads used to rasterize large SVG images.
+ \see raster_threads(int) */
+int Fl_SVG_Image::raster_threads() {
+  return raster_thread_count;
+}
+
+
 void Fl_SVG_Image::desaturate() {
   to_desaturate_ = true;
   Fl_RGB_Image::desaturate();
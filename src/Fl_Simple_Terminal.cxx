@@ -24,6 +24,7 @@
 #include <FL/Fl.H>
 #include <stdarg.h>
 #include "flstring.h"
+#include "fl_threads.h"
 
 #define STE_SIZE sizeof(Fl_Text_Display::Style_Table_Entry)
 
@@ -59,6 +60,43 @@ static const Fl_Text_Display::Style_Table_Entry builtin_stable[] = {
 static const int  builtin_stable_size = sizeof(builtin_stable);
 static const char builtin_normal_index = 17;        // the reset style index used by \033[0m
 
+// Text queued by queue_append() until the main thread appends it.
+//    Shared with the Fl::awake() callbacks, so it stays allocated until
+//    the last callback ran, even if the terminal was deleted before.
+//
+struct Fl_Simple_Terminal_Queue {
+  Fl_Internal_Mutex mutex;
+  Fl_Internal_Condition space;    // signalled when the queue was emptied
+  Fl_Simple_Terminal *term;       // 0 once the terminal was deleted
+  Fl_Internal_Thread_Id owner;    // the main thread (that created the terminal)
+  char *text;                     // queued text, 0 terminated
+  int len, size;                  // length and allocated size of 'text'
+  char *spare;                    // 2nd buffer, swapped with 'text' when flushing
+  int spare_size;                 // allocated size of 'spare'
+  int limit;                      // queue_limit()
+  int rate;                       // queue_rate()
+  bool block;                     // queue_block()
+  bool notified;                  // main thread was told about the queued text
+  int awakes;                     // Fl::awake() callbacks that didn't run yet
+  unsigned long dropped;          // queue_dropped()
+  Fl_Simple_Terminal_Queue(Fl_Simple_Terminal *t) {
+    term = t;
+    owner = fl_thread_id();
+    text = spare = 0;
+    len = size = spare_size = 0;
+    limit = 1024*1024;
+    rate = 30;
+    block = true;
+    notified = false;
+    awakes = 0;
+    dropped = 0;
+  }
+  ~Fl_Simple_Terminal_Queue() {
+    free(text);
+    free(spare);
+  }
+};
+
 // Count how many times character 'c' appears in string 's'
 static int strcnt(const char *s, char c) {
   int count = 0;
@@ -88,6 +126,10 @@ Fl_Simple_Terminal::Fl_Simple_Terminal(int X,int Y,int W,int H,const char *l) :
   lines = 0;                    // note: lines!=mNBufferLines when lines are wrapping
   scrollaway = false;
   scrolling = false;
+  ansi_text_ = 0;
+  ansi_style_ = 0;
+  ansi_size_ = 0;
+  queue_ = new Fl_Simple_Terminal_Queue(this);
   // These defaults similar to typical DOS/unix terminals
   textfont(FL_COURIER);
   color(FL_BLACK);
@@ -98,6 +140,7 @@ Fl_Simple_Terminal::Fl_Simple_Terminal(int X,int Y,int W,int H,const char *l) :
   cursor_style(Fl_Text_Display::BLOCK_CURSOR);
   // Setup text buffer
   buf = new Fl_Text_Buffer();
+  buf->canUndo(0);              // a terminal never undoes, don't save removed history
   buffer(buf);
   sbuf = new Fl_Text_Buffer();  // allocate whether we use it or not
   // XXX: We use WRAP_AT_BOUNDS to prevent the hscrollbar from /always/
@@ -122,6 +165,15 @@ Fl_Simple_Terminal::~Fl_Simple_Terminal() {
   buffer(0);    // disassociate buffer /before/ we delete it
   if ( buf  ) { delete buf;  buf  = 0; }
   if ( sbuf ) { delete sbuf; sbuf = 0; }
+  free(ansi_text_);
+  free(ansi_style_);
+  // The queue is deleted by the last pending Fl::awake() callback, if any
+  Fl::remove_timeout(queue_timer_cb, (void*)this);
+  queue_->mutex.lock();
+  queue_->term = 0;
+  bool orphan = queue_->awakes > 0;
+  queue_->mutex.unlock();
+  if ( !orphan ) delete queue_;
 }
 
 /**
@@ -516,9 +568,18 @@ void Fl_Simple_Terminal::append(const char *s, int len) {
     int nstyles = stable_size_ / STE_SIZE;
     if ( len < 0 ) len = strlen(s);
     // New text buffer (after ansi codes parsed+removed)
-    char *ntm = (char*)malloc(len+1);       // new text memory
+    //    Kept between calls so logging many small strings doesn't
+    //    malloc/free twice per call.
+    if ( len + 1 > ansi_size_ ) {
+      ansi_size_ = (len + 1 > 2 * ansi_size_) ? len + 1 : 2 * ansi_size_;
+      free(ansi_text_);
+      free(ansi_style_);
+      ansi_text_  = (char*)malloc(ansi_size_);
+      ansi_style_ = (char*)malloc(ansi_size_);
+    }
+    char *ntm = ansi_text_;                 // new text memory
     char *ntp = ntm;
-    char *nsm = (char*)malloc(len+1);       // new style memory
+    char *nsm = ansi_style_;                // new style memory
     char *nsp = nsm;
     // ANSI values
     char astyle = 'A'+current_style_index_; // the running style index
@@ -599,8 +660,6 @@ void Fl_Simple_Terminal::append(const char *s, int len) {
     //::printf("  RESULT: nsm='%s'\n", nsm);
     buf->append(ntm);           // new text memory
     sbuf->append(nsm);          // new style memory
-    free(ntm);
-    free(nsm);
   } else {
     // non-ansi buffer
     buf->append(s);
@@ -701,6 +760,279 @@ void Fl_Simple_Terminal::clear() {
   lines = 0;
 }
 
+/**
+ Appends string 's' to the terminal from any thread.
+
+ Unlike append(), this can be called by worker threads without
+ holding Fl::lock(). The text is copied to a queue, and the main
+ thread appends everything queued so far with a single append(),
+ at most queue_rate() times per second. This makes logging many
+ small messages from other threads much cheaper, since the text
+ buffers are modified and the display is updated once per batch
+ instead of once per message.
+
+ As with Fl::awake(), the application must call Fl::lock() once
+ in the main thread before starting the threads, and the main
+ thread must run the event loop (Fl::run() or Fl::wait()).
+
+ If the queue holds more than queue_limit() bytes, the text is either
+ dropped and counted in queue_dropped(), or the calling thread waits
+ until the main thread took the queued text, see queue_block(bool).
+ The main thread itself never waits; it flushes the queue instead.
+
+ If FLTK was built without thread support, this is the same as append().
+
+ \note Threads must stop calling this method before the terminal is
+       deleted, and must not hold Fl::lock() while calling it if
+       queue_block() is true.
+
+ \param s string to append.
+ \param len optional length of string, if known.
+
+ \see queue_printf(), queue_flush(), append()
+ \version 1.4.0
+*/
+void Fl_Simple_Terminal::queue_append(const char *s, int len) {
+#ifndef FL_HAVE_INTERNAL_THREADS
+  append(s, len);
+#else
+  if ( len < 0 ) len = (int)strlen(s);
+  if ( len == 0 ) return;
+  Fl_Simple_Terminal_Queue *q = queue_;
+  q->mutex.lock();
+  if ( q->limit > 0 && q->len > 0 && q->len + len > q->limit ) {
+    if ( !q->block ) {                  // drop the text
+      q->dropped++;
+      q->mutex.unlock();
+      return;
+    }
+    if ( fl_thread_is_current(q->owner) ) {
+      // the main thread must never wait: other threads may fill the queue
+      // again at any time, and only the main thread empties it
+      q->mutex.unlock();
+      queue_flush();                    // keeps the order of earlier text
+      append(s, len);
+      return;
+    }
+    while ( q->len > 0 && q->len + len > q->limit ) {
+      if ( q->notified ) { q->space.wait(q->mutex); continue; }
+      // The main thread doesn't know about the queued text, because the
+      // Fl::awake() ring was full when it was queued: tell it now, and if
+      // the ring is still full, try again soon
+      q->notified = true;
+      q->awakes++;
+      q->mutex.unlock();
+      bool failed = Fl::awake(queue_awake_cb, (void*)q) < 0;
+      q->mutex.lock();
+      if ( failed ) {
+        q->notified = false;
+        q->awakes--;
+        q->space.wait(q->mutex, 10);
+      }
+    }
+  }
+  if ( q->len + len + 1 > q->size ) {
+    int size = q->size ? q->size : 1024;
+    while ( size < q->len + len + 1 ) size *= 2;
+    q->text = (char*)realloc(q->text, size);
+    q->size = size;
+  }
+  memcpy(q->text + q->len, s, len);
+  q->len += len;
+  q->text[q->len] = 0;
+  bool notify = !q->notified;
+  if ( notify ) { q->notified = true; q->awakes++; }
+  q->mutex.unlock();
+  if ( notify && Fl::awake(queue_awake_cb, (void*)q) < 0 ) {
+    // awake ring is full: let the next call try again
+    q->mutex.lock();
+    q->notified = false;
+    q->awakes--;
+    q->mutex.unlock();
+  }
+#endif
+}
+
+/**
+ Appends printf formatted messages to the terminal from any thread.
+
+ This is the thread-safe version of printf(), see queue_append().
+
+ \note The expanded string is currently limited to 1024 characters.
+ \param[in] fmt is a printf format string for the message text.
+ \version 1.4.0
+*/
+void Fl_Simple_Terminal::queue_printf(const char *fmt, ...) {
+  char buffer[1024];
+  va_list ap;
+  va_start(ap, fmt);
+  ::vsnprintf(buffer, 1024, fmt, ap);
+  va_end(ap);
+  buffer[1024-1] = 0;
+  queue_append(buffer);
+}
+
+/**
+ Appends all text queued by queue_append() to the terminal now.
+
+ This is called automatically by the main thread, at most queue_rate()
+ times per second. Call it to show queued text immediately, e.g. before
+ reading text(). Must be called from the main thread.
+ \version 1.4.0
+*/
+void Fl_Simple_Terminal::queue_flush() {
+  Fl_Simple_Terminal_Queue *q = queue_;
+  q->mutex.lock();
+  char *text = q->text;
+  int len = q->len, size = q->size;
+  q->text = q->spare;
+  q->size = q->spare_size;
+  q->len = 0;
+  q->spare = 0;
+  q->spare_size = 0;
+  q->notified = false;
+  q->space.broadcast();
+  q->mutex.unlock();
+  if ( len > 0 ) append(text, len);
+  q->mutex.lock();                      // reuse the buffer for the next flush
+  q->spare = text;
+  q->spare_size = size;
+  q->mutex.unlock();
+}
+
+// Main thread was woken up by queue_append()
+//    Flush now, then at most every 1/queue_rate() seconds while
+//    more text arrives. The timer flushes text queued meanwhile.
+//
+void Fl_Simple_Terminal::queue_ready() {
+  if ( Fl::has_timeout(queue_timer_cb, (void*)this) ) return;
+  queue_flush();
+  int rate = queue_rate();
+  if ( rate > 0 ) Fl::add_timeout(1.0 / rate, queue_timer_cb, (void*)this);
+}
+
+void Fl_Simple_Terminal::queue_awake_cb(void *data) {
+  Fl_Simple_Terminal_Queue *q = (Fl_Simple_Terminal_Queue*)data;
+  q->mutex.lock();
+  q->awakes--;
+  Fl_Simple_Terminal *term = q->term;
+  bool orphan = (!term && q->awakes == 0);
+  q->mutex.unlock();
+  if ( orphan ) delete q;               // terminal was deleted, we're the last user
+  else if ( term ) term->queue_ready();
+}
+
+void Fl_Simple_Terminal::queue_timer_cb(void *data) {
+  Fl_Simple_Terminal *o = (Fl_Simple_Terminal*)data;
+  o->queue_->mutex.lock();
+  bool pending = o->queue_->len > 0;
+  int rate = o->queue_->rate;
+  o->queue_->mutex.unlock();
+  if ( !pending ) return;
+  o->queue_flush();
+  if ( rate > 0 ) Fl::repeat_timeout(1.0 / rate, queue_timer_cb, data);
+}
+
+/**
+ Sets the maximum number of bytes queued by queue_append() before
+ the text is appended to the terminal.
+
+ What happens if the queue is full depends on queue_block(bool).
+ The default is 1048576 (1 MB).
+
+ \param bytes Maximum queue size in bytes, 0 for no limit.
+ \version 1.4.0
+*/
+void Fl_Simple_Terminal::queue_limit(int bytes) {
+  queue_->mutex.lock();
+  queue_->limit = bytes;
+  queue_->space.broadcast();
+  queue_->mutex.unlock();
+}
+
+/**
+ Gets the maximum number of bytes queued by queue_append().
+ \see queue_limit(int)
+ \version 1.4.0
+*/
+int Fl_Simple_Terminal::queue_limit() const {
+  Fl_Internal_Lock lock(queue_->mutex);
+  return queue_->limit;
+}
+
+/**
+ Sets what queue_append() does if the queue is full.
+
+ If true (the default), the calling thread waits until the main thread
+ appended the queued text. If false, the new text is dropped and
+ counted in queue_dropped().
+ \version 1.4.0
+*/
+void Fl_Simple_Terminal::queue_block(bool val) {
+  queue_->mutex.lock();
+  queue_->block = val;
+  queue_->space.broadcast();
+  queue_->mutex.unlock();
+}
+
+/**
+ Gets what queue_append() does if the queue is full.
+ \see queue_block(bool)
+ \version 1.4.0
+*/
+bool Fl_Simple_Terminal::queue_block() const {
+  Fl_Internal_Lock lock(queue_->mutex);
+  return queue_->block;
+}
+
+/**
+ Sets how many times per second text queued by queue_append()
+ is appended to the terminal at most.
+
+ The default is 30. Use 0 to append queued text every time the
+ main thread is woken up, which is more responsive but more costly
+ when threads log a lot of text.
+ \version 1.4.0
+*/
+void Fl_Simple_Terminal::queue_rate(int val) {
+  queue_->mutex.lock();
+  queue_->rate = val < 0 ? 0 : val;
+  queue_->mutex.unlock();
+}
+
+/**
+ Gets how many times per second queued text is appended at most.
+ \see queue_rate(int)
+ \version 1.4.0
+*/
+int Fl_Simple_Terminal::queue_rate() const {
+  Fl_Internal_Lock lock(queue_->mutex);
+  return queue_->rate;
+}
+
+/**
+ Sets the number of queue_append() calls whose text was dropped,
+ e.g. 0 to reset the counter.
+ \see queue_dropped()
+ \version 1.4.0
+*/
+void Fl_Simple_Terminal::queue_dropped(unsigned long val) {
+  queue_->mutex.lock();
+  queue_->dropped = val;
+  queue_->mutex.unlock();
+}
+
+/**
+ Gets the number of queue_append() calls whose text was dropped
+ because the queue was full and queue_block() was false.
+ \see queue_limit(int), queue_block(bool)
+ \version 1.4.0
+*/
+unsigned long Fl_Simple_Terminal::queue_dropped() const {
+  Fl_Internal_Lock lock(queue_->mutex);
+  return queue_->dropped;
+}
+
 /**
  Remove the specified range of lines from the terminal, starting
  with line 'start' and removing 'count' lines.
@@ -27,6 +27,7 @@
 #include <string.h>
 #include "flstring.h"
 #include <time.h>
+#include <sys/stat.h>
 
 const int Fl_System_Driver::fl_NoValue =     0x0000;
 const int Fl_System_Driver::fl_WidthValue =  0x0004;
@@ -407,6 +408,13 @@ int Fl_System_Driver::file_browser_load_directory(const char *directory, char *f
   return filename_list(directory, pfiles, sort);
 }
 
+int Fl_System_Driver::file_browser_load_directory(const char *directory, char *filename,
+                                                  size_t name_size, Fl_Filename_Entry **pentries, int sort,
+                                                  int (*progress)(void *data, const char *name, int type), void *data)
+{
+  return filename_list_entries(directory, pentries, sort, 0, progress, data);
+}
+
 int Fl_System_Driver::file_type(const char *filename)
 {
   return Fl_File_Icon::ANY;
@@ -436,6 +444,56 @@ FILE *Fl_System_Driver::fopen(const char* f, const char *mode) {
   return ::fopen(f, mode);
 }
 
+int Fl_System_Driver::replace_file(const char *filename, const char *data, size_t size) {
+  size_t len = strlen(filename);
+  char *tmp = (char*)malloc(len + 5);
+  memcpy(tmp, filename, len);
+  memcpy(tmp + len, ".tmp", 5);
+  FILE *f = this->fopen(tmp, "wb");
+  if (!f) {
+    free(tmp);
+    return -1;
+  }
+  int ok = (size == 0 || fwrite(data, size, 1, f) == 1);
+  if (fclose(f) != 0) ok = 0;
+  struct stat st;
+  if (ok && this->stat(filename, &st) == 0) this->chmod(tmp, st.st_mode & 07777);
+  if (ok && this->rename(tmp, filename) == 0) {
+    free(tmp);
+    return 0;
+  }
+  this->unlink(tmp);
+  free(tmp);
+  return -1;
+}
+
+void *Fl_System_Driver::map_file(const char *filename, size_t *size) {
+  FILE *f = this->fopen(filename, "rb");
+  if (!f) return NULL;
+  char *data = NULL;
+  size_t n = 0, alloc = 0;
+  for (;;) {
+    if (alloc - n < 4096) {
+      alloc = alloc ? alloc * 2 : 16384;
+      data = (char*)realloc(data, alloc);
+    }
+    size_t r = fread(data + n, 1, alloc - n, f);
+    if (r == 0) break;
+    n += r;
+  }
+  fclose(f);
+  if (n == 0) {
+    free(data);
+    return NULL;
+  }
+  *size = n;
+  return data;
+}
+
+void Fl_System_Driver::unmap_file(void *data, size_t) {
+  free(data);
+}
+
 void Fl_System_Driver::open_callback(void (*)(const char *)) {
 }
 
@@ -445,6 +503,14 @@ void Fl_System_Driver::gettime(time_t *sec, int *usec) {
   *usec = 0;
 }
 
+// Get a time in seconds that never goes backwards.
+double Fl_System_Driver::monotonic_clock() {
+  time_t sec;
+  int usec;
+  gettime(&sec, &usec);
+  return sec + usec / 1e6;
+}
+
 //
 // End of "$Id$".
 //
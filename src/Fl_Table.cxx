@@ -48,6 +48,97 @@ void Fl_Table::IntVector::size(unsigned int count) {
   }
 }
 
+// Row heights or column widths with prefix sums (private to Fl_Table)
+
+Fl_Table::SizeVector::~SizeVector() { // DTOR
+  if (tree)
+    free(tree);
+  tree = 0;
+}
+
+// Build the Fenwick tree from arr in O(n)
+void Fl_Table::SizeVector::build() {
+  tree = (long*)realloc(tree, (_size + 1) * sizeof(long));
+  tree[0] = 0;
+  for ( unsigned int i = 1; i <= _size; i++ ) tree[i] = arr[i-1];
+  for ( unsigned int i = 1; i <= _size; i++ ) {
+    unsigned int parent = i + (i & (0 - i));
+    if ( parent <= _size ) tree[parent] += tree[i];
+  }
+}
+
+// Set number of entries, new entries get size 'val'
+void Fl_Table::SizeVector::size(unsigned int count, int val) {
+  if ( count == 0 && tree ) {		// empty again: back to uniform
+    free(tree);
+    tree = 0;
+    arr.size(0);
+    _size = 0;
+  }
+  if ( !tree && (count <= _size || _size == 0 || val == uniform) ) {
+    // OPTIMIZATION: stay uniform
+    if ( _size == 0 ) uniform = val;
+    _size = count;
+    return;
+  }
+  if ( !tree ) {			// first different size: create array
+    arr.size(_size);
+    for ( unsigned int i = 0; i < _size; i++ ) arr[i] = uniform;
+  }
+  unsigned int now_size = _size;
+  arr.size(count);
+  while ( now_size < count ) arr[now_size++] = val;
+  _size = count;
+  build();
+}
+
+// Set size of entry 'x' to 'val'
+void Fl_Table::SizeVector::set(int x, int val) {
+  if ( !tree ) {
+    if ( val == uniform ) return;	// OPTIMIZATION: stay uniform
+    if ( _size == 1 ) { uniform = val; return; }
+    arr.size(_size);
+    for ( unsigned int i = 0; i < _size; i++ ) arr[i] = uniform;
+    arr[x] = val;
+    build();
+    return;
+  }
+  long delta = (long)val - arr[x];
+  arr[x] = val;
+  for ( unsigned int i = x + 1; i <= _size; i += i & (0 - i) )
+    tree[i] += delta;
+}
+
+// Return sum of the sizes of all entries before entry 'x'
+long Fl_Table::SizeVector::position(int x) const {
+  if ( x <= 0 ) return(0);
+  if ( x > (int)_size ) x = _size;
+  if ( !tree ) return((long)x * uniform);
+  long pos = 0;
+  for ( unsigned int i = x; i > 0; i -= i & (0 - i) )
+    pos += tree[i];
+  return(pos);
+}
+
+// Return the number of leading entries that end at or before 'pos',
+// i.e. the largest x with position(x) <= pos. Sizes must not be negative.
+int Fl_Table::SizeVector::find(long pos) const {
+  if ( pos < 0 ) return(0);
+  if ( !tree ) {
+    if ( uniform <= 0 || pos / uniform >= (long)_size ) return(_size);
+    return((int)(pos / uniform));
+  }
+  unsigned int x = 0, step = 1;
+  while ( step * 2 <= _size ) step *= 2;
+  for ( ; step > 0; step /= 2 ) {
+    if ( x + step <= _size && tree[x + step] <= pos ) {
+      x += step;
+      pos -= tree[x];
+    }
+  }
+  return((int)x);
+}
+
 
 /** Sets the vertical scroll position so 'row' is at the top,
     and causes the screen to redraw.
@@ -90,38 +181,14 @@ void Fl_Table::col_position(int col) {
   Returns the scroll position (in pixels) of the specified 'row'.
 */
 long Fl_Table::row_scroll_position(int row) {
-  int startrow = 0;
-  long scroll = 0; 
-  // OPTIMIZATION: 
-  //     Attempt to use precomputed row scroll position
-  //
-  if ( toprow_scrollpos != -1 && row >= toprow ) {
-    scroll = toprow_scrollpos;
-    startrow = toprow;
-  }
-  for ( int t=startrow; t<row; t++ ) {
-    scroll += row_height(t);
-  }
-  return(scroll);
+  return(_rowheights.position(row));
 }
 
 /**
   Returns the scroll position (in pixels) of the specified column 'col'.
 */
 long Fl_Table::col_scroll_position(int col) {
-  int startcol = 0;
-  long scroll = 0;
-  // OPTIMIZATION: 
-  //     Attempt to use precomputed row scroll position
-  //
-  if ( leftcol_scrollpos != -1 && col >= leftcol ) {
-    scroll = leftcol_scrollpos;
-    startcol = leftcol;
-  }
-  for ( int t=startcol; t<col; t++ ) {
-    scroll += col_width(t);
-  }
-  return(scroll);
+  return(_colwidths.position(col));
 }
 
 /**
@@ -214,13 +281,10 @@ void Fl_Table::row_height(int row, int height) {
     return;		// OPTIMIZATION: no change? avoid redraw
   }
   // Add row heights, even if none yet
-  int now_size = (int)_rowheights.size();
-  if ( row >= now_size ) {
-    _rowheights.size(row);
-    while (now_size < row)
-      _rowheights[now_size++] = height;
+  if ( row >= (int)_rowheights.size() ) {
+    _rowheights.size(row+1, height);
   }
-  _rowheights[row] = height;
+  _rowheights.set(row, height);
   table_resized();
   if ( row <= botrow ) {	// OPTIMIZATION: only redraw if onscreen or above screen
     redraw();
@@ -243,14 +307,10 @@ void Fl_Table::col_width(int col, int width)
     return;			// OPTIMIZATION: no change? avoid redraw
   }
   // Add column widths, even if none yet
-  int now_size = (int)_colwidths.size();
-  if ( col >= now_size ) {
-    _colwidths.size(col+1);
-    while (now_size < col) {
-      _colwidths[now_size++] = width;
-    }
+  if ( col >= (int)_colwidths.size() ) {
+    _colwidths.size(col+1, width);
   }
-  _colwidths[col] = width;
+  _colwidths.set(col, width);
   table_resized();
   if ( col <= rightcol ) {	// OPTIMIZATION: only redraw if onscreen or to the left
     redraw();
@@ -562,38 +622,30 @@ void Fl_Table::recalc_dimensions() {
   TODO: Assumes ti[xywh] has already been recalculated.
 */
 void Fl_Table::table_scrolled() {
-  // Find top row
-  int y, row, voff = vscrollbar->value();
-  for ( row=y=0; row < _rows; row++ ) {
-    y += row_height(row);
-    if ( y > voff ) { y -= row_height(row); break; }
-  }
+  // Find top row: first row whose bottom edge is below the scroll position
+  //    Binary searches of the row heights' prefix sums.
+  //
+  int row, voff = vscrollbar->value();
+  row = _rowheights.find(voff);
+  if ( row > _rows ) row = _rows;
   _row_position = toprow = ( row >= _rows ) ? (row - 1) : row;
-  toprow_scrollpos = y;		// OPTIMIZATION: save for later use 
-  // Find bottom row
+  toprow_scrollpos = (int)_rowheights.position(row);	// kept for subclasses
+  // Find bottom row: first row whose bottom edge reaches the window's bottom
   voff = vscrollbar->value() + tih;
-  for ( ; row < _rows; row++ ) {
-    y += row_height(row);
-    if ( y >= voff ) { break; }
-  }
-  botrow = ( row >= _rows ) ? (row - 1) : row; 
+  int bot = _rowheights.find(voff - 1);
+  if ( bot > row ) row = bot;
+  botrow = ( row >= _rows ) ? (_rows - 1) : row; 
   // Left column
-  int x, col, hoff = hscrollbar->value();
-  for ( col=x=0; col < _cols; col++ ) {
-    x += col_width(col);
-    if ( x > hoff ) { x -= col_width(col); break; }
-  }
+  int col, hoff = hscrollbar->value();
+  col = _colwidths.find(hoff);
+  if ( col > _cols ) col = _cols;
   _col_position = leftcol = ( col >= _cols ) ? (col - 1) : col;
-  leftcol_scrollpos = x;	// OPTIMIZATION: save for later use 
+  leftcol_scrollpos = (int)_colwidths.position(col);	// kept for subclasses
   // Right column
-  //    Work with data left over from leftcol calculation
-  //
   hoff = hscrollbar->value() + tiw;
-  for ( ; col < _cols; col++ ) {
-    x += col_width(col);
-    if ( x >= hoff ) { break; }
-  }
-  rightcol = ( col >= _cols ) ? (col - 1) : col; 
+  int right = _colwidths.find(hoff - 1);
+  if ( right > col ) col = right;
+  rightcol = ( col >= _cols ) ? (_cols - 1) : col; 
   // First tell children to scroll
   draw_cell(CONTEXT_RC_RESIZE, 0,0,0,0,0,0);
 }
@@ -660,11 +712,7 @@ void Fl_Table::rows(int val) {
   _rows = val;
   {
     int default_h = ( _rowheights.size() > 0 ) ? _rowheights.back() : 25;
-    int now_size = _rowheights.size();
-    _rowheights.size(val);			// enlarge or shrink as needed
-    while ( now_size < val ) {
-      _rowheights[now_size++] = default_h;	// fill new
-    }
+    _rowheights.size(val, default_h);		// enlarge or shrink as needed, fill new
   }
   table_resized();
   
@@ -682,12 +730,8 @@ void Fl_Table::rows(int val) {
 void Fl_Table::cols(int val) {
   _cols = val;
   {
-    int default_w = ( _colwidths.size() > 0 ) ? _colwidths[_colwidths.size()-1] : 80;
-    int now_size = _colwidths.size();
-    _colwidths.size(val);			// enlarge or shrink as needed
-    while ( now_size < val ) {
-      _colwidths[now_size++] = default_w;	// fill new
-    }
+    int default_w = ( _colwidths.size() > 0 ) ? _colwidths.back() : 80;
+    _colwidths.size(val, default_w);		// enlarge or shrink as needed, fill new
   }
   table_resized();
   redraw();
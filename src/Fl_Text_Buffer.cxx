@@ -107,6 +107,7 @@ Fl_Text_Buffer::Fl_Text_Buffer(int requestedSize, int preferredGapSize)
   mLength = 0;
   mPreferredGapSize = preferredGapSize;
   mBuf = (char *) malloc(requestedSize + mPreferredGapSize);
+  mBufFront = 0;
   mGapStart = 0;
   mGapEnd = requestedSize + mPreferredGapSize;
   mTabDist = 8;
@@ -134,7 +135,7 @@ Fl_Text_Buffer::Fl_Text_Buffer(int requestedSize, int preferredGapSize)
  */
 Fl_Text_Buffer::~Fl_Text_Buffer()
 {
-  free(mBuf);
+  free(mBuf - mBufFront);
   if (mNModifyProcs != 0) {
     delete[]mModifyProcs;
     delete[]mCbArgs;
@@ -175,11 +176,12 @@ void Fl_Text_Buffer::text(const char *t)
   /* Save information for redisplay, and get rid of the old buffer */
   const char *deletedText = text();
   int deletedLength = mLength;
-  free((void *) mBuf);
+  free((void *) (mBuf - mBufFront));
   
   /* Start a new buffer with a gap of mPreferredGapSize at the end */
   int insertedLength = (int) strlen(t);
   mBuf = (char *) malloc(insertedLength + mPreferredGapSize);
+  mBufFront = 0;
   mLength = insertedLength;
   mGapStart = insertedLength;
   mGapEnd = mGapStart + mPreferredGapSize;
@@ -1178,10 +1180,14 @@ int Fl_Text_Buffer::insert_(int pos, const char *text)
    the current buffer, just move the gap (if necessary) to where
    the text should be inserted.  If the new text is too large, reallocate
    the buffer with a gap large enough to accomodate the new text and a
-   gap of mPreferredGapSize */
-  if (insertedLength > mGapEnd - mGapStart)
-    reallocate_with_gap(pos, insertedLength + mPreferredGapSize);
-  else if (pos != mGapStart)
+   gap of mPreferredGapSize, or an eighth of the text if that is larger,
+   so that a buffer that keeps growing (e.g. a log) is not copied every
+   mPreferredGapSize bytes */
+  if (insertedLength > mGapEnd - mGapStart) {
+    int gapSize = mLength / 8;
+    if (gapSize < mPreferredGapSize) gapSize = mPreferredGapSize;
+    reallocate_with_gap(pos, insertedLength + gapSize);
+  } else if (pos != mGapStart)
     move_gap(pos);
   
   /* Insert the new text (pos now corresponds to the start of the gap) */
@@ -1229,6 +1235,21 @@ void Fl_Text_Buffer::remove_(int start, int end)
     undowidget = this;
   }
   
+  if (start == 0 && end < mGapStart) {
+    /* Removing text at the front (e.g. trimming a log): instead of moving
+     the gap there, release the bytes at the start of the allocation. They
+     are returned when the buffer is reallocated. */
+    if (mCanUndo)
+      memcpy(undobuffer, mBuf, end);
+    mBuf += end;
+    mBufFront += end;
+    mGapStart -= end;
+    mGapEnd -= end;
+    mLength -= end;
+    update_selections(0, end, 0);
+    return;
+  }
+
   if (start > mGapStart) {
     if (mCanUndo)
       memcpy(undobuffer, mBuf + (mGapEnd - mGapStart) + start,
@@ -1501,8 +1522,9 @@ void Fl_Text_Buffer::reallocate_with_gap(int newGapStart, int newGapLen)
 	   &mBuf[mGapEnd + newGapStart - mGapStart],
 	   mLength - newGapStart);
   }
-  free((void *) mBuf);
+  free((void *) (mBuf - mBufFront));
   mBuf = newBuf;
+  mBufFront = 0;
   mGapStart = newGapStart;
   mGapEnd = newGapEnd;
 }
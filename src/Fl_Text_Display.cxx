@@ -58,6 +58,12 @@
 
 #define NO_HINT -1
 
+// Continuous wrap mode line counting: distance in bytes between entries
+// of the wrap index, and bytes counted before the rest of a buffer is
+// counted in the background (see count_buffer_lines())
+#define WRAP_INDEX_STEP 65536
+#define WRAP_COUNT_SYNC (8 * WRAP_INDEX_STEP)
+
 /* Masks for text drawing methods.  These are or'd together to form an
  integer which describes what drawing calls to use to draw a string */
 #define FILL_MASK         0x0100
@@ -118,6 +124,11 @@ Fl_Text_Display::Fl_Text_Display(int X, int Y, int W, int H, const char* l)
   mLastChar = 0;
   mContinuousWrap = 0;
   mWrapMarginPix = 0;
+  mWrapCountWidth = -1;
+  mWrapCounting = 0;
+  mWrapIndex = NULL;
+  mWrapIndexSize = 0;
+  mWrapIndexAlloc = 0;
   mLineStarts = new int[mNVisibleLines];
   { // This code unused unless mNVisibleLines is ever initialized >1
     for (int i=1; i<mNVisibleLines; i++) mLineStarts[i] = -1;
@@ -198,11 +209,14 @@ Fl_Text_Display::~Fl_Text_Display() {
     Fl::remove_timeout(scroll_timer_cb, this);
     scroll_direction = 0;
   }
+  if (mWrapCounting)
+    Fl::remove_timeout(wrap_count_cb, this);
   if (mBuffer) {
     mBuffer->remove_modify_callback(buffer_modified_cb, this);
     mBuffer->remove_predelete_callback(buffer_predelete_cb, this);
   }
   if (mLineStarts) delete[] mLineStarts;
+  free(mWrapIndex);
   if (linenumber_format_) {
     free((void*)linenumber_format_);
     linenumber_format_ = 0;
@@ -364,6 +378,7 @@ void Fl_Text_Display::buffer( Fl_Text_Buffer *buf ) {
   /* Add the buffer to the display, and attach a callback to the buffer for
    receiving modification information when the buffer contents change */
   mBuffer = buf;
+  mWrapCountWidth = -1;
   if (mBuffer) {
     mBuffer->add_modify_callback( buffer_modified_cb, this );
     mBuffer->add_predelete_callback( buffer_predelete_cb, this );
@@ -420,6 +435,7 @@ void Fl_Text_Display::highlight_data(Fl_Text_Buffer *styleBuffer,
   mUnfinishedHighlightCB = unfinishedHighlightCB;
   mHighlightCBArg = cbArg;
   mColumnScale = 0;
+  mWrapCountWidth = -1;
 
   mStyleBuffer->canUndo(0);
   damage(FL_DAMAGE_EXPOSE);
@@ -477,8 +493,6 @@ void Fl_Text_Display::recalc_display() {
   unsigned int vscrollbarvisible = mVScrollBar->visible();
   int scrollsize = scrollbar_width_ ? scrollbar_width_ : Fl::scrollbar_size();
 
-  int oldTAWidth = text_area.w;
-
   int X = x() + Fl::box_dx(box());
   int Y = y() + Fl::box_dy(box());
   int W = w() - Fl::box_dw(box());
@@ -507,12 +521,12 @@ void Fl_Text_Display::recalc_display() {
   // for large buffers that suffer from slow calculations of character width
   // to determine line wrapping.
 
-  oldTAWidth = -1; // force _first_ calculation in loop (STR #3412)
-
   if (mContinuousWrap && !mWrapMarginPix) {
 
     int nvlines = (text_area.h + mMaxsize - 1) / mMaxsize;
-    int nlines = buffer()->count_lines(0,buffer()->length());
+    // reuse the wrapped line count if it was made with a vertical scrollbar
+    int nlines = mWrapCountWidth == text_area.w - scrollsize ?
+                 mNBufferLines : buffer()->count_lines(0,buffer()->length());
     if (nvlines < 1) nvlines = 1;
     if (nlines >= nvlines-1) {
       mVScrollBar->set_visible(); // we need a vertical scrollbar
@@ -529,16 +543,18 @@ void Fl_Text_Display::recalc_display() {
      the top character no longer pointing at a valid line start */
 
 #ifdef DEBUG2
-     printf("*** again ... text_area.w = %d, oldTAWidth = %d, diff = %d\n",
-	      text_area.w, oldTAWidth, text_area.w - oldTAWidth);
+     printf("*** again ... text_area.w = %d, mWrapCountWidth = %d, diff = %d\n",
+	      text_area.w, mWrapCountWidth, text_area.w - mWrapCountWidth);
 #endif // DEBUG2
 
-    if (mContinuousWrap && !mWrapMarginPix && text_area.w != oldTAWidth) {
+    // The line count is kept up to date by buffer_modified_cb(), so only
+    // count again if the wrap width or the fonts have changed (STR #3412)
+    if (mContinuousWrap &&
+        (mWrapMarginPix ? mWrapMarginPix : text_area.w) != mWrapCountWidth) {
 
       int oldFirstChar = mFirstChar;
-      mNBufferLines = count_lines(0, buffer()->length(), true);
       mFirstChar = line_start(mFirstChar);
-      mTopLineNum = count_lines(0, mFirstChar, true)+1;
+      count_buffer_lines();
       absolute_top_line_number(oldFirstChar);
 #ifdef DEBUG2
       printf("    mNBufferLines=%d\n", mNBufferLines);
@@ -546,8 +562,6 @@ void Fl_Text_Display::recalc_display() {
 
     }
 
-    oldTAWidth = text_area.w;
-
     /* reallocate and update the line starts array, which may have changed
      size and / or contents.  */
     int nvlines = (text_area.h + mMaxsize - 1) / mMaxsize;
@@ -933,14 +947,17 @@ void Fl_Text_Display::wrap_mode(int wrap, int wrapMargin) {
   }
 
   if (buffer()) {
-    /* wrapping can change the total number of lines, re-count */
-    mNBufferLines = count_lines(0, buffer()->length(), true);
-
     /* changing wrap margins or changing from wrapped mode to non-wrapped
      can leave the character at the top no longer at a line start, and/or
      change the line number */
     mFirstChar = line_start(mFirstChar);
-    mTopLineNum = count_lines(0, mFirstChar, true) + 1;
+
+    /* wrapping can change the total number of lines, re-count (when
+     wrapping at the bounds, recalc_display() counts for the new width) */
+    if (mContinuousWrap && !mWrapMarginPix)
+      mWrapCountWidth = -1;
+    else
+      count_buffer_lines();
 
     reset_absolute_top_line_number();
 
@@ -1719,6 +1736,16 @@ void Fl_Text_Display::buffer_modified_cb( int pos, int nInserted, int nDeleted,
 
   /* Update the line count for the whole buffer */
   textD->mNBufferLines += linesInserted - linesDeleted;
+  if (textD->mContinuousWrap && (nInserted != 0 || nDeleted != 0)) {
+    textD->wrap_index_update(pos, nInserted, nDeleted, linesInserted - linesDeleted);
+    /* In wrap mode a last line without a newline is counted as well, but
+     the line counts above only count line breaks */
+    if (pos + nInserted == buf->length()) {
+      int oldLast = nDeleted ? deletedText[nDeleted - 1] : pos ? buf->byte_at(pos - 1) : '\n';
+      int newLast = pos + nInserted ? buf->byte_at(pos + nInserted - 1) : '\n';
+      textD->mNBufferLines += (newLast != '\n') - (oldLast != '\n');
+    }
+  }
 
   /* Update the cursor position */
   if ( textD->mCursorToHint != NO_HINT ) {
@@ -2599,7 +2626,10 @@ void Fl_Text_Display::offset_line_starts( int newTopLineNum ) {
    known line start (start or end of buffer, or the closest value in the
    lineStarts array) */
   lastLineNum = oldTopLineNum + nVisLines - 1;
-  if ( newTopLineNum < oldTopLineNum && newTopLineNum < -lineDelta ) {
+  if ( (lineDelta > 2 * nVisLines || -lineDelta > 2 * nVisLines) &&
+       (i = wrap_index_skip( newTopLineNum - 1 )) >= 0 ) {
+    mFirstChar = i;
+  } else if ( newTopLineNum < oldTopLineNum && newTopLineNum < -lineDelta ) {
     mFirstChar = skip_lines( 0, newTopLineNum - 1, true );
   } else if ( newTopLineNum < oldTopLineNum ) {
     mFirstChar = rewind_lines( mFirstChar, -lineDelta );
@@ -2822,6 +2852,218 @@ void Fl_Text_Display::calc_last_char() {
 }
 
 
+// Internal: find the last entry of a wrap index with a position (field 0)
+// or line count (field 1) less than or equal to value, or 0 if there is none
+static int wrap_index_find(const int *index, int size, int value, int field) {
+  int lo = 0, hi = size - 1;
+  while (lo < hi) {
+    int mid = (lo + hi + 1) / 2;
+    if (index[2 * mid + field] <= value) lo = mid;
+    else hi = mid - 1;
+  }
+  return lo;
+}
+
+
+/**
+ \brief Count the lines in the buffer and the lines above the top line.
+
+ Sets mNBufferLines and mTopLineNum for the current wrap mode. mFirstChar
+ must be at the start of a line.
+
+ In continuous wrap mode this also rebuilds the wrap index, which records
+ the number of display lines before a logical line start about every
+ WRAP_INDEX_STEP bytes. buffer_modified_cb() keeps the index up to date, so
+ the buffer needs to be counted again only if the wrap width or the fonts
+ change, and scrolling can jump to any line without counting from the
+ start of the buffer.
+
+ Only the first WRAP_COUNT_SYNC bytes are counted right away. The line
+ numbers of a larger buffer are estimated from that part until the rest is
+ counted in the background by wrap_count_cb(). The visible lines are always
+ laid out exactly.
+ */
+void Fl_Text_Display::count_buffer_lines() {
+  if (mWrapCounting) {
+    Fl::remove_timeout(wrap_count_cb, this);
+    mWrapCounting = 0;
+  }
+  mWrapIndexSize = 0;
+
+  if (!mContinuousWrap) {
+    mWrapCountWidth = -1;
+    mNBufferLines = buffer()->count_lines(0, buffer()->length());
+    mTopLineNum = buffer()->count_lines(0, mFirstChar) + 1;
+    return;
+  }
+
+  mWrapCountWidth = mWrapMarginPix ? mWrapMarginPix : text_area.w;
+  wrap_index_add(0, 0);
+  int nLines = wrap_count_step(WRAP_COUNT_SYNC);
+  if (nLines >= 0) {
+    mNBufferLines = nLines;
+    mTopLineNum = wrap_index_lines(mFirstChar) + 1;
+    return;
+  }
+
+  // estimate the line numbers from the lines per byte counted so far
+  int pos = mWrapIndex[2 * mWrapIndexSize - 2];
+  nLines = mWrapIndex[2 * mWrapIndexSize - 1];
+  double linesPerByte = double(nLines) / pos;
+  mNBufferLines = nLines + int((buffer()->length() - pos) * linesPerByte);
+  if (mFirstChar < pos)
+    mTopLineNum = wrap_index_lines(mFirstChar) + 1;
+  else
+    mTopLineNum = min(mNBufferLines, nLines + int((mFirstChar - pos) * linesPerByte)) + 1;
+
+  mWrapCounting = 1;
+  Fl::add_timeout(0.0, wrap_count_cb, this);
+}
+
+
+/**
+ \brief Count more display lines after the last entry of the wrap index.
+
+ Counts at least \p nBytes in steps of about WRAP_INDEX_STEP bytes, each
+ ending at a logical line start that is added to the index.
+
+ \param nBytes number of bytes to count
+ \return the number of display lines in the buffer if the end of the buffer
+   was reached, otherwise -1
+ */
+int Fl_Text_Display::wrap_count_step(int nBytes) {
+  Fl_Text_Buffer *buf = buffer();
+  int len = buf->length();
+  int pos = mWrapIndex[2 * mWrapIndexSize - 2];
+  int nLines = mWrapIndex[2 * mWrapIndexSize - 1];
+  while (nBytes > 0) {
+    int next = buf->line_end(buf->utf8_align(min(pos + WRAP_INDEX_STEP, len)));
+    if (next >= len) {
+      // count the last line even if it has no newline
+      nLines += wrap_index_count(pos, len);
+      return len && buf->byte_at(len - 1) != '\n' ? nLines + 1 : nLines;
+    }
+    next++; // skip the newline
+    nLines += wrap_index_count(pos, next);
+    wrap_index_add(next, nLines);
+    nBytes -= next - pos;
+    pos = next;
+  }
+  return -1;
+}
+
+
+// Internal: timeout that counts the rest of a large buffer in the background
+void Fl_Text_Display::wrap_count_cb(void *d) {
+  Fl_Text_Display *textD = (Fl_Text_Display *)d;
+  if (textD->mWrapCountWidth < 0 || !textD->mContinuousWrap ||
+      textD->mWrapCountWidth != (textD->mWrapMarginPix ? textD->mWrapMarginPix
+                                                        : textD->text_area.w)) {
+    // the layout has changed, recalc_display() will count again
+    textD->mWrapCounting = 0;
+    return;
+  }
+  int nLines = textD->wrap_count_step(4 * WRAP_INDEX_STEP);
+  if (nLines < 0) {
+    Fl::repeat_timeout(0.0, wrap_count_cb, d);
+    return;
+  }
+  textD->mWrapCounting = 0;
+  textD->mNBufferLines = nLines;
+  int topLineNum = textD->wrap_index_lines(textD->mFirstChar) + 1;
+  if (textD->mTopLineNumHint == textD->mTopLineNum)
+    textD->mTopLineNumHint = topLineNum;
+  textD->mTopLineNum = topLineNum;
+  textD->update_v_scrollbar();
+}
+
+
+// Internal: append an entry to the wrap index
+void Fl_Text_Display::wrap_index_add(int pos, int lines) {
+  if (mWrapIndexSize >= mWrapIndexAlloc) {
+    mWrapIndexAlloc = mWrapIndexAlloc ? 2 * mWrapIndexAlloc : 64;
+    mWrapIndex = (int *)realloc(mWrapIndex, 2 * mWrapIndexAlloc * sizeof(int));
+  }
+  mWrapIndex[2 * mWrapIndexSize] = pos;
+  mWrapIndex[2 * mWrapIndexSize + 1] = lines;
+  mWrapIndexSize++;
+}
+
+
+/**
+ \brief Update the wrap index after a buffer modification.
+
+ Entries inside the deleted text are removed, and entries after it are
+ moved by the change in size and in the number of display lines. If the
+ rest of the buffer is being counted in the background, counting continues
+ after the last entry that is left.
+
+ \param pos starting index of the modification
+ \param nInserted number of bytes inserted
+ \param nDeleted number of bytes deleted
+ \param linesDelta change in the number of display lines
+ */
+void Fl_Text_Display::wrap_index_update(int pos, int nInserted, int nDeleted,
+                                        int linesDelta) {
+  if (!mWrapIndexSize) return;
+  int i = wrap_index_find(mWrapIndex, mWrapIndexSize, pos, 0) + 1;
+  int j = i;
+  while (j < mWrapIndexSize && mWrapIndex[2 * j] <= pos + nDeleted)
+    j++;
+  for ( ; j < mWrapIndexSize; i++, j++) {
+    mWrapIndex[2 * i] = mWrapIndex[2 * j] + nInserted - nDeleted;
+    mWrapIndex[2 * i + 1] = mWrapIndex[2 * j + 1] + linesDelta;
+  }
+  mWrapIndexSize = i;
+}
+
+
+// Internal: number of display lines before the display line start pos,
+// which must not be after the last entry of the wrap index
+int Fl_Text_Display::wrap_index_lines(int pos) const {
+  int i = wrap_index_find(mWrapIndex, mWrapIndexSize, pos, 0);
+  if (mWrapIndex[2 * i] == pos)
+    return mWrapIndex[2 * i + 1];
+  return mWrapIndex[2 * i + 1] + wrap_index_count(mWrapIndex[2 * i], pos);
+}
+
+
+// Internal: number of display line breaks from the line start startPos up
+// to endPos. Unlike count_lines() this does not count a last line without
+// a newline, so counts of adjacent ranges add up.
+int Fl_Text_Display::wrap_index_count(int startPos, int endPos) const {
+  int retPos, retLines, retLineStart, retLineEnd;
+  wrapped_line_counter(buffer(), startPos, endPos, INT_MAX, true, 0, &retPos,
+                       &retLines, &retLineStart, &retLineEnd, false);
+  return retLines;
+}
+
+
+/**
+ \brief Find the start of a display line using the wrap index.
+
+ Text added after the last entry, for instance by appending to the buffer,
+ is indexed on the way.
+
+ \param nLines number of display lines before the line
+ \return the position of the line start, or -1 if the wrap index is not
+   complete and up to date
+ */
+int Fl_Text_Display::wrap_index_skip(int nLines) {
+  if (!mContinuousWrap || mWrapCounting || !mWrapIndexSize ||
+      mWrapCountWidth != (mWrapMarginPix ? mWrapMarginPix : text_area.w))
+    return -1;
+  int len = buffer()->length();
+  while (mWrapIndex[2 * mWrapIndexSize - 1] < nLines &&
+         len - mWrapIndex[2 * mWrapIndexSize - 2] > 2 * WRAP_INDEX_STEP) {
+    if (wrap_count_step(WRAP_INDEX_STEP) >= 0)
+      break;
+  }
+  int i = wrap_index_find(mWrapIndex, mWrapIndexSize, nLines, 1);
+  return skip_lines(mWrapIndex[2 * i], nLines - mWrapIndex[2 * i + 1], true);
+}
+
+
 /**
  \brief Scrolls the current buffer to start at the specified line and column.
 
@@ -62,6 +62,26 @@ static void free_path(char **arr) {
   }
 }
 
+// INTERNAL: A displayed item of the tree, see Fl_Tree::calc_rows()
+struct Fl_Tree_Row {
+  Fl_Tree_Item *item;		// the displayed item
+  int y;			// top of the row, relative to the first row
+  int h;			// item's height (without linespacing)
+  int depth;			// item's depth in the tree (root is 0)
+  int xmax;			// right edge of the item's content, relative to the root's left edge
+};
+
+// INTERNAL: qsort() compare function for the tree's changed rows
+static int compare_rows(const void *a, const void *b) {
+  return(*(const int*)a - *(const int*)b);
+}
+
+// INTERNAL: Is 'item' drawn as the last child of its parent?
+static int is_last_child(const Fl_Tree_Item *item) {
+  const Fl_Tree_Item *p = item->parent();
+  return((!p || p->child(p->children()-1) == item) ? 1 : 0);
+}
+
 #if 0		/* unused code -- STR #3169 */
 // INTERNAL: Recursively descend 'item's tree hierarchy
 //           accumulating total child 'count'
@@ -86,6 +106,19 @@ Fl_Tree::Fl_Tree(int X, int Y, int W, int H, const char *L) : Fl_Group(X,Y,W,H,L
   _scrollbar_size  = 0;				// 0: uses Fl::scrollbar_size()
 	
   _lastselect       = 0;
+  _model            = 0;
+  _mview            = 0;
+  _rows             = 0;
+  _nrows            = -1;			// -1: calc all rows
+  _arows            = 0;
+  _dirty            = 0;
+  _ndirty           = 0;
+  _adirty           = 0;
+  _rows_w           = 0;
+  _rows_h           = 0;
+  _wrows            = 0;
+  _nwrows           = 0;
+  _awrows           = 0;
 
   box(FL_DOWN_BOX);
   color(FL_BACKGROUND2_COLOR, FL_SELECTION_COLOR);
@@ -112,7 +145,11 @@ Fl_Tree::Fl_Tree(int X, int Y, int W, int H, const char *L) : Fl_Group(X,Y,W,H,L
 
 /// Destructor.
 Fl_Tree::~Fl_Tree() {
+  if ( _mview ) model(0);
   if ( _root ) { delete _root; _root = 0; }
+  free(_rows);
+  free(_dirty);
+  free(_wrows);
 }
 
 /// Extend the selection between and including \p 'from' and \p 'to'
@@ -138,6 +175,7 @@ Fl_Tree::~Fl_Tree() {
 ///
 int Fl_Tree::extend_selection_dir(Fl_Tree_Item *from, Fl_Tree_Item *to,
 			          int dir, int val, bool visible ) {
+  if ( _model ) return(extend_selection(from, to, val, visible));
   int changed = 0;
   for (Fl_Tree_Item *item=from; item; item = next_item(item, dir, visible) ) {
     switch (val) {
@@ -178,6 +216,11 @@ int Fl_Tree::extend_selection_dir(Fl_Tree_Item *from, Fl_Tree_Item *to,
 int Fl_Tree::extend_selection(Fl_Tree_Item *from, Fl_Tree_Item *to,
 			      int val, bool visible) {
   int changed = 0;
+  if ( _model ) {				// model mode: select rows from..to
+    long a = model_row(from), b = model_row(to);
+    if ( a < 0 || b < 0 ) return(0);
+    return(a < b ? model_select_rows(a, b, val, when()) : model_select_rows(b, a, val, when()));
+  }
   if ( from == to ) {
     if ( visible && !from->is_visible() ) return(0);	// do nothing
     switch (val) {
@@ -330,6 +373,7 @@ int Fl_Tree::handle(int e) {
 	      set_item_focus(next_visible_item(_item_focus, ekey));	// next item up|dn
 	      if ( _item_focus ) {					// item in focus?
 	        // Autoscroll
+		place_item(_item_focus);				// update item's xywh
 		int itemtop = _item_focus->y();
 		int itembot = _item_focus->y()+_item_focus->h();
 		if ( itemtop < y() ) { show_item_top(_item_focus); }
@@ -345,6 +389,26 @@ int Fl_Tree::handle(int e) {
 	      }
 	      break;
 	    }
+	    case FL_Page_Up:	// PAGEUP/PAGEDOWN: move focus one page up/down
+	    case FL_Page_Down:
+	    case FL_Home:	// HOME/END: move focus to top/bottom of tree
+	    case FL_End: {
+	      Fl_Tree_Item *from = _item_focus;
+	      Fl_Tree_Item *item = (ekey == FL_Home) ? first_visible_item()
+				 : (ekey == FL_End)  ? last_visible_item()
+				 : page_item(from, (ekey == FL_Page_Up) ? FL_Up : FL_Down);
+	      if ( !item ) return(1);
+	      set_item_focus(item);
+	      if ( !displayed(item) ) {					// autoscroll
+		if ( ekey == FL_Page_Up || ekey == FL_Home ) show_item_top(item);
+		else                                          show_item_bottom(item);
+	      }
+	      if ( _prefs.selectmode() == FL_TREE_SELECT_MULTI && is_shift ) {
+		extend_selection(from, item, 1, true);			// extend selection..
+		_lastselect = item;
+	      }
+	      return(1);
+	    }
 	    case 'a':
 	    case 'A': {
 	      if ( is_command ) {					// ^A (win/linux), Meta-A (mac)
@@ -378,13 +442,13 @@ int Fl_Tree::handle(int e) {
   // Handle events the child FLTK widgets didn't need
 
   // fprintf(stderr, "Fl_Tree::handle(): Event was %s (%d)\n", fl_eventnames[e], e); // DEBUGGING
-  if ( ! _root ) return(ret);
+  if ( ! _root && ! _model ) return(ret);
   static int last_my = 0;
   switch ( e ) {
     case FL_PUSH: {		// clicked on tree
       last_my = Fl::event_y();	// save for dragging direction..
       if (Fl::visible_focus() && handle(FL_FOCUS)) Fl::focus(this);
-      Fl_Tree_Item *item = _root->find_clicked(_prefs, 0);
+      Fl_Tree_Item *item = find_clicked(0);
       if ( !item ) {		// clicked, but not on an item?
         _lastselect = 0;
 	switch ( _prefs.selectmode() ) {
@@ -401,7 +465,8 @@ int Fl_Tree::handle(int e) {
       set_item_focus(item);			// becomes new focus widget, calls redraw() if needed
       ret |= 1;					// handled
       if ( Fl::event_button() == FL_LEFT_MOUSE ) {
-	if ( item->event_on_collapse_icon(_prefs) ) {	// collapse icon clicked?
+	if ( _model ? model_event_on_collapse_icon(item)	// collapse icon clicked?
+		    : item->event_on_collapse_icon(_prefs) ) {
 	  open_toggle(item);				// toggle open (handles redraw)
 	} else if ( item->event_on_label(_prefs) && 	// label clicked?
 		 (!item->widget() || !Fl::event_inside(item->widget())) ) {	// not inside widget
@@ -461,7 +526,7 @@ int Fl_Tree::handle(int e) {
       //    During drag, only interested in left-mouse operations.
       //
       if ( Fl::event_button() != FL_LEFT_MOUSE ) break;
-      Fl_Tree_Item *item = _root->find_clicked(_prefs, 1); // item we're on, vertically
+      Fl_Tree_Item *item = find_clicked(1);	// item we're on, vertically
       if ( !item ) break;			// not near item? ignore drag event
       ret |= 1;					// acknowledge event
       if (_prefs.selectmode() != FL_TREE_SELECT_SINGLE_DRAGGABLE)
@@ -495,8 +560,8 @@ int Fl_Tree::handle(int e) {
     }
     case FL_RELEASE:
       if (_prefs.selectmode() == FL_TREE_SELECT_SINGLE_DRAGGABLE &&
-          Fl::event_button() == FL_LEFT_MOUSE) {
-        Fl_Tree_Item *item = _root->find_clicked(_prefs, 1); // item we're on, vertically
+          Fl::event_button() == FL_LEFT_MOUSE && !_model) {
+        Fl_Tree_Item *item = find_clicked(1); // item we're on, vertically
 
         if (item && _lastselect && item != _lastselect &&
             Fl::event_x() >= item->label_x()) {
@@ -653,6 +718,10 @@ void Fl_Tree::calc_dimensions() {
 ///
 /// For this reason, recalc_tree() is used as a way to /schedule/
 /// calculation when changes affect the tree hierarchy's size.
+/// Changes to individual items (open/close, add/remove, label changes..)
+/// only schedule recalculation of the rows of that item's subtree,
+/// which is done when the tree is drawn next. calc_tree() always
+/// recalculates all rows.
 ///
 /// Apps may want to call this method directly if the app makes changes
 /// to the tree's geometry, then immediately needs to work with the tree's
@@ -663,27 +732,13 @@ void Fl_Tree::calc_tree() {
   // Set tree width and height to zero, and recalc just _tox/_toy/_tow/_toh for now.
   _tree_w = _tree_h = -1;
   calc_dimensions();
-  if ( !_root ) return;
-  // Walk the tree to determine its width and height.
-  // We need this to compute scrollbars..
-  // By the end, 'Y' will be the lowest point on the tree
+  if ( _model ) { model_calc_tree(); return; }
+  // Flatten the tree into its displayed rows, measuring each item.
+  // This also determines the tree's width and height, which we need
+  // to compute the scrollbars..
   //
-  int X = _tix + _prefs.marginleft() + _hscroll->value();
-  int Y = _tiy + _prefs.margintop()  - _vscroll->value();
-  int W = _tiw;
-  // Adjust root's X/W if connectors off
-  if (_prefs.connectorstyle() == FL_TREE_CONNECTOR_NONE) {
-    X -= _prefs.openicon()->w();
-    W += _prefs.openicon()->w();
-  }
-  int xmax = 0, render = 0, ytop = Y;
-  fl_font(_prefs.labelfont(), _prefs.labelsize());
-  _root->draw(X, Y, W, 0, xmax, 1, render);		// descend into tree without drawing (render=0)
-  // Save computed tree width and height
-  _tree_w = _prefs.marginleft() + xmax - X;		// include margin in tree's width
-  _tree_h = _prefs.margintop()  + Y - ytop;		// include margin in tree's height
-  // Calc tree dims again; now that tree_w/tree_h are known, scrollbars are calculated.
-  calc_dimensions();
+  _nrows = -1;
+  calc_rows();
 }
 
 void Fl_Tree::resize(int X,int Y,int W, int H) {
@@ -697,7 +752,7 @@ void Fl_Tree::resize(int X,int Y,int W, int H) {
 void Fl_Tree::draw() {
   fix_scrollbar_order();
   // Has tree recalc been scheduled? If so, do it
-  if ( _tree_w == -1 ) calc_tree();
+  if ( _tree_w == -1 ) update_rows();
   else calc_dimensions();
   // Let group draw box+label but *NOT* children.
   // We handle drawing children ourselves by calling each item's draw()
@@ -707,25 +762,17 @@ void Fl_Tree::draw() {
       Fl_Group::draw_box();
       Fl_Group::draw_label();
     }
-    if ( ! _root ) return;
-    // These values are changed during drawing
-    // By end, 'Y' will be the lowest point on the tree
-    int X = _tix + _prefs.marginleft() - _hscroll->value();
-    int Y = _tiy + _prefs.margintop()  - _vscroll->value();
-    int W = _tiw - X + _tix;
-    // Adjust root's X/W if connectors off
-    if (_prefs.connectorstyle() == FL_TREE_CONNECTOR_NONE) {
-      X -= _prefs.openicon()->w();
-      W += _prefs.openicon()->w();
-    }
-    // Draw entire tree, starting with root
+    if ( ! _root && ! _model ) return;
+    // Draw the rows inside the viewport
     fl_push_clip(_tix,_tiy,_tiw,_tih);
     {
-      int xmax = 0;
       fl_font(_prefs.labelfont(), _prefs.labelsize());
-      _root->draw(X, Y, W, 				// descend into tree here to draw it
-		  (Fl::focus()==this)?_item_focus:0,	// show focus item ONLY if Fl_Tree has focus
-		  xmax, 1, 1);
+      if ( _model ) {
+	if ( damage() & ~FL_DAMAGE_CHILD )		// draw displayed rows only
+	  model_draw((Fl::focus()==this)?_item_focus:0);
+      } else {
+	draw_rows((Fl::focus()==this)?_item_focus:0);	// show focus item ONLY if Fl_Tree has focus
+      }
     }
     fl_pop_clip();
   }  
@@ -745,7 +792,7 @@ void Fl_Tree::draw() {
   if (_prefs.selectmode() == FL_TREE_SELECT_SINGLE_DRAGGABLE &&
       Fl::pushed() == this) {
 
-    Fl_Tree_Item *item = _root->find_clicked(_prefs, 1); // item we're on, vertically
+    Fl_Tree_Item *item = find_clicked(1); // item we're on, vertically
     if (item && item != _item_focus) {
       // Are we dropping above or before the target item?
       const int h = Fl::event_y() - item->y();
@@ -798,6 +845,7 @@ Fl_Tree_Item* Fl_Tree::root() {
 void Fl_Tree::root(Fl_Tree_Item *newitem) {
   if ( _root ) clear();
   _root = newitem;
+  recalc_tree();
 }
 
 /// Adds a new item, given a menu style \p 'path'.
@@ -824,6 +872,7 @@ Fl_Tree_Item* Fl_Tree::add(const char *path, Fl_Tree_Item *item) {
     _root = new Fl_Tree_Item(this);
     _root->parent(0);
     _root->label("ROOT");
+    recalc_tree();
   } 
   // Find parent item via path
   char **arr = parse_path(path);
@@ -845,6 +894,36 @@ Fl_Tree_Item* Fl_Tree::add(Fl_Tree_Item *parent_item, const char *name) {
   return(parent_item->add(_prefs, name));
 }
 
+/// Add \p 'count' new child items labeled \p 'names[0..count-1]'
+/// to the specified \p 'parent_item'.
+///
+/// Use this instead of calling add(Fl_Tree_Item*,const char*) in a loop
+/// when adding many items at once (e.g. the files of a large directory):
+/// the parent's array of children is enlarged only once, and the new
+/// items are linked to their siblings in a single pass.
+///
+/// If sortorder() is set, the items are inserted one by one to keep
+/// the children sorted.
+///
+/// Example:
+/// \code
+///     const char *names[] = { "red", "green", "blue" };
+///     Fl_Tree_Item *colors = tree->add("Colors");
+///     tree->add_children(colors, names, 3);
+/// \endcode
+///
+/// \param[in] parent_item The parent item the new child items will be added to.
+///                        Must not be NULL.
+/// \param[in] names Array of \p 'count' labels for the new items
+/// \param[in] count Number of items to add
+/// \returns The first new item added, or 0 if \p 'count' is 0.
+/// \version 1.4.0
+///
+Fl_Tree_Item* Fl_Tree::add_children(Fl_Tree_Item *parent_item,
+				    const char * const *names, int count) {
+  return(parent_item->add_children(_prefs, names, count));
+}
+
 /// Inserts a new item \p 'name' above the specified Fl_Tree_Item \p 'above'.
 /// Example:
 /// \code
@@ -918,6 +997,7 @@ void Fl_Tree::clear() {
   delete _root; _root = 0;
   _item_focus = 0;
   _lastselect = 0;
+  recalc_tree();
 } 
 
 /// Clear all the children for \p 'item'.
@@ -1034,8 +1114,19 @@ int Fl_Tree::item_pathname(char *pathname, int pathnamelen, const Fl_Tree_Item *
 /// \version 1.3.3 ABI feature: added yonly parameter
 ///
 const Fl_Tree_Item* Fl_Tree::find_clicked(int yonly) const {
+  if ( _model ) return(const_cast<Fl_Tree*>(this)->model_find_clicked(yonly));
   if ( ! _root ) return(NULL);
-  return(_root->find_clicked(_prefs, yonly));
+  const_cast<Fl_Tree*>(this)->update_rows();
+  // Find the row under the event (binary search)
+  int ey  = Fl::event_y() - (_tiy + _prefs.margintop() - (int)_vscroll->value());
+  int row = row_at(ey);
+  if ( row < 0 ) return(NULL);
+  if ( yonly && row > 0 && ey <= _rows[row-1].y + _rows[row-1].h ) row--;	// bottom edge of row above
+  const Fl_Tree_Row &r = _rows[row];
+  if ( ey > r.y + r.h ) return(NULL);			// between rows (linespacing)
+  const_cast<Fl_Tree*>(this)->place_row(row);		// update item's xywh
+  if ( yonly ) return(r.item);
+  return(Fl::event_inside(r.item->x(), r.item->y(), r.item->w(), r.item->h()) ? r.item : NULL);
 }
 
 /// Non-const version of Fl_Tree::find_clicked(int yonly) const.
@@ -1103,6 +1194,7 @@ Fl_Tree_Item *Fl_Tree::next_visible_item(Fl_Tree_Item *item, int dir) {
 /// \see first(), next(), last(), prev()
 ///
 Fl_Tree_Item* Fl_Tree::first() {
+  if ( _model ) return(first_visible_item());	// model mode: first displayed row
   return(_root);				// first item always root
 }
 
@@ -1119,6 +1211,7 @@ Fl_Tree_Item* Fl_Tree::first_visible() {
 /// \version 1.3.3
 ///
 Fl_Tree_Item* Fl_Tree::first_visible_item() {
+  if ( _model ) return(model_rows() > 0 ? model_item(0) : 0);
   Fl_Tree_Item *i = showroot() ? first() : next(first());
   while ( i ) {
     if ( i->visible() ) return(i);
@@ -1142,6 +1235,7 @@ Fl_Tree_Item* Fl_Tree::first_visible_item() {
 ///
 Fl_Tree_Item *Fl_Tree::next(Fl_Tree_Item *item) {
   if ( ! item ) return(0);
+  if ( _model ) return(next_item(item, FL_Down, true));
   return(item->next());
 }
 
@@ -1160,6 +1254,7 @@ Fl_Tree_Item *Fl_Tree::next(Fl_Tree_Item *item) {
 ///
 Fl_Tree_Item *Fl_Tree::prev(Fl_Tree_Item *item) {
   if ( ! item ) return(0);
+  if ( _model ) return(next_item(item, FL_Up, true));
   return(item->prev());
 }
 
@@ -1176,6 +1271,7 @@ Fl_Tree_Item *Fl_Tree::prev(Fl_Tree_Item *item) {
 /// \see first(), next(), last(), prev()
 ///
 Fl_Tree_Item* Fl_Tree::last() {
+  if ( _model ) return(last_visible_item());	// model mode: last displayed row
   if ( ! _root ) return(0);
   Fl_Tree_Item *item = _root;
   while ( item->has_children() ) {
@@ -1197,6 +1293,7 @@ Fl_Tree_Item* Fl_Tree::last_visible() {
 /// \version 1.3.3
 ///
 Fl_Tree_Item* Fl_Tree::last_visible_item() {
+  if ( _model ) return(model_rows() > 0 ? model_item(model_rows()-1) : 0);
   Fl_Tree_Item *item = last();
   while ( item ) {
     if ( item->visible() ) {
@@ -1295,6 +1392,23 @@ Fl_Tree_Item *Fl_Tree::last_selected_item() {
 /// \version 1.3.3
 ///  
 Fl_Tree_Item *Fl_Tree::next_item(Fl_Tree_Item *item, int dir, bool visible) {
+  if ( _model ) {				// model mode: rows are always 'visible'
+    long row = item ? model_row(item) : (dir == FL_Up ? model_rows() : -1);
+    if ( row < 0 && item ) return(0);
+    switch (dir) {
+      case FL_Up:   row--; break;
+      case FL_Down: row++; break;
+      default:      return(0);
+    }
+    return((row >= 0 && row < model_rows()) ? model_item(row) : 0);
+  }
+  if ( visible && rows_current() && (dir == FL_Up || dir == FL_Down) ) {
+    int row = item ? item_row(item) : (dir == FL_Up ? _nrows : -1);
+    if ( row >= 0 || !item ) {			// displayed item? use the rows
+      row += (dir == FL_Up) ? -1 : 1;
+      return((row >= 0 && row < _nrows) ? _rows[row].item : 0);
+    }
+  }
   if ( ! item ) {					// no start item?
     if ( visible ) {
 	item = ( dir == FL_Up ) ? last_visible_item() : // wrap to bottom
@@ -1343,6 +1457,7 @@ Fl_Tree_Item *Fl_Tree::next_item(Fl_Tree_Item *item, int dir, bool visible) {
 /// \version 1.3.3
 ///
 Fl_Tree_Item *Fl_Tree::next_selected_item(Fl_Tree_Item *item, int dir) {
+  if ( _model ) return(model_next_selected(item, dir));
   switch (dir) {
     case FL_Down:
       if ( ! item ) {
@@ -1416,7 +1531,11 @@ int Fl_Tree::get_selected_items(Fl_Tree_Item_Array &ret_items) {
 ///
 int Fl_Tree::open(Fl_Tree_Item *item, int docallback) {
   if ( item->is_open() ) return(0);
-  item->open();		// handles recalc_tree()
+  if ( _model ) {
+    if ( ! model_set_open(item, 1) ) return(0);	// not a model row, or no children
+  } else {
+    item->open();		// handles recalc_tree()
+  }
   redraw();
   if ( docallback ) {
     do_callback_for_item(item, FL_TREE_REASON_OPENED);
@@ -1500,7 +1619,11 @@ void Fl_Tree::open_toggle(Fl_Tree_Item *item, int docallback) {
 ///
 int Fl_Tree::close(Fl_Tree_Item *item, int docallback) {
   if ( item->is_close() ) return(0);
-  item->close();		// handles recalc_tree()
+  if ( _model ) {
+    if ( ! model_set_open(item, 0) ) return(0);	// not a model row
+  } else {
+    item->close();		// handles recalc_tree()
+  }
   redraw();
   if ( docallback ) {
     do_callback_for_item(item, FL_TREE_REASON_CLOSED);
@@ -1621,6 +1744,7 @@ int Fl_Tree::select(Fl_Tree_Item *item, int docallback) {
   int alreadySelected = item->is_selected();
   if ( !alreadySelected ) {
     item->select();
+    if ( _model ) model_select(model_index(item), 1);
     set_changed();
     if ( docallback ) {
       do_callback_for_item(item, FL_TREE_REASON_SELECTED);
@@ -1682,6 +1806,7 @@ int Fl_Tree::select(const char *path, int docallback) {
 ///
 void Fl_Tree::select_toggle(Fl_Tree_Item *item, int docallback) {
   item->select_toggle();
+  if ( _model ) model_select(model_index(item), item->is_selected());
   set_changed();
   if ( docallback ) {
     do_callback_for_item(item, item->is_selected() ? FL_TREE_REASON_SELECTED
@@ -1711,6 +1836,7 @@ void Fl_Tree::select_toggle(Fl_Tree_Item *item, int docallback) {
 int Fl_Tree::deselect(Fl_Tree_Item *item, int docallback) {
   if ( item->is_selected() ) {
     item->deselect();
+    if ( _model ) model_select(model_index(item), 0);
     set_changed();
     if ( docallback ) {
       do_callback_for_item(item, FL_TREE_REASON_DESELECTED);
@@ -1768,6 +1894,12 @@ int Fl_Tree::deselect(const char *path, int docallback) {
 /// \returns Count of how many items were actually changed to the deselected state.
 ///
 int Fl_Tree::deselect_all(Fl_Tree_Item *item, int docallback) {
+  if ( _model ) {				// model mode: NULL deselects all nodes
+    if ( ! item ) return(model_deselect_all(0, docallback));
+    long row = model_row(item);
+    if ( row < 0 ) return(0);
+    return(model_select_rows(row, row + model_subtree_rows(row), 0, docallback));
+  }
   item = item ? item : first();			// NULL? use first()
   if ( ! item ) return(0);
   int count = 0;
@@ -1807,11 +1939,15 @@ int Fl_Tree::select_only(Fl_Tree_Item *selitem, int docallback) {
   // Deselect everything first.
   //    Prevents callbacks from seeing more than one item selected.
   //
-  for ( Fl_Tree_Item *item = first(); item; item = item->next() ) {
-    if ( item == selitem ) continue;		// don't do anything to selitem yet..
-    if ( item->is_selected() ) {
-      deselect(item, docallback);
-      ++changed;
+  if ( _model ) {
+    changed = model_deselect_all(selitem, docallback);
+  } else {
+    for ( Fl_Tree_Item *item = first(); item; item = item->next() ) {
+      if ( item == selitem ) continue;		// don't do anything to selitem yet..
+      if ( item->is_selected() ) {
+	deselect(item, docallback);
+	++changed;
+      }
     }
   }
   // Should we 'reselect' item if already selected?
@@ -1845,6 +1981,12 @@ int Fl_Tree::select_only(Fl_Tree_Item *selitem, int docallback) {
 /// \returns Count of how many items were actually changed to the selected state.
 ///
 int Fl_Tree::select_all(Fl_Tree_Item *item, int docallback) {
+  if ( _model ) {				// model mode: select displayed rows
+    long row = item ? model_row(item) : 0;
+    long last = item ? row + model_subtree_rows(row) : model_rows() - 1;
+    if ( row < 0 ) return(0);
+    return(model_select_rows(row, last, 1, docallback));
+  }
   item = item ? item : first();			// NULL? use first()
   if ( ! item ) return(0);
   int count = 0;
@@ -2195,6 +2337,8 @@ int Fl_Tree::showroot() const {
 ///                0 -- hide the root item.
 ///
 void Fl_Tree::showroot(int val) {
+  if ( _model && (val ? 1 : 0) != (showroot() ? 1 : 0) )
+    model_showroot(val);		// add/remove root row in model mode
   _prefs.showroot(val);
   redraw();
   recalc_tree();
@@ -2288,6 +2432,7 @@ Fl_Tree_Item_Draw_Mode Fl_Tree::item_draw_mode() const {
 ///
 void Fl_Tree::item_draw_mode(Fl_Tree_Item_Draw_Mode mode) {
   _prefs.item_draw_mode(mode);
+  recalc_tree();
 }
 
 /// Set the 'item draw mode' used for the tree to integer \p 'mode'.
@@ -2299,6 +2444,7 @@ void Fl_Tree::item_draw_mode(Fl_Tree_Item_Draw_Mode mode) {
 ///
 void Fl_Tree::item_draw_mode(int mode) {
   _prefs.item_draw_mode(Fl_Tree_Item_Draw_Mode(mode));
+  recalc_tree();
 }
 
 /// See if \p 'item' is currently displayed on-screen (visible within the widget).
@@ -2314,6 +2460,7 @@ void Fl_Tree::item_draw_mode(int mode) {
 int Fl_Tree::displayed(Fl_Tree_Item *item) {
   item = item ? item : first();
   if (!item) return(0);
+  place_item(item);
   return( (item->y() >= y()) && (item->y() <= (y()+h()-item->h())) ? 1 : 0);
 }
 
@@ -2334,6 +2481,7 @@ int Fl_Tree::displayed(Fl_Tree_Item *item) {
 void Fl_Tree::show_item(Fl_Tree_Item *item, int yoff) {
   item = item ? item : first();
   if (!item) return;
+  place_item(item);
   int newval = item->y() - y() - yoff + (int)_vscroll->value();
   if ( newval < _vscroll->minimum() ) newval = (int)_vscroll->minimum();
   if ( newval > _vscroll->maximum() ) newval = (int)_vscroll->maximum();
@@ -2371,7 +2519,9 @@ void Fl_Tree::show_item_top(Fl_Tree_Item *item) {
 ///
 void Fl_Tree::show_item_middle(Fl_Tree_Item *item) {
   item = item ? item : first();
-  if (item) show_item(item, (_tih/2)-(item->h()/2));
+  if (!item) return;
+  place_item(item);
+  show_item(item, (_tih/2)-(item->h()/2));
 }
 
 /// Adjust the vertical scrollbar so that \p 'item' is at the bottom of the display.
@@ -2380,7 +2530,9 @@ void Fl_Tree::show_item_middle(Fl_Tree_Item *item) {
 ///
 void Fl_Tree::show_item_bottom(Fl_Tree_Item *item) {
   item = item ? item : first();
-  if (item) show_item(item, _tih-item->h());
+  if (!item) return;
+  place_item(item);
+  show_item(item, _tih-item->h());
 }
 
 /// Displays \p 'item', scrolling the tree as necessary.
@@ -2636,6 +2788,357 @@ void Fl_Tree::fix_scrollbar_order() {
 ///
 void Fl_Tree::recalc_tree() {
   _tree_w = _tree_h = -1;
+  _nrows  = -1;					// recalc all rows
+  _ndirty = 0;
+}
+
+//////////////////////
+// Displayed rows
+//////////////////////
+//
+// The tree keeps its displayed items (open and visible) in a flat array
+// of rows, top to bottom, each with its position relative to the first row.
+// This way drawing only has to visit the rows inside the viewport, and
+// finding the row under the mouse is a binary search.
+//
+// Changes to an item (open/close, add/remove children, label..) mark the
+// row of the item (or of its nearest displayed parent) as 'dirty' via
+// Fl_Tree_Item::recalc_tree(). The next calc_rows() then only measures
+// the subtrees of these rows again, and moves the rows below them.
+//
+// The rows of items with FLTK widgets are indexed separately, because
+// their widgets have to be moved along even when their rows are not drawn.
+//
+
+// INTERNAL: Left edge of a row at 'depth' (same layout as Fl_Tree_Item::draw())
+int Fl_Tree::row_x(int depth) const {
+  int icon_w = _prefs.openicon()->w();
+  int hconn_x2 = icon_w/2 - 1 + _prefs.connectorwidth();
+  int indent = icon_w + (hconn_x2 - icon_w) / 2 - icon_w/2 + 1;
+  int X = _tix + _prefs.marginleft() - (int)_hscroll->value();
+  if (_prefs.connectorstyle() == FL_TREE_CONNECTOR_NONE) X -= icon_w;
+  return(X + (depth - (showroot() ? 0 : 1)) * indent);
+}
+
+// INTERNAL: Find the last row whose top is at or above 'y' (relative to the first row)
+//    Returns -1 if 'y' is above the first row.
+//
+int Fl_Tree::row_at(int y) const {
+  int lo = 0, hi = _nrows - 1, row = -1;
+  while ( lo <= hi ) {
+    int mid = (lo + hi) / 2;
+    if ( _rows[mid].y <= y ) { row = mid; lo = mid + 1; }
+    else                     { hi = mid - 1; }
+  }
+  return(row);
+}
+
+// INTERNAL: Returns the row of 'item', or -1 if the item is not displayed
+int Fl_Tree::item_row(const Fl_Tree_Item *item) const {
+  int row = item->_row;
+  return((row >= 0 && row < _nrows && _rows[row].item == item) ? row : -1);
+}
+
+// INTERNAL: Are the rows up to date, i.e. can they be used without calc_rows()?
+int Fl_Tree::rows_current() const {
+  return(!_model && _tree_w != -1 && _nrows >= 0);
+}
+
+// INTERNAL: Returns the row following the subtree of 'row'
+int Fl_Tree::subtree_end(int row) const {
+  int depth = _rows[row].depth;
+  for ( ++row; row < _nrows && _rows[row].depth > depth; ++row ) { }
+  return(row);
+}
+
+// INTERNAL: Calculate the geometry of the item in 'row', and draw it if 'render'
+//    Returns the right edge of the item's content.
+//
+int Fl_Tree::place_row(int row, Fl_Tree_Item *itemfocus, int render) {
+  const Fl_Tree_Row &r = _rows[row];
+  int X = row_x(r.depth);
+  int Y = _tiy + _prefs.margintop() - (int)_vscroll->value() + r.y;
+  return(r.item->draw_row(X, Y, _tix + _tiw - X, r.h, r.h + _prefs.linespacing(),
+                          itemfocus, is_last_child(r.item), render));
+}
+
+// INTERNAL: Update the xywh of 'item' if it is displayed.
+//    Only the rows inside the viewport are positioned when the tree is drawn,
+//    so use this before looking at the position of any other item.
+//
+void Fl_Tree::place_item(Fl_Tree_Item *item) {
+  if ( _model || !item ) return;
+  update_rows();
+  int row = item_row(item);
+  if ( row >= 0 ) place_row(row);
+}
+
+// INTERNAL: Append the displayed rows of 'item' and its children to 'rows'
+//    'Y' is the top of the item's row, and on return the top of the next row.
+//
+void Fl_Tree::add_rows(Fl_Tree_Row *&rows, int &n, int &alloc,
+                       Fl_Tree_Item *item, int depth, int &Y) {
+  if ( !item->is_visible() ) return;
+  if ( !item->is_root() || _prefs.showroot() ) {	// item drawn?
+    if ( n >= alloc ) {
+      alloc = alloc ? alloc * 2 : 64;
+      rows = (Fl_Tree_Row*)realloc(rows, alloc * sizeof(Fl_Tree_Row));
+    }
+    // Measure the item like Fl_Tree_Item::draw() with render=0 does
+    int X = row_x(depth);
+    int H = item->calc_item_height(_prefs);
+    int ytop = _tiy + _prefs.margintop() - (int)_vscroll->value();
+    int xmax = item->draw_row(X, ytop + Y, _tix + _tiw - X, H, H + _prefs.linespacing(),
+                              0, 0, 0);
+    Fl_Tree_Row &r = rows[n++];
+    r.item  = item;
+    r.y     = Y;
+    r.h     = H;
+    r.depth = depth;
+    r.xmax  = xmax - row_x(_prefs.showroot() ? 0 : 1);
+    Y += H + _prefs.linespacing();
+  }
+  if ( item->has_children() && item->is_open() ) {
+    for ( int t=0; t<item->children(); t++ )
+      add_rows(rows, n, alloc, item->child(t), depth + 1, Y);
+    Y += _prefs.openchild_marginbottom();		// offset below open child tree
+  }
+}
+
+// INTERNAL: Sort the changed rows, and drop rows inside the subtree of another changed row
+void Fl_Tree::sort_dirty() {
+  qsort(_dirty, _ndirty, sizeof(int), compare_rows);
+  int n = 0, end = 0;
+  for ( int t=0; t<_ndirty; t++ ) {
+    if ( n > 0 && _dirty[t] < end ) continue;		// already recalculated with its parent
+    _dirty[n++] = _dirty[t];
+    end = subtree_end(_dirty[t]);
+  }
+  _ndirty = n;
+}
+
+// INTERNAL: Schedule the rows of 'item' and its children to be recalculated.
+//    Called by Fl_Tree_Item::recalc_tree() when the item changed.
+//    If the item is not displayed, its nearest displayed parent is used.
+//
+void Fl_Tree::recalc_rows(Fl_Tree_Item *item) {
+  _tree_w = _tree_h = -1;
+  if ( _model || _nrows < 0 ) return;			// all rows are recalculated anyway
+  int row;
+  while ( (row = item_row(item)) < 0 && item->parent() ) item = item->parent();
+  if ( row < 0 ) {					// no displayed parent?
+    if ( item == _root ) _nrows = -1;			// e.g. hidden root: recalc all rows
+    return;						// else: item is not in the tree (yet)
+  }
+  if ( _ndirty > 0 && _dirty[_ndirty-1] == row ) return;	// same as last time
+  if ( _ndirty > 64 && _ndirty > _nrows / 8 ) {		// many changes? recalc all rows
+    _nrows  = -1;
+    _ndirty = 0;
+    return;
+  }
+  if ( _ndirty >= _adirty ) {
+    _adirty = _adirty ? _adirty * 2 : 16;
+    _dirty = (int*)realloc(_dirty, _adirty * sizeof(int));
+  }
+  _dirty[_ndirty++] = row;
+}
+
+// INTERNAL: Recalculate the displayed rows and the tree's size.
+//    Recalculates all rows if _nrows is -1, else only the subtrees of the
+//    rows that changed since the last call (see recalc_rows()).
+//
+void Fl_Tree::calc_rows() {
+  fl_font(_prefs.labelfont(), _prefs.labelsize());
+  if ( !_root ) { _nrows = 0; _ndirty = 0; _nwrows = 0; return; }
+  // Changed rows whose items were hidden are recalculated with their parent
+  int again = (_nrows >= 0 && _ndirty > 0);
+  while ( again ) {
+    sort_dirty();
+    again = 0;
+    for ( int t=0; t<_ndirty; t++ ) {
+      Fl_Tree_Item *item = _rows[_dirty[t]].item;
+      if ( item->is_visible() ) continue;
+      int row = item->parent() ? item_row(item->parent()) : -1;
+      if ( row < 0 ) { _nrows = -1; break; }		// hidden root (or its child)
+      _dirty[t] = row;
+      again = 1;
+    }
+    if ( _nrows < 0 ) break;
+  }
+  if ( _nrows < 0 ) {
+    // Recalculate all rows
+    int Y = 0;
+    _nrows = 0;
+    add_rows(_rows, _nrows, _arows, _root, 0, Y);
+    _rows_h = Y;
+    _rows_w = 0;
+    for ( int t=0; t<_nrows; t++ ) {
+      _rows[t].item->_row = t;
+      if ( _rows[t].xmax > _rows_w ) _rows_w = _rows[t].xmax;
+    }
+  } else if ( _ndirty > 0 ) {
+    // Recalculate the subtrees of the changed rows into 'add',
+    // then merge these with the unchanged rows
+    Fl_Tree_Row *add = 0;
+    int nadd = 0, aadd = 0;
+    int *range = (int*)malloc(_ndirty * 3 * sizeof(int));	// end, #rows, dy per changed row
+    int nrows = _nrows, inplace = 1, rescan = 0, t;
+    for ( t=0; t<_ndirty; t++ ) {
+      int first = _dirty[t], end = subtree_end(first);
+      Fl_Tree_Item *item = _rows[first].item;
+      int Y = _rows[first].y, n0 = nadd;
+      add_rows(add, nadd, aadd, item, _rows[first].depth, Y);
+      // Parents whose last displayed child this is end here, too
+      if ( _prefs.openchild_marginbottom() ) {
+        for ( Fl_Tree_Item *c = item; c->parent(); c = c->parent() ) {
+          Fl_Tree_Item *p = c->parent();
+          int next = p->find_child(c) + 1;
+          while ( next < p->children() && !p->child(next)->is_visible() ) next++;
+          if ( next < p->children() ) break;
+          Y += _prefs.openchild_marginbottom();
+        }
+      }
+      range[t*3+0] = end;
+      range[t*3+1] = nadd - n0;
+      range[t*3+2] = Y - (end < _nrows ? _rows[end].y : _rows_h);
+      if ( nadd - n0 != end - first ) inplace = 0;
+      nrows += (nadd - n0) - (end - first);
+      for ( int r=first; r<end; r++ )			// was the widest row removed?
+        if ( _rows[r].xmax >= _rows_w ) rescan = 1;
+    }
+    Fl_Tree_Row *rows = _rows;
+    int arows = _arows;
+    if ( !inplace ) {
+      arows = nrows > 64 ? nrows : 64;
+      rows = (Fl_Tree_Row*)malloc(arows * sizeof(Fl_Tree_Row));
+    }
+    int src = 0, dst = 0, dy = 0, a = 0;
+    for ( t=0; t<=_ndirty; t++ ) {
+      int stop = (t < _ndirty) ? _dirty[t] : _nrows;
+      for ( ; src < stop; src++, dst++ ) {		// unchanged rows: move
+        rows[dst] = _rows[src];
+        rows[dst].y += dy;
+        if ( dst != src ) rows[dst].item->_row = dst;
+      }
+      if ( t == _ndirty ) break;
+      for ( int n=0; n<range[t*3+1]; n++, dst++ ) {	// changed rows: replace
+        rows[dst] = add[a++];
+        rows[dst].y += dy;
+        rows[dst].item->_row = dst;
+        if ( !rescan && rows[dst].xmax > _rows_w ) _rows_w = rows[dst].xmax;
+      }
+      src = range[t*3+0];
+      dy += range[t*3+2];
+    }
+    if ( !inplace ) { free(_rows); _rows = rows; _arows = arows; }
+    _nrows  = nrows;
+    _rows_h += dy;
+    if ( rescan ) {
+      _rows_w = 0;
+      for ( t=0; t<_nrows; t++ )
+        if ( _rows[t].xmax > _rows_w ) _rows_w = _rows[t].xmax;
+    }
+    free(range);
+    free(add);
+  }
+  _ndirty = 0;
+  // Index the rows of items with widgets (any children besides the scrollbars?)
+  _nwrows = 0;
+  if ( children() > 2 ) {
+    for ( int t=0; t<_nrows; t++ ) {
+      if ( !_rows[t].item->widget() ) continue;
+      if ( _nwrows >= _awrows ) {
+        _awrows = _awrows ? _awrows * 2 : 16;
+        _wrows = (int*)realloc(_wrows, _awrows * sizeof(int));
+      }
+      _wrows[_nwrows++] = t;
+    }
+  }
+  // Save computed tree width and height
+  _tree_w = _prefs.marginleft() + _rows_w;		// include margin in tree's width
+  _tree_h = _prefs.margintop()  + _rows_h;		// include margin in tree's height
+  // Calc tree dims again; now that tree_w/tree_h are known, scrollbars are calculated.
+  calc_dimensions();
+  // Rows may have moved: move their widgets along, even if they are not drawn
+  place_widgets();
+}
+
+// INTERNAL: Recalculate the rows and tree size, if scheduled by recalc_tree()
+void Fl_Tree::update_rows() {
+  if ( _tree_w != -1 ) return;				// up to date
+  if ( _model ) { calc_tree(); return; }
+  calc_dimensions();
+  calc_rows();
+}
+
+// INTERNAL: Position the widgets of the rows outside first..last (last=-1: all rows)
+//    With 'render', the rows must be outside the viewport, so that they are
+//    clipped and only their widgets are moved.
+//
+void Fl_Tree::place_widgets(int first, int last, int render) {
+  for ( int t=0; t<_nwrows; t++ ) {
+    int row = _wrows[t];
+    if ( row < first || row > last ) place_row(row, 0, render);
+  }
+}
+
+// INTERNAL: Draw the rows inside the viewport
+void Fl_Tree::draw_rows(Fl_Tree_Item *itemfocus) {
+  // Items with widgets may change their height (FL_TREE_ITEM_HEIGHT_FROM_WIDGET)
+  if ( _nwrows > 0 ) {
+    for ( int t=0; t<_nwrows; t++ ) {
+      const Fl_Tree_Row &r = _rows[_wrows[t]];
+      if ( r.item->calc_item_height(_prefs) != r.h )
+        recalc_rows(r.item);
+    }
+    update_rows();
+  }
+  int top   = _tiy + _prefs.margintop() - (int)_vscroll->value();
+  int first = row_at(_tiy - top);
+  int last  = row_at(_tiy + _tih - top);
+  if ( first < 0 ) first = 0;
+  // Vertical connectors of the rows' parents, for rows that are not the last child
+  if ( (damage() & ~FL_DAMAGE_CHILD) && _prefs.connectorstyle() != FL_TREE_CONNECTOR_NONE ) {
+    int icon_w = _prefs.openicon()->w();
+    for ( int t=first; t<=last; t++ ) {
+      Fl_Tree_Item *item = _rows[t].item;
+      int Y1 = top + _rows[t].y;
+      int Y2 = top + ((t + 1 < _nrows) ? _rows[t+1].y : _rows_h);
+      int depth = _rows[t].depth - 1;
+      for ( Fl_Tree_Item *a = item->parent(); a && a->parent(); a = a->parent(), depth-- ) {
+        if ( !is_last_child(a) )
+          item->draw_vertical_connector(row_x(depth) + icon_w/2 - 1, Y1, Y2, _prefs);
+      }
+    }
+  }
+  for ( int t=first; t<=last; t++ )
+    place_row(t, itemfocus, 1);
+  // Move the widgets of the other rows along when scrolled
+  place_widgets(first, last, 1);
+}
+
+// INTERNAL: Find the displayed item about one page above or below 'item'
+Fl_Tree_Item *Fl_Tree::page_item(Fl_Tree_Item *item, int dir) {
+  if ( _model ) {
+    long row = model_row(item), rows = model_rows();
+    if ( row < 0 || rows <= 0 ) return(0);
+    int h = item->h() + _prefs.linespacing();
+    long step = (h > 0) ? _tih / h : 1;
+    if ( step < 1 ) step = 1;
+    row += (dir == FL_Up) ? -step : step;
+    if ( row < 0 ) row = 0;
+    if ( row >= rows ) row = rows - 1;
+    return(model_item(row));
+  }
+  update_rows();
+  int row = item_row(item);
+  if ( row < 0 || _nrows <= 0 ) return(0);
+  int to = row_at(_rows[row].y + ((dir == FL_Up) ? -_tih : _tih));
+  if ( dir == FL_Up ) { if ( to >= row ) to = row - 1; }	// move at least one row
+  else                { if ( to <= row ) to = row + 1; }
+  if ( to < 0 ) to = 0;
+  if ( to >= _nrows ) to = _nrows - 1;
+  return(_rows[to].item);
 }
 
 //
@@ -73,6 +73,7 @@ void Fl_Tree_Item::_Init(const Fl_Tree_Prefs &prefs, Fl_Tree *tree) {
   _children.manage_item_destroy(1);	// let array's dtor manage destroying Fl_Tree_Items
   _prev_sibling     = 0;
   _next_sibling     = 0;
+  _row              = -1;
 }
 
 /// Constructor.
@@ -129,6 +130,7 @@ Fl_Tree_Item::Fl_Tree_Item(const Fl_Tree_Item *o) {
   _parent           = o->_parent;
   _prev_sibling     = 0;		// do not copy ptrs! use update_prev_next()
   _next_sibling     = 0;		// do not copy ptrs! use update_prev_next()
+  _row              = -1;
 }
 
 /// Print the tree as 'ascii art' to stdout.
@@ -155,8 +157,11 @@ void Fl_Tree_Item::show_self(const char *indent) const {
 /// Makes and manages an internal copy of \p 'name'.
 ///
 void Fl_Tree_Item::label(const char *name) {
+  // Keep parent's index of its children's labels up to date
+  int indexed = _parent ? _parent->_children.index_remove(this) : 0;
   if ( _label ) { free((void*)_label); _label = 0; }
   _label = name ? strdup(name) : 0;
+  if ( indexed ) _parent->_children.index_add(this);
   recalc_tree();		// may change label geometry
 }
 
@@ -183,13 +188,8 @@ void Fl_Tree_Item::clear_children() {
 /// \version 1.3.0 release
 ///
 int Fl_Tree_Item::find_child(const char *name) {
-  if ( name ) {
-    for ( int t=0; t<children(); t++ )
-      if ( child(t)->label() )
-        if ( strcmp(child(t)->label(), name) == 0 )
-          return(t);
-  }
-  return(-1);
+  Fl_Tree_Item *item = _children.find(name);	// uses hash index (if many children)
+  return(item ? find_child(item) : -1);
 }
 
 /// Return the /immediate/ child of current item
@@ -199,12 +199,7 @@ int Fl_Tree_Item::find_child(const char *name) {
 /// \version 1.3.3
 ///
 const Fl_Tree_Item* Fl_Tree_Item::find_child_item(const char *name) const {
-  if ( name )
-    for ( int t=0; t<children(); t++ )
-      if ( child(t)->label() )
-        if ( strcmp(child(t)->label(), name) == 0 )
-          return(child(t));
-  return(0);
+  return(_children.find(name));			// uses hash index (if many children)
 }
 
 /// Non-const version of Fl_Tree_Item::find_child_item(const char *name) const.
@@ -222,18 +217,11 @@ Fl_Tree_Item* Fl_Tree_Item::find_child_item(const char *name) {
 /// \version 1.3.0 release
 ///
 const Fl_Tree_Item *Fl_Tree_Item::find_child_item(char **arr) const {
-  for ( int t=0; t<children(); t++ ) {
-    if ( child(t)->label() ) {
-      if ( strcmp(child(t)->label(), *arr) == 0 ) {	// match?
-        if ( *(arr+1) ) {				// more in arr? descend
-          return(_children[t]->find_child_item(arr+1));
-        } else {					// end of arr? done
-          return(_children[t]);
-        }
-      }
-    }
+  const Fl_Tree_Item *item = _children.find(*arr);
+  if ( item && *(arr+1) ) {			// match, more in arr? descend
+    return(item->find_child_item(arr+1));
   }
-  return(0);
+  return(item);					// end of arr (or not found)? done
 }
 
 /// Non-const version of Fl_Tree_Item::find_child_item(char **arr) const.
@@ -338,6 +326,43 @@ Fl_Tree_Item *Fl_Tree_Item::add(const Fl_Tree_Prefs &prefs,
   return(item);
 }
 
+/// Add new children with the labels \p 'new_labels[0..count-1]' to the end
+/// of this item's children, with defaults from \p 'prefs'.
+///
+/// This is much faster than calling add(const Fl_Tree_Prefs&,const char*)
+/// for each label when adding many items: the array of children is enlarged
+/// once, and the new items are linked to their siblings in a single pass.
+///
+/// If prefs.sortorder() is not FL_TREE_SORT_NONE, the items are added
+/// one by one with add() to keep the children sorted.
+///
+/// \param[in] prefs      The tree's preferences
+/// \param[in] new_labels Array of \p 'count' labels (internally managed copies are made)
+/// \param[in] count      Number of items to add
+/// \returns the first item added, or 0 if \p 'count' is 0.
+/// \version 1.4.0
+///
+Fl_Tree_Item *Fl_Tree_Item::add_children(const Fl_Tree_Prefs &prefs,
+					  const char * const *new_labels, int count) {
+  if ( count <= 0 ) return(0);
+  if ( prefs.sortorder() != FL_TREE_SORT_NONE ) {
+    Fl_Tree_Item *first = add(prefs, new_labels[0]);
+    for ( int t=1; t<count; t++ ) add(prefs, new_labels[t]);
+    return(first);
+  }
+  Fl_Tree_Item **items = (Fl_Tree_Item**)malloc(count * sizeof(Fl_Tree_Item*));
+  for ( int t=0; t<count; t++ ) {
+    items[t] = new Fl_Tree_Item(_tree);
+    items[t]->label(new_labels[t]);
+    items[t]->_parent = this;
+  }
+  _children.add(items, count);
+  Fl_Tree_Item *first = items[0];
+  free((void*)items);
+  recalc_tree();		// may change tree geometry
+  return(first);
+}
+
 /// Descend into the path specified by \p 'arr', and add a new child there.
 /// Should be used only by Fl_Tree's internals.
 /// Adds the item based on the value of prefs.sortorder().
@@ -431,6 +456,7 @@ Fl_Tree_Item *Fl_Tree_Item::insert_above(const Fl_Tree_Prefs &prefs, const char
 Fl_Tree_Item* Fl_Tree_Item::deparent(int pos) {
   Fl_Tree_Item *orphan = _children[pos];
   if ( _children.deparent(pos) < 0 ) return NULL;
+  recalc_tree();		// may change tree geometry
   return orphan;
 }
 
@@ -445,6 +471,7 @@ int Fl_Tree_Item::reparent(Fl_Tree_Item *newchild, int pos) {
   int ret;
   if ( (ret = _children.reparent(newchild, this, pos)) < 0 ) return ret;
   newchild->parent(this);		// take custody
+  recalc_tree();		// may change tree geometry
   return 0;
 }
 
@@ -457,7 +484,9 @@ int Fl_Tree_Item::reparent(Fl_Tree_Item *newchild, int pos) {
 /// \see move_above(), move_below(), move_into(), move(Fl_Tree_Item*,int,int)
 ///
 int Fl_Tree_Item::move(int to, int from) {
-  return _children.move(to, from);
+  int ret = _children.move(to, from);
+  if ( ret == 0 ) recalc_tree();	// changes order of displayed items
+  return ret;
 }
 
 /// Move the current item above/below/into the specified 'item',
@@ -663,6 +692,7 @@ int Fl_Tree_Item::remove_child(const char *name) {
 ///
 void Fl_Tree_Item::swap_children(int ax, int bx) {
   _children.swap(ax, bx);
+  recalc_tree();		// changes order of displayed items
 }
 
 /// Swap two of our immediate children, given item pointers.
@@ -978,31 +1008,26 @@ int Fl_Tree_Item::draw_item_content(int render) {
   return xmax;
 }
 
-/// Draw this item and its children.
+/// Internal: Draw this item, but not its children.
 ///
-/// \param[in]     X              Horizontal position for item being drawn
-/// \param[in,out] Y              Vertical position for item being drawn,
-///                               returns new position for next item
-/// \param[in]     W              Recommended width for item
-/// \param[in]     itemfocus      The tree's current focus item (if any)
-/// \param[in,out] tree_item_xmax The tree's running xmax (right-most edge so far).
-///                               Mainly used by parent tree when render==0 to
-///                               calculate tree's max width.
-/// \param[in]     lastchild      Is this item the last child in a subtree?
-/// \param[in]     render         Whether or not to render the item:
-///                               0: no rendering, just calculate size w/out drawing.
-///                               1: render item as well as size calc
+/// Calculates the geometry of the item (xywh, label and collapse icon),
+/// positions the item's widget(), and draws the item unless it's clipped.
+/// Used by draw(), and by Fl_Tree to draw the displayed rows of the tree.
 ///
-/// \version 1.3.3 ABI feature: modified parameters
+/// \param[in] X,Y,W      Position and recommended width of the item
+/// \param[in] H          Height of the item, see calc_item_height()
+/// \param[in] H2         Height of the row (item height plus line spacing)
+/// \param[in] itemfocus  The tree's current focus item (if any)
+/// \param[in] lastchild  Is this item the last child in a subtree?
+/// \param[in] render     0: only calculate the item's geometry, 1: draw it too
+/// \returns the right-most X coordinate of the item's content
+/// \version 1.4.0
 ///
-void Fl_Tree_Item::draw(int X, int &Y, int W, Fl_Tree_Item *itemfocus,
-			int &tree_item_xmax, int lastchild, int render) {
+int Fl_Tree_Item::draw_row(int X, int Y, int W, int H, int H2, Fl_Tree_Item *itemfocus,
+                           int lastchild, int render) {
   Fl_Tree_Prefs &prefs = _tree->_prefs;
-  if ( !is_visible() ) return; 
   int tree_top = tree()->_tiy;
   int tree_bot = tree_top + tree()->_tih;
-  int H = calc_item_height(prefs);	// height of item
-  int H2 = H + prefs.linespacing();	// height of item with line spacing
 
   // Update the xywh of this item
   _xywh[0] = X;
@@ -1145,12 +1170,46 @@ void Fl_Tree_Item::draw(int X, int &Y, int W, Fl_Tree_Item *itemfocus,
       }
     }			// end drawthis
   }			// end clipped
+  return(xmax);
+}
+
+/// Draw this item and its children.
+///
+/// \param[in]     X              Horizontal position for item being drawn
+/// \param[in,out] Y              Vertical position for item being drawn,
+///                               returns new position for next item
+/// \param[in]     W              Recommended width for item
+/// \param[in]     itemfocus      The tree's current focus item (if any)
+/// \param[in,out] tree_item_xmax The tree's running xmax (right-most edge so far).
+///                               Mainly used by parent tree when render==0 to
+///                               calculate tree's max width.
+/// \param[in]     lastchild      Is this item the last child in a subtree?
+/// \param[in]     render         Whether or not to render the item:
+///                               0: no rendering, just calculate size w/out drawing.
+///                               1: render item as well as size calc
+///
+/// \version 1.3.3 ABI feature: modified parameters
+///
+void Fl_Tree_Item::draw(int X, int &Y, int W, Fl_Tree_Item *itemfocus,
+			int &tree_item_xmax, int lastchild, int render) {
+  Fl_Tree_Prefs &prefs = _tree->_prefs;
+  if ( !is_visible() ) return; 
+  int tree_top = tree()->_tiy;
+  int tree_bot = tree_top + tree()->_tih;
+  int H = calc_item_height(prefs);	// height of item
+  int H2 = H + prefs.linespacing();	// height of item with line spacing
+  int xmax = draw_row(X, Y, W, H, H2, itemfocus, lastchild, render);
+  char drawthis = ( is_root() && prefs.showroot() == 0 ) ? 0 : 1;
   if ( drawthis ) Y += H2;					// adjust Y (even if clipped)
   // Manage tree_item_xmax
   if ( xmax > tree_item_xmax )
     tree_item_xmax = xmax;
   // Draw child items (if any)
   if ( has_children() && is_open() ) {
+    int icon_w = prefs.openicon()->w();
+    int hconn_x  = X+icon_w/2-1;
+    int hconn_x2 = hconn_x + prefs.connectorwidth();
+    int hconn_x_center = X + icon_w + ((hconn_x2 - (X + icon_w)) / 2);
     int child_x = drawthis ? (hconn_x_center - (icon_w/2) + 1)	// offset children to right,
                            : X;					// unless didn't drawthis
     int child_w = W - (child_x-X);
@@ -1173,6 +1232,94 @@ void Fl_Tree_Item::draw(int X, int &Y, int W, Fl_Tree_Item *itemfocus,
 }
 
 
+/// Internal: Draw this item as a single row of a tree in 'model mode'.
+///
+/// Unlike draw(), this does not descend into children: in model mode the
+/// tree draws each displayed row itself (including the vertical connectors
+/// of the row's ancestors), and the item's children are not materialized.
+///
+/// \param[in] X,Y,W     Position and recommended width of the row
+/// \param[in] H         Height of the item
+/// \param[in] H2        Height of the row (item height plus line spacing)
+/// \param[in] haskids   Whether the model node has children (draws collapse icon)
+/// \param[in] lastchild Is this item the last child of its parent?
+/// \param[in] itemfocus The tree's current focus item (if any)
+/// \param[in] render    0: only calculate the item's geometry, 1: draw it too
+/// \returns the right-most X coordinate of the item's content
+/// \see Fl_Tree::model(Fl_Tree_Model*)
+/// \version 1.4.0
+///
+int Fl_Tree_Item::draw_model_row(int X, int Y, int W, int H, int H2, int haskids,
+                                 int lastchild, Fl_Tree_Item *itemfocus, int render) {
+  const Fl_Tree_Prefs &prefs = _tree->_prefs;
+  _xywh[0] = X;
+  _xywh[1] = Y;
+  _xywh[2] = W;
+  _xywh[3] = H;
+
+  int item_y_center = Y+(H/2);
+  int icon_w = prefs.openicon()->w();
+  int icon_x = X + (icon_w + prefs.connectorwidth())/2 - 3;
+  int icon_y = item_y_center - (prefs.openicon()->h()/2);
+  _collapse_xywh[0] = icon_x;
+  _collapse_xywh[1] = icon_y;
+  _collapse_xywh[2] = icon_w;
+  _collapse_xywh[3] = prefs.openicon()->h();
+
+  int hconn_x  = X+icon_w/2-1;
+  int hconn_x2 = hconn_x + prefs.connectorwidth();
+  int hconn_x_center = X + icon_w + ((hconn_x2 - (X + icon_w)) / 2);
+  int cw1 = icon_w+prefs.connectorwidth()/2, cw2 = prefs.connectorwidth();
+  int conn_w = cw1>cw2 ? cw1 : cw2;
+
+  Fl_Image *uicon = usericon() ? usericon() : prefs.usericon();
+  int uicon_x = X+(icon_w/2-1+conn_w) + (uicon ? prefs.usericonmarginleft() : 0);
+  int uicon_w = uicon ? uicon->w() : 0;
+
+  _label_xywh[0] = uicon_x + uicon_w + prefs.labelmarginleft();
+  _label_xywh[1] = Y;
+  _label_xywh[2] = _tree->_tix + _tree->_tiw - _label_xywh[0];
+  _label_xywh[3] = H;
+
+  if ( !render ) return draw_item_content(0);
+
+  char active = (is_active() && _tree->active_r()) ? 1 : 0;
+  if ( prefs.connectorstyle() != FL_TREE_CONNECTOR_NONE ) {
+    if (is_root()) draw_horizontal_connector(hconn_x_center, hconn_x2, item_y_center, prefs);
+    else           draw_horizontal_connector(hconn_x, hconn_x2, item_y_center, prefs);
+    if ( haskids && is_open() )
+      draw_vertical_connector(hconn_x_center, item_y_center, Y+H2, prefs);
+    if ( !is_root() ) {
+      if ( lastchild ) draw_vertical_connector(hconn_x, Y, item_y_center, prefs);
+      else             draw_vertical_connector(hconn_x, Y, Y+H2, prefs);
+    }
+  }
+  if ( haskids && prefs.showcollapse() ) {
+    if ( is_open() ) {
+      if ( active ) prefs.closeicon()->draw(icon_x,icon_y);
+      else          prefs.closedeicon()->draw(icon_x,icon_y);
+    } else {
+      if ( active ) prefs.openicon()->draw(icon_x,icon_y);
+      else          prefs.opendeicon()->draw(icon_x,icon_y);
+    }
+  }
+  if ( uicon ) {
+    int uicon_y = item_y_center - (uicon->h() >> 1);
+    Fl_Image *deicon = usericon() ? userdeicon() : prefs.userdeicon();
+    if ( active ) uicon->draw(uicon_x,uicon_y);
+    else if ( deicon ) deicon->draw(uicon_x,uicon_y);
+  }
+  int xmax = draw_item_content(1);
+  if ( this == itemfocus &&
+       Fl::visible_focus() &&
+       Fl::focus() == _tree &&
+       prefs.selectmode() != FL_TREE_SELECT_NONE ) {
+    draw_item_focus(FL_NO_BOX,drawfgcolor(),drawbgcolor(),
+                    label_x()+1,label_y()+1,label_w()-1,label_h()-1);
+  }
+  return xmax;
+}
+
 /// Was the event on the 'collapse' button of this item?
 ///
 int Fl_Tree_Item::event_on_collapse_icon(const Fl_Tree_Prefs &prefs) const {
@@ -1436,10 +1583,13 @@ int Fl_Tree_Item::visible_r() const {
 /// Call this when our geometry is changed. (Font size, label contents, etc)
 /// Schedules tree to recalculate itself, as changes to us may affect tree
 /// widget's scrollbar visibility and tab sizes.
+///
+/// Only the tree's rows of this item and its open children are
+/// recalculated, not the entire tree.
 /// \version 1.3.3 ABI
 ///
 void Fl_Tree_Item::recalc_tree() {
-  _tree->recalc_tree();
+  if ( _tree ) _tree->recalc_rows(this);
 }
 
 //
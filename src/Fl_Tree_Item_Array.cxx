@@ -27,10 +27,19 @@
 //     http://www.fltk.org/str.php
 //
 
+// INTERNAL: Hash value of a label (FNV-1a)
+static unsigned int label_hash(const char *s) {
+  unsigned int h = 2166136261U;
+  for ( ; *s; s++ ) { h ^= (unsigned char)*s; h *= 16777619U; }
+  return(h);
+}
+
 /// Constructor; creates an empty array.
 ///
 ///     The optional 'chunksize' can be specified to optimize
 ///     memory allocation for potentially large arrays. Default chunksize is 10.
+///     The array grows by at least 'chunksize' items, and doubles its size
+///     once it is larger than that.
 /// 
 Fl_Tree_Item_Array::Fl_Tree_Item_Array(int new_chunksize) {
   _items     = 0;
@@ -38,6 +47,8 @@ Fl_Tree_Item_Array::Fl_Tree_Item_Array(int new_chunksize) {
   _size      = 0;
   _flags     = 0;
   _chunksize = new_chunksize;
+  _index     = 0;
+  _indexsize = 0;
 }
 
 /// Destructor. Calls each item's destructor, destroys internal _items array.
@@ -52,6 +63,8 @@ Fl_Tree_Item_Array::Fl_Tree_Item_Array(const Fl_Tree_Item_Array* o) {
   _size      = o->_size;
   _chunksize = o->_chunksize;
   _flags     = o->_flags;
+  _index     = 0;				// built again by find() if needed
+  _indexsize = 0;
   for ( int t=0; t<o->_total; t++ ) {
     if ( _flags & MANAGE_ITEM ) {
       _items[t] = new Fl_Tree_Item(o->_items[t]);	// make new copy of item
@@ -70,6 +83,7 @@ Fl_Tree_Item_Array::Fl_Tree_Item_Array(const Fl_Tree_Item_Array* o) {
 ///     and the array will be cleared. total() will return 0.
 ///
 void Fl_Tree_Item_Array::clear() {
+  free((void*)_index); _index = 0; _indexsize = 0;
   if ( _items ) {
     for ( int t=0; t<_total; t++ ) {
       if ( _flags & MANAGE_ITEM )
@@ -87,25 +101,105 @@ void Fl_Tree_Item_Array::clear() {
 //
 //    Adjusts size/items memory allocation as needed.
 //    Does NOT change total.
+//    The size doubles, so that adding n items one by one takes O(n) time.
 //
 void Fl_Tree_Item_Array::enlarge(int count) {
   int newtotal = _total + count;	// new total
   if ( newtotal >= _size ) {		// more than we have allocated?
-    if ( (newtotal/150) > _chunksize ) _chunksize *= 10;
     // Increase size of array
-    int newsize = _size + _chunksize;
-    Fl_Tree_Item **newitems = (Fl_Tree_Item**)malloc(newsize * sizeof(Fl_Tree_Item*));
-    if ( _items ) { 
-      // Copy old array -> new, delete old
-      memmove(newitems, _items, _size * sizeof(Fl_Tree_Item*));
-      free((void*)_items); _items = 0;
-    }
-    // Adjust items/sizeitems
-    _items = newitems;
+    int newsize = _size * 2;
+    if ( newsize < _size + _chunksize ) newsize = _size + _chunksize;
+    if ( newsize <= newtotal ) newsize = newtotal + 1;
+    _items = (Fl_Tree_Item**)realloc((void*)_items, newsize * sizeof(Fl_Tree_Item*));
     _size = newsize;
   }
 }
 
+// Internal: (Re)build the hash index of the items' labels.
+//
+//    The index is an open addressing hash table with at least
+//    twice as many slots as there are items.
+//
+void Fl_Tree_Item_Array::index_build() const {
+  int size = 64;
+  while ( size < _total * 2 + 2 ) size *= 2;
+  free((void*)_index);
+  _index = (Fl_Tree_Item**)calloc(size, sizeof(Fl_Tree_Item*));
+  _indexsize = size;
+  for ( int t=0; t<_total; t++ )
+    index_add(_items[t]);
+}
+
+// Internal: Add 'item' to the hash index, if there is one.
+void Fl_Tree_Item_Array::index_add(Fl_Tree_Item *item) const {
+  if ( !_index || !item->label() ) return;
+  if ( _total * 2 + 2 > _indexsize ) { index_build(); return; }	// grow (adds item)
+  unsigned int mask = _indexsize - 1;
+  unsigned int i = label_hash(item->label()) & mask;
+  while ( _index[i] ) i = (i + 1) & mask;
+  _index[i] = item;
+}
+
+// Internal: Remove 'item' from the hash index, if there is one.
+//
+//    Must be called before the item's label changes or the item is destroyed.
+//    Returns 1 if the item is in the array and was removed from the index
+//    (items without a label are never in the index), 0 otherwise.
+//
+int Fl_Tree_Item_Array::index_remove(Fl_Tree_Item *item) const {
+  if ( !_index ) return(0);
+  if ( !item->label() ) {				// not in index: in array?
+    for ( int t=0; t<_total; t++ )
+      if ( _items[t] == item ) return(1);
+    return(0);
+  }
+  unsigned int mask = _indexsize - 1;
+  unsigned int i = label_hash(item->label()) & mask;
+  while ( _index[i] != item ) {
+    if ( !_index[i] ) return(0);			// not found
+    i = (i + 1) & mask;
+  }
+  // Move following entries of the probe sequence into the gap
+  unsigned int j = i;
+  while ( 1 ) {
+    j = (j + 1) & mask;
+    if ( !_index[j] ) break;
+    unsigned int k = label_hash(_index[j]->label()) & mask;
+    if ( (i <= j) ? (i < k && k <= j) : (i < k || k <= j) ) continue;	// stays
+    _index[i] = _index[j];
+    i = j;
+  }
+  _index[i] = 0;
+  return(1);
+}
+
+/// Find the first item whose label is \p 'name'.
+///
+///     For arrays with many items a hash index of the labels is built
+///     on the first call, so that subsequent lookups are fast.
+///
+///     \returns the item, or NULL if no item has this label.
+///     \version 1.4.0
+///
+Fl_Tree_Item *Fl_Tree_Item_Array::find(const char *name) const {
+  if ( !name ) return(0);
+  if ( !_index && _total >= INDEX_MIN ) index_build();
+  if ( _index ) {
+    unsigned int mask = _indexsize - 1;
+    Fl_Tree_Item *found = 0;
+    int matches = 0;
+    for ( unsigned int i = label_hash(name) & mask; _index[i]; i = (i + 1) & mask ) {
+      if ( strcmp(_index[i]->label(), name) == 0 ) { found = _index[i]; ++matches; }
+    }
+    if ( matches <= 1 ) return(found);
+    // Several items with this label: find the first one below
+  }
+  for ( int t=0; t<_total; t++ )
+    if ( _items[t]->label() && strcmp(_items[t]->label(), name) == 0 )
+      return(_items[t]);
+  return(0);
+}
+
 /// Insert an item at index position \p pos.
 ///
 ///     Handles enlarging array if needed, total increased by 1.
@@ -124,6 +218,7 @@ void Fl_Tree_Item_Array::insert(int pos, Fl_Tree_Item *new_item) {
   {
     _items[pos]->update_prev_next(pos);	// adjust item's prev/next and its neighbors
   }
+  index_add(new_item);
 }
 
 /// Add an item* to the end of the array.
@@ -136,12 +231,43 @@ void Fl_Tree_Item_Array::add(Fl_Tree_Item *val) {
   insert(_total, val);
 }
 
+/// Add \p 'count' items from \p 'vals' to the end of the array.
+///
+///     Same as calling add(Fl_Tree_Item*) for each item, but enlarges
+///     the array only once, and links the items to their siblings
+///     in a single pass.
+///
+///     \version 1.4.0
+///
+void Fl_Tree_Item_Array::add(Fl_Tree_Item **vals, int count) {
+  if ( count <= 0 ) return;
+  enlarge(count);
+  int first = _total;
+  memcpy(&_items[first], vals, count * sizeof(Fl_Tree_Item*));
+  _total += count;
+  if ( _flags & MANAGE_ITEM ) {
+    Fl_Tree_Item *prev = first > 0 ? _items[first-1] : 0;
+    for ( int t=first; t<_total; t++ ) {
+      Fl_Tree_Item *item = _items[t];
+      item->_prev_sibling = prev;
+      item->_next_sibling = 0;
+      if ( prev ) prev->_next_sibling = item;
+      prev = item;
+    }
+  }
+  if ( _index ) {
+    if ( _total * 2 + 2 > _indexsize ) index_build();	// grow (adds all items)
+    else for ( int t=first; t<_total; t++ ) index_add(_items[t]);
+  }
+}
+
 /// Replace the item at \p index with \p newitem.
 ///
 /// Old item at index position will be destroyed,
 /// and the new item will take it's place, and stitched into the linked list.
 ///
 void Fl_Tree_Item_Array::replace(int index, Fl_Tree_Item *newitem) {
+  if ( _items[index] ) index_remove(_items[index]);
   if ( _items[index] ) {			// delete if non-zero
     if ( _flags & MANAGE_ITEM )
       // Destroy old item
@@ -153,6 +279,7 @@ void Fl_Tree_Item_Array::replace(int index, Fl_Tree_Item *newitem) {
     // Restitch into linked list
     _items[index]->update_prev_next(index);
   }
+  index_add(newitem);
 }
 
 /// Remove the item at \param[in] index from the array.
@@ -161,14 +288,14 @@ void Fl_Tree_Item_Array::replace(int index, Fl_Tree_Item *newitem) {
 ///
 void Fl_Tree_Item_Array::remove(int index) {
   if ( _items[index] ) {			// delete if non-zero
+    index_remove(_items[index]);
     if ( _flags & MANAGE_ITEM )
       delete _items[index];
   }
   _items[index] = 0;
   _total--;
-  for ( int i=index; i<_total; i++ ) {		// reshuffle the array
-    _items[i] = _items[i+1];
-  }
+  memmove(&_items[index], &_items[index+1],	// reshuffle the array
+          (_total - index) * sizeof(Fl_Tree_Item*));
   if ( _flags & MANAGE_ITEM )
   {
     if ( index < _total ) {			// removed item not last?
@@ -247,10 +374,11 @@ int Fl_Tree_Item_Array::deparent(int pos) {
   Fl_Tree_Item *item = _items[pos];
   Fl_Tree_Item *prev = item->prev_sibling();
   Fl_Tree_Item *next = item->next_sibling();
+  index_remove(item);
   // Remove from parent's list of children
   _total -= 1;
-  for ( int t=pos; t<_total; t++ )
-    _items[t] = _items[t+1];            // delete, no destroy
+  memmove(&_items[pos], &_items[pos+1], // delete, no destroy
+          (_total - pos) * sizeof(Fl_Tree_Item*));
   // Now an orphan: remove association with old parent and siblings
   item->update_prev_next(-1);           // become an orphan
   // Adjust bereaved siblings
@@ -269,12 +397,13 @@ int Fl_Tree_Item_Array::reparent(Fl_Tree_Item *item, Fl_Tree_Item* newparent, in
   // Add item to new parent
   enlarge(1);
   _total += 1;
-  for ( int t=_total-1; t>pos; --t )    // shuffle array to make room for new entry
-    _items[t] = _items[t-1];
+  memmove(&_items[pos+1], &_items[pos], // shuffle array to make room for new entry
+          (_total - 1 - pos) * sizeof(Fl_Tree_Item*));
   _items[pos] = item;                   // insert new entry
   // Attach to new parent and siblings
   _items[pos]->parent(newparent);       // reparent (update_prev_next() needs this)
   _items[pos]->update_prev_next(pos);   // find new siblings
+  index_add(item);
   return 0;
 }
 
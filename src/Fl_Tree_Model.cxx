@@ -0,0 +1,778 @@
+//
+// "$Id$"
+//
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <FL/Fl_Tree.H>
+#include <FL/Fl_Tree_Model.H>
+
+//////////////////////
+// Fl_Tree_Model.cxx
+//////////////////////
+//
+// Fl_Tree -- This file is part of the Fl_Tree widget for FLTK
+// Copyright (C) 2009-2018 by Greg Ercolano and others.
+//
+// This library is free software. Distribution and use rights are outlined in
+// the file "COPYING" which should have been included with this file.  If this
+// file is missing or damaged, see the license at:
+//
+//     http://www.fltk.org/COPYING.php
+//
+// Please report all bugs and problems on the following page:
+//
+//     http://www.fltk.org/str.php
+//
+
+// Model mode of Fl_Tree
+//
+//     The structure of the tree is owned by the application's Fl_Tree_Model.
+//     The tree only remembers which nodes are open, in a small tree of
+//     Fl_Tree_Model_Node's: each open node knows its number of children and
+//     the number of rows displayed below it (its children plus the rows of
+//     its open children). This maps a row number to a model node in
+//     O(depth) steps without ever enumerating closed or off-screen nodes.
+//
+//     Fl_Tree_Item's are only created for rows that are drawn (plus a margin)
+//     or asked for by the API (focus item, callbacks, next_item()..), and are
+//     kept in a small cache sorted by row number.
+//
+
+/// Destructor.
+Fl_Tree_Model::~Fl_Tree_Model() {
+}
+
+// INTERNAL: An open node of the model
+struct Fl_Tree_Model_Node {
+  long id;				// model index
+  int pos;				// position in parent
+  int count;				// number of children
+  long rows;				// number of rows displayed below this node
+  long skip;				// rows of the open siblings before this node
+  Fl_Tree_Model_Node *parent;		// parent node (NULL for root)
+  Fl_Tree_Model_Node **kids;		// open children, sorted by pos
+  int nkids, akids;			// used/allocated size of kids[]
+};
+
+// INTERNAL: A materialized row
+struct Fl_Tree_Model_Entry {
+  long row;				// displayed row number
+  long id;				// model index
+  int depth;				// 0 for the root
+  int haskids;				// node can be opened
+  Fl_Tree_Item *item;
+};
+
+// INTERNAL: Result of Fl_Tree_Model_View::locate()
+struct Fl_Tree_Model_Row {
+  Fl_Tree_Model_Node *parent;		// node this row is a child of (NULL for root)
+  int pos;				// position in parent
+  long id;				// model index
+  Fl_Tree_Model_Node *node;		// the row's node if open, else NULL
+  int depth;				// 0 for the root
+};
+
+// INTERNAL: Model mode state of an Fl_Tree
+class Fl_Tree_Model_View {
+public:
+  Fl_Tree_Model *model;
+  Fl_Tree_Model_Node *root;
+  int root_open;
+  long *sel;				// selected model indexes (hash set, -1 = free slot)
+  long nsel;				// allocated size of sel[], a power of 2
+  long nselected;			// number of selected model indexes
+  Fl_Tree_Model_Entry *cache;		// materialized rows, sorted by row
+  int ncache, acache;			// used/allocated size of cache[]
+  int itemh, rowh;			// item height, without/with linespacing
+  int maxw;				// widest row content seen so far
+
+  Fl_Tree_Model_View(Fl_Tree_Model *m);
+  ~Fl_Tree_Model_View();
+  long rows(int showroot) const {
+    return (showroot ? 1 : 0) + ((root_open || !showroot) ? root->rows : 0);
+  }
+  int locate(long row, int showroot, Fl_Tree_Model_Row &r) const;
+  int find(long row) const;
+  long slot(long id) const;
+  int bit(long id) const {
+    return (id >= 0 && nselected > 0) ? sel[slot(id)] == id : 0;
+  }
+  int set_bit(long id, int val);
+  void clear_bits();
+};
+
+static Fl_Tree_Model_Node *new_node(long id, int pos, int count,
+                                    Fl_Tree_Model_Node *parent) {
+  Fl_Tree_Model_Node *n = new Fl_Tree_Model_Node;
+  n->id     = id;
+  n->pos    = pos;
+  n->count  = count > 0 ? count : 0;
+  n->rows   = n->count;
+  n->skip   = 0;
+  n->parent = parent;
+  n->kids   = 0;
+  n->nkids  = n->akids = 0;
+  return n;
+}
+
+static void free_node(Fl_Tree_Model_Node *n) {
+  for ( int t=0; t<n->nkids; t++ ) free_node(n->kids[t]);
+  free(n->kids);
+  delete n;
+}
+
+// INTERNAL: Index of the first open child of 'n' at or after position 'pos'
+static int kid_index(const Fl_Tree_Model_Node *n, int pos) {
+  int lo = 0, hi = n->nkids;
+  while ( lo < hi ) {
+    int mid = (lo + hi) / 2;
+    if ( n->kids[mid]->pos < pos ) lo = mid + 1; else hi = mid;
+  }
+  return lo;
+}
+
+// INTERNAL: Add 'delta' rows below open node 'n' to the counts of its parents,
+//    and to the 'skip' of the open siblings after 'n' and after each parent.
+//
+static void add_rows(Fl_Tree_Model_Node *n, long delta) {
+  for ( Fl_Tree_Model_Node *p = n->parent; p; n = p, p = p->parent ) {
+    p->rows += delta;
+    for ( int t = kid_index(p, n->pos) + 1; t < p->nkids; t++ )
+      p->kids[t]->skip += delta;
+  }
+}
+
+// INTERNAL: Add an open child to its parent, update the parents' row counts
+//    Returns 0 if out of memory.
+//
+static int insert_node(Fl_Tree_Model_Node *n) {
+  Fl_Tree_Model_Node *p = n->parent;
+  if ( p->nkids == p->akids ) {
+    int a = p->akids ? p->akids * 2 : 4;
+    Fl_Tree_Model_Node **kids =
+      (Fl_Tree_Model_Node**)realloc(p->kids, a * sizeof(Fl_Tree_Model_Node*));
+    if ( !kids ) return(0);
+    p->kids  = kids;
+    p->akids = a;
+  }
+  int t = kid_index(p, n->pos);
+  memmove(p->kids+t+1, p->kids+t, (p->nkids-t) * sizeof(Fl_Tree_Model_Node*));
+  p->kids[t] = n;
+  p->nkids++;
+  n->skip = t > 0 ? p->kids[t-1]->skip + p->kids[t-1]->rows : 0;
+  add_rows(n, n->rows);
+  return(1);
+}
+
+// INTERNAL: Remove and free an open child, update the parents' row counts
+static void remove_node(Fl_Tree_Model_Node *n) {
+  Fl_Tree_Model_Node *p = n->parent;
+  add_rows(n, -n->rows);
+  int t = kid_index(p, n->pos);
+  memmove(p->kids+t, p->kids+t+1, (p->nkids-t-1) * sizeof(Fl_Tree_Model_Node*));
+  p->nkids--;
+  free_node(n);
+}
+
+Fl_Tree_Model_View::Fl_Tree_Model_View(Fl_Tree_Model *m) {
+  model     = m;
+  long id   = m->root();
+  root      = new_node(id, 0, m->child_count(id), 0);
+  root_open = 1;
+  sel       = 0;
+  nsel      = 0;
+  nselected = 0;
+  cache     = 0;
+  ncache    = acache = 0;
+  itemh     = rowh = 0;
+  maxw      = 0;
+}
+
+// Items in the cache must be deleted by the tree before this
+Fl_Tree_Model_View::~Fl_Tree_Model_View() {
+  free_node(root);
+  free(sel);
+  free(cache);
+}
+
+// INTERNAL: Find the model node displayed in 'row'
+//    Returns 0 if row is out of range.
+//
+int Fl_Tree_Model_View::locate(long row, int showroot, Fl_Tree_Model_Row &r) const {
+  if ( row < 0 || row >= rows(showroot) ) return(0);
+  if ( showroot ) {
+    if ( row == 0 ) {
+      r.parent = 0;
+      r.pos    = 0;
+      r.id     = root->id;
+      r.node   = root_open ? root : 0;
+      r.depth  = 0;
+      return(1);
+    }
+    row--;
+  }
+  // Descend into the open children; 'row' is relative to the first child of 'n'.
+  // The row of open child k is k->pos + k->skip, so the open child at or
+  // before 'row' is found with a binary search.
+  Fl_Tree_Model_Node *n = root;
+  int depth = 1;
+  for (;;) {
+    int lo = 0, hi = n->nkids;		// find the first open child after 'row'
+    while ( lo < hi ) {
+      int mid = (lo + hi) / 2;
+      Fl_Tree_Model_Node *k = n->kids[mid];
+      if ( k->pos + k->skip <= row ) lo = mid + 1; else hi = mid;
+    }
+    Fl_Tree_Model_Node *k = lo > 0 ? n->kids[lo-1] : 0;
+    long start = k ? k->pos + k->skip : 0;	// row of child k
+    if ( k && row == start ) {
+      r.parent = n;
+      r.pos    = k->pos;
+      r.id     = k->id;
+      r.node   = k;
+      r.depth  = depth;
+      return(1);
+    }
+    if ( !k || row > start + k->rows ) {	// a closed child
+      r.parent = n;
+      r.pos    = (int)(row - (k ? k->skip + k->rows : 0));
+      r.id     = model->child(n->id, r.pos);
+      r.node   = 0;
+      r.depth  = depth;
+      return(1);
+    }
+    row -= start + 1;			// inside k's children
+    n = k;
+    depth++;
+  }
+}
+
+// INTERNAL: Index of the first cache entry whose row is >= 'row'
+int Fl_Tree_Model_View::find(long row) const {
+  int lo = 0, hi = ncache;
+  while ( lo < hi ) {
+    int mid = (lo + hi) / 2;
+    if ( cache[mid].row < row ) lo = mid + 1; else hi = mid;
+  }
+  return lo;
+}
+
+// INTERNAL: Hash of a model index
+static unsigned long sel_hash(long id) {
+  unsigned long h = (unsigned long)id * 2654435761UL;
+  return(h ^ (h >> 15));
+}
+
+// INTERNAL: Slot of model index 'id' in sel[], or the free slot where it belongs
+//    The selection is a hash set with linear probing that is never full,
+//    so its size depends on the number of selected nodes only, however
+//    sparse the model indexes are.
+//
+long Fl_Tree_Model_View::slot(long id) const {
+  long mask = nsel - 1;
+  long t = (long)(sel_hash(id) & (unsigned long)mask);
+  while ( sel[t] != id && sel[t] != -1 ) t = (t + 1) & mask;
+  return(t);
+}
+
+// INTERNAL: Set or clear the selection bit of model index 'id'
+//    Returns 1 if the bit was changed, 0 if not (or if out of memory).
+//
+int Fl_Tree_Model_View::set_bit(long id, int val) {
+  if ( id < 0 ) return(0);
+  if ( !val ) {
+    if ( !bit(id) ) return(0);
+    // Remove the entry, then move the following entries of the probe
+    // sequence up, so that lookups don't stop at the hole
+    long mask = nsel - 1;
+    long hole = slot(id);
+    for ( long t = (hole + 1) & mask; sel[t] != -1; t = (t + 1) & mask ) {
+      long home = (long)(sel_hash(sel[t]) & (unsigned long)mask);
+      if ( ((t - home) & mask) >= ((t - hole) & mask) ) {
+        sel[hole] = sel[t];
+        hole = t;
+      }
+    }
+    sel[hole] = -1;
+    nselected--;
+    return(1);
+  }
+  if ( bit(id) ) return(0);
+  if ( (nselected + 1) * 4 > nsel * 3 ) {	// grow: keep the set at most 3/4 full
+    long n = nsel ? nsel * 2 : 64;
+    long *s = (long*)malloc(n * sizeof(long));
+    if ( !s ) return(0);
+    for ( long t=0; t<n; t++ ) s[t] = -1;
+    long *old = sel, nold = nsel;
+    sel  = s;
+    nsel = n;
+    for ( long t=0; t<nold; t++ )
+      if ( old[t] != -1 ) sel[slot(old[t])] = old[t];
+    free(old);
+  }
+  sel[slot(id)] = id;
+  nselected++;
+  return(1);
+}
+
+// INTERNAL: Deselect all model indexes
+void Fl_Tree_Model_View::clear_bits() {
+  free(sel);
+  sel       = 0;
+  nsel      = 0;
+  nselected = 0;
+}
+
+/// Sets the data model of the tree, switching the tree to 'model mode'.
+///
+/// In model mode the tree shows the nodes of \p 'm' instead of its own
+/// items (which are kept, but neither shown nor changed). Items are only
+/// created for the rows that are displayed, and children are only asked
+/// for when a node is opened. This allows browsing hierarchies with
+/// millions of nodes, e.g. file systems or symbol tables.
+///
+/// In model mode:
+///   - Fl_Tree_Item's returned by the tree (e.g. by first(), next_item(),
+///     find_clicked(), callback_item()) represent displayed rows. Use
+///     model_index() to find the model node of an item. Items are recycled
+///     as they are scrolled out of view, so don't keep pointers to them
+///     beyond the next redraw.
+///   - first(), next(), last() and prev() walk the displayed rows,
+///     like next_visible_item().
+///   - The selection state is kept by model index and is not lost when
+///     nodes are closed; see model_select() and model_selected().
+///     Bulk operations like select_all() and deselect_all() invoke the
+///     callback once with callback_item() set to NULL for nodes that have
+///     no item.
+///   - Closing a node forgets which of its children were open.
+///   - All rows have the same height, openchild_marginbottom() is ignored,
+///     and items can't be dragged with FL_TREE_SELECT_SINGLE_DRAGGABLE.
+///
+/// The tree does not take ownership of the model. Call model_changed()
+/// after the model's structure has changed.
+///
+/// \param[in] m The data model, or NULL to show the tree's own items again.
+/// \see Fl_Tree_Model, model_changed(), model_index()
+/// \version 1.4.0
+///
+void Fl_Tree::model(Fl_Tree_Model *m) {
+  if ( _mview ) {
+    for ( int t=0; t<_mview->ncache; t++ )
+      delete _mview->cache[t].item;	// also clears _item_focus
+    delete _mview;
+    _mview = 0;
+  }
+  _item_focus    = 0;
+  _lastselect    = 0;
+  _callback_item = 0;
+  _model = m;
+  if ( _model ) _mview = new Fl_Tree_Model_View(_model);
+  recalc_tree();
+  redraw();
+}
+
+/// Tells the tree that the structure of its model has changed.
+///
+/// All nodes except the root are closed, the selection is cleared,
+/// and the displayed rows are fetched again from the model.
+///
+/// \see model(Fl_Tree_Model*)
+/// \version 1.4.0
+///
+void Fl_Tree::model_changed() {
+  model(_model);
+}
+
+/// Returns the model index of \p 'item', or -1 if \p 'item' is
+/// not a row of the tree's model (or the tree is not in model mode).
+/// \see model(Fl_Tree_Model*)
+/// \version 1.4.0
+///
+long Fl_Tree::model_index(const Fl_Tree_Item *item) const {
+  Fl_Tree_Model_Entry *e = model_entry(item);
+  return(e ? e->id : -1);
+}
+
+/// Selects or deselects the model node with index \p 'index'.
+///
+/// This works for any node of the model, even if it is not displayed.
+/// The callback is not invoked. Handles calling redraw() if anything changed.
+///
+/// \param[in] index Model index of the node
+/// \param[in] val   1 to select, 0 to deselect the node
+/// \returns 1 if the selection state was changed, 0 if not.
+/// \see model_selected(), model(Fl_Tree_Model*)
+/// \version 1.4.0
+///
+int Fl_Tree::model_select(long index, int val) {
+  if ( !_mview || !_mview->set_bit(index, val) ) return(0);
+  for ( int t=0; t<_mview->ncache; t++ )
+    if ( _mview->cache[t].id == index )
+      _mview->cache[t].item->select(val);
+  set_changed();
+  redraw();
+  return(1);
+}
+
+/// Returns 1 if the model node with index \p 'index' is selected, 0 if not.
+/// \see model_select(), model(Fl_Tree_Model*)
+/// \version 1.4.0
+///
+int Fl_Tree::model_selected(long index) const {
+  return(_mview ? _mview->bit(index) : 0);
+}
+
+// INTERNAL: Number of rows displayed in model mode
+long Fl_Tree::model_rows() const {
+  return(_mview->rows(showroot()));
+}
+
+// INTERNAL: Cache entry of a materialized item, or NULL
+Fl_Tree_Model_Entry *Fl_Tree::model_entry(const Fl_Tree_Item *item) const {
+  if ( !_mview || !item ) return(0);
+  for ( int t=0; t<_mview->ncache; t++ )
+    if ( _mview->cache[t].item == item ) return(&_mview->cache[t]);
+  return(0);
+}
+
+// INTERNAL: Displayed row of a materialized item, or -1
+long Fl_Tree::model_row(const Fl_Tree_Item *item) const {
+  Fl_Tree_Model_Entry *e = model_entry(item);
+  return(e ? e->row : -1);
+}
+
+// INTERNAL: Number of rows displayed below 'row'
+long Fl_Tree::model_subtree_rows(long row) const {
+  Fl_Tree_Model_Row r;
+  if ( !_mview->locate(row, showroot(), r) || !r.node ) return(0);
+  return(r.node->rows);
+}
+
+// INTERNAL: Calculate the geometry of a materialized item, and draw it if 'render'
+//    Returns the right edge of the item's content.
+//
+int Fl_Tree::model_place(Fl_Tree_Model_Entry &e, int lastchild,
+                         Fl_Tree_Item *itemfocus, int render) {
+  Fl_Tree_Model_View *v = _mview;
+  if ( v->rowh <= 0 ) calc_tree();
+  long Y = _tiy + _prefs.margintop() - (long)_vscroll->value() + e.row * v->rowh;
+  if ( Y < -0x3fffffff ) Y = -0x3fffffff;	// far away rows: keep coordinates in range
+  if ( Y >  0x3fffffff ) Y =  0x3fffffff;
+  int X  = row_x(e.depth);
+  int X0 = _tix + _prefs.marginleft() - (int)_hscroll->value();
+  int W  = _tiw - X + _tix;
+  fl_font(e.item->labelfont(), e.item->labelsize());
+  int xmax = e.item->draw_model_row(X, (int)Y, W, v->itemh, v->rowh, e.haskids,
+                                    lastchild, itemfocus, render);
+  if ( xmax - X0 > v->maxw ) v->maxw = xmax - X0;
+  return(xmax);
+}
+
+// INTERNAL: Return the item for displayed 'row', creating it if needed
+Fl_Tree_Item *Fl_Tree::model_item(long row) {
+  Fl_Tree_Model_View *v = _mview;
+  int t = v->find(row);
+  if ( t < v->ncache && v->cache[t].row == row ) {
+    model_place(v->cache[t]);
+    return(v->cache[t].item);
+  }
+  Fl_Tree_Model_Row r;
+  if ( !v->locate(row, showroot(), r) ) return(0);
+  // Keep the cache small when the API walks many rows, e.g. next_item() loops
+  int limit = 256 + (v->rowh > 0 ? 4 * (_tih / v->rowh) : 0);
+  if ( v->ncache >= limit ) {
+    model_evict(row - limit/4, row + limit/4);
+    t = v->find(row);
+  }
+  if ( v->ncache == v->acache ) {
+    int a = v->acache ? v->acache * 2 : 64;
+    Fl_Tree_Model_Entry *cache =
+      (Fl_Tree_Model_Entry*)realloc(v->cache, a * sizeof(Fl_Tree_Model_Entry));
+    if ( !cache ) return(0);
+    v->cache  = cache;
+    v->acache = a;
+  }
+  memmove(v->cache+t+1, v->cache+t, (v->ncache-t) * sizeof(Fl_Tree_Model_Entry));
+  v->ncache++;
+  Fl_Tree_Model_Entry &e = v->cache[t];
+  Fl_Tree_Item *item = new Fl_Tree_Item(this);
+  item->parent(r.parent ? _root : 0);	// the model's root is the only 'root' item
+  item->label(_model->label(r.id));
+  item->usericon(_model->icon(r.id));
+  if ( !r.node ) item->_flags &= ~Fl_Tree_Item::OPEN;
+  if ( v->bit(r.id) ) item->_flags |= Fl_Tree_Item::SELECTED;
+  e.row     = row;
+  e.id      = r.id;
+  e.depth   = r.depth;
+  e.haskids = r.node ? (r.node->count > 0) : _model->has_children(r.id);
+  e.item    = item;
+  model_place(e);
+  return(item);
+}
+
+// INTERNAL: Move materialized rows after 'row' by 'delta' rows
+//    A negative delta removes rows row+1 .. row-delta (a node was closed).
+//
+void Fl_Tree::model_shift_rows(long row, long delta) {
+  Fl_Tree_Model_View *v = _mview;
+  long last = delta < 0 ? row - delta : row;
+  int j = 0;
+  for ( int t=0; t<v->ncache; t++ ) {
+    Fl_Tree_Model_Entry e = v->cache[t];
+    if ( e.row > row && e.row <= last ) {	// row is no longer displayed
+      if ( e.item == _lastselect ) _lastselect = 0;
+      if ( e.item == _callback_item ) _callback_item = 0;
+      delete e.item;			// also clears _item_focus
+      continue;
+    }
+    if ( e.row > last ) e.row += delta;
+    v->cache[j++] = e;
+  }
+  v->ncache = j;
+}
+
+// INTERNAL: Delete materialized rows outside first..last,
+//    except the ones the tree still refers to.
+//
+void Fl_Tree::model_evict(long first, long last) {
+  Fl_Tree_Model_View *v = _mview;
+  int j = 0;
+  for ( int t=0; t<v->ncache; t++ ) {
+    Fl_Tree_Model_Entry &e = v->cache[t];
+    if ( (e.row < first || e.row > last) &&
+         e.item != _item_focus && e.item != _lastselect && e.item != _callback_item ) {
+      delete e.item;
+      continue;
+    }
+    v->cache[j++] = e;
+  }
+  v->ncache = j;
+}
+
+// INTERNAL: Add (val=1) or remove (val=0) the root row, see showroot()
+//    A hidden root is always open.
+//
+void Fl_Tree::model_showroot(int val) {
+  model_shift_rows(-1, val ? 1 : -1);
+  _mview->root_open = 1;
+}
+
+// INTERNAL: Open (val=1) or close (val=0) the node of a materialized item
+//    Returns 1 if the state was changed.
+//
+int Fl_Tree::model_set_open(Fl_Tree_Item *item, int val) {
+  Fl_Tree_Model_View *v = _mview;
+  Fl_Tree_Model_Entry *e = model_entry(item);
+  Fl_Tree_Model_Row r;
+  if ( !e || !e->haskids || !v->locate(e->row, showroot(), r) ) return(0);
+  long row = e->row;
+  if ( val ) {
+    if ( r.node ) return(0);
+    if ( !r.parent ) {			// root
+      v->root_open = 1;
+      model_shift_rows(row, v->root->rows);
+    } else {
+      Fl_Tree_Model_Node *n = new_node(r.id, r.pos, _model->child_count(r.id), r.parent);
+      if ( !insert_node(n) ) { free_node(n); return(0); }
+      model_shift_rows(row, n->rows);
+    }
+    item->_flags |= Fl_Tree_Item::OPEN;
+  } else {
+    if ( !r.node ) return(0);
+    Fl_Tree_Item *focus = _item_focus;
+    if ( !r.parent ) {			// root
+      v->root_open = 0;
+      model_shift_rows(row, -v->root->rows);
+      for ( int t=0; t<v->root->nkids; t++ ) free_node(v->root->kids[t]);
+      v->root->nkids = 0;
+      v->root->rows = v->root->count;
+    } else {
+      long rows = r.node->rows;
+      remove_node(r.node);
+      model_shift_rows(row, -rows);
+    }
+    if ( focus && !_item_focus ) _item_focus = item;	// focus was inside closed node
+    item->_flags &= ~Fl_Tree_Item::OPEN;
+  }
+  recalc_tree();
+  return(1);
+}
+
+// INTERNAL: Change the selection of displayed rows from..to
+//    val: 0=deselect, 1=select, 2=toggle
+//    The selection is changed first, then the callback is invoked for the
+//    materialized items that changed, and once with a NULL item for the
+//    other rows that changed, like model_deselect_all().
+//    Returns the number of rows changed.
+//
+int Fl_Tree::model_select_rows(long from, long to, int val, int docallback) {
+  Fl_Tree_Model_View *v = _mview;
+  long changed = 0, nsel = 0, ndesel = 0;
+  Fl_Tree_Model_Row r;
+  for ( long row = from; row <= to; row++ ) {
+    if ( !v->locate(row, showroot(), r) ) break;
+    int sel = v->bit(r.id);
+    int newsel = (val == 2) ? !sel : val;
+    if ( newsel == sel || !v->set_bit(r.id, newsel) ) continue;
+    ++changed;
+    if ( newsel ) ++nsel; else ++ndesel;
+  }
+  if ( changed == 0 ) return(0);
+  // Update the materialized items, remember the ones that changed
+  Fl_Tree_Item **items = (Fl_Tree_Item**)malloc(v->ncache * sizeof(Fl_Tree_Item*) + 1);
+  int nitems = 0, nitemsel = 0;
+  for ( int t=0; t<v->ncache; t++ ) {
+    Fl_Tree_Model_Entry &e = v->cache[t];
+    int sel = v->bit(e.id);
+    if ( e.item->is_selected() == sel ) continue;
+    e.item->select(sel);
+    if ( items && e.row >= from && e.row <= to ) {
+      items[nitems++] = e.item;
+      if ( sel ) nitemsel++;
+    }
+  }
+  set_changed();
+  redraw();
+  if ( docallback ) {
+    for ( int t=0; t<nitems; t++ )
+      do_callback_for_item(items[t], items[t]->is_selected() ? FL_TREE_REASON_SELECTED
+                                                             : FL_TREE_REASON_DESELECTED);
+    if ( nsel > nitemsel )		// nodes without an item
+      do_callback_for_item(0, FL_TREE_REASON_SELECTED);
+    if ( ndesel > nitems - nitemsel )
+      do_callback_for_item(0, FL_TREE_REASON_DESELECTED);
+  }
+  free(items);
+  return(changed > 0x7fffffff ? 0x7fffffff : (int)changed);
+}
+
+// INTERNAL: Deselect all model nodes except the node of 'keep' (may be NULL)
+//    Returns the number of nodes deselected.
+//
+int Fl_Tree::model_deselect_all(Fl_Tree_Item *keep, int docallback) {
+  Fl_Tree_Model_View *v = _mview;
+  long keepid = model_index(keep);
+  int keepsel = v->bit(keepid);
+  long count = v->nselected - keepsel;
+  if ( count <= 0 ) return(0);
+  // Remember the materialized items that change, for the callbacks
+  Fl_Tree_Item **items = (Fl_Tree_Item**)malloc(v->ncache * sizeof(Fl_Tree_Item*) + 1);
+  int nitems = 0;
+  for ( int t=0; t<v->ncache; t++ ) {
+    Fl_Tree_Model_Entry &e = v->cache[t];
+    if ( e.id != keepid && v->bit(e.id) ) {
+      items[nitems++] = e.item;
+      e.item->deselect();
+    }
+  }
+  v->clear_bits();
+  if ( keepsel ) v->set_bit(keepid, 1);
+  set_changed();
+  redraw();
+  if ( docallback ) {
+    for ( int t=0; t<nitems; t++ )
+      do_callback_for_item(items[t], FL_TREE_REASON_DESELECTED);
+    if ( count > nitems )		// nodes without an item
+      do_callback_for_item(0, FL_TREE_REASON_DESELECTED);
+  }
+  free(items);
+  return(count > 0x7fffffff ? 0x7fffffff : (int)count);
+}
+
+// INTERNAL: next_selected_item() in model mode: only displayed rows are searched
+Fl_Tree_Item *Fl_Tree::model_next_selected(Fl_Tree_Item *item, int dir) {
+  if ( _mview->nselected == 0 ) return(0);
+  long n = model_rows();
+  long row = item ? model_row(item) : (dir == FL_Up ? n : -1);
+  if ( item && row < 0 ) return(0);
+  int step = (dir == FL_Up) ? -1 : 1;
+  Fl_Tree_Model_Row r;
+  for ( row += step; row >= 0 && row < n; row += step ) {
+    if ( _mview->locate(row, showroot(), r) && _mview->bit(r.id) )
+      return(model_item(row));
+  }
+  return(0);
+}
+
+// INTERNAL: find_clicked() in model mode: all rows have the same height
+Fl_Tree_Item *Fl_Tree::model_find_clicked(int yonly) {
+  if ( _mview->rowh <= 0 ) return(0);
+  long dy = Fl::event_y() - (_tiy + _prefs.margintop() - (long)_vscroll->value());
+  if ( dy < 0 ) return(0);
+  long row = dy / _mview->rowh;
+  if ( row >= model_rows() ) return(0);
+  Fl_Tree_Item *item = model_item(row);
+  if ( !item ) return(0);
+  if ( !yonly && !Fl::event_inside(item->x(), item->y(), item->w(), item->h()) )
+    return(0);
+  return(item);
+}
+
+// INTERNAL: Was the event on the collapse icon of a materialized item?
+int Fl_Tree::model_event_on_collapse_icon(Fl_Tree_Item *item) {
+  Fl_Tree_Model_Entry *e = model_entry(item);
+  if ( !e || !e->haskids || !_prefs.showcollapse() || !item->is_active() ) return(0);
+  const int *xywh = item->_collapse_xywh;
+  return(Fl::event_inside(xywh[0], xywh[1], xywh[2], xywh[3]) ? 1 : 0);
+}
+
+// INTERNAL: calc_tree() in model mode
+void Fl_Tree::model_calc_tree() {
+  Fl_Tree_Model_View *v = _mview;
+  fl_font(_prefs.labelfont(), _prefs.labelsize());
+  int H = _prefs.labelsize() + fl_descent() + 1;
+  if ( _prefs.openicon() && H < _prefs.openicon()->h() ) H = _prefs.openicon()->h();
+  if ( _prefs.usericon() && H < _prefs.usericon()->h() ) H = _prefs.usericon()->h();
+  v->itemh = H;
+  v->rowh  = H + _prefs.linespacing();
+  if ( v->rowh < 1 ) v->rowh = 1;
+  double h = _prefs.margintop() + (double)model_rows() * v->rowh;
+  _tree_h = h > 0x3fffffff ? 0x3fffffff : (int)h;
+  _tree_w = _prefs.marginleft() + v->maxw;
+  calc_dimensions();
+}
+
+// INTERNAL: Draw the displayed rows in model mode
+//    Only the rows inside the widget are visited.
+//
+void Fl_Tree::model_draw(Fl_Tree_Item *itemfocus) {
+  Fl_Tree_Model_View *v = _mview;
+  if ( v->rowh <= 0 ) return;
+  long n = model_rows();
+  long top = _tiy + _prefs.margintop() - (long)_vscroll->value();	// y of row 0
+  long first = (_tiy - top) / v->rowh;
+  long last  = (_tiy + _tih - top) / v->rowh;
+  if ( first < 0 ) first = 0;
+  if ( last >= n ) last = n - 1;
+  int oldw = v->maxw;
+  int vconn = _prefs.connectorstyle() != FL_TREE_CONNECTOR_NONE;
+  int icon_w = _prefs.openicon()->w();
+  Fl_Tree_Model_Row r;
+  for ( long row = first; row <= last; row++ ) {
+    if ( !v->locate(row, showroot(), r) ) break;
+    Fl_Tree_Item *item = model_item(row);
+    int Y = item->y();
+    // Vertical connectors of ancestors that have more children below
+    if ( vconn ) {
+      int depth = r.depth - 1;
+      for ( Fl_Tree_Model_Node *a = r.parent; a && a->parent; a = a->parent, depth-- ) {
+        if ( a->pos < a->parent->count - 1 )
+          item->draw_vertical_connector(row_x(depth) + icon_w/2 - 1, Y, Y + v->rowh, _prefs);
+      }
+    }
+    int lastchild = r.parent && (r.pos == r.parent->count - 1);
+    model_place(v->cache[v->find(row)], lastchild, itemfocus, 1);
+  }
+  long margin = (last - first) / 2 + 4;
+  model_evict(first - margin, last + margin);
+  if ( v->maxw != oldw ) {		// found wider rows: update horizontal scrollbar
+    _tree_w = _prefs.marginleft() + v->maxw;
+    calc_dimensions();
+  }
+}
+
+//
+// End of "$Id$".
+//
@@ -20,6 +20,7 @@
 #include <FL/Fl_Widget.H>
 #include <FL/Fl_Group.H>
 #include <FL/Fl_Tooltip.H>
+#include <FL/Fl_Event_Stats.H>
 #include <FL/fl_draw.H>
 #include <stdlib.h>
 #include "flstring.h"
@@ -329,7 +330,11 @@ void Fl_Widget::copy_label(const char *a) {
 void Fl_Widget::do_callback(Fl_Widget *widget, void *arg) {
   if (!callback_) return;
   Fl_Widget_Tracker wp(this);
-  callback_(widget, arg);
+  Fl_Callback *cb = callback_;
+  double t = Fl_Event_Stats::start();
+  cb(widget, arg);
+  if (t >= 0)
+    Fl_Event_Stats::record(Fl_Event_Stats::WIDGET, t, (void*)cb, arg, wp.deleted() ? 0 : this);
   if (wp.deleted()) return;
   if (callback_ != default_callback)
     clear_changed();
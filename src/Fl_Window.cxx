@@ -28,6 +28,7 @@
 #include <FL/Fl_RGB_Image.H>
 #include <FL/Fl_Window.H>
 #include <FL/Fl_Tooltip.H>
+#include <FL/Fl_Event_Stats.H>
 #include <FL/fl_draw.H>
 #include <stdlib.h>
 #include "flstring.h"
@@ -87,6 +88,7 @@ pWindowDriver(Fl_Window_Driver::newWindowDriver(this))
 
 Fl_Window::~Fl_Window() {
   hide();
+  Fl_Event_Stats::window_deleted(this);
   if (xclass_) {
     free(xclass_);
   }
@@ -20,6 +20,7 @@
 // Replaces the older set_idle() call (which is used to implement this)
 
 #include <FL/Fl.H>
+#include <FL/Fl_Event_Stats.H>
 
 struct idle_cb {
   void (*cb)(void*);
@@ -37,7 +38,11 @@ static idle_cb* freelist;
 static void call_idle() {
   idle_cb* p = first;
   last = p; first = p->next;
-  p->cb(p->data); // this may call add_idle() or remove_idle()!
+  void (*cb)(void*) = p->cb;
+  void *data = p->data;
+  double t = Fl_Event_Stats::start();
+  cb(data); // this may call add_idle() or remove_idle()!
+  if (t >= 0) Fl_Event_Stats::record(Fl_Event_Stats::IDLE, t, (void*)cb, data);
 }
 
 /**
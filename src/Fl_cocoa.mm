@@ -41,6 +41,7 @@ extern "C" {
 #include <FL/Fl_Screen_Driver.H>
 #include <FL/Fl_Window.H>
 #include <FL/Fl_Tooltip.H>
+#include <FL/Fl_Event_Stats.H>
 #include <FL/Fl_Printer.H>
 #include <FL/Fl_Shared_Image.H>
 #include <FL/fl_draw.H>
@@ -547,7 +548,11 @@ static void do_timer(CFRunLoopTimerRef timer, void* data)
   fl_intptr_t timerId = (fl_intptr_t)data;
   current_timer = &mac_timers[timerId];
   current_timer->pending = 0;
-  (current_timer->callback)(current_timer->data);
+  Fl_Timeout_Handler cb = current_timer->callback;
+  void *argp = current_timer->data;
+  double t = Fl_Event_Stats::start();
+  cb(argp);
+  if (t >= 0) Fl_Event_Stats::record(Fl_Event_Stats::TIMEOUT, t, (void*)cb, argp);
   if (current_timer && current_timer->pending == 0)
     delete_timer(*current_timer);
   current_timer = NULL;
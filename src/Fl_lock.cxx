@@ -19,6 +19,7 @@
 #include "config_lib.h"
 #include <FL/Fl.H>
 #include <FL/Fl_System_Driver.H>
+#include <FL/Fl_Event_Stats.H>
 
 #include <stdlib.h>
 
@@ -271,8 +272,13 @@ void Fl_WinAPI_System_Driver::awake(void* msg) {
 #  include <unistd.h>
 #  include <fcntl.h>
 #  include <pthread.h>
+#  if USE_EPOLL
+#    include <sys/eventfd.h>
+#  endif
 
-// Pipe for thread messaging via Fl::awake()...
+// Pipe for thread messaging via Fl::awake(); with epoll() both ends are
+// the same eventfd, which only wakes up the main thread, and the messages
+// are queued in awake_messages instead:
 static int thread_filedes[2];
 
 // Mutex and state information for Fl::lock() and Fl::unlock()...
@@ -318,11 +324,49 @@ static void unlock_function_rec() {
 }
 #  endif // PTHREAD_MUTEX_RECURSIVE
 
+static void* thread_message_;
+#  if USE_EPOLL
+// Ring buffer of the messages sent with Fl::awake(). Like the pipe, it
+// delivers one message per call of thread_awake_cb(), in order, and drops
+// messages when it is full:
+static const int AWAKE_MESSAGES_MAX = 65536;
+static void** awake_messages;
+static int awake_messages_size, awake_messages_head, awake_messages_count;
+static pthread_mutex_t awake_messages_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static void wake_up_main_thread() {
+  unsigned long long one = 1;
+  if (write(thread_filedes[1], &one, sizeof(one))==0) { /* ignore */ }
+}
+#  endif
+
 void Fl_Posix_System_Driver::awake(void* msg) {
+#  if USE_EPOLL
+  pthread_mutex_lock(&awake_messages_mutex);
+  if (awake_messages_count >= awake_messages_size &&
+      awake_messages_size < AWAKE_MESSAGES_MAX) {
+    int size = awake_messages_size ? 2 * awake_messages_size : 64;
+    void** a = (void**)malloc(size * sizeof(void*));
+    if (a) {
+      for (int i = 0; i < awake_messages_count; i++)
+        a[i] = awake_messages[(awake_messages_head + i) % awake_messages_size];
+      free(awake_messages);
+      awake_messages = a;
+      awake_messages_size = size;
+      awake_messages_head = 0;
+    }
+  }
+  if (awake_messages_count < awake_messages_size) {
+    awake_messages[(awake_messages_head + awake_messages_count) % awake_messages_size] = msg;
+    awake_messages_count++;
+  }
+  pthread_mutex_unlock(&awake_messages_mutex);
+  wake_up_main_thread();
+#  else
   if (write(thread_filedes[1], &msg, sizeof(void*))==0) { /* ignore */ }
+#  endif
 }
 
-static void* thread_message_;
 void* Fl_Posix_System_Driver::thread_message() {
   void* r = thread_message_;
   thread_message_ = 0;
@@ -330,13 +374,32 @@ void* Fl_Posix_System_Driver::thread_message() {
 }
 
 static void thread_awake_cb(int fd, void*) {
+#  if USE_EPOLL
+  unsigned long long count;
+  if (read(fd, &count, sizeof(count))==0) {
+    /* This should never happen */
+  }
+  pthread_mutex_lock(&awake_messages_mutex);
+  int more = 0;
+  if (awake_messages_count) {
+    thread_message_ = awake_messages[awake_messages_head];
+    awake_messages_head = (awake_messages_head + 1) % awake_messages_size;
+    more = --awake_messages_count;
+  }
+  pthread_mutex_unlock(&awake_messages_mutex);
+  // the counter was reset by read(), come back for the next message:
+  if (more) wake_up_main_thread();
+#  else
   if (read(fd, &thread_message_, sizeof(void*))==0) { 
     /* This should never happen */
   }
+#  endif
   Fl_Awake_Handler func;
   void *data;
   while (Fl::get_awake_handler_(func, data)==0) {
+    double t = Fl_Event_Stats::start();
     (*func)(data);
+    if (t >= 0) Fl_Event_Stats::record(Fl_Event_Stats::AWAKE, t, (void*)func, data);
   }
 }
 
@@ -348,6 +411,10 @@ int Fl_Posix_System_Driver::lock() {
   if (!thread_filedes[1]) {
     // Initialize thread communication pipe to let threads awake FLTK
     // from Fl::wait()
+#  if USE_EPOLL
+    thread_filedes[0] = thread_filedes[1] =
+      eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+#  else
     if (pipe(thread_filedes)==-1) {
       /* this should not happen */
     }
@@ -356,6 +423,7 @@ int Fl_Posix_System_Driver::lock() {
     // conditions (STR #1537)
     fcntl(thread_filedes[1], F_SETFL,
           fcntl(thread_filedes[1], F_GETFL) | O_NONBLOCK);
+#  endif
 
     // Monitor the read side of the pipe so that messages sent via
     // Fl::awake() from a thread will "wake up" the main thread in
@@ -64,6 +64,7 @@ void fl_cleanup_dc_list(void);
 #include <FL/fl_draw.H>
 #include <FL/Enumerations.H>
 #include <FL/Fl_Tooltip.H>
+#include <FL/Fl_Event_Stats.H>
 #include <FL/Fl_Paged_Device.H>
 #include <FL/Fl_Shared_Image.H>
 #include <FL/Fl_Image_Surface.H>
@@ -378,7 +379,9 @@ static void process_awake_handler_requests(void) {
   Fl_Awake_Handler func;
   void *data;
   while (Fl::get_awake_handler_(func, data) == 0) {
+    double t = Fl_Event_Stats::start();
     func(data);
+    if (t >= 0) Fl_Event_Stats::record(Fl_Event_Stats::AWAKE, t, (void*)func, data);
   }
 }
 
@@ -420,8 +423,13 @@ double Fl_WinAPI_Screen_Driver::wait(double time_to_wait) {
 	  revents |= FL_WRITE;
 	if (fl_wsk_fd_is_set(f, &fdt[2]))
 	  revents |= FL_EXCEPT;
-	if (fd[i].events & revents)
-	  fd[i].cb(f, fd[i].arg);
+	if (fd[i].events & revents) {
+	  void (*cb)(FL_SOCKET, void *) = fd[i].cb;
+	  void *arg = fd[i].arg;
+	  double t = Fl_Event_Stats::start();
+	  cb(f, arg);
+	  if (t >= 0) Fl_Event_Stats::record(Fl_Event_Stats::FD, t, (void*)cb, arg);
+	}
       }
       time_to_wait = 0.0; // just peek for any messages
     } else {
@@ -443,7 +451,9 @@ double Fl_WinAPI_Screen_Driver::wait(double time_to_wait) {
 
   time_to_wait = (time_to_wait > 10000 ? 10000 : time_to_wait);
   int t_msec = (int)(time_to_wait * 1000.0 + 0.5);
+  double tw = t_msec ? Fl_Event_Stats::start() : -1.0;
   MsgWaitForMultipleObjects(0, NULL, FALSE, t_msec, QS_ALLINPUT);
+  if (tw >= 0) Fl_Event_Stats::record(Fl_Event_Stats::WAIT, tw);
 
   fl_lock_function();
 
@@ -464,7 +474,15 @@ double Fl_WinAPI_Screen_Driver::wait(double time_to_wait) {
     }
 
     TranslateMessage(&fl_msg);
+    double t = Fl_Event_Stats::start();
+    if (t < 0) {
+      DispatchMessageW(&fl_msg);
+      continue;
+    }
+    Fl_Widget_Tracker wp(fl_find(fl_msg.hwnd));
+    UINT message = fl_msg.message;
     DispatchMessageW(&fl_msg);
+    Fl_Event_Stats::record(Fl_Event_Stats::EVENT, t, 0, (void*)(fl_intptr_t)message, wp.widget());
   }
 
   // The following conditional test:
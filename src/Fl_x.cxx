@@ -29,6 +29,7 @@
 #  include <FL/Fl_Window.H>
 #  include <FL/fl_utf8.h>
 #  include <FL/Fl_Tooltip.H>
+#  include <FL/Fl_Event_Stats.H>
 #  include <FL/fl_draw.H>
 #  include <FL/Fl_Paged_Device.H>
 #  include <FL/Fl_Shared_Image.H>
@@ -80,6 +81,152 @@ extern Fl_Widget *fl_selection_requestor;
 ////////////////////////////////////////////////////////////////
 // interface to poll/select call:
 
+#  if USE_EPOLL
+
+// With epoll() the file descriptors are registered with the kernel once,
+// and Fl::wait() only looks at the ones that are ready. As with select(),
+// a descriptor may have one handler for each condition. Descriptors that
+// epoll() does not support, like regular files, are always ready, which
+// is also what select() and poll() report for them.
+
+#    include <poll.h>
+#    include <errno.h>
+#    include <sys/epoll.h>
+#    include <sys/timerfd.h>
+
+#    define FD_CONDITIONS (POLLIN|POLLOUT|POLLERR)
+
+struct FD_Handler {
+  int events;
+  void (*cb)(int, void*);
+  void* arg;
+};
+
+struct FD {
+  FD_Handler handler[3];	// at most one handler per condition
+  unsigned registered;		// epoll events given to the kernel
+  char always_ready;		// not supported by epoll, see above
+};
+
+static FD *fd = 0;		// indexed by file descriptor
+static int fd_array_size = 0;
+static int nfds = 0;		// descriptors with handlers
+static int *ready_fds = 0;	// descriptors that are always ready
+static int nready_fds = 0;
+static int ready_fds_size = 0;
+static int epoll_fd = -1;
+static int timer_fd = -1;	// wakes epoll_wait() for the next timeout
+static char timer_armed = 0;
+
+static int epoll_init() {
+  if (epoll_fd >= 0) return 1;
+  epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+  if (epoll_fd < 0) return 0;
+  timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+  if (timer_fd >= 0) {
+    epoll_event ev;
+    ev.events = EPOLLIN;
+    ev.data.fd = timer_fd;
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, timer_fd, &ev) < 0) {
+      close(timer_fd);
+      timer_fd = -1;
+    }
+  }
+  return 1;
+}
+
+// tell the kernel about the conditions of a descriptor after they changed:
+static void fd_update(int n) {
+  FD &f = fd[n];
+  int events = 0;
+  for (int i = 0; i < 3; i++) events |= f.handler[i].events;
+  unsigned e = 0;
+  if (events & POLLIN) e |= EPOLLIN;
+  if (events & POLLOUT) e |= EPOLLOUT;
+  if (events & POLLERR) e |= EPOLLPRI;
+  if (e && (events & FL_EDGE)) e |= EPOLLET;
+
+  if (f.always_ready) {
+    if (e) return;
+    for (int i = 0; i < nready_fds; i++)
+      if (ready_fds[i] == n) {ready_fds[i] = ready_fds[--nready_fds]; break;}
+    f.always_ready = 0;
+    return;
+  }
+  if (e == f.registered) return;
+
+  epoll_event ev;
+  ev.events = e;
+  ev.data.fd = n;
+  if (!e) {
+    // fails if the descriptor was closed already, which is fine
+    epoll_ctl(epoll_fd, EPOLL_CTL_DEL, n, &ev);
+    f.registered = 0;
+    return;
+  }
+  int r = epoll_ctl(epoll_fd, f.registered ? EPOLL_CTL_MOD : EPOLL_CTL_ADD, n, &ev);
+  // the descriptor may have been closed and opened again since it was added:
+  if (r < 0 && errno == ENOENT) r = epoll_ctl(epoll_fd, EPOLL_CTL_ADD, n, &ev);
+  else if (r < 0 && errno == EEXIST) r = epoll_ctl(epoll_fd, EPOLL_CTL_MOD, n, &ev);
+  if (r < 0) {
+    f.registered = 0;
+    if (errno != EPERM) return;
+    if (nready_fds >= ready_fds_size) {
+      ready_fds_size = 2*ready_fds_size+8;
+      ready_fds = (int*)realloc(ready_fds, ready_fds_size*sizeof(int));
+    }
+    ready_fds[nready_fds++] = n;
+    f.always_ready = 1;
+    return;
+  }
+  f.registered = e;
+}
+
+void Fl_X11_System_Driver::add_fd(int n, int events, void (*cb)(int, void*), void *v) {
+  remove_fd(n,events);
+  if (n < 0 || !(events & FD_CONDITIONS) || !epoll_init()) return;
+  if (n >= fd_array_size) {
+    int size = 2*fd_array_size+1;
+    if (size <= n) size = n+1;
+    FD *temp = (FD*)realloc(fd, size*sizeof(FD));
+    if (!temp) return;
+    memset(temp + fd_array_size, 0, (size - fd_array_size)*sizeof(FD));
+    fd = temp;
+    fd_array_size = size;
+  }
+  FD &f = fd[n];
+  int i, used = 0;
+  for (i = 0; i < 3; i++) if (f.handler[i].events) used = 1;
+  for (i = 0; f.handler[i].events; i++) {/*empty*/}
+  f.handler[i].events = events;
+  f.handler[i].cb = cb;
+  f.handler[i].arg = v;
+  if (!used) nfds++;
+  fd_update(n);
+}
+
+void Fl_X11_System_Driver::add_fd(int n, void (*cb)(int, void*), void* v) {
+  add_fd(n, POLLIN, cb, v);
+}
+
+void Fl_X11_System_Driver::remove_fd(int n, int events) {
+  if (n < 0 || n >= fd_array_size) return;
+  FD &f = fd[n];
+  int used = 0, left = 0;
+  for (int i = 0; i < 3; i++) {
+    FD_Handler &h = f.handler[i];
+    if (!h.events) continue;
+    used = 1;
+    h.events &= ~events;
+    if (!(h.events & FD_CONDITIONS)) h.events = 0; // no events left, delete this handler
+    else left = 1;
+  }
+  if (used && !left) nfds--;
+  fd_update(n);
+}
+
+#  else
+
 #  if USE_POLL
 
 #    include <poll.h>
@@ -193,6 +340,8 @@ void Fl_X11_System_Driver::remove_fd(int n, int events) {
 #  endif
 }
 
+#  endif /* USE_EPOLL */
+
 void Fl_X11_System_Driver::remove_fd(int n) {
   remove_fd(n, -1);
 }
@@ -211,7 +360,14 @@ static void do_queued_events() {
     XNextEvent(fl_display, &xevent);
     if (fl_send_system_handlers(&xevent))
       continue;
+    double t = Fl_Event_Stats::start();
+    if (t < 0) {
+      fl_handle(xevent);
+      continue;
+    }
+    Fl_Widget_Tracker wp(fl_find(xevent.xany.window));
     fl_handle(xevent);
+    Fl_Event_Stats::record(Fl_Event_Stats::EVENT, t, 0, (void*)(fl_intptr_t)xevent.type, wp.widget());
   }
   // we send FL_LEAVE only if the mouse did not enter some other window:
   if (!in_a_window) Fl::handle(FL_LEAVE, 0);
@@ -228,6 +384,106 @@ static void nothing() {}
 void (*fl_lock_function)() = nothing;
 void (*fl_unlock_function)() = nothing;
 
+#  if USE_EPOLL
+
+// call the handlers of a descriptor for the conditions that are met:
+static void fd_dispatch(int n, int revents) {
+  for (int i = 0; i < 3; i++) {
+    // the handlers may change the table
+    if (n >= fd_array_size) return;
+    FD_Handler h = fd[n].handler[i];
+    if (!(h.events & revents)) continue;
+    double t = Fl_Event_Stats::start();
+    h.cb(n, h.arg);
+    if (t >= 0) Fl_Event_Stats::record(Fl_Event_Stats::FD, t, (void*)h.cb, h.arg);
+  }
+}
+
+// This is never called with time_to_wait < 0.0:
+// It should return negative on error, 0 if nothing happens before
+// timeout, and >0 if any callbacks were done.
+int Fl_X11_Screen_Driver::poll_or_select_with_delay(double time_to_wait) {
+
+  // OpenGL and other broken libraries call XEventsQueued
+  // unnecessarily and thus cause the file descriptor to not be ready,
+  // so we must check for already-read events:
+  if (fl_display && XQLength(fl_display)) {do_queued_events(); return 1;}
+
+  if (!epoll_init()) return -1;
+
+  int timeout = -1;
+  if (nready_fds || time_to_wait <= 0.0) {
+    timeout = 0;
+  } else if (time_to_wait < 2147483.648) {
+    if (timer_fd >= 0) {
+      itimerspec t;
+      t.it_interval.tv_sec = t.it_interval.tv_nsec = 0;
+      t.it_value.tv_sec = time_t(time_to_wait);
+      t.it_value.tv_nsec = long(1e9 * (time_to_wait - t.it_value.tv_sec));
+      if (!t.it_value.tv_sec && !t.it_value.tv_nsec) t.it_value.tv_nsec = 1;
+      timerfd_settime(timer_fd, 0, &t, 0);
+      timer_armed = 1;
+    } else {
+      timeout = int(time_to_wait*1000 + .5);
+    }
+  } else if (timer_armed) {
+    itimerspec t;
+    memset(&t, 0, sizeof(t));
+    timerfd_settime(timer_fd, 0, &t, 0);
+    timer_armed = 0;
+  }
+
+  epoll_event ev[64];
+
+  fl_unlock_function();
+
+  double tw = timeout ? Fl_Event_Stats::start() : -1.0;
+  int n = epoll_wait(epoll_fd, ev, 64, timeout);
+  if (tw >= 0) Fl_Event_Stats::record(Fl_Event_Stats::WAIT, tw);
+
+  fl_lock_function();
+
+  if (n < 0) return n;
+  int ret = n;
+  for (int i = 0; i < n; i++) {
+    int f = ev[i].data.fd;
+    if (f == timer_fd) {
+      unsigned long long expirations;
+      if (read(timer_fd, &expirations, sizeof(expirations)) < 0) { /* ignore */ }
+      timer_armed = 0;
+      ret--;
+      continue;
+    }
+    unsigned e = ev[i].events;
+    int revents = 0;
+    if (e & EPOLLIN) revents |= POLLIN;
+    if (e & EPOLLOUT) revents |= POLLOUT;
+    if (e & EPOLLPRI) revents |= POLLERR;
+    if (e & (EPOLLERR | EPOLLHUP)) revents |= FD_CONDITIONS; // like poll()
+    fd_dispatch(f, revents);
+  }
+  for (int i = 0; i < nready_fds; i++) {
+    fd_dispatch(ready_fds[i], POLLIN | POLLOUT);
+    ret++;
+  }
+  return ret;
+}
+
+// just like Fl_X11_Screen_Driver::poll_or_select_with_delay(0.0) except no callbacks are done:
+int Fl_X11_Screen_Driver::poll_or_select() {
+  if (XQLength(fl_display)) return 1;
+  if (!nfds) return 0; // nothing to select or poll
+  if (nready_fds) return nready_fds;
+  // the epoll descriptor is readable if any descriptor is ready, asking it
+  // this way does not use up edge triggered events:
+  pollfd p;
+  p.fd = epoll_fd;
+  p.events = POLLIN;
+  return ::poll(&p, 1, 0);
+}
+
+#  else
+
 // This is never called with time_to_wait < 0.0:
 // It should return negative on error, 0 if nothing happens before
 // timeout, and >0 if any callbacks were done.
@@ -248,6 +504,7 @@ int Fl_X11_Screen_Driver::poll_or_select_with_delay(double time_to_wait) {
 
   fl_unlock_function();
 
+  double tw = time_to_wait > 0.0 ? Fl_Event_Stats::start() : -1.0;
   if (time_to_wait < 2147483.648) {
 #  if USE_POLL
     n = ::poll(pollfds, nfds, int(time_to_wait*1000 + .5));
@@ -264,21 +521,28 @@ int Fl_X11_Screen_Driver::poll_or_select_with_delay(double time_to_wait) {
     n = ::select(maxfd+1,&fdt[0],&fdt[1],&fdt[2],0);
 #  endif
   }
+  if (tw >= 0) Fl_Event_Stats::record(Fl_Event_Stats::WAIT, tw);
 
   fl_lock_function();
 
   if (n > 0) {
     for (int i=0; i<nfds; i++) {
 #  if USE_POLL
-      if (pollfds[i].revents) fd[i].cb(pollfds[i].fd, fd[i].arg);
+      if (!pollfds[i].revents) continue;
+      int f = pollfds[i].fd;
 #  else
       int f = fd[i].fd;
       short revents = 0;
       if (FD_ISSET(f,&fdt[0])) revents |= POLLIN;
       if (FD_ISSET(f,&fdt[1])) revents |= POLLOUT;
       if (FD_ISSET(f,&fdt[2])) revents |= POLLERR;
-      if (fd[i].events & revents) fd[i].cb(f, fd[i].arg);
+      if (!(fd[i].events & revents)) continue;
 #  endif
+      void (*cb)(int, void*) = fd[i].cb;
+      void *arg = fd[i].arg;
+      double t = Fl_Event_Stats::start();
+      cb(f, arg);
+      if (t >= 0) Fl_Event_Stats::record(Fl_Event_Stats::FD, t, (void*)cb, arg);
     }
   }
   return n;
@@ -302,6 +566,8 @@ int Fl_X11_Screen_Driver::poll_or_select() {
 #  endif
 }
 
+#  endif /* USE_EPOLL */
+
 // replace \r\n by \n
 static void convert_crlf(unsigned char *string, long& len) {
   unsigned char *a, *b;
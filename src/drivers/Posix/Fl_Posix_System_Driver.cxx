@@ -34,6 +34,9 @@
 #include <pwd.h>
 #include <unistd.h>
 #include <time.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <errno.h>
 
 //
 // Define missing POSIX/XPG4 macros as needed...
@@ -85,6 +88,140 @@ int Fl_Posix_System_Driver::file_type(const char *filename)
   return filetype;
 }
 
+// Internal: file type for fl_filename_list() from the mode returned by stat()
+static int filename_type(mode_t mode) {
+  if (S_ISDIR(mode)) return FL_FILENAME_DIRECTORY;
+#  ifdef S_ISFIFO
+  if (S_ISFIFO(mode)) return FL_FILENAME_FIFO;
+#  endif // S_ISFIFO
+#  if defined(S_ISCHR) && defined(S_ISBLK)
+  if (S_ISCHR(mode) || S_ISBLK(mode)) return FL_FILENAME_DEVICE;
+#  endif // S_ISCHR && S_ISBLK
+  return FL_FILENAME_PLAIN;
+}
+
+/*
+ Lists a directory in one pass with readdir(). The file type comes from
+ dirent.d_type where the system provides it; only symbolic links, entries
+ of unknown type, and all entries with FL_FILENAME_STAT need a stat() call,
+ which is made relative to the open directory if possible.
+*/
+int Fl_Posix_System_Driver::filename_entries(const char *d, int flags,
+                                             int (*add)(void *data, const char *name, int type, double size, long mtime),
+                                             void *data) {
+  // Assume that locale encoding is no less dense than UTF-8
+  int dirlen = (int) strlen(d);
+  char *dirloc = (char *)malloc(dirlen + 1);
+  utf8to_mb(d, dirlen, dirloc, dirlen + 1);
+  DIR *dir = opendir(dirloc);
+  if (!dir) {
+    free(dirloc);
+    return -1;
+  }
+#ifdef AT_FDCWD
+  int dfd = dirfd(dir);
+  char *fullname = 0;
+#else
+  char *fullname = (char *)malloc(dirlen + FL_PATH_MAX + 2);
+  memcpy(fullname, dirloc, dirlen);
+  char *name = fullname + dirlen;
+  if (name != fullname && name[-1] != '/') *name++ = '/';
+#endif
+  int utf8 = utf8locale();
+  char *utf8name = 0;
+  unsigned utf8size = 0;
+  int n = 0;
+  struct dirent *de;
+  while ((de = readdir(dir)) != NULL) {
+    int type = 0;
+    double size = -1;
+    long mtime = 0;
+#ifdef DT_DIR
+    switch (de->d_type) {
+      case DT_DIR :  type = FL_FILENAME_DIRECTORY; break;
+      case DT_REG :  type = FL_FILENAME_PLAIN; break;
+      case DT_FIFO : type = FL_FILENAME_FIFO; break;
+      case DT_CHR :
+      case DT_BLK :  type = FL_FILENAME_DEVICE; break;
+      case DT_SOCK : type = FL_FILENAME_PLAIN; break;
+      default : break; // DT_LNK, DT_UNKNOWN: need stat()
+    }
+#endif // DT_DIR
+    if (!type || (flags & FL_FILENAME_STAT)) {
+      struct stat s;
+#ifdef AT_FDCWD
+      int ret = fstatat(dfd, de->d_name, &s, 0);
+#else
+      strlcpy(name, de->d_name, FL_PATH_MAX);
+      int ret = ::stat(fullname, &s);
+#endif
+      if (ret == 0) {
+        type = filename_type(s.st_mode);
+        if (flags & FL_FILENAME_STAT) {
+          size  = (double)s.st_size;
+          mtime = (long)s.st_mtime;
+        }
+      } else if (!type) {
+        type = FL_FILENAME_PLAIN; // e.g. a dangling link
+      }
+    }
+    int stop;
+    if (utf8) {
+      stop = add(data, de->d_name, type, size, mtime);
+    } else {
+      unsigned len = (unsigned) strlen(de->d_name);
+      unsigned newlen = utf8from_mb(NULL, 0, de->d_name, len);
+      if (newlen + 1 > utf8size) {
+        utf8size = newlen + 1;
+        utf8name = (char *)realloc(utf8name, utf8size);
+      }
+      utf8from_mb(utf8name, newlen + 1, de->d_name, len);
+      stop = add(data, utf8name, type, size, mtime);
+    }
+    if (stop) {
+      n = -1;
+      break;
+    }
+    n++;
+  }
+  closedir(dir);
+  free(utf8name);
+  free(fullname);
+  free(dirloc);
+  return n;
+}
+
+// the temporary file is synced before the rename, so that a crash leaves
+// either the old or the new file on disk
+int Fl_Posix_System_Driver::replace_file(const char *filename, const char *data, size_t size) {
+  size_t len = strlen(filename);
+  char *tmp = (char*)malloc(len + 32);
+  snprintf(tmp, len + 32, "%s.%ld.tmp", filename, (long)getpid());
+  int fd = ::open(tmp, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+  if (fd < 0) {
+    free(tmp);
+    return -1;
+  }
+  int ok = 1;
+  while (ok && size > 0) {
+    ssize_t n = ::write(fd, data, size);
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) ok = 0;
+    else { data += n; size -= n; }
+  }
+  struct stat st;
+  if (ok && ::stat(filename, &st) == 0) fchmod(fd, st.st_mode & 07777);
+  if (ok && fsync(fd) != 0) ok = 0;
+  if (::close(fd) != 0) ok = 0;
+  if (ok && ::rename(tmp, filename) == 0) {
+    free(tmp);
+    return 0;
+  }
+  ::unlink(tmp);
+  free(tmp);
+  return -1;
+}
+
 const char *Fl_Posix_System_Driver::getpwnam(const char *login) {
   struct passwd *pwd;
   pwd = ::getpwnam(login);
@@ -99,6 +236,15 @@ void Fl_Posix_System_Driver::gettime(time_t *sec, int *usec) {
   *usec = tv.tv_usec;
 }
 
+double Fl_Posix_System_Driver::monotonic_clock() {
+#if defined(CLOCK_MONOTONIC)
+  struct timespec ts;
+  if (clock_gettime(CLOCK_MONOTONIC, &ts) == 0)
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+#endif
+  return Fl_System_Driver::monotonic_clock();
+}
+
 //
 // End of "$Id$".
 //
@@ -29,6 +29,55 @@
 
 const char *Fl_PostScript_File_Device::file_chooser_title = "Select a .ps file";
 
+static int compression_level = 6;
+static Fl_PostScript_Deflate deflate_fn = NULL;
+
+/**
+ \brief Sets the compression of image data in PostScript output.
+ 
+ With a \p level between 1 (fastest) and 9 (smallest output), images, bitmaps, and text drawn
+ as bitmaps are compressed with the /FlateDecode filter. Identical small images, like repeated
+ icons, are then written only once per document and reused. With \p level 0 the
+ /RunLengthDecode filter is used as in earlier versions of FLTK.
+ 
+ Flate compression needs a compression function, see deflate_function(), which is set by
+ fl_register_images(). The output is then a LanguageLevel 3 PostScript document.
+ The default level is 6. The level in effect when a print job starts is used for the whole job.
+ \since FLTK 1.4.0
+ */
+void Fl_PostScript_File_Device::compression(int level)
+{
+  compression_level = level < 0 ? 0 : (level > 9 ? 9 : level);
+}
+
+/** Returns the compression level of image data in PostScript output.
+ \see compression(int)
+ */
+int Fl_PostScript_File_Device::compression()
+{
+  return compression_level;
+}
+
+/**
+ \brief Sets the function used to compress image data in PostScript output.
+ 
+ The core FLTK library does not use zlib, therefore the fltk_images library sets this function
+ when fl_register_images() is called. Use NULL to always use RunLength encoding.
+ \since FLTK 1.4.0
+ */
+void Fl_PostScript_File_Device::deflate_function(Fl_PostScript_Deflate f)
+{
+  deflate_fn = f;
+}
+
+/** Returns the function used to compress image data in PostScript output, or NULL.
+ \see deflate_function(Fl_PostScript_Deflate)
+ */
+Fl_PostScript_Deflate Fl_PostScript_File_Device::deflate_function()
+{
+  return deflate_fn;
+}
+
 /**
  @brief The constructor.
  */
@@ -38,6 +87,12 @@ Fl_PostScript_Graphics_Driver::Fl_PostScript_Graphics_Driver(void)
   //lang_level_ = 3;
   lang_level_ = 2;
   mask = 0;
+  flate_level_ = 0;
+  image_resources_ = NULL;
+  image_resource_count_ = image_resource_alloc_ = 0;
+  image_resource_bytes_ = image_resource_ids_ = 0;
+  image_pending_ = NULL;
+  image_pending_length_ = 0;
   ps_filename_ = NULL;
   scale_x = scale_y = 1.;
   bg_r = bg_g = bg_b = 255;
@@ -46,6 +101,7 @@ Fl_PostScript_Graphics_Driver::Fl_PostScript_Graphics_Driver(void)
 /** \brief The destructor. */
 Fl_PostScript_Graphics_Driver::~Fl_PostScript_Graphics_Driver() {
   if(ps_filename_) free(ps_filename_);
+  free_image_resources_();
 }
 
 Fl_PostScript_File_Device::Fl_PostScript_File_Device(void)
@@ -183,15 +239,13 @@ static const char * prolog =
 "/GL { setgray } bind def\n"
 "/SRGB { setrgbcolor } bind def\n"
 
-"/A85RLE { /ASCII85Decode filter /RunLengthDecode filter } bind def\n" // ASCII85Decode followed by RunLengthDecode filters
-
 //  color images 
 
 "/CI { GS /py exch def /px exch def /sy exch def /sx exch def\n"
 "translate \n"
 "sx sy scale px py 8 \n"
 "[ px 0 0 py neg 0 py ]\n"
-"currentfile A85RLE\n false 3"
+"IDS\n false 3"
 " colorimage GR\n"
 "} bind def\n"
 
@@ -203,7 +257,7 @@ static const char * prolog =
 
 
 "[ px 0 0 py neg 0 py ]\n"
-"currentfile A85RLE\n"
+"IDS\n"
 "image GR\n"
 "} bind def\n"
 
@@ -213,7 +267,7 @@ static const char * prolog =
 "translate \n"
 "sx sy scale px py true \n"
 "[ px 0 0 py neg 0 py ]\n"
-"currentfile A85RLE\n"
+"IDS\n"
 "imagemask GR\n"
 "} bind def\n"
 
@@ -264,7 +318,7 @@ static const char * prolog_2 =  // prolog relevant only if lang_level >1
 "/Height py def\n"
 "/BitsPerComponent 8 def\n"
 "/Interpolate inter def\n"
-"/DataSource currentfile A85RLE def\n"
+"/DataSource IDS def\n"
 "/MultipleDataSources false def\n"
 "/ImageMatrix [ px 0 0 py neg 0 py ] def\n"
 "/Decode [ 0 1 0 1 0 1 ] def\n"
@@ -284,7 +338,7 @@ static const char * prolog_2 =  // prolog relevant only if lang_level >1
 "/BitsPerComponent 8 def\n"
 
 "/Interpolate inter def\n"
-"/DataSource currentfile A85RLE def\n"
+"/DataSource IDS def\n"
 "/MultipleDataSources false def\n"
 "/ImageMatrix [ px 0 0 py neg 0 py ] def\n"
 "/Decode [ 0 1 ] def\n"
@@ -389,7 +443,7 @@ static const char * prolog_2_pixmap =  // prolog relevant only if lang_level ==
 "pixmap_w pixmap_h scale "
 "pixmap_sx pixmap_sy 8 "
 "pixmap_mat "
-"currentfile A85RLE "
+"IDS "
 "false 3 "
 "colorimage "
 "end "
@@ -407,7 +461,7 @@ static const char * prolog_2_pixmap =  // prolog relevant only if lang_level ==
 "pixmap_sx pixmap_sy\n"
 "true\n"
 "pixmap_mat\n"
-"currentfile A85RLE\n"
+"IDS\n"
 "imagemask\n"
 "GR\n"
 "} bind def\n"
@@ -429,7 +483,7 @@ static const char * prolog_3 = // prolog relevant only if lang_level >2
 "/Height py def\n"
 "/BitsPerComponent 8 def\n"
 "/Interpolate inter def\n"
-"/DataSource currentfile A85RLE def\n"
+"/DataSource IDS def\n"
 "/MultipleDataSources false def\n"
 "/ImageMatrix [ px 0 0 py neg 0 py ] def\n"
 
@@ -470,7 +524,7 @@ static const char * prolog_3 = // prolog relevant only if lang_level >2
 "/Height py def\n"
 "/BitsPerComponent 8 def\n"
 "/Interpolate inter def\n"
-"/DataSource currentfile A85RLE def\n"
+"/DataSource IDS def\n"
 "/MultipleDataSources false def\n"
 "/ImageMatrix [ px 0 0 py neg 0 py ] def\n"
 
@@ -500,6 +554,23 @@ static const char * prolog_3 = // prolog relevant only if lang_level >2
 "\n"
 ;
 
+static const char * prolog_flate = // prolog relevant only with compressed image data
+// ASCII85Decode followed by FlateDecode filters
+"/A85D { /ASCII85Decode filter /FlateDecode filter } bind def\n"
+
+// reads a file until EOD into an array of strings in global VM that survives the
+// save and restore around each image; the page undefines it when it ends
+// usage: dict key file FLR
+"/FLR { currentglobal exch true setglobal\n"
+"[ exch { dup 4096 string readstring { exch } { exch pop exit } ifelse } loop ]\n"
+"exch 4 1 roll put setglobal } bind def\n"
+
+// turns an array of strings read by FLR into a data source procedure
+// usage: array FLS /FlateDecode filter
+"/FLS { userdict begin /FLa exch def /FLi 0 def end\n"
+"{ FLi FLa length lt { FLa FLi get userdict /FLi FLi 1 add put } { () } ifelse } } bind def\n"
+;
+
 // end prolog 
 
 int Fl_PostScript_Graphics_Driver::start_postscript (int pagecount, 
@@ -524,9 +595,13 @@ int Fl_PostScript_Graphics_Driver::start_postscript (int pagecount,
     ph_ = Fl_Paged_Device::page_formats[format].height;
   }
   
+  flate_level_ = Fl_PostScript_File_Device::deflate_function() ? Fl_PostScript_File_Device::compression() : 0;
+  free_image_resources_();
   fputs("%!PS-Adobe-3.0\n", output);
   fputs("%%Creator: FLTK\n", output);
-  if (lang_level_>1)
+  if (flate_level_ && lang_level_ < 3) // the FlateDecode filter needs level 3
+    fputs("%%LanguageLevel: 3\n", output);
+  else if (lang_level_>1)
     fprintf(output, "%%%%LanguageLevel: %i\n" , lang_level_);
   if ((pages_ = pagecount))
     fprintf(output, "%%%%Pages: %i\n", pagecount);
@@ -540,6 +615,12 @@ int Fl_PostScript_Graphics_Driver::start_postscript (int pagecount,
   fputs("%%EndFeature\n", output);
   fputs("%%EndComments\n", output);
   fputs(prolog, output);
+  if (flate_level_) {
+    fputs(prolog_flate, output);
+  } else {
+    fputs("/A85D { /ASCII85Decode filter /RunLengthDecode filter } bind def\n", output);
+  }
+  fputs("/IDS { currentfile A85D } def\n", output); // source of image data
   if (lang_level_ > 1) {
     fputs(prolog_2, output);
     }
@@ -604,6 +685,7 @@ void Fl_PostScript_Graphics_Driver::page_policy(int p){
 void Fl_PostScript_Graphics_Driver::page(double pw, double ph, int media) {
   
   if (nPages){
+    end_image_resources_();
     fprintf(output, "CR\nGR\nGR\nGR\nSP\nrestore\n");
   }
   ++nPages;
@@ -996,6 +1078,23 @@ static uchar *calc_mask(uchar *img, int w, int h, Fl_Color bg)
   return mask;
 }
 
+struct text_mask_args {
+  const uchar *mask;
+  int wmask, h;
+};
+
+// writes the rows of the mask computed by calc_mask() from bottom to top
+static void text_mask_writer(Fl_PostScript_Graphics_Driver *d, void *stream, void *args) {
+  text_mask_args *a = (text_mask_args *)args;
+  for (int j = a->h - 1; j >= 0; j--){
+    const uchar *di = a->mask + j * a->wmask;
+    for (int i = 0; i < a->wmask; i++){
+      d->write_data85(*di, stream);
+      di++;
+    }
+  }
+}
+
 // write to PostScript a bitmap image of a UTF8 string
 void Fl_PostScript_Graphics_Driver::transformed_draw_extra(const char* str, int n, double x, double y, int w, bool rtl)
 {
@@ -1034,18 +1133,11 @@ void Fl_PostScript_Graphics_Driver::transformed_draw_extra(const char* str, int
   delete[] img;
   // write the string image to PostScript as a scaled bitmask
   scale = w2 / float(w);
+  text_mask_args args = { mask, (w2+7)/8, h };
+  int shared = begin_image_data(text_mask_writer, &args, args.wmask * h);
   clocale_printf("%g %g %g %g %d %d MI\n", x, y - h*0.77/scale, w2/scale, h/scale, w2, h);
-  uchar *di;
-  int wmask = (w2+7)/8;
-  void *rle85 = prepare_rle85();
-  for (int j = h - 1; j >= 0; j--){
-    di = mask + j * wmask;
-    for (int i = 0; i < wmask; i++){
-      write_rle85(*di, rle85);
-      di++;
-    }
-  }
-  close_rle85(rle85); fputc('\n', output);
+  end_image_data(shared, text_mask_writer, &args);
+  fputc('\n', output);
   delete[] mask;
 }
 
@@ -1450,6 +1542,7 @@ void Fl_PostScript_File_Device::end_job (void)
 // finishes PostScript & closes file
 {
   Fl_PostScript_Graphics_Driver *ps = driver();
+  ps->end_image_resources_();
   if (ps->nPages) {  // for eps nPages is 0 so it is fine ....
     fprintf(ps->output, "CR\nGR\nGR\nGR\nSP\n restore\n");
     if (!ps->pages_){
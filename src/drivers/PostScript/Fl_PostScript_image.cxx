@@ -191,6 +191,204 @@ void Fl_PostScript_Graphics_Driver::close_rle85(void *data) // stop doing RLE+AS
 // End of implementation of the /RunLengthEncode + /ASCII85Encode PostScript filter
 //
 
+//
+// Implementation of image data streams: /FlateEncode (see Fl_PostScript_File_Device::compression())
+// or /RunLengthEncode, followed by /ASCII85Encode.
+// A stream can also collect its data in memory to find identical images.
+//
+
+struct struct_data85 {
+  void *rle85;       // aux data for RLE+ASCII85 encoding, or NULL
+  struct85 *data85;  // aux data for ASCII85 encoding of compressed data
+  void *flate;       // state of the deflate function
+  Fl_PostScript_Graphics_Driver *driver;
+  int capture;       // don't output anything, only collect the data in 'data'
+  uchar *data;       // collected data
+  int length, alloc; // used/allocated size of data
+  int count;         // current buffer length
+  uchar buffer[4096]; // data waiting for compression
+};
+
+// image data seen on the current page
+struct Fl_PostScript_Graphics_Driver::Image_Resource {
+  unsigned hash;     // hash value of data, to skip most comparisons
+  uchar *data;
+  int length;
+  int id;            // number of the shared resource, -1 while the image was drawn once
+};
+
+// FNV-1a hash value of image data
+static unsigned image_hash(const uchar *data, int length)
+{
+  unsigned h = 2166136261U;
+  for (int i = 0; i < length; i++) h = (h ^ data[i]) * 16777619U;
+  return h;
+}
+
+void Fl_PostScript_Graphics_Driver::free_image_resources_()
+{
+  for (int i = 0; i < image_resource_count_; i++) free(image_resources_[i].data);
+  free(image_resources_);
+  image_resources_ = NULL;
+  image_resource_count_ = image_resource_alloc_ = 0;
+  image_resource_bytes_ = image_resource_ids_ = 0;
+}
+
+// Removes the shared resources of the page that ends, so that no page uses
+// resources of another one, and their global VM can be reclaimed.
+void Fl_PostScript_Graphics_Driver::end_image_resources_()
+{
+  for (int i = 0; i < image_resource_count_; i++)
+    if (image_resources_[i].id >= 0)
+      fprintf(output, "globaldict /FLimg%d undef\n", image_resources_[i].id);
+  free_image_resources_();
+}
+
+// size limit of shared images: bigger images are rarely drawn more than once
+static const int max_shared_image_size = 64 * 1024;
+// limits of the images kept per page to find the ones that are drawn again
+static const int max_page_images = 256;
+static const int max_page_image_bytes = 4 * 1024 * 1024;
+
+void *Fl_PostScript_Graphics_Driver::prepare_data85(int capture)
+{
+  struct_data85 *d = new struct_data85;
+  d->rle85 = (flate_level_ || capture) ? NULL : prepare_rle85();
+  d->data85 = (flate_level_ && !capture) ? (struct85*)prepare85() : NULL;
+  d->flate = NULL;
+  d->driver = this;
+  d->capture = capture;
+  d->data = NULL;
+  d->length = d->alloc = 0;
+  d->count = 0;
+  return d;
+}
+
+void Fl_PostScript_Graphics_Driver::flate_output_(void *data, const uchar *p, int len)
+{
+  struct_data85 *d = (struct_data85 *)data;
+  d->driver->write85(d->data85, p, len);
+}
+
+void Fl_PostScript_Graphics_Driver::flate_data85(void *data, int finish)
+{
+  struct_data85 *d = (struct_data85 *)data;
+  Fl_PostScript_File_Device::deflate_function()(&d->flate, flate_level_, d->buffer, d->count,
+                                                finish, flate_output_, d);
+  d->count = 0;
+}
+
+void Fl_PostScript_Graphics_Driver::write_data85(uchar b, void *data) // sends one input byte to the stream
+{
+  struct_data85 *d = (struct_data85 *)data;
+  if (d->capture) {
+    if (d->length >= d->alloc) {
+      d->alloc = d->alloc ? 2 * d->alloc : 4096;
+      d->data = (uchar*)realloc(d->data, d->alloc);
+    }
+    d->data[d->length++] = b;
+  } else if (d->rle85) {
+    write_rle85(b, d->rle85);
+  } else {
+    d->buffer[d->count++] = b;
+    if (d->count >= (int)sizeof(d->buffer)) flate_data85(d, 0);
+  }
+}
+
+void Fl_PostScript_Graphics_Driver::close_data85(void *data) // stops the stream
+{
+  struct_data85 *d = (struct_data85 *)data;
+  if (d->rle85) {
+    close_rle85(d->rle85);
+  } else if (d->data85) {
+    flate_data85(d, 1);
+    close85(d->data85);
+  }
+  free(d->data);
+  delete d;
+}
+
+/*
+ Prepares the data of an image that is drawn with the IDS data source after this call.
+ The data are produced by writer(this, stream, args) with write_data85() calls, and are
+ size bytes long. Small images are kept in memory until the end of the page, and an
+ image that is drawn again on the same page is output once as a shared resource of the
+ page. Returns 1 if the image uses a shared resource, 2 if its data were collected, and
+ 0 otherwise; end_image_data() outputs the data in the last two cases.
+ The writer is called once in all cases, so a Fl_Draw_Image_Cb is called once per row.
+ */
+int Fl_PostScript_Graphics_Driver::begin_image_data(Image_Data_Writer writer, void *args, int size)
+{
+  if (!flate_level_ || size > max_shared_image_size) return 0;
+  struct_data85 *c = (struct_data85 *)prepare_data85(1);
+  writer(this, c, args);
+  unsigned hash = image_hash(c->data, c->length);
+  int i;
+  for (i = 0; i < image_resource_count_; i++) {
+    Image_Resource *r = image_resources_ + i;
+    if (r->hash == hash && r->length == c->length && !memcmp(r->data, c->data, c->length)) break;
+  }
+  if (i < image_resource_count_) { // drawn again: use a shared resource
+    Image_Resource *r = image_resources_ + i;
+    if (r->id < 0) {
+      r->id = image_resource_ids_++;
+      fprintf(output, "globaldict /FLimg%d currentfile /ASCII85Decode filter FLR\n", r->id);
+      void *data85 = prepare_data85();
+      for (int k = 0; k < r->length; k++) write_data85(r->data[k], data85);
+      close_data85(data85); fputc('\n', output);
+    }
+    close_data85(c);
+    fprintf(output, "/IDS { FLimg%d FLS /FlateDecode filter } def\n", r->id);
+    return 1;
+  }
+  // drawn for the first time: keep the data if the page limits allow it
+  if (image_resource_count_ < max_page_images &&
+      image_resource_bytes_ + c->length <= max_page_image_bytes) {
+    if (image_resource_count_ >= image_resource_alloc_) {
+      image_resource_alloc_ = image_resource_alloc_ ? 2 * image_resource_alloc_ : 16;
+      image_resources_ = (Image_Resource*)realloc(image_resources_,
+                                                  image_resource_alloc_ * sizeof(Image_Resource));
+    }
+    Image_Resource *r = image_resources_ + image_resource_count_++;
+    r->hash = hash;
+    r->data = c->data;
+    r->length = c->length;
+    r->id = -1;
+    image_resource_bytes_ += c->length;
+  }
+  image_pending_ = c->data;
+  image_pending_length_ = c->length;
+  c->data = NULL;
+  close_data85(c);
+  return 2;
+}
+
+/*
+ Outputs the image data after the image operator, or restores the IDS data source
+ if the data were shared by begin_image_data().
+ */
+void Fl_PostScript_Graphics_Driver::end_image_data(int shared, Image_Data_Writer writer, void *args)
+{
+  if (shared == 1) {
+    fputs("/IDS { currentfile A85D } def\n", output);
+    return;
+  }
+  void *data85 = prepare_data85();
+  if (shared == 2) {
+    for (int k = 0; k < image_pending_length_; k++) write_data85(image_pending_[k], data85);
+    // the data belong to the last image kept, unless the page limits were reached
+    if (!image_resource_count_ || image_resources_[image_resource_count_ - 1].data != image_pending_)
+      free(image_pending_);
+    image_pending_ = NULL;
+  } else
+    writer(this, data85, args);
+  close_data85(data85);
+}
+
+//
+// End of implementation of image data streams
+//
+
  
 int Fl_PostScript_Graphics_Driver::alpha_mask(const uchar * data, int w, int h, int D, int LD){
 
@@ -382,6 +580,50 @@ void Fl_PostScript_Graphics_Driver::draw_image(const uchar *data, int ix, int iy
   draw_image(draw_image_cb, &cb_data, ix, iy, iw, ih, D);
 }
 
+// arguments of the image data writers below
+struct image_data_args {
+  Fl_Draw_Image_Cb call;
+  void *data;
+  const uchar *pixels;
+  int iw, ih, D, LD;
+  uchar *buf;
+};
+
+// writes color image data, preceded by interleaved mask data with PostScript level 3
+static void color_image_writer(Fl_PostScript_Graphics_Driver *d, void *stream, void *args) {
+  image_data_args *a = (image_data_args *)args;
+  uchar *curmask = d->mask;
+  int i, j, k;
+  for (j=0; j<a->ih;j++) {
+    if (d->mask && d->lang_level_ > 2) {  // InterleaveType 2 mask data
+      for (k=0; k<d->my/a->ih;k++) { //for alpha pseudo-masking
+        for (i=0; i<((d->mx+7)/8);i++) {
+          d->write_data85(swap_byte(*curmask), stream);
+          curmask++;
+        }
+      }
+    }
+    a->call(a->data,0,j,a->iw,a->buf);
+    uchar *curdata=a->buf;
+    for (i=0 ; i<a->iw ; i++) {
+      uchar r = curdata[0];
+      uchar g =  curdata[1];
+      uchar b =  curdata[2];
+      
+      if (d->lang_level_<3 && a->D>3) { //can do  mixing using bg_* colors)
+        unsigned int a2 = curdata[3]; //must be int
+        unsigned int a1 = 255-a2;
+        r = (a2 * r + d->bg_r * a1)/255;
+        g = (a2 * g + d->bg_g * a1)/255;
+        b = (a2 * b + d->bg_b * a1)/255;
+      }
+      
+      d->write_data85(r, stream); d->write_data85(g, stream); d->write_data85(b, stream);
+      curdata +=a->D;
+    }
+  }
+}
+
 void Fl_PostScript_Graphics_Driver::draw_image(Fl_Draw_Image_Cb call, void *data, int ix, int iy, int iw, int ih, int D) {
   double x = ix, y = iy, w = iw, h = ih;
 
@@ -389,14 +631,19 @@ void Fl_PostScript_Graphics_Driver::draw_image(Fl_Draw_Image_Cb call, void *data
   fprintf(output,"save\n");
   int i,j,k;
   const char * interpol;
+  int LD=iw*D;
+  uchar *rgbdata=new uchar[LD];
+  image_data_args args = { call, data, NULL, iw, ih, D, LD, rgbdata };
+  int shared = 0;
+  if (lang_level_ == 2 && mask) level2_mask = 1; // use method for drawing masked color image with PostScript level 2
+  else shared = begin_image_data(color_image_writer, &args, iw * ih * 3 + (mask ? my * ((mx+7)/8) : 0));
   if (lang_level_ > 1) {
     if (interpolate_) interpol="true";
     else interpol="false";
     if (mask && lang_level_ > 2) {
       fprintf(output, "%g %g %g %g %i %i %i %i %s CIM\n", x , y+h , w , -h , iw , ih, mx, my, interpol);
     }
-    else if (mask && lang_level_ == 2) {
-      level2_mask = 1; // use method for drawing masked color image with PostScript level 2
+    else if (level2_mask) {
       fprintf(output, " %g %g %g %g %d %d pixmap_plot\n", x, y, w, h, iw, ih);
     }
     else {
@@ -406,66 +653,66 @@ void Fl_PostScript_Graphics_Driver::draw_image(Fl_Draw_Image_Cb call, void *data
     fprintf(output , "%g %g %g %g %i %i CI", x , y+h , w , -h , iw , ih);
   }
   
-  int LD=iw*D;
-  uchar *rgbdata=new uchar[LD];
-  uchar *curmask=mask;
-  void *big = prepare_rle85();
-  
   if (level2_mask) {
+    uchar *curmask=mask;
+    void *big = prepare_data85();
     for (j = ih - 1; j >= 0; j--) { // output full image data
       call(data, 0, j, iw, rgbdata);
       uchar *curdata = rgbdata;
       for (i=0 ; i<iw ; i++) {
-        write_rle85(curdata[0], big); write_rle85(curdata[1], big); write_rle85(curdata[2], big);
+        write_data85(curdata[0], big); write_data85(curdata[1], big); write_data85(curdata[2], big);
         curdata += D;
       }
     }
-    close_rle85(big); fputc('\n', output);
-    big = prepare_rle85();
+    close_data85(big); fputc('\n', output);
+    big = prepare_data85();
     for (j = ih - 1; j >= 0; j--) { // output mask data
       curmask = mask + j * (my/ih) * ((mx+7)/8);
       for (k=0; k < my/ih; k++) {
         for (i=0; i < ((mx+7)/8); i++) {
-          write_rle85(swap_byte(*curmask), big);
+          write_data85(swap_byte(*curmask), big);
           curmask++;
         }
       }
     }
+    close_data85(big);
   }
   else {
-    for (j=0; j<ih;j++) {
-      if (mask && lang_level_ > 2) {  // InterleaveType 2 mask data
-        for (k=0; k<my/ih;k++) { //for alpha pseudo-masking
-          for (i=0; i<((mx+7)/8);i++) {
-            write_rle85(swap_byte(*curmask), big);
-            curmask++;
-          }
+    end_image_data(shared, color_image_writer, &args);
+  }
+  fprintf(output,"\nrestore\n");
+  delete[] rgbdata;
+}
+
+// writes gray image data from memory, preceded by interleaved mask data
+static void mono_image_writer(Fl_PostScript_Graphics_Driver *d, void *stream, void *args) {
+  image_data_args *a = (image_data_args *)args;
+  int bg = (d->bg_r + d->bg_g + d->bg_b)/3;
+  uchar *curmask = d->mask;
+  int i, j, k;
+  for (j=0; j<a->ih;j++){
+    if (d->mask){
+      for (k=0;k<d->my/a->ih;k++){
+        for (i=0; i<((d->mx+7)/8);i++){
+          d->write_data85(swap_byte(*curmask), stream);
+          curmask++;
         }
       }
-      call(data,0,j,iw,rgbdata);
-      uchar *curdata=rgbdata;
-      for (i=0 ; i<iw ; i++) {
-        uchar r = curdata[0];
-        uchar g =  curdata[1];
-        uchar b =  curdata[2];
-        
-        if (lang_level_<3 && D>3) { //can do  mixing using bg_* colors)
-          unsigned int a2 = curdata[3]; //must be int
-          unsigned int a = 255-a2;
-          r = (a2 * r + bg_r * a)/255;
-          g = (a2 * g + bg_g * a)/255;
-          b = (a2 * b + bg_b * a)/255;
-        }
-        
-        write_rle85(r, big); write_rle85(g, big); write_rle85(b, big);
-        curdata +=D;
+    }
+    const uchar *curdata=a->pixels+j*a->LD;
+    for (i=0 ; i<a->iw ; i++) {
+      uchar r = curdata[0];
+      if (d->lang_level_<3 && a->D>1) { //can do  mixing
+
+        unsigned int a2 = curdata[1]; //must be int
+        unsigned int a1 = 255-a2;
+        r = (a2 * r + bg * a1)/255;
       }
-      
+      d->write_data85(r, stream);
+      curdata +=a->D;
     }
+
   }
-  close_rle85(big);
-  fprintf(output,"\nrestore\n");
-  delete[] rgbdata;
 }
 
 void Fl_PostScript_Graphics_Driver::draw_image_mono(const uchar *data, int ix, int iy, int iw, int ih, int D, int LD) {
@@ -473,7 +720,10 @@ void Fl_PostScript_Graphics_Driver::draw_image_mono(const uchar *data, int ix, i
 
   fprintf(output,"save\n");
 
-  int i,j, k;
+  if (!LD) LD = iw*D;
+
+  image_data_args args = { NULL, NULL, data, iw, ih, D, LD, NULL };
+  int shared = begin_image_data(mono_image_writer, &args, iw * ih + (mask ? my * ((mx+7)/8) : 0));
 
   const char * interpol;
   if (lang_level_>1){
@@ -488,48 +738,44 @@ void Fl_PostScript_Graphics_Driver::draw_image_mono(const uchar *data, int ix, i
   }else
     fprintf(output , "%g %g %g %g %i %i GI", x , y+h , w , -h , iw , ih);
 
-
-  if (!LD) LD = iw*D;
+  end_image_data(shared, mono_image_writer, &args);
+  fprintf(output,"restore\n");
+}
 
 
-  int bg = (bg_r + bg_g + bg_b)/3;
+// writes gray image data from a callback, preceded by interleaved mask data with PostScript level 3
+static void mono_cb_image_writer(Fl_PostScript_Graphics_Driver *d, void *stream, void *args) {
+  image_data_args *a = (image_data_args *)args;
+  uchar *curmask = d->mask;
+  int i, j, k;
+  for (j=0; j<a->ih;j++){
 
-  uchar *curmask=mask;
-  void *big = prepare_rle85();
-  for (j=0; j<ih;j++){
-    if (mask){
-      for (k=0;k<my/ih;k++){
-        for (i=0; i<((mx+7)/8);i++){
-          write_rle85(swap_byte(*curmask), big);
+    if (d->mask && d->lang_level_>2){  // InterleaveType 2 mask data
+      for (k=0; k<d->my/a->ih;k++){ //for alpha pseudo-masking
+        for (i=0; i<((d->mx+7)/8);i++){
+          d->write_data85(swap_byte(*curmask), stream);
           curmask++;
         }
       }
     }
-    const uchar *curdata=data+j*LD;
-    for (i=0 ; i<iw ; i++) {
-      uchar r = curdata[0];
-      if (lang_level_<3 && D>1) { //can do  mixing
-
-        unsigned int a2 = curdata[1]; //must be int
-        unsigned int a = 255-a2;
-        r = (a2 * r + bg * a)/255;
-      }
-      write_rle85(r, big);
-      curdata +=D;
+    a->call(a->data,0,j,a->iw,a->buf);
+    uchar *curdata=a->buf;
+    for (i=0 ; i<a->iw ; i++) {
+      d->write_data85(curdata[0], stream);
+      curdata +=a->D;
     }
-
   }
-  close_rle85(big);
-  fprintf(output,"restore\n");
 }
 
-
-
 void Fl_PostScript_Graphics_Driver::draw_image_mono(Fl_Draw_Image_Cb call, void *data, int ix, int iy, int iw, int ih, int D) {
   double x = ix, y = iy, w = iw, h = ih;
 
   fprintf(output,"save\n");
-  int i,j,k;
+  int LD=iw*D;
+  uchar *rgbdata=new uchar[LD];
+  image_data_args args = { call, data, NULL, iw, ih, D, LD, rgbdata };
+  int shared = begin_image_data(mono_cb_image_writer, &args, iw * ih + (mask ? my * ((mx+7)/8) : 0));
+
   const char * interpol;
   if (lang_level_>1){
     if (interpolate_) interpol="true";
@@ -541,28 +787,7 @@ void Fl_PostScript_Graphics_Driver::draw_image_mono(Fl_Draw_Image_Cb call, void
   } else
     fprintf(output , "%g %g %g %g %i %i GI", x , y+h , w , -h , iw , ih);
 
-  int LD=iw*D;
-  uchar *rgbdata=new uchar[LD];
-  uchar *curmask=mask;
-  void *big = prepare_rle85();
-  for (j=0; j<ih;j++){
-
-    if (mask && lang_level_>2){  // InterleaveType 2 mask data
-      for (k=0; k<my/ih;k++){ //for alpha pseudo-masking
-        for (i=0; i<((mx+7)/8);i++){
-          write_rle85(swap_byte(*curmask), big);
-          curmask++;
-        }
-      }
-    }
-    call(data,0,j,iw,rgbdata);
-    uchar *curdata=rgbdata;
-    for (i=0 ; i<iw ; i++) {
-      write_rle85(curdata[0], big);
-      curdata +=D;
-    }
-  }
-  close_rle85(big);
+  end_image_data(shared, mono_cb_image_writer, &args);
   fprintf(output,"restore\n");
   delete[] rgbdata;
 }
@@ -601,20 +826,26 @@ void Fl_PostScript_Graphics_Driver::draw_rgb(Fl_RGB_Image * rgb,int XP, int YP,
   pop_clip(); // matches push_no_clip in scale_for_image_
 }
 
+// writes the bits of a bitmap, in reversed order
+static void bitmap_writer(Fl_PostScript_Graphics_Driver *d, void *stream, void *args) {
+  image_data_args *a = (image_data_args *)args;
+  const uchar *di = a->pixels;
+  for (int j=0; j<a->ih; j++){
+    for (int i=0; i<a->LD; i++){
+      d->write_data85(swap_byte(*di), stream);
+      di++;
+    }
+  }
+}
+
 void Fl_PostScript_Graphics_Driver::draw_bitmap(Fl_Bitmap * bitmap,int XP, int YP, int WP, int HP, int cx, int cy) {
   if (scale_for_image_(bitmap, XP, YP, WP, HP, cx, cy)) return;
   WP = bitmap->data_w(), HP = bitmap->data_h();
-  const uchar * di = bitmap->array;
-  int i, j, xx = (WP+7)/8;
+  image_data_args args = { NULL, NULL, bitmap->array, WP, HP, 1, (WP+7)/8, NULL };
+  int shared = begin_image_data(bitmap_writer, &args, HP * args.LD);
   fprintf(output , "%i %i %i %i %i %i MI\n", 0, HP, WP, -HP, WP, HP);
-  void *rle85 = prepare_rle85();
-  for (j=0; j<HP; j++){
-    for (i=0; i<xx; i++){
-      write_rle85(swap_byte(*di), rle85);
-      di++;
-    }
-  }
-  close_rle85(rle85); fputc('\n', output);
+  end_image_data(shared, bitmap_writer, &args);
+  fputc('\n', output);
   clocale_printf("GR GR\n");
   pop_clip(); // matches push_no_clip in scale_for_image_
 }
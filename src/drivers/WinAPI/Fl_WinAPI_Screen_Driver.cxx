@@ -25,6 +25,7 @@
 #include <FL/Fl_Graphics_Driver.H>
 #include <FL/Fl_RGB_Image.H>
 #include <FL/fl_ask.H>
+#include <FL/Fl_Event_Stats.H>
 #include <stdio.h>
 
 
@@ -384,7 +385,9 @@ static LRESULT CALLBACK s_TimerProc(HWND hwnd, UINT msg,
         void*              data = win32_timers[id].data;
         delete_timer(win32_timers[id]);
         if (cb) {
+          double t = Fl_Event_Stats::start();
           (*cb)(data);
+          if (t >= 0) Fl_Event_Stats::record(Fl_Event_Stats::TIMEOUT, t, (void*)cb, data);
         }
       }
     }
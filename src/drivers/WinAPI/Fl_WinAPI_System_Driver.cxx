@@ -308,6 +308,33 @@ int Fl_WinAPI_System_Driver::rename(const char *fnam, const char *newnam) {
   return _wrename(wbuf, wbuf1);
 }
 
+// uses its own buffers instead of wbuf and wbuf1 because it may be
+// called from a background thread
+int Fl_WinAPI_System_Driver::replace_file(const char *filename, const char *data, size_t size) {
+  size_t len = strlen(filename);
+  char *tmp = (char*)malloc(len + 5);
+  memcpy(tmp, filename, len);
+  memcpy(tmp + len, ".tmp", 5);
+  wchar_t *wname = NULL, *wtmp = NULL;
+  utf8_to_wchar(filename, wname);
+  utf8_to_wchar(tmp, wtmp);
+  free(tmp);
+  int ret = -1;
+  FILE *f = _wfopen(wtmp, L"wbc"); // 'c': fflush() commits the file to disk
+  if (f) {
+    int ok = (size == 0 || fwrite(data, size, 1, f) == 1);
+    if (fflush(f) != 0) ok = 0;
+    if (fclose(f) != 0) ok = 0;
+    if (ok && MoveFileExW(wtmp, wname, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH))
+      ret = 0;
+    else
+      _wunlink(wtmp);
+  }
+  free(wname);
+  free(wtmp);
+  return ret;
+}
+
 // Two Windows-specific functions fl_utf8_to_locale() and fl_locale_to_utf8()
 // from file fl_utf8.cxx are put here for API compatibility
 
@@ -752,6 +779,20 @@ int Fl_WinAPI_System_Driver::file_browser_load_directory(const char *directory,
   return filename_list(filename, pfiles, sort);
 }
 
+int Fl_WinAPI_System_Driver::file_browser_load_directory(const char *directory, char *filename,
+                                                         size_t name_size, Fl_Filename_Entry **pentries, int sort,
+                                                         int (*progress)(void *data, const char *name, int type), void *data)
+{
+  strlcpy(filename, directory, name_size);
+  int i = (int) (strlen(filename) - 1);
+  if (i == 2 && filename[1] == ':' &&
+      (filename[2] == '/' || filename[2] == '\\'))
+    filename[2] = '/';
+  else if (filename[i] != '/' && filename[i] != '\\')
+    strlcat(filename, "/", name_size);
+  return filename_list_entries(filename, pentries, sort, 0, progress, data);
+}
+
 void Fl_WinAPI_System_Driver::newUUID(char *uuidBuffer)
 {
   // First try and use the win API function UuidCreate(), but if that is not
@@ -931,6 +972,16 @@ void Fl_WinAPI_System_Driver::gettime(time_t *sec, int *usec) {
   *usec = t.millitm * 1000;
 }
 
+double Fl_WinAPI_System_Driver::monotonic_clock() {
+  static LARGE_INTEGER frequency;
+  LARGE_INTEGER count;
+  if (!frequency.QuadPart && !QueryPerformanceFrequency(&frequency))
+    frequency.QuadPart = -1;
+  if (frequency.QuadPart < 0 || !QueryPerformanceCounter(&count))
+    return Fl_System_Driver::monotonic_clock();
+  return double(count.QuadPart) / double(frequency.QuadPart);
+}
+
 //
 // End of "$Id$".
 //
@@ -28,6 +28,7 @@
 #include <FL/Fl_Box.H>
 #include <FL/Fl_Image_Surface.H>
 #include <FL/Fl_Tooltip.H>
+#include <FL/Fl_Event_Stats.H>
 
 #include <sys/time.h>
 
@@ -460,7 +461,9 @@ double Fl_X11_Screen_Driver::wait(double time_to_wait)
       t->next = free_timeout;
       free_timeout = t;
       // Now it is safe for the callback to do add_timeout:
+      double ts = Fl_Event_Stats::start();
       cb(argp);
+      if (ts >= 0) Fl_Event_Stats::record(Fl_Event_Stats::TIMEOUT, ts, (void*)cb, argp);
     }
   } else {
     reset_clock = 1; // we are not going to check the clock
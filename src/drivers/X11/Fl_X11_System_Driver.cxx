@@ -488,7 +488,14 @@ int Fl_X11_System_Driver::filename_list(const char *d, dirent ***list, int (*sor
     if (de->d_name[len-1]!='/' && len<=FL_PATH_MAX) {
       // Use memcpy for speed since we already know the length of the string...
       memcpy(name, de->d_name, len+1);
-      if (fl_filename_isdir(fullname)) {
+#ifdef DT_DIR
+      // the directory entry may already tell, except for symbolic links
+      int isdir = (de->d_type == DT_UNKNOWN || de->d_type == DT_LNK) ?
+                  fl_filename_isdir(fullname) : de->d_type == DT_DIR;
+#else
+      int isdir = fl_filename_isdir(fullname);
+#endif
+      if (isdir) {
         char *dst = newde->d_name + newlen;
         *dst++ = '/';
         *dst = 0;
@@ -24,6 +24,8 @@
 #include <FL/fl_utf8.h>
 #include "flstring.h"
 #include <stdlib.h>
+#include <sys/types.h>
+#include <sys/stat.h>
 
 
 int fl_alphasort(struct dirent **a, struct dirent **b) {
@@ -92,6 +94,246 @@ void fl_filename_free_list(struct dirent ***list, int n)
   *list = 0;
 }
 
+
+// Internal: collects the entries of a directory for
+// fl_filename_list(const char*, Fl_Filename_Entry**, int, int)
+struct Fl_Filename_List_Builder {
+  char *names;		// all names, nul-terminated
+  int names_size, names_alloc;
+  Fl_Filename_Entry *entries; // name is an offset into names until the end
+  int num_entries, alloc_entries;
+  int (*progress)(void *data, const char *name, int type);
+  void *progress_data;
+};
+
+// Internal: add one entry to a Fl_Filename_List_Builder
+static int filename_list_add(void *data, const char *name, int type,
+                             double size, long mtime) {
+  Fl_Filename_List_Builder *b = (Fl_Filename_List_Builder *)data;
+  int len = (int) strlen(name);
+  if (b->names_size + len + 2 > b->names_alloc) {
+    b->names_alloc = b->names_alloc ? 2 * b->names_alloc : 4096;
+    if (b->names_alloc < b->names_size + len + 2)
+      b->names_alloc = b->names_size + len + 2;
+    b->names = (char *)realloc(b->names, b->names_alloc);
+  }
+  if (b->num_entries >= b->alloc_entries) {
+    b->alloc_entries = b->alloc_entries ? 2 * b->alloc_entries : 64;
+    b->entries = (Fl_Filename_Entry *)realloc(b->entries,
+                                b->alloc_entries * sizeof(Fl_Filename_Entry));
+  }
+  Fl_Filename_Entry *e = b->entries + b->num_entries++;
+  e->name  = (const char *)(fl_intptr_t)b->names_size;
+  e->type  = type;
+  e->size  = size;
+  e->mtime = mtime;
+  char *dst = b->names + b->names_size;
+  memcpy(dst, name, len);
+  if (type == FL_FILENAME_DIRECTORY && (len == 0 || name[len - 1] != '/'))
+    dst[len++] = '/';
+  dst[len] = 0;
+  b->names_size += len + 1;
+  return b->progress ? b->progress(b->progress_data, dst, type) : 0;
+}
+
+
+/*
+ Writes the sort key of a file name for fl_filename_list(const char*,
+ Fl_Filename_Entry**, int, int) to key, which must have room for
+ 3 * strlen(name) bytes, and returns its length. Keys are compared with
+ memcmp(), so every name is only looked at once, not in every comparison.
+
+ For the numeric sort orders each run of digits becomes the number of its
+ significant digits followed by those digits, so that numbers compare by
+ value. The count is in '0'...'8', or '9' and four more bytes for numbers
+ with 9 or more digits, so a number still compares with the other
+ characters like its first digit did in fl_numericsort(). Bytes are compared
+ unsigned, so unlike fl_numericsort() non-ASCII names sort after ASCII ones.
+*/
+static int filename_sort_key(char *key, const char *name, int sort) {
+  int numeric = (sort == FL_FILENAME_SORT_NUMERIC || sort == FL_FILENAME_SORT_CASENUMERIC);
+  int nocase  = (sort == FL_FILENAME_SORT_CASEALPHA || sort == FL_FILENAME_SORT_CASENUMERIC);
+  char *k = key;
+  const unsigned char *s = (const unsigned char *)name;
+  while (*s) {
+    if (numeric && *s >= '0' && *s <= '9') {
+      while (*s == '0') s++;
+      const unsigned char *digits = s;
+      while (*s >= '0' && *s <= '9') s++;
+      int n = (int)(s - digits);
+      if (n < 9) {
+        *k++ = (char)('0' + n);
+      } else {
+        *k++ = '9';
+        *k++ = (char)(n >> 24); *k++ = (char)(n >> 16);
+        *k++ = (char)(n >> 8);  *k++ = (char)n;
+      }
+      memcpy(k, digits, n);
+      k += n;
+    } else {
+      unsigned char c = *s++;
+      if (nocase && c >= 'A' && c <= 'Z') c += 'a' - 'A';
+      *k++ = (char)c;
+    }
+  }
+  return (int)(k - key);
+}
+
+// Internal: a name to sort in fl_filename_list()
+struct Fl_Filename_Sort_Item {
+  const char *key;
+  int len;
+  int index;
+};
+
+static int filename_sort_compare(const void *a, const void *b) {
+  const Fl_Filename_Sort_Item *ia = (const Fl_Filename_Sort_Item *)a;
+  const Fl_Filename_Sort_Item *ib = (const Fl_Filename_Sort_Item *)b;
+  int ret = memcmp(ia->key, ib->key, ia->len < ib->len ? ia->len : ib->len);
+  if (ret) return ret;
+  if (ia->len != ib->len) return ia->len - ib->len;
+  return ia->index - ib->index;
+}
+
+
+/**
+  Lists a directory with the type of each file.
+
+  This is faster than fl_filename_list(const char*, dirent***, Fl_File_Sort_F*)
+  followed by a stat() call per file. Where the system provides the file type
+  with the directory entry no stat() call is made at all, except for symbolic
+  links, which are followed. All entries and names are stored in a single
+  block of memory, and the names are sorted with a precomputed key instead
+  of calling a comparison function like fl_numericsort() for every comparison.
+
+  \code
+  Fl_Filename_Entry *list;
+  int n = fl_filename_list("/tmp", &list);
+  for (int i = 0; i < n; i++)
+    printf("%s%s\n", list[i].name, list[i].type == FL_FILENAME_FIFO ? " (pipe)" : "");
+  fl_filename_free_list(&list);
+  \endcode
+
+  \param[in] d the name of the directory to list
+  \param[out] list array of the entries, followed by one with a NULL name;
+	free it with fl_filename_free_list(Fl_Filename_Entry**)
+  \param[in] sort FL_FILENAME_SORT_NUMERIC (default), FL_FILENAME_SORT_CASENUMERIC,
+	FL_FILENAME_SORT_ALPHA, FL_FILENAME_SORT_CASEALPHA, or FL_FILENAME_SORT_NONE
+  \param[in] flags FL_FILENAME_STAT to also get the size and modification time of
+	all files, which needs a stat() call per file
+  \return the number of entries, or a negative value if the directory can not
+	be read (*list is then NULL)
+  \version 1.4.0
+*/
+int fl_filename_list(const char *d, Fl_Filename_Entry **list, int sort, int flags) {
+  return Fl::system_driver()->filename_list_entries(d, list, sort, flags, 0, 0);
+}
+
+/*
+ Lists a directory like fl_filename_list(const char*, Fl_Filename_Entry**, int, int),
+ but also passes the name and type of every entry to progress() as soon as it is
+ found, e.g. to show a long listing while it is being made. Listing stops when
+ progress() returns non-zero, and -1 is returned.
+*/
+int Fl_System_Driver::filename_list_entries(const char *d, Fl_Filename_Entry **list,
+                                            int sort, int flags,
+                                            int (*progress)(void *data, const char *name, int type),
+                                            void *data) {
+  Fl_Filename_List_Builder b;
+  memset(&b, 0, sizeof(b));
+  b.progress = progress;
+  b.progress_data = data;
+  *list = 0;
+  int n = filename_entries(d, flags, filename_list_add, &b);
+  if (n < 0) {
+    free(b.names);
+    free(b.entries);
+    return n;
+  }
+  n = b.num_entries;
+
+  // sort the names by their keys
+  Fl_Filename_Sort_Item *items = 0;
+  char *keys = 0;
+  if (sort != FL_FILENAME_SORT_NONE && n > 1) {
+    items = (Fl_Filename_Sort_Item *)malloc(n * sizeof(Fl_Filename_Sort_Item));
+    keys = (char *)malloc(3 * b.names_size + 1);
+    char *k = keys;
+    for (int i = 0; i < n; i++) {
+      items[i].key   = k;
+      items[i].len   = filename_sort_key(k, b.names + (fl_intptr_t)b.entries[i].name, sort);
+      // sort directories by their names without the '/'
+      if (b.entries[i].type == FL_FILENAME_DIRECTORY && items[i].len && k[items[i].len - 1] == '/')
+        items[i].len--;
+      items[i].index = i;
+      k += items[i].len;
+    }
+    qsort(items, n, sizeof(Fl_Filename_Sort_Item), filename_sort_compare);
+  }
+
+  // copy the entries and names to a single block
+  Fl_Filename_Entry *result =
+    (Fl_Filename_Entry *)malloc((n + 1) * sizeof(Fl_Filename_Entry) + b.names_size);
+  char *names = (char *)(result + n + 1);
+  if (b.names_size) memcpy(names, b.names, b.names_size);
+  for (int i = 0; i < n; i++) {
+    result[i] = b.entries[items ? items[i].index : i];
+    result[i].name = names + (fl_intptr_t)result[i].name;
+  }
+  memset(result + n, 0, sizeof(Fl_Filename_Entry));
+
+  free(keys);
+  free(items);
+  free(b.names);
+  free(b.entries);
+  *list = result;
+  return n;
+}
+
+/**
+  Frees a list made by fl_filename_list(const char*, Fl_Filename_Entry**, int, int).
+  \param[in,out] list the list, set to NULL
+  \version 1.4.0
+*/
+void fl_filename_free_list(Fl_Filename_Entry **list) {
+  free(*list);
+  *list = 0;
+}
+
+/*
+ Default implementation of the directory listing for fl_filename_list(const char*,
+ Fl_Filename_Entry**, int, int). This one is based on filename_list() and
+ stat() and should work everywhere; platforms can do better.
+*/
+int Fl_System_Driver::filename_entries(const char *d, int flags,
+                                       int (*add)(void *data, const char *name, int type, double size, long mtime),
+                                       void *data) {
+  dirent **files;
+  int n = filename_list(d, &files, 0);
+  if (n < 0) return n;
+  char fullname[FL_PATH_MAX];
+  int stop = 0;
+  for (int i = 0; i < n; i++) {
+    const char *name = files[i]->d_name;
+    int len = (int) strlen(name);
+    int type = (len && name[len - 1] == '/') ? FL_FILENAME_DIRECTORY : FL_FILENAME_PLAIN;
+    double size = -1;
+    long mtime = 0;
+    if (!stop && (flags & FL_FILENAME_STAT)) {
+      struct stat s;
+      snprintf(fullname, sizeof(fullname), "%s/%s", d, name);
+      if (fl_stat(fullname, &s) == 0) {
+        size = (double)s.st_size;
+        mtime = (long)s.st_mtime;
+      }
+    }
+    if (!stop) stop = add(data, name, type, size, mtime);
+    free(files[i]);
+  }
+  free(files);
+  return stop ? -1 : n;
+}
+
 //
 // End of "$Id$".
 //
@@ -69,8 +69,8 @@ int fl_measure_pixmap(/*const*/ char* const* data, int &w, int &h) {
   */
 int fl_measure_pixmap(const char * const *cdata, int &w, int &h) {
   int i = sscanf(cdata[0],"%d%d%d%d",&w,&h,&ncolors,&chars_per_pixel);
-  if (i<4 || w<=0 || h<=0 ||
-      (chars_per_pixel!=1 && chars_per_pixel!=2) ) return w=0;
+  if (i<4 || w<=0 || h<=0 || chars_per_pixel<1 ||
+      (ncolors<0 && chars_per_pixel!=1) ) return w=0;
   return 1;
 }
 
@@ -124,91 +124,281 @@ void Fl_GDI_Graphics_Driver::make_unused_color_(uchar &r, uchar &g, uchar &b) {
 #endif // FL_CFG_SYS_WIN32
 
 
+// Parsing the color map of XPM data, especially color names, is slow.
+// Therefore the parsed color map is kept for each XPM data pointer, together
+// with a table to find the color of each pixel code. The copy of the color
+// map lines is used to detect modified data, e.g. after Fl_Pixmap::desaturate().
+
+enum {
+  XPM_COLOR,		// parsed color
+  XPM_NONE,		// "None" or unknown color: transparent or background
+  XPM_BLANK		// ' ' in FLTK's compressed color map: always transparent
+};
+
+struct Fl_XPM_Colors {
+  const char *const *cdata;	// the XPM data
+  Fl_XPM_Colors *next;		// next entry with the same hash value
+  char *cmap;			// copy of header and color map lines
+  int cmap_size;
+  int ncolors, cpp;		// number of colors and characters per pixel
+  uchar (*rgb)[3];		// the colors, plus 1 for undefined pixel codes
+  uchar *kind;			// XPM_COLOR, XPM_NONE, or XPM_BLANK
+  int *index;			// cpp == 1: color index of each code
+  const uchar *codes;		// cpp > 1: color codes (pointers into cmap)
+  int *hash;			// cpp > 1: open hash table of color indexes
+  unsigned hash_mask;
+};
+
+static const int XPM_BUCKETS = 256;		// power of 2
+static const int XPM_MAX_CACHED = 1024;
+static Fl_XPM_Colors *xpm_colors[XPM_BUCKETS];
+static int xpm_colors_count = 0;
+
+static unsigned xpm_bucket(const char *const *cdata) {
+  return (unsigned)(((fl_uintptr_t)cdata >> 4) & (XPM_BUCKETS - 1));
+}
+
+static unsigned xpm_code_hash(const uchar *code, int cpp) {
+  unsigned h = 2166136261U; // FNV-1a
+  for (int i = 0; i < cpp; i++) h = (h ^ code[i]) * 16777619U;
+  return h;
+}
+
+static void xpm_free_colors(Fl_XPM_Colors *c) {
+  free(c->cmap);
+  delete[] c->rgb;
+  delete[] c->kind;
+  delete[] c->index;
+  delete[] c->hash;
+  delete c;
+}
+
+// number of color map lines and their total size (without the header)
+static int xpm_cmap_size(const char *const *cdata, int ncolors) {
+  if (ncolors < 0) return -4 * ncolors;
+  int size = 0;
+  for (int i = 1; i <= ncolors; i++) size += (int)strlen(cdata[i]) + 1;
+  return size;
+}
+
+// copies the header and color map lines into one buffer
+static void xpm_copy_cmap(const char *const *cdata, int ncolors, char *buf) {
+  int l = (int)strlen(cdata[0]) + 1;
+  memcpy(buf, cdata[0], l);
+  buf += l;
+  if (ncolors < 0) {
+    memcpy(buf, cdata[1], -4 * ncolors);
+  } else {
+    for (int i = 1; i <= ncolors; i++) {
+      l = (int)strlen(cdata[i]) + 1;
+      memcpy(buf, cdata[i], l);
+      buf += l;
+    }
+  }
+}
+
+static int xpm_same_cmap(const Fl_XPM_Colors *c, const char *const *cdata) {
+  const char *buf = c->cmap;
+  int l = (int)strlen(cdata[0]) + 1;
+  if (l > c->cmap_size || memcmp(buf, cdata[0], l)) return 0;
+  buf += l;
+  if (c->ncolors < 0)
+    return buf - 4 * c->ncolors <= c->cmap + c->cmap_size &&
+           !memcmp(buf, cdata[1], -4 * c->ncolors);
+  for (int i = 1; i <= c->ncolors; i++) {
+    l = (int)strlen(cdata[i]) + 1;
+    if (buf + l > c->cmap + c->cmap_size || memcmp(buf, cdata[i], l)) return 0;
+    buf += l;
+  }
+  return 1;
+}
+
+// parses the color map of cdata
+static Fl_XPM_Colors *xpm_parse_colors(const char *const *cdata) {
+  int n = ncolors < 0 ? -ncolors : ncolors;
+  int header = (int)strlen(cdata[0]) + 1;
+  Fl_XPM_Colors *c = new Fl_XPM_Colors;
+  c->cdata = cdata;
+  c->next = 0;
+  c->ncolors = ncolors;
+  c->cpp = chars_per_pixel;
+  c->cmap_size = header + xpm_cmap_size(cdata, ncolors);
+  c->cmap = (char*)malloc(c->cmap_size);
+  xpm_copy_cmap(cdata, ncolors, c->cmap);
+  c->rgb = new uchar[n + 1][3];
+  c->kind = new uchar[n + 1];
+  c->index = 0;
+  c->codes = 0;
+  c->hash = 0;
+  c->hash_mask = 0;
+  // pixel codes not in the color map are transparent black
+  c->rgb[n][0] = c->rgb[n][1] = c->rgb[n][2] = 0;
+  c->kind[n] = XPM_BLANK;
+
+  if (ncolors < 0) {	// FLTK (non standard) compressed colormap
+    const uchar *p = (const uchar*)c->cmap + header;
+    c->index = new int[256];
+    for (int i = 0; i < 256; i++) c->index[i] = n;
+    for (int i = 0; i < n; i++, p += 4) {
+      c->index[p[0]] = i;
+      c->rgb[i][0] = p[1];
+      c->rgb[i][1] = p[2];
+      c->rgb[i][2] = p[3];
+      // if first color is ' ' it is transparent
+      c->kind[i] = (i == 0 && p[0] == ' ') ? XPM_BLANK : XPM_COLOR;
+    }
+    return c;
+  }
+
+  // normal XPM colormap with names
+  if (chars_per_pixel == 1) {
+    c->index = new int[256];
+    for (int i = 0; i < 256; i++) c->index[i] = n;
+  } else {
+    unsigned size = 16;
+    while (size < 2U * n) size <<= 1;
+    c->hash = new int[size];
+    for (unsigned i = 0; i < size; i++) c->hash[i] = -1;
+    c->hash_mask = size - 1;
+    c->codes = (const uchar*)c->cmap + header;
+  }
+  const uchar *line = (const uchar*)c->cmap + header;
+  int *code_offset = (chars_per_pixel > 1) ? new int[n] : 0;
+  for (int i = 0; i < n; i++) {
+    const uchar *p = line;
+    line += strlen((const char*)line) + 1;
+    // the first chars_per_pixel characters are the color code:
+    if (chars_per_pixel == 1) {
+      c->index[*p] = i;
+    } else {
+      code_offset[i] = (int)(p - c->codes);
+      unsigned h = xpm_code_hash(p, chars_per_pixel) & c->hash_mask;
+      for (;;) { // later definitions of a code replace earlier ones
+        int j = c->hash[h];
+        if (j < 0 || !memcmp(c->codes + code_offset[j], p, chars_per_pixel)) break;
+        h = (h + 1) & c->hash_mask;
+      }
+      c->hash[h] = i;
+    }
+    p += chars_per_pixel;
+    // look for "c word", or last word if none:
+    const uchar *previous_word = p;
+    for (;;) {
+      while (*p && isspace(*p)) p++;
+      uchar what = *p++;
+      while (*p && !isspace(*p)) p++;
+      while (*p && isspace(*p)) p++;
+      if (!*p) {p = previous_word; break;}
+      if (what == 'c') break;
+      previous_word = p;
+      while (*p && !isspace(*p)) p++;
+    }
+    if (fl_parse_color((const char*)p, c->rgb[i][0], c->rgb[i][1], c->rgb[i][2])) {
+      c->kind[i] = XPM_COLOR;
+    } else {
+      // assume "None" or "#transparent" for any errors
+      c->kind[i] = XPM_NONE;
+    }
+  }
+  if (code_offset) c->index = code_offset; // color i has its code at codes + index[i]
+  return c;
+}
+
+// returns the parsed color map of cdata; fl_measure_pixmap() must have been called
+static Fl_XPM_Colors *xpm_colors_of(const char *const *cdata) {
+  Fl_XPM_Colors **p = &xpm_colors[xpm_bucket(cdata)];
+  for (Fl_XPM_Colors *c = *p; c; p = &c->next, c = c->next) {
+    if (c->cdata != cdata) continue;
+    if (c->cpp == chars_per_pixel && c->ncolors == ncolors && xpm_same_cmap(c, cdata))
+      return c;
+    *p = c->next; // data were modified
+    xpm_free_colors(c);
+    xpm_colors_count--;
+    break;
+  }
+  if (xpm_colors_count >= XPM_MAX_CACHED) {
+    for (int i = 0; i < XPM_BUCKETS; i++) {
+      while (xpm_colors[i]) {
+        Fl_XPM_Colors *c = xpm_colors[i];
+        xpm_colors[i] = c->next;
+        xpm_free_colors(c);
+      }
+    }
+    xpm_colors_count = 0;
+  }
+  Fl_XPM_Colors *c = xpm_parse_colors(cdata);
+  unsigned b = xpm_bucket(cdata);
+  c->next = xpm_colors[b];
+  xpm_colors[b] = c;
+  xpm_colors_count++;
+  return c;
+}
+
+/*
+  Frees the parsed color map of XPM data when the data are deleted.
+  This is not required for correctness (modified data are detected),
+  only to release memory early.
+*/
+void fl_uncache_pixmap_colors(const char *const *cdata) {
+  Fl_XPM_Colors **p = &xpm_colors[xpm_bucket(cdata)];
+  for (Fl_XPM_Colors *c = *p; c; p = &c->next, c = c->next) {
+    if (c->cdata == cdata) {
+      *p = c->next;
+      xpm_free_colors(c);
+      xpm_colors_count--;
+      return;
+    }
+  }
+}
+
 int fl_convert_pixmap(const char*const* cdata, uchar* out, Fl_Color bg) {
   int w, h;
-  const uchar*const* data = (const uchar*const*)(cdata+1);
-  uchar *transparent_c = (uchar *)0; // such that transparent_c[0,1,2] are the RGB of the transparent color
   
   if (!fl_measure_pixmap(cdata, w, h))
     return 0;
-  
-  if ((chars_per_pixel < 1) || (chars_per_pixel > 2))
-    return 0;
-  
+
+  Fl_XPM_Colors *xpm = xpm_colors_of(cdata);
+  const uchar*const* data = (const uchar*const*)(cdata + 1 + (ncolors < 0 ? 1 : ncolors));
+  int n = ncolors < 0 ? -ncolors : ncolors;
+
+  // compute the RGBA colors for this bg color and drawing surface
   typedef uchar uchar4[4];
-  uchar4 *colors = new uchar4[1<<(chars_per_pixel*8)];
-  
+  uchar4 *colors = new uchar4[n + 1];
+  uchar *transparent_c = (uchar *)0; // such that transparent_c[0,1,2] are the RGB of the transparent color
   if (Fl_Graphics_Driver::need_pixmap_bg_color) {
     color_count = 0;
-    used_colors = (UsedColor*)malloc(abs(ncolors) * sizeof(UsedColor));
+    used_colors = (UsedColor*)malloc((n + 1) * sizeof(UsedColor));
   }
-  
-  if (ncolors < 0) {	// FLTK (non standard) compressed colormap
-    ncolors = -ncolors;
-    const uchar *p = *data++;
-    // if first color is ' ' it is transparent (put it later to make
-    // it not be transparent):
-    if (*p == ' ') {
-      uchar* c = colors[(int)' '];
-      Fl::get_color(bg, c[0], c[1], c[2]); c[3] = 0;
-      if (Fl_Graphics_Driver::need_pixmap_bg_color) transparent_c = c;
-      p += 4;
-      ncolors--;
-    }
-    // read all the rest of the colors:
-    for (int i=0; i < ncolors; i++) {
-      uchar* c = colors[*p++];
-      if (Fl_Graphics_Driver::need_pixmap_bg_color) {
-        used_colors[color_count].r = *(p+0);
-        used_colors[color_count].g = *(p+1);
-        used_colors[color_count].b = *(p+2);
-        color_count++;
-      }
-      *c++ = *p++;
-      *c++ = *p++;
-      *c++ = *p++;
-      *c = 255;
-    }
-  } else {	// normal XPM colormap with names
-    for (int i=0; i<ncolors; i++) {
-      const uchar *p = *data++;
-      // the first 1 or 2 characters are the color index:
-      int ind = *p++;
-      uchar* c;
-      if (chars_per_pixel>1)
-        ind = (ind<<8)|*p++;
-      c = colors[ind];
-      // look for "c word", or last word if none:
-      const uchar *previous_word = p;
-      for (;;) {
-        while (*p && isspace(*p)) p++;
-        uchar what = *p++;
-        while (*p && !isspace(*p)) p++;
-        while (*p && isspace(*p)) p++;
-        if (!*p) {p = previous_word; break;}
-        if (what == 'c') break;
-        previous_word = p;
-        while (*p && !isspace(*p)) p++;
-      }
-      int parse = fl_parse_color((const char*)p, c[0], c[1], c[2]);
-      c[3] = 255;
-      if (parse) {
+  uchar **m = fl_graphics_driver->mask_bitmap();
+  for (int i = 0; i <= n; i++) {
+    uchar *c = colors[i];
+    switch (xpm->kind[i]) {
+      case XPM_COLOR:
+        c[0] = xpm->rgb[i][0]; c[1] = xpm->rgb[i][1]; c[2] = xpm->rgb[i][2];
+        c[3] = 255;
         if (Fl_Graphics_Driver::need_pixmap_bg_color) {
           used_colors[color_count].r = c[0];
           used_colors[color_count].g = c[1];
           used_colors[color_count].b = c[2];
           color_count++;
         }
-      } else {
-        // assume "None" or "#transparent" for any errors
-        // "bg" should be transparent...
+        break;
+      case XPM_NONE: // "bg" should be transparent...
         Fl::get_color(bg, c[0], c[1], c[2]);
-        uchar **m = fl_graphics_driver->mask_bitmap();
         c[3] = (m && !*m) ? 255 : 0;
         if (Fl_Graphics_Driver::need_pixmap_bg_color) transparent_c = c;
-      } // if parse
-    } // for ncolors
-  } // if ncolors
+        break;
+      default: // XPM_BLANK
+        if (i < n) {
+          Fl::get_color(bg, c[0], c[1], c[2]);
+          if (Fl_Graphics_Driver::need_pixmap_bg_color) transparent_c = c;
+        } else { // undefined pixel codes
+          c[0] = c[1] = c[2] = 0;
+        }
+        c[3] = 0;
+        break;
+    }
+  }
   if (Fl_Graphics_Driver::need_pixmap_bg_color) {
     if (transparent_c) {
       fl_graphics_driver->make_unused_color_(transparent_c[0], transparent_c[1], transparent_c[2]);
@@ -217,18 +407,31 @@ int fl_convert_pixmap(const char*const* cdata, uchar* out, Fl_Color bg) {
       fl_graphics_driver->make_unused_color_(r, g, b);
     }
   }
-  
+
   U32 *q = (U32*)out;
+  int cpp = chars_per_pixel;
   for (int Y = 0; Y < h; Y++) {
     const uchar* p = data[Y];
-    if (chars_per_pixel <= 1) {
+    if (cpp == 1) {
+      const int *index = xpm->index;
       for (int X = 0; X < w; X++)
-        memcpy(q++, colors[*p++], 4);
+        memcpy(q++, colors[index[*p++]], 4);
     } else {
-      for (int X = 0; X < w; X++) {
-        int ind = (*p++)<<8;
-        ind |= *p++;
-        memcpy(q++, colors[ind], 4);
+      // pixels often repeat the previous code: remember its color
+      const uchar *last = 0;
+      int color = n;
+      for (int X = 0; X < w; X++, p += cpp) {
+        if (!last || memcmp(p, last, cpp)) {
+          unsigned k = xpm_code_hash(p, cpp) & xpm->hash_mask;
+          for (;;) {
+            color = xpm->hash[k];
+            if (color < 0) { color = n; break; }
+            if (!memcmp(xpm->codes + xpm->index[color], p, cpp)) break;
+            k = (k + 1) & xpm->hash_mask;
+          }
+          last = p;
+        }
+        memcpy(q++, colors[color], 4);
       }
     }
   }
@@ -19,6 +19,7 @@
 //
 //   fl_register_images() - Register the image formats.
 //   fl_check_images()    - Check for a supported image format.
+//   fl_deflate_ps()      - Compress PostScript image data.
 //
 
 //
@@ -32,6 +33,7 @@
 #include <FL/Fl_PNG_Image.H>
 #include <FL/Fl_PNM_Image.H>
 #include <FL/Fl_SVG_Image.H>
+#include <FL/Fl_PostScript.H>
 #include <FL/fl_utf8.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -46,6 +48,10 @@
 //
 
 static Fl_Image	*fl_check_images(const char *name, uchar *header, int headerlen);
+#if defined(HAVE_LIBZ) && !defined(FL_NO_PRINT_SUPPORT)
+static int	fl_deflate_ps(void **state, int level, const uchar *in, int len, int finish,
+		              void (*output)(void *data, const uchar *p, int len), void *data);
+#endif
 
 
 /**
@@ -53,10 +59,14 @@ static Fl_Image	*fl_check_images(const char *name, uchar *header, int headerlen)
  *
  This function is provided in the fltk_images library and 
  registers all of the "extra" image file formats that are not part
- of the core FLTK library.
+ of the core FLTK library. It also allows compressed image data in
+ PostScript output, see Fl_PostScript_File_Device::compression().
 */
 void fl_register_images() {
   Fl_Shared_Image::add_handler(fl_check_images);
+#if defined(HAVE_LIBZ) && !defined(FL_NO_PRINT_SUPPORT)
+  Fl_PostScript_File_Device::deflate_function(fl_deflate_ps);
+#endif
 }
 
 
@@ -113,6 +123,52 @@ fl_check_images(const char *name,		// I - Filename
 }
 
 
+#if defined(HAVE_LIBZ) && !defined(FL_NO_PRINT_SUPPORT)
+
+//
+// 'fl_deflate_ps()' - Compress PostScript image data with zlib.
+//
+
+static int					// O - 0 if OK, -1 on error
+fl_deflate_ps(void **state,			// IO - zlib stream, NULL at start
+              int level,			// I - Compression level
+              const uchar *in,			// I - Input data
+              int len,				// I - Length of input data
+              int finish,			// I - Non-zero at end of data
+              void (*output)(void *data, const uchar *p, int len),
+						// I - Output function
+              void *data) {			// I - Output function data
+  z_stream *z = (z_stream *)*state;
+  if (!z) {
+    z = new z_stream;
+    memset(z, 0, sizeof(z_stream));
+    if (deflateInit(z, level) != Z_OK) {
+      delete z;
+      return -1;
+    }
+    *state = z;
+  }
+  uchar buffer[4096];
+  int status;
+  z->next_in  = (Bytef *)in;
+  z->avail_in = len;
+  do {
+    z->next_out  = buffer;
+    z->avail_out = sizeof(buffer);
+    status = deflate(z, finish ? Z_FINISH : Z_NO_FLUSH);
+    if (status == Z_STREAM_ERROR) break;
+    output(data, buffer, sizeof(buffer) - z->avail_out);
+  } while (z->avail_out == 0 || (finish && status != Z_STREAM_END));
+  if (finish || status == Z_STREAM_ERROR) {
+    deflateEnd(z);
+    delete z;
+    *state = NULL;
+  }
+  return status == Z_STREAM_ERROR ? -1 : 0;
+}
+
+#endif // HAVE_LIBZ && !FL_NO_PRINT_SUPPORT
+
 //
 // End of "$Id$".
 //
@@ -0,0 +1,235 @@
+/*
+ * "$Id$"
+ *
+ * Internal thread and mutex support for the Fast Light Tool Kit (FLTK).
+ *
+ * Copyright 1998-2018 by Bill Spitzak and others.
+ *
+ * This library is free software. Distribution and use rights are outlined in
+ * the file "COPYING" which should have been included with this file.  If this
+ * file is missing or damaged, see the license at:
+ *
+ *     http://www.fltk.org/COPYING.php
+ *
+ * Please report all bugs and problems on the following page:
+ *
+ *     http://www.fltk.org/str.php
+ */
+
+/*
+  Minimal portable wrappers for the few places inside the library that use
+  worker threads (e.g. SVG rasterization). This is not a public API and is
+  intentionally kept as small as possible, see the notes in Fl_lock.cxx.
+
+  If the platform has no thread support (or FLTK was built without it),
+  FL_HAVE_INTERNAL_THREADS is not defined, mutexes and conditions do nothing,
+  and fl_thread_create() always fails. Callers must then do their work in
+  the calling thread.
+*/
+
+#ifndef fl_threads_h
+#  define fl_threads_h
+
+#  include <config.h>
+
+typedef void *(*Fl_Thread_Proc)(void *);
+
+#  if defined(HAVE_PTHREAD)
+
+#    include <pthread.h>
+#    include <unistd.h>
+#    include <time.h>
+#    define FL_HAVE_INTERNAL_THREADS 1
+
+class Fl_Internal_Mutex {
+  friend class Fl_Internal_Condition;
+  pthread_mutex_t mutex_;
+  Fl_Internal_Mutex(const Fl_Internal_Mutex&);
+  Fl_Internal_Mutex& operator=(const Fl_Internal_Mutex&);
+public:
+  Fl_Internal_Mutex() { pthread_mutex_init(&mutex_, NULL); }
+  ~Fl_Internal_Mutex() { pthread_mutex_destroy(&mutex_); }
+  void lock() { pthread_mutex_lock(&mutex_); }
+  void unlock() { pthread_mutex_unlock(&mutex_); }
+};
+
+class Fl_Internal_Condition {
+  pthread_cond_t cond_;
+  Fl_Internal_Condition(const Fl_Internal_Condition&);
+  Fl_Internal_Condition& operator=(const Fl_Internal_Condition&);
+public:
+  Fl_Internal_Condition() { pthread_cond_init(&cond_, NULL); }
+  ~Fl_Internal_Condition() { pthread_cond_destroy(&cond_); }
+  void wait(Fl_Internal_Mutex &m) { pthread_cond_wait(&cond_, &m.mutex_); }
+  /* Waits at most 'ms' milliseconds. */
+  void wait(Fl_Internal_Mutex &m, int ms) {
+    struct timespec t;
+    clock_gettime(CLOCK_REALTIME, &t);
+    t.tv_sec += ms / 1000;
+    t.tv_nsec += (ms % 1000) * 1000000L;
+    if (t.tv_nsec >= 1000000000L) { t.tv_sec++; t.tv_nsec -= 1000000000L; }
+    pthread_cond_timedwait(&cond_, &m.mutex_, &t);
+  }
+  void signal() { pthread_cond_signal(&cond_); }
+  void broadcast() { pthread_cond_broadcast(&cond_); }
+};
+
+typedef pthread_t Fl_Internal_Thread;
+
+/* Returns 0 on success. Detached threads must not be joined. */
+static inline int fl_thread_create(Fl_Internal_Thread &t, Fl_Thread_Proc proc,
+                                   void *data, int detached = 0) {
+  if (pthread_create(&t, NULL, proc, data)) return -1;
+  if (detached) pthread_detach(t);
+  return 0;
+}
+
+static inline void fl_thread_join(Fl_Internal_Thread t) {
+  pthread_join(t, NULL);
+}
+
+typedef pthread_t Fl_Internal_Thread_Id;
+
+/* Returns an id of the calling thread, see fl_thread_is_current(). */
+static inline Fl_Internal_Thread_Id fl_thread_id() {
+  return pthread_self();
+}
+
+static inline int fl_thread_is_current(Fl_Internal_Thread_Id id) {
+  return pthread_equal(id, pthread_self());
+}
+
+static inline int fl_thread_cpu_count() {
+#    ifdef _SC_NPROCESSORS_ONLN
+  long n = sysconf(_SC_NPROCESSORS_ONLN);
+  return n > 0 ? (int)n : 1;
+#    else
+  return 1;
+#    endif
+}
+
+#  elif defined(_WIN32) && defined(_WIN32_WINNT) && (_WIN32_WINNT >= 0x0600)
+
+#    include <windows.h>
+#    include <process.h>
+#    define FL_HAVE_INTERNAL_THREADS 1
+
+class Fl_Internal_Mutex {
+  friend class Fl_Internal_Condition;
+  CRITICAL_SECTION cs_;
+  Fl_Internal_Mutex(const Fl_Internal_Mutex&);
+  Fl_Internal_Mutex& operator=(const Fl_Internal_Mutex&);
+public:
+  Fl_Internal_Mutex() { InitializeCriticalSection(&cs_); }
+  ~Fl_Internal_Mutex() { DeleteCriticalSection(&cs_); }
+  void lock() { EnterCriticalSection(&cs_); }
+  void unlock() { LeaveCriticalSection(&cs_); }
+};
+
+class Fl_Internal_Condition {
+  CONDITION_VARIABLE cond_;
+  Fl_Internal_Condition(const Fl_Internal_Condition&);
+  Fl_Internal_Condition& operator=(const Fl_Internal_Condition&);
+public:
+  Fl_Internal_Condition() { InitializeConditionVariable(&cond_); }
+  void wait(Fl_Internal_Mutex &m) { SleepConditionVariableCS(&cond_, &m.cs_, INFINITE); }
+  void wait(Fl_Internal_Mutex &m, int ms) { SleepConditionVariableCS(&cond_, &m.cs_, (DWORD)ms); }
+  void signal() { WakeConditionVariable(&cond_); }
+  void broadcast() { WakeAllConditionVariable(&cond_); }
+};
+
+typedef HANDLE Fl_Internal_Thread;
+
+struct Fl_Thread_Start_ {
+  Fl_Thread_Proc proc;
+  void *data;
+  static unsigned __stdcall run(void *p) {
+    Fl_Thread_Start_ s = *(Fl_Thread_Start_*)p;
+    delete (Fl_Thread_Start_*)p;
+    s.proc(s.data);
+    return 0;
+  }
+};
+
+static inline int fl_thread_create(Fl_Internal_Thread &t, Fl_Thread_Proc proc,
+                                   void *data, int detached = 0) {
+  Fl_Thread_Start_ *s = new Fl_Thread_Start_;
+  s->proc = proc;
+  s->data = data;
+  t = (HANDLE)_beginthreadex(NULL, 0, Fl_Thread_Start_::run, s, 0, NULL);
+  if (!t) { delete s; return -1; }
+  if (detached) CloseHandle(t);
+  return 0;
+}
+
+static inline void fl_thread_join(Fl_Internal_Thread t) {
+  WaitForSingleObject(t, INFINITE);
+  CloseHandle(t);
+}
+
+typedef DWORD Fl_Internal_Thread_Id;
+
+static inline Fl_Internal_Thread_Id fl_thread_id() {
+  return GetCurrentThreadId();
+}
+
+static inline int fl_thread_is_current(Fl_Internal_Thread_Id id) {
+  return id == GetCurrentThreadId();
+}
+
+static inline int fl_thread_cpu_count() {
+  SYSTEM_INFO info;
+  GetSystemInfo(&info);
+  return info.dwNumberOfProcessors > 0 ? (int)info.dwNumberOfProcessors : 1;
+}
+
+#  else // no thread support
+
+class Fl_Internal_Mutex {
+public:
+  void lock() { }
+  void unlock() { }
+};
+
+class Fl_Internal_Condition {
+public:
+  void wait(Fl_Internal_Mutex &) { }
+  void wait(Fl_Internal_Mutex &, int) { }
+  void signal() { }
+  void broadcast() { }
+};
+
+typedef int Fl_Internal_Thread;
+
+static inline int fl_thread_create(Fl_Internal_Thread &, Fl_Thread_Proc,
+                                   void *, int = 0) {
+  return -1;
+}
+
+static inline void fl_thread_join(Fl_Internal_Thread) { }
+
+typedef int Fl_Internal_Thread_Id;
+
+static inline Fl_Internal_Thread_Id fl_thread_id() { return 0; }
+
+static inline int fl_thread_is_current(Fl_Internal_Thread_Id) { return 1; }
+
+static inline int fl_thread_cpu_count() { return 1; }
+
+#  endif // HAVE_PTHREAD
+
+/* Locks a mutex for the lifetime of this object. */
+class Fl_Internal_Lock {
+  Fl_Internal_Mutex &m_;
+  Fl_Internal_Lock(const Fl_Internal_Lock&);
+  Fl_Internal_Lock& operator=(const Fl_Internal_Lock&);
+public:
+  Fl_Internal_Lock(Fl_Internal_Mutex &m) : m_(m) { m_.lock(); }
+  ~Fl_Internal_Lock() { m_.unlock(); }
+};
+
+#endif /* !fl_threads_h */
+
+/*
+ * End of "$Id$".
+ */
@@ -0,0 +1,224 @@
+//
+// "$Id$"
+//
+// Fl_Help_View segmented layout test program for the Fast Light Tool Kit (FLTK).
+//
+// Fl_Help_View lays out only the parts of a document that are in view and
+// estimates the heights of the others. This program loads random documents
+// into several views and checks that
+//
+//   - the size of a document is the same after laying it out from the top
+//     down and from the bottom up,
+//   - the size does not change any more once the whole document was laid
+//     out,
+//   - find() returns the same positions in a view that laid out only the
+//     parts it searched and in one that laid out the whole document,
+//   - the targets of a document are at the same positions in both views,
+//     and in the order of the document.
+//
+// Usage: help_view_layout [-n documents] [-s seed]
+//
+// Copyright 1998-2018 by Bill Spitzak and others.
+//
+// This library is free software. Distribution and use rights are outlined in
+// the file "COPYING" which should have been included with this file.  If this
+// file is missing or damaged, see the license at:
+//
+//     http://www.fltk.org/COPYING.php
+//
+// Please report all bugs and problems on the following page:
+//
+//     http://www.fltk.org/str.php
+//
+
+#include <FL/Fl.H>
+#include <FL/Fl_Double_Window.H>
+#include <FL/Fl_Help_View.H>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int nerrors = 0;
+static int doc = 0;
+
+static void error(const char *msg, int a, int b) {
+  if (++nerrors <= 20)
+    printf("document %d: %s (%d, %d)\n", doc, msg, a, b);
+}
+
+// A growing string
+struct Text {
+  char *s;
+  int n, alloc;
+  Text() : s(0), n(0), alloc(0) {}
+  ~Text() { free(s); }
+  void add(const char *t) {
+    int l = (int)strlen(t);
+    if (n + l + 1 > alloc) {
+      alloc = alloc ? 2 * alloc : 4096;
+      while (n + l + 1 > alloc) alloc *= 2;
+      s = (char *)realloc(s, alloc);
+    }
+    memcpy(s + n, t, l + 1);
+    n += l;
+  }
+};
+
+static const char *words[] = {
+  "a", "the", "light", "toolkit", "window", "widget", "x", "layout",
+  "segment", "of", "and", "fast", "height", "estimate", "scroll", "in"
+};
+
+// Adds n random words, some of them in bold or in another size
+static void add_words(Text &t, int n) {
+  for (int i = 0; i < n; i++) {
+    switch (rand() % 16) {
+      case 0: t.add("<b>"); t.add(words[rand() % 16]); t.add("</b>"); break;
+      case 1: t.add("<font size=\"+2\">"); t.add(words[rand() % 16]); t.add("</font>"); break;
+      case 2: t.add("&amp;"); break;
+      default: t.add(words[rand() % 16]); break;
+    }
+    t.add(" ");
+  }
+}
+
+// Makes a random document with ntargets targets and nneedles words to find
+static void make_document(Text &t, int &ntargets, int &nneedles) {
+  char buf[64];
+  ntargets = nneedles = 0;
+  t.add("<html><body>\n");
+  int nblocks = 20 + rand() % 200;
+  for (int b = 0; b < nblocks; b++) {
+    switch (rand() % 10) {
+      case 0:				// heading with a target
+        sprintf(buf, "<h2><a name=\"t%d\">", ntargets++);
+        t.add(buf);
+        add_words(t, 1 + rand() % 4);
+        t.add("</a></h2>\n");
+        break;
+      case 1: {				// list
+        t.add("<ul>\n");
+        int n = 1 + rand() % 6;
+        for (int i = 0; i < n; i++) { t.add("<li>"); add_words(t, 1 + rand() % 12); t.add("\n"); }
+        t.add("</ul>\n");
+        break;
+      }
+      case 2: {				// preformatted lines
+        t.add("<pre>\n");
+        int n = 1 + rand() % 8;
+        for (int i = 0; i < n; i++) { add_words(t, rand() % 4); t.add("\n"); }
+        t.add("</pre>\n");
+        break;
+      }
+      case 3: {				// table of short cells
+        t.add("<table border=\"1\">\n");
+        int rows = 1 + rand() % 5, cols = 1 + rand() % 3;
+        for (int r = 0; r < rows; r++) {
+          t.add("<tr>");
+          for (int c = 0; c < cols; c++) { t.add("<td>"); add_words(t, 1 + rand() % 3); t.add("</td>"); }
+          t.add("</tr>\n");
+        }
+        t.add("</table>\n");
+        break;
+      }
+      case 4:				// paragraph with a word to find
+        t.add("<p>");
+        add_words(t, rand() % 20);
+        sprintf(buf, "needle%d ", nneedles++);
+        t.add(buf);
+        add_words(t, rand() % 20);
+        t.add("\n");
+        break;
+      case 5:				// comment and line breaks
+        t.add("<!-- a comment <p> that is skipped -->");
+        add_words(t, 1 + rand() % 6);
+        t.add("<br>\n");
+        break;
+      default:				// paragraph
+        t.add("<p>");
+        add_words(t, 1 + rand() % 60);
+        t.add("\n");
+        break;
+    }
+  }
+  t.add("</body></html>\n");
+}
+
+// Lays out the whole document by scrolling through it, and returns its size
+static int layout_all(Fl_Help_View *view, int down) {
+  int size = view->size();
+  for (int pass = 0; pass < 10; pass++) {
+    int step = view->h() / 2;
+    if (down) {
+      for (int top = 0; top <= view->size(); top += step) { view->topline(top); view->size(); }
+    } else {
+      for (int top = view->size(); top >= 0; top -= step) { view->topline(top); view->size(); }
+      view->topline(0);
+    }
+    if (pass > 0 && view->size() == size) return size;
+    size = view->size();
+  }
+  error("size changes after laying out the whole document", size, view->size());
+  return size;
+}
+
+int main(int argc, char **argv) {
+  int ndocs = 100;
+  unsigned seed = 1;
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "-n") && i + 1 < argc) ndocs = atoi(argv[++i]);
+    else if (!strcmp(argv[i], "-s") && i + 1 < argc) seed = (unsigned)atoi(argv[++i]);
+    else {
+      fprintf(stderr, "Usage: help_view_layout [-n documents] [-s seed]\n");
+      return 1;
+    }
+  }
+  srand(seed);
+
+  Fl_Double_Window win(900, 300, "help_view_layout");
+  Fl_Help_View down(0, 0, 300, 300);	// laid out from the top down
+  Fl_Help_View up(300, 0, 300, 300);	// laid out from the bottom up
+  Fl_Help_View lazy(600, 0, 300, 300);	// laid out only where searched
+  win.end();
+
+  char buf[64];
+  for (doc = 1; doc <= ndocs && nerrors == 0; doc++) {
+    Text t;
+    int ntargets, nneedles;
+    make_document(t, ntargets, nneedles);
+    down.value(t.s);
+    up.value(t.s);
+    lazy.value(t.s);
+
+    int dsize = layout_all(&down, 1);
+    int usize = layout_all(&up, 0);
+    if (dsize != usize) error("sizes differ when laid out from the top and the bottom", dsize, usize);
+    layout_all(&down, 0);
+    if (down.size() != dsize) error("size changes when laid out again", dsize, down.size());
+
+    for (int i = 0; i < nneedles; i++) {
+      sprintf(buf, "needle%d", i);
+      int p = lazy.find(buf, 0);
+      int q = down.find(buf, 0);
+      if (p != q || p < 0) error("find() positions differ", p, q);
+    }
+    if (lazy.find("no such needle", 0) != -1) error("found a word that is not there", 0, 0);
+
+    int last = 0;
+    for (int i = 0; i < ntargets; i++) {
+      sprintf(buf, "t%d", i);
+      down.topline(buf);
+      up.topline(buf);
+      if (down.topline() != up.topline()) error("target positions differ", down.topline(), up.topline());
+      if (down.topline() < last) error("targets are out of order", last, down.topline());
+      last = down.topline();
+    }
+  }
+
+  printf("help_view_layout: %d documents, %d errors\n", doc - 1, nerrors);
+  return nerrors ? 1 : 0;
+}
+
+//
+// End of "$Id$".
+//
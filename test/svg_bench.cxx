@@ -0,0 +1,184 @@
+//
+// "$Id$"
+//
+// SVG rasterization benchmark for the Fast Light Tool Kit (FLTK).
+//
+// Rasterizes SVG images with one thread and with several threads,
+// prints the timings and checks that both results are identical.
+//
+// Usage: svg_bench [-s size] [-t threads] [file.svg|directory ...]
+//
+// Without file or directory arguments the SVG files in the current
+// directory and in ../documentation/src are used, in addition to a
+// generated test image.
+//
+// Copyright 1998-2018 by Bill Spitzak and others.
+//
+// This library is free software. Distribution and use rights are outlined in
+// the file "COPYING" which should have been included with this file.  If this
+// file is missing or damaged, see the license at:
+//
+//     http://www.fltk.org/COPYING.php
+//
+// Please report all bugs and problems on the following page:
+//
+//     http://www.fltk.org/str.php
+//
+
+#include <config.h>
+#include <FL/Fl.H>
+#include <FL/filename.H>
+#include <FL/fl_utf8.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if !defined(FLTK_USE_NANOSVG)
+
+int main(int, char**) {
+  fprintf(stderr, "svg_bench: FLTK was built without SVG support.\n");
+  return 1;
+}
+
+#else
+
+#include <FL/Fl_SVG_Image.H>
+
+#ifdef _WIN32
+#  include <windows.h>
+static double now() { return GetTickCount() / 1000.0; }
+#else
+#  include <sys/time.h>
+static double now() {
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+#endif
+
+static int nfailed = 0;
+static int nthreads = 0; // default of Fl_SVG_Image::raster_threads()
+
+// Builds a map-like image with many filled and stroked shapes
+static char *make_test_svg() {
+  int size = 256 * 1024;
+  char *svg = (char*)malloc(size);
+  int n = snprintf(svg, size,
+    "<svg viewBox=\"0 0 1000 1000\" width=\"1000\" height=\"1000\" "
+    "xmlns=\"http://www.w3.org/2000/svg\">\n"
+    "<defs><linearGradient id=\"g\" x1=\"0\" y1=\"0\" x2=\"1\" y2=\"1\">"
+    "<stop offset=\"0\" stop-color=\"#2060a0\"/><stop offset=\"1\" stop-color=\"#a0e0ff\"/>"
+    "</linearGradient></defs>\n"
+    "<rect width=\"1000\" height=\"1000\" fill=\"url(#g)\"/>\n");
+  srand(1);
+  for (int i = 0; i < 600 && n < size - 512; i++) {
+    int x = rand() % 1000, y = rand() % 1000, r = 5 + rand() % 60;
+    switch (i % 3) {
+      case 0:
+        n += snprintf(svg + n, size - n,
+          "<circle cx=\"%d\" cy=\"%d\" r=\"%d\" fill=\"#%06x\" fill-opacity=\"0.6\"/>\n",
+          x, y, r, rand() & 0xffffff);
+        break;
+      case 1:
+        n += snprintf(svg + n, size - n,
+          "<path d=\"M%d %d Q%d %d %d %d T%d %d\" stroke=\"#%06x\" stroke-width=\"%d\" "
+          "fill=\"none\" stroke-linejoin=\"round\"/>\n",
+          x, y, x + r, y - 2 * r, x + 2 * r, y, x + 4 * r, y + r, rand() & 0xffffff, 1 + r / 10);
+        break;
+      default:
+        n += snprintf(svg + n, size - n,
+          "<polygon points=\"%d,%d %d,%d %d,%d %d,%d\" fill=\"#%06x\" "
+          "stroke=\"black\" fill-rule=\"evenodd\"/>\n",
+          x, y, x + r, y + 2 * r, x - r, y + r, x + 2 * r, y - r, rand() & 0xffffff);
+        break;
+    }
+  }
+  snprintf(svg + n, size - n, "</svg>\n");
+  return svg;
+}
+
+// Rasterizes svg to the given size, returns the time in seconds
+static double rasterize(Fl_SVG_Image *svg, int size, int threads) {
+  Fl_SVG_Image::raster_threads(threads);
+  double t = now();
+  svg->resize(size, size);
+  return now() - t;
+}
+
+static void bench(const char *name, Fl_SVG_Image *svg, int size) {
+  if (svg->fail()) {
+    printf("%-32s cannot be loaded\n", name);
+    return;
+  }
+  Fl_SVG_Image *svg1 = (Fl_SVG_Image*)svg->copy();
+  Fl_SVG_Image *svg2 = (Fl_SVG_Image*)svg->copy();
+  double t1 = rasterize(svg1, size, 1);
+  double t2 = rasterize(svg2, size, nthreads);
+  int same = (svg1->w() == svg2->w() && svg1->h() == svg2->h() &&
+              !memcmp(svg1->array, svg2->array, svg1->w() * svg1->h() * 4));
+  if (!same) nfailed++;
+  printf("%-32s %5d x %-5d %9.1f ms %9.1f ms %6.2fx  %s\n", name, svg1->w(), svg1->h(),
+         t1 * 1000, t2 * 1000, t2 > 0 ? t1 / t2 : 0, same ? "identical" : "DIFFERENT");
+  delete svg1;
+  delete svg2;
+}
+
+static void bench_path(const char *path, int size, int explicit_arg) {
+  if (!fl_filename_isdir(path)) {
+    Fl_SVG_Image svg(path);
+    bench(fl_filename_name(path), &svg, size);
+    return;
+  }
+  dirent **files;
+  int n = fl_filename_list(path, &files);
+  if (n < 0) {
+    if (explicit_arg) printf("%s: cannot read directory\n", path);
+    return;
+  }
+  for (int i = 0; i < n; i++) {
+    if (fl_filename_match(files[i]->d_name, "*.{svg,svgz}")) {
+      char file[FL_PATH_MAX];
+      snprintf(file, sizeof(file), "%s/%s", path, files[i]->d_name);
+      Fl_SVG_Image svg(file);
+      bench(files[i]->d_name, &svg, size);
+    }
+  }
+  fl_filename_free_list(&files, n);
+}
+
+int main(int argc, char **argv) {
+  int size = 2048;
+  int first = 1;
+  while (first + 1 < argc && argv[first][0] == '-') {
+    if (!strcmp(argv[first], "-s")) size = atoi(argv[first + 1]);
+    else if (!strcmp(argv[first], "-t")) nthreads = atoi(argv[first + 1]);
+    else size = 0;
+    if (size <= 0 || nthreads < 0) {
+      fprintf(stderr, "Usage: svg_bench [-s size] [-t threads] [file.svg|directory ...]\n");
+      return 1;
+    }
+    first += 2;
+  }
+  Fl_SVG_Image::raster_cache_limit(0); // measure rasterization only
+
+  printf("%-32s %-13s %12s %12s %7s\n", "image", "size", "1 thread", "threads", "speedup");
+  char *data = make_test_svg();
+  Fl_SVG_Image generated(NULL, data);
+  free(data);
+  bench("(generated)", &generated, size);
+
+  if (first >= argc) {
+    bench_path(".", size, 0);
+    bench_path("../documentation/src", size, 0);
+  } else {
+    for (int i = first; i < argc; i++) bench_path(argv[i], size, 1);
+  }
+  if (nfailed) printf("%d image(s) differ!\n", nfailed);
+  return nfailed ? 1 : 0;
+}
+
+#endif // FLTK_USE_NANOSVG
+
+//
+// End of "$Id$".
+//
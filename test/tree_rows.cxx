@@ -0,0 +1,188 @@
+//
+// "$Id$"
+//
+// Fl_Tree displayed rows test program for the Fast Light Tool Kit (FLTK).
+//
+// Changes an Fl_Tree with random insert, remove, open, close, label,
+// widget and showroot operations, and checks after each step that
+//
+//   - the tree's displayed rows are the items found by walking the tree,
+//   - the positions of the rows that were updated incrementally are the
+//     same as after recalculating the whole tree,
+//   - the widgets of the items are where the items are, even if the
+//     items were never drawn.
+//
+// Usage: tree_rows [-n steps] [-s seed]
+//
+// Copyright 1998-2018 by Bill Spitzak and others.
+//
+// This library is free software. Distribution and use rights are outlined in
+// the file "COPYING" which should have been included with this file.  If this
+// file is missing or damaged, see the license at:
+//
+//     http://www.fltk.org/COPYING.php
+//
+// Please report all bugs and problems on the following page:
+//
+//     http://www.fltk.org/str.php
+//
+
+#include <FL/Fl.H>
+#include <FL/Fl_Double_Window.H>
+#include <FL/Fl_Tree.H>
+#include <FL/Fl_Box.H>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int nerrors = 0;
+static int step = 0;
+
+static void error(const char *msg, const Fl_Tree_Item *item) {
+  if (++nerrors <= 20)
+    printf("step %d: %s (%s)\n", step, msg, item && item->label() ? item->label() : "-");
+}
+
+// A growing list of items
+struct Item_List {
+  Fl_Tree_Item **items;
+  int n, alloc;
+  Item_List() : items(0), n(0), alloc(0) {}
+  ~Item_List() { free(items); }
+  void add(Fl_Tree_Item *item) {
+    if (n >= alloc) {
+      alloc = alloc ? 2 * alloc : 256;
+      items = (Fl_Tree_Item **)realloc(items, alloc * sizeof(Fl_Tree_Item *));
+    }
+    items[n++] = item;
+  }
+};
+
+// The items that should be displayed: the open and visible ones
+static void walk(Fl_Tree *tree, Fl_Tree_Item *item, Item_List &list) {
+  if (!item->is_visible()) return;
+  if (!item->is_root() || tree->showroot()) list.add(item);
+  if (item->is_open())
+    for (int t = 0; t < item->children(); t++)
+      walk(tree, item->child(t), list);
+}
+
+// Check the tree's rows, and the positions of its items and widgets
+static void check(Fl_Tree *tree) {
+  Item_List expect, rows;
+  walk(tree, tree->root(), expect);
+  tree->displayed(tree->first());	// update the rows
+  // Remember the widget positions now: they must not change when the
+  // items are positioned one by one below
+  int *wy = new int[expect.n + 1];
+  int t;
+  for (t = 0; t < expect.n; t++)
+    wy[t] = expect.items[t]->widget() ? expect.items[t]->widget()->y() : 0;
+  for (Fl_Tree_Item *i = tree->next_item(0, FL_Down, true); i; i = tree->next_item(i, FL_Down, true))
+    rows.add(i);
+  if (rows.n != expect.n) {
+    char msg[80];
+    sprintf(msg, "%d rows instead of %d", rows.n, expect.n);
+    error(msg, 0);
+  }
+  int *y = new int[expect.n + 1];
+  for (t = 0; t < expect.n; t++) {
+    Fl_Tree_Item *item = expect.items[t];
+    if (t < rows.n && rows.items[t] != item) { error("wrong row", item); break; }
+    tree->displayed(item);
+    y[t] = item->y();
+    if (t > 0 && y[t] < y[t-1] + expect.items[t-1]->h()) error("rows overlap", item);
+    if (item->widget() && item->widget()->y() != wy[t]) error("widget was not moved", item);
+  }
+  // Compare with the positions after recalculating all rows
+  tree->calc_tree();
+  for (t = 0; t < expect.n; t++) {
+    tree->displayed(expect.items[t]);
+    if (expect.items[t]->y() != y[t]) { error("incremental position differs", expect.items[t]); break; }
+  }
+  delete[] y;
+  delete[] wy;
+}
+
+// All items of the tree, displayed or not
+static void all_items(Fl_Tree *tree, Item_List &list) {
+  for (Fl_Tree_Item *i = tree->first(); i; i = tree->next(i))
+    list.add(i);
+}
+
+int main(int argc, char **argv) {
+  int nsteps = 2000;
+  unsigned seed = 1;
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "-n") && i + 1 < argc) nsteps = atoi(argv[++i]);
+    else if (!strcmp(argv[i], "-s") && i + 1 < argc) seed = (unsigned)atoi(argv[++i]);
+    else {
+      fprintf(stderr, "Usage: tree_rows [-n steps] [-s seed]\n");
+      return 1;
+    }
+  }
+  srand(seed);
+
+  Fl_Double_Window win(300, 400, "tree_rows");
+  Fl_Tree tree(0, 0, 300, 400);
+  tree.root_label("root");
+  win.end();
+
+  char name[64];
+  int nitems = 0;
+  for (int i = 0; i < 50; i++) {
+    sprintf(name, "item %d", nitems++);
+    tree.add(name);
+  }
+  check(&tree);
+
+  for (step = 1; step <= nsteps && nerrors == 0; step++) {
+    Item_List items;
+    all_items(&tree, items);
+    Fl_Tree_Item *item = items.items[rand() % items.n];
+    switch (rand() % 8) {
+      case 0:				// insert children
+      case 1: {
+        int n = 1 + rand() % 4;
+        for (int i = 0; i < n; i++) {
+          sprintf(name, "item %d", nitems++);
+          tree.insert(item, name, rand() % (item->children() + 1));
+        }
+        break;
+      }
+      case 2:				// remove an item with its children
+        if (!item->is_root()) tree.remove(item);
+        break;
+      case 3:				// open or close
+      case 4:
+        if (item->is_open()) tree.close(item, 0);
+        else tree.open(item, 0);
+        break;
+      case 5:				// change the label's width
+        sprintf(name, "%s%s", item->label() ? item->label() : "", rand() % 2 ? " wider" : "");
+        item->label(rand() % 2 ? name : "x");
+        break;
+      case 6:				// add a widget
+        if (!item->widget()) {
+          tree.begin();
+          Fl_Box *box = new Fl_Box(0, 0, 40, 10 + rand() % 20, "W");
+          tree.end();
+          item->widget(box);
+        }
+        break;
+      case 7:				// show or hide the root
+        if (rand() % 8 == 0) tree.showroot(!tree.showroot());
+        break;
+    }
+    check(&tree);
+  }
+
+  Item_List items;
+  all_items(&tree, items);
+  printf("tree_rows: %d steps, %d items, %d errors\n", step - 1, items.n, nerrors);
+  return nerrors ? 1 : 0;
+}
+
+//
+// End of "$Id$".
+//